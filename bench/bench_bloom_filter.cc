@@ -0,0 +1,852 @@
+/**
+ * @file bench_bloom_filter.cc
+ * @brief Bloom filter に対するベンチマーク．
+ *
+ * 結果をビルド間で比較する場合は JSON 形式で出力する．
+ * @code
+ * $ ./bench_simplebf --benchmark_out=result.json --benchmark_out_format=json
+ * @endcode
+ */
+
+#include <benchmark/benchmark.h>
+#include "simplebf/util.h"
+#include "simplebf/bloom_filter.h"
+#include "simplebf/bit_sliced_index.h"
+#include "simplebf/checkpoint_bloom_filter.h"
+#include "simplebf/concurrent_bloom_filter.h"
+#include "simplebf/filter_arena.h"
+#include "simplebf/filter_holder.h"
+#include "simplebf/logged_bloom_filter.h"
+#include "simplebf/replicated_bloom_filter.h"
+#include "simplebf/snapshot_bloom_filter.h"
+#include "simplebf/static_bloom_filter.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/** ベンチマークで使う要素数． */
+constexpr std::size_t kNumKeys = 1 << 16;
+
+/** 要素生成に使う乱数シード． */
+constexpr std::uint64_t kSeed = 12345;
+
+/** 偽陽性テスト用の要素生成に使う乱数シード． */
+constexpr std::uint64_t kMissSeed = 67890;
+
+/** 判定に使う要素を選ぶ乱数シード． */
+constexpr std::uint64_t kSampleSeed = 13579;
+
+/** フィルタに追加する要素1個あたりのフィルタ用配列のビット数． */
+constexpr std::size_t kBitsPerKey = 10;
+
+/**
+ * 追加と判定のベンチマークで使う要素数．
+ *
+ * 要素が触れるフィルタ用配列のキャッシュラインが LLC に収まらないように十分大きくする．
+ */
+constexpr std::size_t kNumQueryKeys = 1 << 20;
+
+/** ランダムな文字列に使う文字． */
+constexpr char kKeyChars[] =
+  "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/**
+ * 指定された長さのランダムな文字列を生成する．
+ *
+ * @param[in] length 文字列の長さ
+ * @param[in,out] rnd 乱数生成器
+ * @return ランダムな文字列
+ */
+std::string RandomString(std::size_t length, std::mt19937_64& rnd) {
+  std::uniform_int_distribution<std::size_t> dist(0, sizeof(kKeyChars) - 2);
+  std::string str(length, '\0');
+  for (auto&& c : str) {
+    c = kKeyChars[dist(rnd)];
+  }
+  return str;
+}
+
+/**
+ * ベンチマーク用の要素を生成する．
+ *
+ * @tparam T 要素の型
+ * @param[in] size 要素数
+ * @param[in] length 文字列の長さ（T が std::string の場合のみ使う）
+ * @param[in] seed 乱数シード
+ * @return 要素を並べたベクトル
+ */
+template <class T>
+std::vector<T> GenerateKeys(std::size_t size, std::size_t length,
+    std::uint64_t seed) {
+  std::mt19937_64 rnd(seed);
+  std::vector<T> keys(size);
+  for (auto&& key : keys) {
+    if constexpr (std::is_same<T, std::string>::value) {
+      key = RandomString(length, rnd);
+    }
+    else {
+      key = static_cast<T>(rnd());
+    }
+  }
+  return keys;
+}
+
+/**
+ * splitmix64 の撹拌関数により64ビット値を撹拌する．
+ *
+ * @param[in] x 値
+ * @return 撹拌した値
+ */
+std::uint64_t Mix64(std::uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/**
+ * 番号から決まる要素を求める．
+ *
+ * 数値の場合は番号を撹拌した値とする．<br>
+ * 文字列の場合は，key の先頭を番号を撹拌した値の62進表記で置き換える．
+ * key には GenerateKeys() で生成した1個の文字列を与えておく．<br>
+ * 要素をすべて保持せずに，大きなフィルタにも配列サイズに見合う個数の要素を追加するために使う．
+ *
+ * @tparam T 要素の型
+ * @param[in] index 要素の番号
+ * @param[in] seed 乱数シード
+ * @param[in,out] key 要素
+ */
+template <class T>
+void KeyAt(std::uint64_t index, std::uint64_t seed, T& key) {
+  std::uint64_t value = Mix64(index ^ Mix64(seed));
+  if constexpr (std::is_same<T, std::string>::value) {
+    for (std::size_t i = 0; i < key.size() && value != 0; i++) {
+      key[i] = kKeyChars[value % (sizeof(kKeyChars) - 1)];
+      value /= sizeof(kKeyChars) - 1;
+    }
+  }
+  else {
+    key = static_cast<T>(value);
+  }
+}
+
+/**
+ * 番号が 0 から num_indices - 1 の要素から，ランダムに kNumQueryKeys 個を選ぶ．
+ *
+ * @tparam T 要素の型
+ * @param[in] num_indices 要素の個数
+ * @param[in] length 文字列の長さ（T が std::string の場合のみ使う）
+ * @param[in] seed 要素を求める乱数シード
+ * @return 選んだ要素を並べたベクトル
+ */
+template <class T>
+std::vector<T> SampleKeys(std::uint64_t num_indices, std::size_t length, std::uint64_t seed) {
+  std::vector<T> keys(kNumQueryKeys, GenerateKeys<T>(1, length, seed)[0]);
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    KeyAt(Mix64(i ^ kSampleSeed) % num_indices, seed, keys[i]);
+  }
+  return keys;
+}
+
+/**
+ * 配列サイズの kBitsPerKey 分の1個の要素を追加したフィルタを返す．
+ *
+ * 追加する要素は，番号が 0 から個数 - 1 の KeyAt() の要素とする．<br>
+ * 大きなフィルタでは追加に時間がかかるため，同じ引数で続けて呼び出された場合は前回のフィルタを返す．
+ *
+ * @tparam T 要素の型
+ * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+ * @param[in] num_hashes ハッシュ関数の個数
+ * @param[in] length 文字列の長さ（T が std::string の場合のみ使う）
+ * @return フィルタ
+ */
+template <class T>
+const sbf::BloomFilter<T>& FilledFilter(std::size_t log2_num_bits, std::size_t num_hashes,
+    std::size_t length) {
+  static std::unique_ptr<sbf::BloomFilter<T>> bf;
+  static std::size_t filled_length = 0;
+  if (!bf || bf->Log2NumBits() != log2_num_bits || bf->NumHashes() != num_hashes
+      || filled_length != length) {
+    bf.reset();
+    bf = std::make_unique<sbf::BloomFilter<T>>(log2_num_bits, num_hashes);
+    filled_length = length;
+    T key = GenerateKeys<T>(1, length, kSeed)[0];
+    for (std::size_t i = 0; i < bf->NumBits() / kBitsPerKey; i++) {
+      KeyAt(i, kSeed, key);
+      bf->Insert(key);
+    }
+  }
+  return *bf;
+}
+
+/** 小さなフィルタのベンチマークで使う BloomFilter の型． */
+using SmallBloomFilter = sbf::BloomFilter<unsigned long>;
+
+/** 小さなフィルタのベンチマークで使う StaticBloomFilter の型． */
+using SmallStaticBloomFilter = sbf::StaticBloomFilter<unsigned long, 12, 6>;
+
+/**
+ * 小さなフィルタのベンチマークで使うフィルタを返す．
+ *
+ * @tparam Filter フィルタの型
+ * @return フィルタ
+ */
+template <class Filter>
+Filter MakeSmallFilter() {
+  if constexpr (std::is_same<Filter, SmallBloomFilter>::value) {
+    return Filter(12, 6);
+  }
+  else {
+    return Filter();
+  }
+}
+
+/**
+ * 複数スレッドでの判定のベンチマークで使うフィルタを返す．
+ *
+ * フィルタ用配列は 128MB とし，ハッシュ関数は4個とする．<br>
+ * 全スレッドで共有するため，最初のスレッドが作成して各スレッドに同じものを返す．
+ *
+ * @tparam Filter フィルタの型
+ * @return フィルタ
+ */
+template <class Filter>
+Filter& SharedLargeFilter() {
+  static Filter bf(30, 4);
+  return bf;
+}
+
+/**
+ * 要素を追加する速度を計測する．
+ *
+ * 引数は順に，フィルタ用配列サイズのビット数の底2による対数値，
+ * ハッシュ関数の個数，文字列の長さ．<br>
+ * 大きなフィルタでもキャッシュに収まらないように，kNumQueryKeys 個の異なる要素を順に追加する．
+ *
+ * @tparam T 要素の型
+ * @param[in,out] state ベンチマークの状態
+ */
+template <class T>
+void BM_Insert(benchmark::State& state) {
+  const auto& keys = SampleKeys<T>(std::numeric_limits<std::uint64_t>::max(),
+    state.range(2), kSeed);
+  sbf::BloomFilter<T> bf(state.range(0), state.range(1));
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    bf.Insert(keys[i]);
+    i = (i + 1) & (kNumQueryKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * 追加済みの要素を判定する速度を計測する．
+ *
+ * 引数は BM_Insert() と同じ．<br>
+ * 配列サイズの kBitsPerKey 分の1個の要素を追加したフィルタで，
+ * 追加した要素からランダムに選んだ kNumQueryKeys 個を判定する．
+ *
+ * @tparam T 要素の型
+ * @param[in,out] state ベンチマークの状態
+ */
+template <class T>
+void BM_ContainsHit(benchmark::State& state) {
+  const auto& bf = FilledFilter<T>(state.range(0), state.range(1), state.range(2));
+  const auto& keys = SampleKeys<T>(bf.NumBits() / kBitsPerKey, state.range(2), kSeed);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bf.Contains(keys[i]));
+    i = (i + 1) & (kNumQueryKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * 追加されていない要素を判定する速度を計測する．
+ *
+ * 引数は BM_Insert() と同じ．<br>
+ * BM_ContainsHit() と同じフィルタで，追加していない kNumQueryKeys 個の要素を判定する．
+ *
+ * @tparam T 要素の型
+ * @param[in,out] state ベンチマークの状態
+ */
+template <class T>
+void BM_ContainsMiss(benchmark::State& state) {
+  const auto& bf = FilledFilter<T>(state.range(0), state.range(1), state.range(2));
+  const auto& challenges = SampleKeys<T>(std::numeric_limits<std::uint64_t>::max(),
+    state.range(2), kMissSeed);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bf.Contains(challenges[i]));
+    i = (i + 1) & (kNumQueryKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * djb2 によるハッシュ値の計算速度を計測する．
+ *
+ * 引数は文字列の長さ．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_Djb2(benchmark::State& state) {
+  const auto& keys = GenerateKeys<std::string>(kNumKeys, state.range(0), kSeed);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sbf::hash::Djb2(keys[i]));
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+/**
+ * 複数のハッシュ値の計算速度を計測する．
+ *
+ * 引数は順に，ハッシュ関数の個数，文字列の長さ．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_Hash(benchmark::State& state) {
+  const auto& keys = GenerateKeys<std::string>(kNumKeys, state.range(1), kSeed);
+  sbf::BloomFilter<std::string> bf(20, state.range(0));
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bf.Hash(keys[i]));
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * 同じ要素を多数のフィルタで判定する速度を計測する．
+ *
+ * 引数は順に，フィルタの個数，文字列の長さ，計算済みのハッシュ値を使うか (0 または 1)．<br>
+ * 各フィルタの配列サイズは異なる．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_ProbeFilters(benchmark::State& state) {
+  const auto& keys = GenerateKeys<std::string>(kNumKeys, state.range(1), kSeed);
+  std::vector<sbf::BloomFilter<std::string>> filters;
+  for (std::int64_t i = 0; i < state.range(0); i++) {
+    filters.emplace_back(14 + i % 8, 4);
+  }
+  bool hashed = state.range(2) != 0;
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    if (hashed) {
+      auto key = sbf::BloomFilter<std::string>::HashKey(keys[i]);
+      for (auto&& bf : filters) {
+        benchmark::DoNotOptimize(bf.Contains(key));
+      }
+    }
+    else {
+      for (auto&& bf : filters) {
+        benchmark::DoNotOptimize(bf.Contains(keys[i]));
+      }
+    }
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/**
+ * 要素を含む可能性があるシャードを求める速度を計測する．
+ *
+ * 引数は順に，シャード数，ビットスライス索引を使うか (0 または 1)．<br>
+ * 索引を使わない場合はシャードごとの BloomFilter を順に判定する．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_RouteShards(benchmark::State& state) {
+  constexpr std::size_t kLog2NumBits = 16;
+  constexpr std::size_t kNumHashes = 4;
+  constexpr std::size_t kEntriesPerShard = 64;
+  std::size_t num_shards = state.range(0);
+  bool sliced = state.range(1) != 0;
+  const auto& keys = GenerateKeys<std::string>(kNumKeys, 16, kSeed);
+
+  std::vector<sbf::BloomFilter<std::string>> filters;
+  sbf::BitSlicedIndex<std::string> index(sliced ? num_shards : 0, kLog2NumBits, kNumHashes);
+  for (std::size_t shard = 0; shard < num_shards; shard++) {
+    sbf::BloomFilter<std::string> bf(kLog2NumBits, kNumHashes);
+    for (std::size_t i = 0; i < kEntriesPerShard; i++) {
+      bf.Insert(keys[(shard * kEntriesPerShard + i) & (kNumKeys - 1)]);
+    }
+    if (sliced) {
+      index.AddFilter(shard, bf);
+    }
+    else {
+      filters.push_back(std::move(bf));
+    }
+  }
+
+  std::vector<std::uint64_t> candidates;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    if (sliced) {
+      benchmark::DoNotOptimize(index.Query(keys[i], candidates));
+    }
+    else {
+      auto key = sbf::BloomFilter<std::string>::HashKey(keys[i]);
+      candidates.assign((num_shards + 63) / 64, 0);
+      for (std::size_t shard = 0; shard < num_shards; shard++) {
+        candidates[shard >> 6] |= std::uint64_t{filters[shard].Contains(key)} << (shard & 63);
+      }
+      benchmark::DoNotOptimize(candidates.data());
+    }
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * ストリームからフィルタを読み込む速度を計測する．
+ *
+ * 引数は順に，充填率 [%]，圧縮するか (0 または 1)．<br>
+ * フィルタ用配列サイズは 2^24 ビットとする．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_Load(benchmark::State& state) {
+  sbf::BloomFilter<unsigned long> bf(24, 1);
+  std::size_t num_entries = static_cast<std::size_t>(
+    -std::log(1 - state.range(0) / 100.0) * bf.NumBits());
+  for (auto&& key : GenerateKeys<unsigned long>(num_entries, 0, kSeed)) {
+    bf.Insert(key);
+  }
+  std::stringstream ss;
+  if (state.range(1) != 0) {
+    bf.SaveCompressed(ss);
+  }
+  else {
+    bf.Save(ss);
+  }
+  std::string serialized = ss.str();
+
+  sbf::BloomFilter<unsigned long> loaded;
+  for (auto _ : state) {
+    std::istringstream in(serialized);
+    benchmark::DoNotOptimize(loaded.Load(in));
+  }
+  state.SetBytesProcessed(state.iterations() * bf.NumWords() * 8);
+  state.counters["serialized_bytes"] = serialized.size();
+}
+
+/**
+ * 小さなフィルタで判定する速度を計測する．
+ *
+ * 配列サイズ 2^12 ビット，ハッシュ関数 6 個のフィルタを，
+ * 実行時にパラメータを与える BloomFilter とコンパイル時に固定した StaticBloomFilter で比べる．<br>
+ * 位置の計算と判定の差を見るため，ハッシュ値は事前に計算しておく．
+ *
+ * @tparam Filter フィルタの型
+ * @param[in,out] state ベンチマークの状態
+ */
+template <class Filter>
+void BM_SmallFilterContains(benchmark::State& state) {
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  std::vector<sbf::HashedKey> hashed_keys;
+  for (auto&& key : keys) {
+    hashed_keys.push_back(Filter::HashKey(key));
+  }
+  Filter bf = MakeSmallFilter<Filter>();
+  for (std::size_t i = 0; i < 256; i++) {
+    bf.Insert(hashed_keys[i]);
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bf.Contains(hashed_keys[i]));
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * 複数スレッドから大きなフィルタを判定する速度を計測する．
+ *
+ * 1個の配列を共有する ConcurrentBloomFilter と，NUMA ノードごとに複製を持つ
+ * ReplicatedBloomFilter で比べる．<br>
+ * 複数ソケットのマシンでは，前者は半数程度のスレッドがリモートメモリを読む．
+ *
+ * @tparam Filter フィルタの型
+ * @param[in,out] state ベンチマークの状態
+ */
+template <class Filter>
+void BM_ParallelContains(benchmark::State& state) {
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  std::vector<sbf::HashedKey> hashed_keys;
+  for (auto&& key : keys) {
+    hashed_keys.push_back(Filter::HashKey(key));
+  }
+  Filter& bf = SharedLargeFilter<Filter>();
+  if (state.thread_index() == 0) {
+    for (std::size_t i = 0; i < kNumKeys; i += 2) {
+      bf.Insert(hashed_keys[i]);
+    }
+  }
+
+  std::size_t i = state.thread_index() * 4099;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bf.Contains(hashed_keys[i]));
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * 先行書き込みログに記録しながら要素を追加する速度を計測する．
+ *
+ * 引数は方法 (0: BloomFilter に追加する，1: LoggedBloomFilter に追加してログを group commit する)．<br>
+ * 後者は計測の最後に Sync() を呼び出し，すべての記録の同期を待つ時間も含める．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_LoggedInsert(benchmark::State& state) {
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  std::vector<sbf::HashedKey> hashed_keys;
+  for (auto&& key : keys) {
+    hashed_keys.push_back(sbf::BloomFilter<unsigned long>::HashKey(key));
+  }
+  std::string path = "bench_logged.bin";
+  sbf::BloomFilter<unsigned long> bf(24, 4);
+  sbf::LoggedBloomFilter<unsigned long> logged_bf(24, 4);
+  if (state.range(0) == 1 && !logged_bf.Open(path)) {
+    state.SkipWithError("Failed to open the log.");
+    return;
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    if (state.range(0) == 0) {
+      bf.Insert(hashed_keys[i]);
+    }
+    else {
+      logged_bf.Insert(hashed_keys[i]);
+    }
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  if (state.range(0) == 1) {
+    logged_bf.Sync();
+  }
+  state.SetItemsProcessed(state.iterations());
+  logged_bf.Close();
+  std::remove(path.c_str());
+  std::remove((path + ".log").c_str());
+}
+
+/**
+ * 複数のスレッドで FilterHolder を介して判定する速度を計測する．
+ *
+ * 引数は方法 (0: BloomFilter で直接判定する，1: FilterHolder を介して判定する)．<br>
+ * 両者の差がハザードレコードの占有と解除の費用となる．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_HolderContains(benchmark::State& state) {
+  using bf_t = sbf::BloomFilter<unsigned long>;
+  static sbf::FilterHolder<bf_t> holder(std::make_unique<bf_t>(24, 4));
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  sbf::FilterHolder<bf_t>::ReadGuard guard(holder);
+  const bf_t& bf = *guard.Get();
+
+  std::size_t i = state.thread_index() * 4099;
+  for (auto _ : state) {
+    if (state.range(0) == 0) {
+      benchmark::DoNotOptimize(bf.Contains(keys[i]));
+    }
+    else {
+      benchmark::DoNotOptimize(holder.Contains(keys[i]));
+    }
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * 要素を追加したフィルタをファイルに永続化する処理時間を計測する．
+ *
+ * 引数は順に，フィルタ用配列サイズのビット数の底2による対数値，
+ * 方法 (0: WriteFilterFile() で全体を書き出す，1: CheckpointBloomFilter::Checkpoint() で変更したチャンクのみを書き出す)．<br>
+ * 書き出すたびに 64 個の要素を追加する．大きなフィルタでは，変更したチャンクは一部に留まる．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_Checkpoint(benchmark::State& state) {
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  std::string path = "bench_checkpoint.bin";
+  sbf::CheckpointBloomFilter<unsigned long> bf(state.range(0), 4);
+  bf.Checkpoint(path);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    for (std::size_t j = 0; j < 64; j++) {
+      bf.Insert(keys[i]);
+      i = (i + 1) & (kNumKeys - 1);
+    }
+    if (state.range(1) == 0) {
+      sbf::FilterHeader header;
+      header.log2_num_bits = bf.Log2NumBits();
+      header.num_hashes = bf.NumHashes();
+      header.size = bf.Size();
+      benchmark::DoNotOptimize(sbf::WriteFilterFile(path, header, bf.Data()));
+    }
+    else {
+      benchmark::DoNotOptimize(bf.Checkpoint(path));
+    }
+  }
+  std::remove(path.c_str());
+}
+
+/**
+ * 追加を続けるフィルタのある時点の内容を保持する処理時間を計測する．
+ *
+ * 引数は順に，フィルタ用配列サイズのビット数の底2による対数値，
+ * 方法 (0: BloomFilter を複製する，1: SnapshotBloomFilter::Snapshot() を取る)．<br>
+ * 共有したページの複製の費用も含めるため，保持するたびに 64 個の要素を追加する．<br>
+ * 追加した要素数に比べてページ数が十分に多い場合，複製するページは一部に留まる．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_Snapshot(benchmark::State& state) {
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  sbf::BloomFilter<unsigned long> bf(state.range(0), 4);
+  sbf::SnapshotBloomFilter<unsigned long> snapshot_bf(state.range(0), 4);
+  for (auto&& key : keys) {
+    bf.Insert(key);
+    snapshot_bf.Insert(key);
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    if (state.range(1) == 0) {
+      sbf::BloomFilter<unsigned long> copied(bf);
+      benchmark::DoNotOptimize(copied.Data());
+      for (std::size_t j = 0; j < 64; j++) {
+        bf.Insert(keys[i]);
+        i = (i + 1) & (kNumKeys - 1);
+      }
+    }
+    else {
+      auto snapshot = snapshot_bf.Snapshot();
+      benchmark::DoNotOptimize(snapshot);
+      for (std::size_t j = 0; j < 64; j++) {
+        snapshot_bf.Insert(keys[i]);
+        i = (i + 1) & (kNumKeys - 1);
+      }
+    }
+  }
+}
+
+/**
+ * フィルタを構築する処理時間を計測する．
+ *
+ * 引数は順に，フィルタ用配列サイズのビット数の底2による対数値，
+ * Prefault() に使うスレッド数 (0 の場合は呼び出さない)．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_Construct(benchmark::State& state) {
+  for (auto _ : state) {
+    sbf::BloomFilter<unsigned long> bf(state.range(0), 4);
+    if (state.range(1) > 0) {
+      bf.Prefault(state.range(1));
+    }
+    benchmark::DoNotOptimize(bf.Data());
+  }
+}
+
+/**
+ * フィルタを空にする処理時間を計測する．
+ *
+ * 引数は順に，フィルタ用配列サイズのビット数の底2による対数値，
+ * 方法 (0: 新たなフィルタを作成して代入する，1: Clear() する)．<br>
+ * 空にするたびに，計測の外で全ページに触れるよう要素を追加し直す．
+ * Clear() が遅延させた0埋めの費用はこの追加に含まれ，計測されない．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_Clear(benchmark::State& state) {
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  sbf::BloomFilter<unsigned long> bf(state.range(0), 4);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (auto&& key : keys) {
+      bf.Insert(key);
+    }
+    state.ResumeTiming();
+    if (state.range(1) == 0) {
+      bf = sbf::BloomFilter<unsigned long>(state.range(0), 4);
+    }
+    else {
+      bf.Clear();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bf.NumWords() * 8);
+}
+
+/**
+ * リクエストごとに小さなフィルタを作成して破棄する速度を計測する．
+ *
+ * 1回の反復で配列サイズ 2^12 ビットのフィルタを 64 個作成し，それぞれに要素を1個追加して破棄する．<br>
+ * 引数が 0 の場合は通常のメモリ確保，1 の場合は FilterArena から切り出して反復ごとに Reset() する．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_FilterChurn(benchmark::State& state) {
+  constexpr std::size_t kNumFilters = 64;
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  sbf::FilterArena arena;
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    if (state.range(0) == 0) {
+      for (std::size_t f = 0; f < kNumFilters; f++) {
+        sbf::BloomFilter<unsigned long> bf(12, 4);
+        bf.Insert(keys[i]);
+        benchmark::DoNotOptimize(bf.Data());
+        i = (i + 1) & (kNumKeys - 1);
+      }
+    }
+    else {
+      for (std::size_t f = 0; f < kNumFilters; f++) {
+        sbf::ArenaBloomFilter<unsigned long> bf(12, 4, arena);
+        bf.Insert(keys[i]);
+        benchmark::DoNotOptimize(bf.Data());
+        i = (i + 1) & (kNumKeys - 1);
+      }
+      arena.Reset();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFilters);
+}
+
+/**
+ * フィルタ用配列のページの種類ごとに，大きなフィルタで追加されていない要素を判定する速度を計測する．
+ *
+ * 引数は順に，フィルタ用配列サイズのビット数の底2による対数値，
+ * ページの種類 (sbf::HugePages の値)．<br>
+ * 判定ごとにほぼ異なるページに触れるため，通常のページでは TLB ミスが支配的となる．
+ *
+ * @param[in,out] state ベンチマークの状態
+ */
+void BM_HugePagesContainsMiss(benchmark::State& state) {
+  const auto& keys = GenerateKeys<unsigned long>(kNumKeys, 0, kSeed);
+  const auto& challenges = GenerateKeys<unsigned long>(kNumKeys, 0, kMissSeed);
+  sbf::BloomFilter<unsigned long> bf(state.range(0), 4,
+    static_cast<sbf::HugePages>(state.range(1)));
+  for (auto&& key : keys) {
+    bf.Insert(key);
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bf.Contains(challenges[i]));
+    i = (i + 1) & (kNumKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["page_size"] = bf.PageSize();
+}
+
+/**
+ * 文字列要素に対するベンチマークの引数を設定する．
+ *
+ * フィルタ用配列サイズは L1 キャッシュに収まる 4KB から，
+ * DRAM に置かれる 128MB までを対象とする．
+ *
+ * @param[in,out] b ベンチマーク
+ */
+void StringArguments(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"log2_num_bits", "num_hashes", "length"});
+  b->ArgsProduct({{15, 20, 24, 30}, {1, 4, 8, 16}, {8, 64, 256}});
+}
+
+/**
+ * 数値要素に対するベンチマークの引数を設定する．
+ *
+ * @param[in,out] b ベンチマーク
+ */
+void NumericArguments(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"log2_num_bits", "num_hashes", "length"});
+  b->ArgsProduct({{15, 20, 24, 30}, {1, 4, 8, 16}, {0}});
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_Insert, std::string)->Apply(StringArguments);
+BENCHMARK_TEMPLATE(BM_Insert, unsigned long)->Apply(NumericArguments);
+BENCHMARK_TEMPLATE(BM_Insert, double)->Apply(NumericArguments);
+
+BENCHMARK_TEMPLATE(BM_ContainsHit, std::string)->Apply(StringArguments);
+BENCHMARK_TEMPLATE(BM_ContainsHit, unsigned long)->Apply(NumericArguments);
+BENCHMARK_TEMPLATE(BM_ContainsHit, double)->Apply(NumericArguments);
+
+BENCHMARK_TEMPLATE(BM_ContainsMiss, std::string)->Apply(StringArguments);
+BENCHMARK_TEMPLATE(BM_ContainsMiss, unsigned long)->Apply(NumericArguments);
+BENCHMARK_TEMPLATE(BM_ContainsMiss, double)->Apply(NumericArguments);
+
+BENCHMARK(BM_Djb2)->ArgName("length")->RangeMultiplier(4)->Range(4, 4096);
+
+BENCHMARK(BM_Hash)->ArgNames({"num_hashes", "length"})
+  ->ArgsProduct({{1, 4, 8, 16}, {8, 64, 256}});
+
+BENCHMARK(BM_ProbeFilters)->ArgNames({"num_filters", "length", "hashed"})
+  ->ArgsProduct({{8, 64}, {16, 256}, {0, 1}});
+
+BENCHMARK(BM_RouteShards)->ArgNames({"num_shards", "sliced"})
+  ->ArgsProduct({{100, 1000, 10000}, {0, 1}});
+
+BENCHMARK(BM_Load)->ArgNames({"fill_percent", "compressed"})
+  ->ArgsProduct({{1, 10, 30}, {0, 1}});
+
+BENCHMARK(BM_Checkpoint)->ArgNames({"log2_num_bits", "incremental"})
+  ->ArgsProduct({{24, 30}, {0, 1}})->Iterations(8);
+
+BENCHMARK(BM_LoggedInsert)->ArgName("logged")->Arg(0)->Arg(1);
+
+BENCHMARK(BM_HolderContains)->ArgName("holder")->Arg(0)->Arg(1)
+  ->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK(BM_Snapshot)->ArgNames({"log2_num_bits", "snapshot"})
+  ->ArgsProduct({{20, 27, 30}, {0, 1}})->Iterations(16);
+
+BENCHMARK(BM_Construct)->ArgNames({"log2_num_bits", "prefault_threads"})
+  ->ArgsProduct({{16, 24, 30, 33}, {0, 1, 4}})->Iterations(8);
+
+BENCHMARK(BM_Clear)->ArgNames({"log2_num_bits", "clear"})->Iterations(16)
+  ->ArgsProduct({{20, 27, 30}, {0, 1}});
+
+BENCHMARK(BM_FilterChurn)->ArgName("arena")->Arg(0)->Arg(1);
+
+BENCHMARK(BM_HugePagesContainsMiss)->ArgNames({"log2_num_bits", "huge_pages"})
+  ->ArgsProduct({{24, 30, 33}, {0, 1, 2, 3}});
+
+BENCHMARK_TEMPLATE(BM_SmallFilterContains, SmallBloomFilter);
+BENCHMARK_TEMPLATE(BM_SmallFilterContains, SmallStaticBloomFilter);
+
+BENCHMARK_TEMPLATE(BM_ParallelContains, sbf::ConcurrentBloomFilter<unsigned long>)
+  ->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ParallelContains, sbf::ReplicatedBloomFilter<unsigned long>)
+  ->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
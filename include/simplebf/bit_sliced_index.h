@@ -0,0 +1,293 @@
+/**
+ * @file bit_sliced_index.h
+ * @brief 多数の Bloom filter をまとめて判定するビットスライス索引用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_BIT_SLICED_INDEX_H_
+#define CPPBF_BIT_SLICED_INDEX_H_
+
+#include "bloom_filter.h"
+#include "hasher.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 多数の Bloom filter をまとめて判定するビットスライス索引用クラス．
+ *
+ * 配列サイズとハッシュ関数を共有する NumShards() 個の Bloom filter を転置して保持する．<br>
+ * すなわち，フィルタ用配列の i ビット目を行とし，各行に全シャードの i ビット目を並べたビットマップを置く．<br>
+ * 要素の判定では，その要素の NumHashes() 個の位置の行の論理積をとるだけで，
+ * 要素を含む可能性があるシャードのビットマップが得られる．<br>
+ * 行は連続した64ビット単位の配列なので，論理積はコンパイラによりベクトル化される．
+ *
+ * シャード s の内容は，同じパラメータの BloomFilter<T, HashPolicy> に同じ要素を追加したものと一致する．
+ *
+ * 参考：B. Goodwin et al., "BitFunnel: Revisiting Signatures for Search", SIGIR 2017.
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class BitSlicedIndex {
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
+
+public:
+  /**
+   * シャード数，フィルタ用配列サイズのビット数とハッシュ関数の個数を与えて初期化する．
+   *
+   * パラメータの制約は BloomFilter と同じであり，制約を満たさない場合は
+   * 最も近い値を設定してパラメータエラーフラグを立てる．
+   *
+   * @param[in] num_shards シャード数
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @param[in] num_hashes ハッシュ関数の個数
+   */
+  BitSlicedIndex(std::size_t num_shards, std::size_t log2_num_bits,
+      std::size_t num_hashes) : num_shards_(num_shards),
+      words_per_row_((num_shards + 63) / 64), log2_num_bits_(log2_num_bits),
+      num_hashes_(num_hashes), parameter_error_flags_(0) {
+    if (log2_num_bits_ > kMaxLog2NumBits) {
+      log2_num_bits_ = kMaxLog2NumBits;
+      parameter_error_flags_ |= kHasLog2NumBitsError;
+    }
+    if (num_hashes_ < 1) {
+      num_hashes_ = 1;
+      parameter_error_flags_ |= kHasNumHashesError;
+    }
+    rows_.resize(NumBits() * words_per_row_);
+  }
+
+  /**
+   * シャードに要素を追加する．
+   *
+   * @param[in] shard シャード番号 (NumShards() 未満)
+   * @param[in] entry 追加する要素
+   */
+  void Insert(std::size_t shard, const T& entry) {
+    Insert(shard, MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値でシャードに要素を追加する．
+   *
+   * @param[in] shard シャード番号 (NumShards() 未満)
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void Insert(std::size_t shard, const HashedKey& key) {
+    std::uint64_t bit = 1ull << (shard & 63);
+    ForEachPosition(key, log2_num_bits_, num_hashes_, [this, shard, bit](std::size_t position) {
+      rows_[position * words_per_row_ + (shard >> 6)] |= bit;
+    });
+  }
+
+  /**
+   * Bloom filter の内容をシャードに追加する．
+   *
+   * 既存のシャードの内容との論理和をとる．<br>
+   * 配列サイズまたはハッシュ関数の個数が異なる場合は何もせず false を返す．
+   *
+   * @tparam Allocator Bloom filter のフィルタ用配列のアロケータ
+   * @param[in] shard シャード番号 (NumShards() 未満)
+   * @param[in] bf Bloom filter
+   * @return 追加できた場合は true
+   */
+  template <class Allocator>
+  bool AddFilter(std::size_t shard, const BloomFilter<T, HashPolicy, Allocator>& bf) {
+    if (bf.Log2NumBits() != log2_num_bits_ || bf.NumHashes() != num_hashes_) {
+      return false;
+    }
+
+    // 立っているビットの行にのみシャードのビットを立てる．
+    const std::uint64_t* words = bf.Data();
+    std::uint64_t bit = 1ull << (shard & 63);
+    for (std::size_t w = 0; w < bf.NumWords(); w++) {
+      for (std::uint64_t word = words[w]; word != 0; word &= word - 1) {
+        std::size_t row = w * 64 + __builtin_ctzll(word);
+        rows_[row * words_per_row_ + (shard >> 6)] |= bit;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * 要素を含む可能性があるシャードのビットマップを求める．
+   *
+   * candidates の s / 64 番目の要素の下位から s % 64 ビット目が，
+   * シャード s が要素を含む可能性があるかを表す．
+   *
+   * @param[in] entry 判定したい要素
+   * @param[out] candidates シャードのビットマップ (WordsPerRow() 個の要素)
+   * @return 要素を含む可能性があるシャードが存在する場合は true
+   */
+  bool Query(const T& entry, std::vector<std::uint64_t>& candidates) const {
+    return Query(MakeHashedKey<HashPolicy>(entry), candidates);
+  }
+
+  /**
+   * 文字列を含む可能性があるシャードのビットマップを求める．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 判定したい文字列
+   * @param[out] candidates シャードのビットマップ (WordsPerRow() 個の要素)
+   * @return 要素を含む可能性があるシャードが存在する場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Query(std::string_view entry, std::vector<std::uint64_t>& candidates) const {
+    return Query(MakeHashedKey<HashPolicy>(entry), candidates);
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を含む可能性があるシャードのビットマップを求める．
+   *
+   * 全シャードが候補から外れた時点で残りの行の読み込みを打ち切る．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @param[out] candidates シャードのビットマップ (WordsPerRow() 個の要素)
+   * @return 要素を含む可能性があるシャードが存在する場合は true
+   */
+  bool Query(const HashedKey& key, std::vector<std::uint64_t>& candidates) const {
+    // 全シャードを候補として，各位置の行との論理積をとる．
+    candidates.assign(words_per_row_, ~std::uint64_t{0});
+    std::uint64_t* result = candidates.data();
+    return ForEachPosition(key, log2_num_bits_, num_hashes_, [this, result](std::size_t position) {
+      const std::uint64_t* row = &rows_[position * words_per_row_];
+      std::uint64_t any = 0;
+      for (std::size_t w = 0; w < words_per_row_; w++) {
+        result[w] &= row[w];
+        any |= result[w];
+      }
+      return any != 0;
+    });
+  }
+
+  /**
+   * 要素を含む可能性があるシャードの番号を昇順に返す．
+   *
+   * @param[in] entry 判定したい要素
+   * @return シャード番号を並べたベクトル
+   */
+  std::vector<std::size_t> Candidates(const T& entry) const {
+    std::vector<std::uint64_t> candidates;
+    std::vector<std::size_t> shards;
+    if (!Query(entry, candidates)) {
+      return shards;
+    }
+    for (std::size_t w = 0; w < candidates.size(); w++) {
+      for (std::uint64_t word = candidates[w]; word != 0; word &= word - 1) {
+        shards.push_back(w * 64 + __builtin_ctzll(word));
+      }
+    }
+    return shards;
+  }
+
+  /**
+   * シャード数を返す．
+   *
+   * @return シャード数
+   */
+  std::size_t NumShards() const {
+    return num_shards_;
+  }
+
+  /**
+   * 1行あたりの64ビット単位の要素数を返す．
+   *
+   * @return 1行あたりの64ビット単位の要素数
+   */
+  std::size_t WordsPerRow() const {
+    return words_per_row_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数 (行数) を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  std::size_t NumBits() const {
+    return std::size_t{1} << log2_num_bits_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  std::size_t Log2NumBits() const {
+    return log2_num_bits_;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  std::size_t NumHashes() const {
+    return num_hashes_;
+  }
+
+  /**
+   * パラメータエラーを表すビットフラグを返す．
+   *
+   * @return パラメータエラーを表すビットフラグ．
+   */
+  int ParameterErrorFlags() const {
+    return parameter_error_flags_;
+  }
+
+  /**
+   * パラメータエラーがあるかを返す．
+   *
+   * @return パラメータエラーがある場合はtrue.
+   */
+  bool HasParameterError() const {
+    return (parameter_error_flags_ != 0);
+  }
+
+public:
+  /** フィルタ用配列サイズのビット数の底2による対数値の設定に対するビットフラグ */
+  static constexpr int kHasLog2NumBitsError = 0x1;
+
+  /** Bloom filter におけるハッシュ関数の個数に対するビットフラグ */
+  static constexpr int kHasNumHashesError = 0x2;
+
+private:
+  /**
+   * 転置したフィルタ．
+   *
+   * i 行目は rows_[i * words_per_row_] から words_per_row_ 個の要素であり，
+   * シャード s のビットはその s / 64 番目の要素の下位から s % 64 ビット目に対応する．
+   */
+  std::vector<std::uint64_t> rows_;
+
+  /** シャード数． */
+  std::size_t num_shards_;
+
+  /** 1行あたりの64ビット単位の要素数． */
+  std::size_t words_per_row_;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::size_t log2_num_bits_;
+
+  /** Bloom filter におけるハッシュ関数の個数． */
+  std::size_t num_hashes_;
+
+  /** パラメータエラーを表すビットフラグ. */
+  int parameter_error_flags_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_BIT_SLICED_INDEX_H_
@@ -6,11 +6,21 @@
 #ifndef CPPBF_BLOOM_FILTER_H_
 #define CPPBF_BLOOM_FILTER_H_
 
+#include "bloom_filter_view.h"
+#include "hasher.h"
+#include "page_allocator.h"
+#include "serialization.h"
 #include "util.h"
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
-#include <functional>
 
 /**
  * @brief Bloom filter のための名前空間．
@@ -26,9 +36,12 @@ namespace sbf {
  * * 含まれているのに含まれていないと判定される誤り (false negative) は発生しない
  * * 含まれていないのに含まれていると判定される誤り (false positive) が発生することがある
  *
- * @tparam T 要素の型．ただし，以下の型のみが認められている．
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．<br>
+ *     既定値の Hasher<T> は以下の型のみに特殊化されている．
  *     * int
  *     * unsigned int
+ *     * long
  *     * unsigned long
  *     * long long
  *     * unsigned long long
@@ -36,22 +49,17 @@ namespace sbf {
  *     * double
  *     * long double
  *     * std::string
+ * @tparam Allocator フィルタ用配列 (std::uint64_t の配列) のアロケータ．<br>
+ *     既定値の PageAllocator は huge page に確保できる．
+ *     多数の小さなフィルタをまとめて確保・解放する場合は ArenaAllocator を使う．
  */
-template <class T>
+template <class T, class HashPolicy = Hasher<T>,
+  class Allocator = PageAllocator<std::uint64_t>>
 class BloomFilter {
-  // std::to_string 可能な型か文字列型のみを認める．
-  static_assert(std::is_same<T, int>::value ||
-    std::is_same<T, unsigned int>::value ||
-    std::is_same<T, long>::value ||
-    std::is_same<T, unsigned long>::value ||
-    std::is_same<T, long long>::value ||
-    std::is_same<T, unsigned long long>::value ||
-    std::is_same<T, float>::value ||
-    std::is_same<T, double>::value ||
-    std::is_same<T, long double>::value ||
-    std::is_same<T, std::string>::value,
-      "This class template only supports std::string or "
-      "types that can be converted to std::string by std::to_string.");
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
 
 public:
   /** デフォルトコンストラクタ． */
@@ -72,8 +80,25 @@ public:
    * @param[in] num_bits フィルタ用配列サイズのビット数．
    * @param[in] num_hashes ハッシュ関数の個数．
    */
-  BloomFilter(std::size_t num_bits, std::size_t num_hashes) : size_(0),
-      parameter_error_flags_(0) {
+  BloomFilter(std::size_t num_bits, std::size_t num_hashes) : log2_num_bits_(0),
+      size_(0), parameter_error_flags_(0) {
+    SetLog2NumBits(num_bits);
+    SetNumHashes(num_hashes);
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数，ハッシュ関数の個数とフィルタ用配列のアロケータを与えて初期化する．
+   *
+   * フィルタ用配列の確保は1回のみである．<br>
+   * 既定の PageAllocator では HugePages の値を，ArenaAllocator では FilterArena を直接渡せる．
+   *
+   * @param[in] num_bits フィルタ用配列サイズのビット数．
+   * @param[in] num_hashes ハッシュ関数の個数．
+   * @param[in] allocator フィルタ用配列のアロケータ．
+   */
+  BloomFilter(std::size_t num_bits, std::size_t num_hashes,
+      const Allocator& allocator) : words_(allocator),
+      log2_num_bits_(0), size_(0), parameter_error_flags_(0) {
     SetLog2NumBits(num_bits);
     SetNumHashes(num_hashes);
   }
@@ -84,11 +109,46 @@ public:
    * @param[in] entry 追加する要素
    */
   void Insert(const T& entry) {
-    const auto& hashes = Hash(entry);
-    for (auto&& hash : hashes) {
-      filter_[hash] = true;
-    }
-    size_++;
+    InsertPositions(HashKey(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を追加する．
+   *
+   * HashKey() で計算した値を渡すと，もとの要素を Insert(const T&) で追加した場合と同じビットが立つ．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void Insert(const HashedKey& key) {
+    InsertPositions(key);
+  }
+
+  /**
+   * 文字列を追加する．
+   *
+   * T が std::string の場合のみ使える．<br>
+   * 同じ内容の std::string を Insert(const T&) で追加した場合と同じビットが立つ．<br>
+   * 文字列をコピーしないため，受信バッファなどを直接渡せる．
+   *
+   * @param[in] entry 追加する文字列
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  void Insert(std::string_view entry) {
+    InsertPositions(HashKey(entry));
+  }
+
+  /**
+   * バイト列を文字列として追加する．
+   *
+   * T が std::string の場合のみ使える．<br>
+   * Insert(std::string_view) と同じビットが立つ．
+   *
+   * @param[in] data バイト列の先頭
+   * @param[in] size バイト列のサイズ [bytes]
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  void Insert(const void* data, std::size_t size) {
+    Insert(std::string_view(static_cast<const char*>(data), size));
   }
 
   /**
@@ -102,26 +162,89 @@ public:
    * @return ハッシュ値
    */
   bool Contains(const T& entry) const {
-    const auto& hashes = Hash(entry);
-    for (auto&& hash : hashes) {
-      if (!filter_[hash]) {
-        return false;
-      }
-    }
-    return true; 
+    return ContainsPositions(HashKey(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * HashKey() で計算した値を渡すと，もとの要素を Contains(const T&) で判定した場合と同じ結果を返す．<br>
+   * 同じ要素を多数のフィルタで判定する場合に，ハッシュ値の計算を1回で済ませられる．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key) const {
+    return ContainsPositions(key);
+  }
+
+  /**
+   * 文字列が含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．<br>
+   * 同じ内容の std::string を Contains(const T&) で判定した場合と同じ結果を返す．
+   *
+   * @param[in] entry 含まれているかを判定したい文字列
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(std::string_view entry) const {
+    return ContainsPositions(HashKey(entry));
+  }
+
+  /**
+   * バイト列が文字列として含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．<br>
+   * Contains(std::string_view) と同じ結果を返す．
+   *
+   * @param[in] data バイト列の先頭
+   * @param[in] size バイト列のサイズ [bytes]
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(const void* data, std::size_t size) const {
+    return Contains(std::string_view(static_cast<const char*>(data), size));
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * 同じ HashPolicy を使うフィルタであれば，配列サイズやハッシュ関数の個数によらず
+   * Insert(const HashedKey&), Contains(const HashedKey&) に渡せる．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を文字列から計算して返す．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry ハッシュ値を計算したい文字列
+   * @return 計算済みのハッシュ値
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  static HashedKey HashKey(std::string_view entry) {
+    return MakeHashedKey<HashPolicy>(entry);
   }
 
   /**
    * double hashing 向けのハッシュ値を返す． 
    *
    * 0以上 NumBits() 未満の値を返す．<br>
-   * より具体的には，std::hash によるハッシュ値を NumBits() で割った余りを返す．
+   * より具体的には，HashPolicy::First() によるハッシュ値を NumBits() で割った余りを返す．<br>
+   * 既定の方針では std::hash によるハッシュ値を用いる．
    *
    * @param[in] entry ハッシュ値を計算したい要素
    * @return ハッシュ値
    */
   std::size_t FirstHash(const T& entry) const {
-    std::size_t hash = ModNumBits(std::hash<T>{}(entry));
+    std::size_t hash = ModNumBits(HashPolicy::First(entry));
     return hash;
   }
 
@@ -132,14 +255,72 @@ public:
    * NumBits() は2べきなので， FirstHash() とは異なるハッシュ関数による値を
    * 2倍して1を足したものを返す．
    * 
-   * より具体的には，入力値を文字列化したものの djb2 によるハッシュ値を計算し，<br>
-   * その値を2倍して1を足したものを， NumBits() で割った余りを返す．
+   * より具体的には，HashPolicy::Second() によるハッシュ値を計算し，<br>
+   * その値を2倍して1を足したものを， NumBits() で割った余りを返す．<br>
+   * 既定の方針では入力値 (数値型の場合は文字列化したもの) の djb2 によるハッシュ値を用いる．
    *
    * @param[in] entry ハッシュ値を計算したい要素
    * @return ハッシュ値
    */
   std::size_t SecondHash(const T& entry) const {
-    std::size_t hash = ModNumBits((hash::Djb2(std::to_string(entry)) << 1) | 1);
+    std::size_t hash = ModNumBits((HashPolicy::Second(entry) << 1) | 1);
+    return hash;
+  }
+
+  /**
+   * double hashing 向けのハッシュ値を文字列から計算して返す．
+   *
+   * T が std::string の場合のみ使える．<br>
+   * HashPolicy が std::string_view を受け付ける必要がある．既定の Hasher<std::string> は
+   * 同じ内容の std::string と同じ値を返すため，FirstHash(const T&) と同じ値となる．
+   *
+   * @param[in] entry ハッシュ値を計算したい文字列
+   * @return ハッシュ値
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  std::size_t FirstHash(std::string_view entry) const {
+    std::size_t hash = ModNumBits(HashPolicy::First(entry));
+    return hash;
+  }
+
+  /**
+   * double hashing 向けのハッシュ値を文字列から計算して返す．
+   *
+   * T が std::string の場合のみ使える．<br>
+   * SecondHash(const T&) と同じ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい文字列
+   * @return ハッシュ値
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  std::size_t SecondHash(std::string_view entry) const {
+    std::size_t hash = ModNumBits((HashPolicy::Second(entry) << 1) | 1);
+    return hash;
+  }
+
+  /**
+   * 計算済みのハッシュ値から double hashing 向けのハッシュ値を返す．
+   *
+   * HashKey() で計算した値に対して FirstHash(const T&) と同じ値を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return ハッシュ値
+   */
+  std::size_t FirstHash(const HashedKey& key) const {
+    std::size_t hash = ModNumBits(key.first);
+    return hash;
+  }
+
+  /**
+   * 計算済みのハッシュ値から double hashing 向けのハッシュ値を返す．
+   *
+   * HashKey() で計算した値に対して SecondHash(const T&) と同じ値を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return ハッシュ値
+   */
+  std::size_t SecondHash(const HashedKey& key) const {
+    std::size_t hash = ModNumBits((key.second << 1) | 1);
     return hash;
   }
 
@@ -155,17 +336,10 @@ public:
    * @return 複数のハッシュ値を並べたベクトル
    */
   std::vector<std::size_t> Hash(const T& entry) const {
-    std::size_t a = FirstHash(entry);
-    std::size_t b = SecondHash(entry);
-    std::size_t num_hashes = NumHashes();
-    std::vector<std::size_t> hashes(num_hashes);
-    hashes[0] = a;
-    std::size_t mask = NumBits() - 1;
-    for (std::size_t i = 1; i < num_hashes; i++) {
-      a = (a + b) & mask;
-      b = (b + i) & mask;
-      hashes[i] = a;
-    }
+    std::vector<std::size_t> hashes;
+    hashes.reserve(num_hashes_);
+    ForEachPosition(HashKey(entry), log2_num_bits_, num_hashes_,
+      [&hashes](std::size_t position) { hashes.push_back(position); });
     return hashes;
   }
 
@@ -175,7 +349,16 @@ public:
    * @return フィルタ用配列サイズのビット数
    */
   std::size_t NumBits() const {
-    return filter_.size();
+    return std::size_t{1} << log2_num_bits_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  std::size_t Log2NumBits() const {
+    return log2_num_bits_;
   }
 
   /**
@@ -188,14 +371,15 @@ public:
    * @return 指定値が設定できたら true
    */
   bool SetLog2NumBits(std::size_t log2_num_bits) {
-    if (log2_num_bits > 33) {
-      // 2^33 [bits] = 2^3 * 2^30 [bits] = 8 * (2^10)^3 [bits] = 1 [GB]
-      filter_.resize(1ull << 33);
+    if (log2_num_bits > kMaxLog2NumBits) {
+      log2_num_bits_ = kMaxLog2NumBits;
+      ResizeWords(NumWords());
       parameter_error_flags_ |= kHasLog2NumBitsError;
       return false;
     }
 
-    filter_.resize(1ull << log2_num_bits);
+    log2_num_bits_ = log2_num_bits;
+    ResizeWords(NumWords());
     ClearParameterError(kHasLog2NumBitsError);
     return true;
   }
@@ -261,6 +445,34 @@ public:
     return size_;
   }
 
+  /**
+   * フィルタ用配列の全ページを書き込み可能な状態で割り当てさせる．
+   *
+   * 大きなフィルタのフィルタ用配列は0のページとして確保され，最初の書き込み時に割り当てられる．<br>
+   * 追加の処理時間のばらつきを避けたい場合は，要素を追加する前に呼び出す．
+   * 内容は変えないが，他のスレッドが同時に追加している間は呼び出せない．
+   *
+   * @param[in] num_threads 使うスレッド数
+   */
+  void Prefault(std::size_t num_threads = 1) {
+    PrefaultPages(words_.data(), words_.size() * sizeof(std::uint64_t), num_threads);
+  }
+
+  /**
+   * 追加した要素をすべて削除し，追加された要素数を0にする．
+   *
+   * 配列サイズとハッシュ関数の個数は変えず，フィルタ用配列も確保し直さない．<br>
+   * PageAllocator が MapPages() で確保した大きなフィルタではページをカーネルに返し，
+   * 次に触れたときに遅延して0にする (ZeroMappedPages())．
+   * それ以外は num_threads 個のスレッドで並列に0で埋める (ZeroPages())．
+   *
+   * @param[in] num_threads 0埋めに使うスレッド数 (ZeroPages() を参照)
+   */
+  void Clear(std::size_t num_threads = 1) {
+    ZeroWords(0, words_.size(), num_threads);
+    size_ = 0;
+  }
+
   /**
    * パラメータエラーを表すビットフラグを返す．
    *
@@ -288,7 +500,285 @@ public:
     return (parameter_error_flags_ != 0);
   }
 
+  /**
+   * フィルタ用配列の立っているビットの割合 (充填率) を返す．
+   *
+   * @return 充填率
+   */
+  double FillRatio() const {
+    std::size_t num_set_bits = 0;
+    for (auto&& word : words_) {
+      num_set_bits += __builtin_popcountll(word);
+    }
+    return static_cast<double>(num_set_bits) / NumBits();
+  }
+
+  /**
+   * 現在のフィルタ用配列に対する偽陽性率の期待値を返す．
+   *
+   * 充填率 p とハッシュ関数の個数 k から p^k として見積もる．<br>
+   * 追加された要素数によらずフィルタ用配列の状態から計算するため，
+   * Fold() や論理和をとった後のフィルタにも使える．
+   *
+   * @return 偽陽性率の期待値
+   */
+  double ExpectedFalsePositiveRate() const {
+    return std::pow(FillRatio(), static_cast<double>(num_hashes_));
+  }
+
+  /**
+   * フィルタ用配列を折りたたんで縮小する．
+   *
+   * 位置は NumBits() で割った余りとして求めるため，配列サイズを 1/factor にしても，
+   * 各ビットを新しい配列サイズで割った余りの位置に移せば，同じ要素の位置は移した先と一致する．<br>
+   * したがって，factor 個に分割した配列の論理和をとることで，偽陰性を生じさせずに縮小できる．<br>
+   * 偽陽性率は ExpectedFalsePositiveRate() で確認できる．
+   *
+   * factor が2べきでない場合や，縮小後の配列サイズが1ビット未満となる場合は何もせず false を返す．
+   *
+   * @param[in] factor 縮小率 (2べき)
+   * @return 縮小できた場合は true
+   */
+  bool Fold(std::size_t factor) {
+    if (factor == 0 || (factor & (factor - 1)) != 0) {
+      return false;
+    }
+    std::size_t shift = __builtin_ctzll(factor);
+    if (shift > log2_num_bits_) {
+      return false;
+    }
+
+    std::size_t num_bits = NumBits();
+    std::size_t folded_num_bits = num_bits >> shift;
+    if (folded_num_bits >= 64) {
+      // 語単位で論理和をとる．
+      std::size_t folded_num_words = folded_num_bits / 64;
+      for (std::size_t offset = folded_num_words; offset < words_.size();
+          offset += folded_num_words) {
+        for (std::size_t w = 0; w < folded_num_words; w++) {
+          words_[w] |= words_[offset + w];
+        }
+      }
+    }
+    else {
+      // 64ビットに畳んだ後，語の中で半分ずつ畳む．
+      std::uint64_t word = 0;
+      for (auto&& w : words_) {
+        word |= w;
+      }
+      for (std::size_t width = std::min<std::size_t>(num_bits, 64) / 2;
+          width >= folded_num_bits; width /= 2) {
+        word = (word | (word >> width)) & ((1ull << width) - 1);
+      }
+      words_[0] = word;
+    }
+
+    log2_num_bits_ -= shift;
+    words_.resize(NumWords());
+    words_.shrink_to_fit();
+    return true;
+  }
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  std::size_t NumWords() const {
+    return (NumBits() + 63) / 64;
+  }
+
+  /**
+   * フィルタ用配列に実際に使われているページのサイズを返す．
+   *
+   * huge page を要求しても確保できなかった場合は通常のページサイズとなる．<br>
+   * Allocator が PageAllocator の場合のみ使える．
+   *
+   * @return ページのサイズ [bytes]
+   */
+  std::size_t PageSize() const {
+    return words_.get_allocator().PageSize();
+  }
+
+  /**
+   * フィルタ用配列に要求したページの種類を返す．
+   *
+   * Allocator が PageAllocator の場合のみ使える．
+   *
+   * @return ページの種類
+   */
+  HugePages PageRequest() const {
+    return words_.get_allocator().Request();
+  }
+
+  /**
+   * フィルタ用配列の先頭を返す．
+   *
+   * i ビット目は Data()[i / 64] の下位から (i % 64) ビット目に対応する．
+   *
+   * @return フィルタ用配列の先頭
+   */
+  const std::uint64_t* Data() const {
+    return words_.data();
+  }
+
+  /**
+   * このフィルタを参照する読み取り専用のビューを返す．
+   *
+   * ビューはこのフィルタのフィルタ用配列を直接参照するため，
+   * 配列サイズを変更する操作 (Fold(), Load() など) の後は使えない．
+   *
+   * @return 読み取り専用のビュー
+   */
+  BloomFilterView<T, HashPolicy> View() const {
+    return BloomFilterView<T, HashPolicy>(words_.data(), log2_num_bits_,
+      num_hashes_, size_);
+  }
+
+  /**
+   * フィルタをストリームに書き出す．
+   *
+   * 書式は serialization.h を参照．
+   *
+   * @param[in,out] out 出力ストリーム
+   * @return 書き出せた場合は true
+   */
+  bool Save(std::ostream& out) const {
+    FilterHeader header;
+    header.log2_num_bits = log2_num_bits_;
+    header.num_hashes = num_hashes_;
+    header.size = size_;
+    return WriteFilterHeader(out, header)
+      && WriteFilterWords(out, words_.data(), words_.size());
+  }
+
+  /**
+   * フィルタ用配列を Rice 符号で圧縮してストリームに書き出す．
+   *
+   * 書式は serialization.h を参照．Load() でそのまま読み込める．<br>
+   * 立っているビットの割合が小さいほどよく圧縮できる．
+   * 圧縮後のサイズは CompressedSize() で事前に確認できる．
+   *
+   * @param[in,out] out 出力ストリーム
+   * @return 書き出せた場合は true
+   */
+  bool SaveCompressed(std::ostream& out) const {
+    FilterHeader header;
+    header.flags = kFilterFlagCompressed;
+    header.log2_num_bits = log2_num_bits_;
+    header.num_hashes = num_hashes_;
+    header.size = size_;
+    return WriteFilterHeader(out, header)
+      && WriteCompressedFilterWords(out, words_.data(), words_.size());
+  }
+
+  /**
+   * SaveCompressed() で書き出されるサイズを返す．
+   *
+   * 符号化はせずに，立っているビットの間隔から求める．<br>
+   * Save() で書き出されるサイズは kFilterHeaderSize + 8 * NumWords() [bytes] である．
+   *
+   * @return SaveCompressed() で書き出されるサイズ [bytes]
+   */
+  std::size_t CompressedSize() const {
+    return kFilterHeaderSize + CompressedFilterSize(words_.data(), words_.size());
+  }
+
+  /**
+   * ストリームからフィルタを読み込む．
+   *
+   * Save(), SaveCompressed() のいずれで書き出したものも読み込める．<br>
+   * 配列サイズ，ハッシュ関数の個数，追加された要素数も読み込んだ値に置き換える．<br>
+   * 読み込みに失敗した場合は false を返し，フィルタの内容は不定となる．
+   *
+   * @param[in,out] in 入力ストリーム
+   * @return 読み込めた場合は true
+   */
+  bool Load(std::istream& in) {
+    FilterHeader header;
+    if (!ReadFilterHeader(in, header) || !SetLog2NumBits(header.log2_num_bits)
+        || !SetNumHashes(header.num_hashes)) {
+      return false;
+    }
+    size_ = header.size;
+    if ((header.flags & kFilterFlagCompressed) != 0) {
+      return ReadCompressedFilterWords(in, words_.data(), words_.size());
+    }
+    return ReadFilterWords(in, words_.data(), words_.size());
+  }
+
 private:
+  /**
+   * フィルタ用配列の要素数を変更する．増えた要素は0とする．
+   *
+   * PageAllocator は追加した要素を0で初期化しないため，新たに確保したメモリが0でない場合か，
+   * 確保済みの領域を再利用した場合にのみ0で埋める．
+   * 大きな配列は0のページとして確保されるため，全ページに触れずに済む．
+   *
+   * @param[in] num_words 要素数
+   */
+  void ResizeWords(std::size_t num_words) {
+    std::size_t old_size = words_.size();
+    std::size_t old_capacity = words_.capacity();
+    words_.resize(num_words);
+    if constexpr (std::is_same<Allocator, PageAllocator<std::uint64_t>>::value) {
+      if (num_words > old_size && (num_words <= old_capacity
+          || !words_.get_allocator().AllocatesZeroPages(words_.capacity()))) {
+        ZeroWords(old_size, num_words);
+      }
+    }
+  }
+
+  /**
+   * フィルタ用配列の指定された範囲を0で埋める．
+   *
+   * PageAllocator が MapPages() で確保した配列のみ ZeroMappedPages() でページを返却し，
+   * それ以外は ZeroPages() で埋める．<br>
+   * 他のアロケータのメモリは共有メモリやファイルのマッピング，アリーナのブロックの一部でありうるため，
+   * ページを返却してはならない．
+   *
+   * @param[in] begin 最初の要素の番号
+   * @param[in] end 最後の要素の次の番号
+   * @param[in] num_threads 0埋めに使うスレッド数
+   */
+  void ZeroWords(std::size_t begin, std::size_t end, std::size_t num_threads = 1) {
+    std::size_t size = (end - begin) * sizeof(std::uint64_t);
+    if constexpr (std::is_same<Allocator, PageAllocator<std::uint64_t>>::value) {
+      if (words_.get_allocator().AllocatesZeroPages(words_.capacity())) {
+        std::size_t page_size = words_.get_allocator().MappingPageSize(words_.data());
+        ZeroMappedPages(words_.data() + begin, size, page_size, num_threads);
+        return;
+      }
+    }
+    ZeroPages(words_.data() + begin, size, num_threads);
+  }
+
+  /**
+   * Hash() と同じ位置のビットを立てる．
+   *
+   * Insert() で Hash() のベクトルを確保しないよう，位置を順に計算しながらビットを立てる．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void InsertPositions(const HashedKey& key) {
+    ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      words_[position >> 6] |= 1ull << (position & 63);
+    });
+    size_++;
+  }
+
+  /**
+   * Hash() と同じ位置のビットがすべて立っているかを返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return すべて立っている場合は true
+   */
+  bool ContainsPositions(const HashedKey& key) const {
+    return ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      return (words_[position >> 6] & (1ull << (position & 63))) != 0;
+    });
+  }
+
   /**
    * ファイル用配列サイズのビット数で割った余りを返す．
    *
@@ -320,11 +810,14 @@ private:
   /**
    * Bloom filter 用フィルタ．
    *
-   * std::vector テンプレートクラスは bool 型に対して特殊化されており，
-   * 各要素1ビットのみで済むように最適化されている．
-   * したがって，ベクトルサイズがNならば，Nビットのみが必要となる．
+   * i ビット目は words_[i / 64] の下位から (i % 64) ビット目に対応する．<br>
+   * 64ビット単位で保持するため，ファイルへの入出力やフィルタ同士の演算を語単位で行える．<br>
+   * 大きなフィルタの TLB ミスを減らせるよう，既定では huge page に確保できるアロケータを使う．
    */
-  std::vector<bool> filter_;
+  std::vector<std::uint64_t, Allocator> words_;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::size_t log2_num_bits_;
 
   /** Bloom filter におけるハッシュ関数の個数． */
   std::size_t num_hashes_;
@@ -336,25 +829,6 @@ private:
   int parameter_error_flags_;
 };
 
-/**
- * double hashing 向けのハッシュ値を返す（FirstHashとは異なるハッシュ値）．
- *
- * 1以上 NumBits() 未満であって， NumBits() と互いに素な値を返す．<br>
- * NumBits() は2べきなので， FirstHash() とは異なるハッシュ関数による値を
- * 2倍して1を足したものを返す．
- * 
- * より具体的には，入力値の djb2 によるハッシュ値を計算し，<br>
- * その値を2倍して1を足したものを， NumBits() で割った余りを返す．
- *
- * @param[in] entry ハッシュ値を計算したい要素
- * @return ハッシュ値
- */
-template <>
-std::size_t BloomFilter<std::string>::SecondHash(const std::string& entry) const {
-  std::size_t hash = ModNumBits((hash::Djb2(entry) << 1) | 1);
-  return hash;
-}
-
 } // namespace sbf
 
 #endif // #ifndef CPPBF_BLOOM_FILTER_H_
@@ -0,0 +1,171 @@
+/**
+ * @file bloom_filter_view.h
+ * @brief 読み取り専用の Bloom filter 用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_BLOOM_FILTER_VIEW_H_
+#define CPPBF_BLOOM_FILTER_VIEW_H_
+
+#include "hasher.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 読み取り専用の Bloom filter 用クラス．
+ *
+ * 他で確保されたフィルタ用配列を参照し，要素が含まれているかの判定のみを行う．<br>
+ * 配列は BloomFilter::Data() と同じ配置とし，位置の計算方法も BloomFilter と同じである．<br>
+ * したがって，BloomFilter の配列や，それを書き出したものをそのまま参照でき，同じ判定結果となる．
+ *
+ * コンストラクタは constexpr であり，プログラムに埋め込んだ定数配列
+ * (simplebf embed サブコマンドの出力など) を参照するビューを定数として定義できる．<br>
+ * 参照先の配列はビューより長く生存している必要がある．
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class BloomFilterView {
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
+
+public:
+  /**
+   * フィルタ用配列とパラメータを与えて初期化する．
+   *
+   * @param[in] words フィルタ用配列 (NumWords() 個の要素)
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @param[in] num_hashes ハッシュ関数の個数
+   * @param[in] size 追加された要素数
+   */
+  constexpr BloomFilterView(const std::uint64_t* words, std::size_t log2_num_bits,
+      std::size_t num_hashes, std::size_t size) : words_(words),
+      log2_num_bits_(log2_num_bits), num_hashes_(num_hashes), size_(size) {
+  }
+
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列が含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 含まれているかを判定したい文字列
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(std::string_view entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  constexpr bool Contains(const HashedKey& key) const {
+    return ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      return (words_[position >> 6] & (std::uint64_t{1} << (position & 63))) != 0;
+    });
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  constexpr std::size_t NumBits() const {
+    return std::size_t{1} << log2_num_bits_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  constexpr std::size_t Log2NumBits() const {
+    return log2_num_bits_;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  constexpr std::size_t NumHashes() const {
+    return num_hashes_;
+  }
+
+  /**
+   * 追加された要素数を返す．
+   *
+   * @return 追加された要素数．
+   */
+  constexpr std::size_t Size() const {
+    return size_;
+  }
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  constexpr std::size_t NumWords() const {
+    return (NumBits() + 63) / 64;
+  }
+
+  /**
+   * フィルタ用配列の先頭を返す．
+   *
+   * @return フィルタ用配列の先頭
+   */
+  constexpr const std::uint64_t* Data() const {
+    return words_;
+  }
+
+private:
+  /** 参照するフィルタ用配列． */
+  const std::uint64_t* words_;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::size_t log2_num_bits_;
+
+  /** Bloom filter におけるハッシュ関数の個数． */
+  std::size_t num_hashes_;
+
+  /** 追加された要素数． */
+  std::size_t size_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_BLOOM_FILTER_VIEW_H_
@@ -0,0 +1,449 @@
+/**
+ * @file checkpoint_bloom_filter.h
+ * @brief 変更したチャンクのみをファイルに書き出せる Bloom filter 用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_CHECKPOINT_BLOOM_FILTER_H_
+#define CPPBF_CHECKPOINT_BLOOM_FILTER_H_
+
+#include "bloom_filter.h"
+#include "hasher.h"
+#include "page_allocator.h"
+#include "serialization.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/** CheckpointBloomFilter のチャンクの要素数の底2による対数値．1チャンクは 64KB となる． */
+constexpr std::size_t kCheckpointLog2ChunkWords = 13;
+
+/** CheckpointBloomFilter のチャンクの要素数． */
+constexpr std::size_t kCheckpointChunkWords = std::size_t{1} << kCheckpointLog2ChunkWords;
+
+/**
+ * @brief 変更したチャンクのみをファイルに書き出せる Bloom filter 用クラス．
+ *
+ * フィルタ用配列を 64KB のチャンクに区切り，前回の Checkpoint() 以降に書き込んだチャンクを
+ * ビットマップで管理する．<br>
+ * Checkpoint() は，前回書き出したファイルに対しては変更したチャンクとヘッダのみをその場で書き換え，
+ * それ以外のファイルに対しては全体を書き出す．
+ * 前回書き出したファイルであることは，パスに加えてデバイスと i-node 番号，ヘッダの要素数で確かめる．
+ * そのため，大きなフィルタでも追加した要素数に比例する程度の書き出しで永続化できる．
+ *
+ * ファイルは BloomFilter::Save() と同じ形式であり，BloomFilter::Load() や Load() で読み込める．
+ *
+ * BloomFilter と同じく，Insert() と Checkpoint() は1個のスレッドから呼び出す．<br>
+ * 位置の計算方法は BloomFilter と同じであり，同じパラメータの BloomFilter と同じビットが立つ．
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class CheckpointBloomFilter {
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
+
+public:
+  /**
+   * フィルタ用配列サイズのビット数とハッシュ関数の個数を与えて初期化する．
+   *
+   * パラメータの制約は BloomFilter と同じであり，制約を満たさない場合は
+   * 最も近い値を設定してパラメータエラーフラグを立てる．
+   *
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @param[in] num_hashes ハッシュ関数の個数
+   */
+  CheckpointBloomFilter(std::size_t log2_num_bits, std::size_t num_hashes)
+      : log2_num_bits_(log2_num_bits), num_hashes_(num_hashes), size_(0),
+      parameter_error_flags_(0) {
+    if (log2_num_bits_ > kMaxLog2NumBits) {
+      log2_num_bits_ = kMaxLog2NumBits;
+      parameter_error_flags_ |= kHasLog2NumBitsError;
+    }
+    if (num_hashes_ < 1) {
+      num_hashes_ = 1;
+      parameter_error_flags_ |= kHasNumHashesError;
+    }
+    words_.resize(NumWords());
+    if (!words_.get_allocator().AllocatesZeroPages(words_.capacity())) {
+      ZeroPages(words_.data(), words_.size() * sizeof(std::uint64_t));
+    }
+    dirty_.assign((NumChunks() + 63) / 64, 0);
+  }
+
+  CheckpointBloomFilter(const CheckpointBloomFilter&) = delete;
+  CheckpointBloomFilter& operator=(const CheckpointBloomFilter&) = delete;
+
+  /**
+   * 要素を追加する．
+   *
+   * @param[in] entry 追加する要素
+   */
+  void Insert(const T& entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列を追加する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 追加する文字列
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  void Insert(std::string_view entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を追加する．
+   *
+   * BloomFilter::Insert(const HashedKey&) と同じビットを立て，書き込んだチャンクを記録する．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void Insert(const HashedKey& key) {
+    ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      std::size_t w = position >> 6;
+      words_[w] |= 1ull << (position & 63);
+      std::size_t chunk = w >> kCheckpointLog2ChunkWords;
+      dirty_[chunk >> 6] |= 1ull << (chunk & 63);
+    });
+    size_++;
+  }
+
+  /**
+   * BloomFilter の内容を追加する．
+   *
+   * 既存の内容との論理和をとり，値が変わったチャンクを記録する．<br>
+   * 配列サイズまたはハッシュ関数の個数が異なる場合は何もせず false を返す．
+   *
+   * @tparam Allocator Bloom filter のフィルタ用配列のアロケータ
+   * @param[in] bf Bloom filter
+   * @return 追加できた場合は true
+   */
+  template <class Allocator>
+  bool AddFilter(const BloomFilter<T, HashPolicy, Allocator>& bf) {
+    if (bf.Log2NumBits() != log2_num_bits_ || bf.NumHashes() != num_hashes_) {
+      return false;
+    }
+    const std::uint64_t* words = bf.Data();
+    for (std::size_t chunk = 0; chunk < NumChunks(); chunk++) {
+      std::size_t begin = chunk << kCheckpointLog2ChunkWords;
+      std::size_t end = std::min(NumWords(), begin + kCheckpointChunkWords);
+      std::uint64_t changed = 0;
+      for (std::size_t i = begin; i < end; i++) {
+        changed |= words[i] & ~words_[i];
+        words_[i] |= words[i];
+      }
+      if (changed != 0) {
+        dirty_[chunk >> 6] |= 1ull << (chunk & 63);
+      }
+    }
+    size_ += bf.Size();
+    return true;
+  }
+
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列が含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 含まれているかを判定したい文字列
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(std::string_view entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * BloomFilter::Contains(const HashedKey&) と同じ結果を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key) const {
+    return ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      return (words_[position >> 6] & (1ull << (position & 63))) != 0;
+    });
+  }
+
+  /**
+   * 現在の内容をファイルに書き出す．
+   *
+   * path が前回 Checkpoint() で書き出したか Load() で読み込んだファイルであれば，
+   * 以降に変更したチャンクとヘッダのみを書き換える (UpdateFilterFile() を参照)．<br>
+   * それ以外の場合や，ファイルが他のファイルに置き換えられていた (デバイスまたは i-node 番号が異なる) 場合，
+   * 他の内容を書き込まれていた (ヘッダの要素数が異なる) 場合は，全体を書き出して置き換える
+   * (WriteFilterFile() を参照)．<br>
+   * いずれの場合も，書き出せた時点で変更したチャンクの記録を消去する．
+   *
+   * @param[in] path ファイルのパス
+   * @return 書き出せた場合は true
+   */
+  bool Checkpoint(const std::string& path) {
+    FilterHeader header;
+    header.log2_num_bits = log2_num_bits_;
+    header.num_hashes = num_hashes_;
+    header.size = size_;
+    if (path != checkpoint_path_ || !UpdateFilterFile(path, header, words_.data(),
+        DirtyChunks(), kCheckpointChunkWords, checkpoint_identity_)) {
+      checkpoint_path_.clear();
+      if (!WriteFilterFile(path, header, words_.data(), &checkpoint_identity_)) {
+        return false;
+      }
+      checkpoint_path_ = path;
+    }
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+    return true;
+  }
+
+  /**
+   * BloomFilter::Save() と同じ形式でストリームに書き出す．
+   *
+   * 変更したチャンクの記録は変えない．
+   *
+   * @param[in,out] out 出力ストリーム
+   * @return 書き出せた場合は true
+   */
+  bool Save(std::ostream& out) const {
+    FilterHeader header;
+    header.log2_num_bits = log2_num_bits_;
+    header.num_hashes = num_hashes_;
+    header.size = size_;
+    return WriteFilterHeader(out, header)
+      && WriteFilterWords(out, words_.data(), words_.size());
+  }
+
+  /**
+   * ファイルを読み込んで内容を置き換える．
+   *
+   * BloomFilter::Save(), BloomFilter::SaveCompressed() のいずれで書き出したものも読み込める．<br>
+   * 圧縮されていないファイルであれば，以降の同じパスへの Checkpoint() は変更したチャンクのみを書き換える．<br>
+   * 読み込めなかった場合は内容を変えずに false を返す．
+   *
+   * @param[in] path ファイルのパス
+   * @return 読み込めた場合は true
+   */
+  bool Load(const std::string& path) {
+    FilterFileIdentity identity;
+    bool identified = ReadFilterFileIdentity(path, identity);
+    std::ifstream in(path, std::ios::binary);
+    FilterHeader header;
+    if (!ReadFilterHeader(in, header) || header.log2_num_bits > kMaxLog2NumBits
+        || header.num_hashes < 1) {
+      return false;
+    }
+    std::vector<std::uint64_t, PageAllocator<std::uint64_t>> words(header.NumWords());
+    bool compressed = (header.flags & kFilterFlagCompressed) != 0;
+    if (compressed ? !ReadCompressedFilterWords(in, words.data(), words.size())
+        : !ReadFilterWords(in, words.data(), words.size())) {
+      return false;
+    }
+    words_.swap(words);
+    log2_num_bits_ = header.log2_num_bits;
+    num_hashes_ = header.num_hashes;
+    size_ = header.size;
+    parameter_error_flags_ = 0;
+    dirty_.assign((NumChunks() + 63) / 64, 0);
+
+    // 読み込む前後で同じファイルであった場合のみ，以降の Checkpoint() で書き換える．
+    FilterFileIdentity loaded_identity;
+    bool unchanged = identified && ReadFilterFileIdentity(path, loaded_identity)
+      && loaded_identity.device == identity.device && loaded_identity.inode == identity.inode
+      && loaded_identity.size == header.size && identity.size == header.size;
+    checkpoint_path_ = compressed || !unchanged ? std::string() : path;
+    checkpoint_identity_ = identity;
+    return true;
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * フィルタ用配列の先頭を返す．
+   *
+   * @return フィルタ用配列の先頭
+   */
+  const std::uint64_t* Data() const {
+    return words_.data();
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  std::size_t NumBits() const {
+    return std::size_t{1} << log2_num_bits_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  std::size_t Log2NumBits() const {
+    return log2_num_bits_;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  std::size_t NumHashes() const {
+    return num_hashes_;
+  }
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  std::size_t NumWords() const {
+    return (NumBits() + 63) / 64;
+  }
+
+  /**
+   * チャンク数を返す．
+   *
+   * @return チャンク数
+   */
+  std::size_t NumChunks() const {
+    return (NumWords() + kCheckpointChunkWords - 1) >> kCheckpointLog2ChunkWords;
+  }
+
+  /**
+   * 前回の Checkpoint() 以降に変更したチャンク数を返す．
+   *
+   * @return 変更したチャンク数
+   */
+  std::size_t NumDirtyChunks() const {
+    std::size_t num_dirty_chunks = 0;
+    for (std::uint64_t word : dirty_) {
+      num_dirty_chunks += __builtin_popcountll(word);
+    }
+    return num_dirty_chunks;
+  }
+
+  /**
+   * 追加された要素数を返す．
+   *
+   * @return 追加された要素数．
+   */
+  std::size_t Size() const {
+    return size_;
+  }
+
+  /**
+   * パラメータエラーを表すビットフラグを返す．
+   *
+   * @return パラメータエラーを表すビットフラグ．
+   */
+  int ParameterErrorFlags() const {
+    return parameter_error_flags_;
+  }
+
+  /**
+   * パラメータエラーがあるかを返す．
+   *
+   * @return パラメータエラーがある場合はtrue.
+   */
+  bool HasParameterError() const {
+    return (parameter_error_flags_ != 0);
+  }
+
+public:
+  /** フィルタ用配列サイズのビット数の底2による対数値の設定に対するビットフラグ */
+  static constexpr int kHasLog2NumBitsError = 0x1;
+
+  /** Bloom filter におけるハッシュ関数の個数に対するビットフラグ */
+  static constexpr int kHasNumHashesError = 0x2;
+
+private:
+  /**
+   * 前回の Checkpoint() 以降に変更したチャンクの番号を返す．
+   *
+   * @return 変更したチャンクの番号 (昇順)
+   */
+  std::vector<std::size_t> DirtyChunks() const {
+    std::vector<std::size_t> chunks;
+    for (std::size_t i = 0; i < dirty_.size(); i++) {
+      for (std::uint64_t word = dirty_[i]; word != 0; word &= word - 1) {
+        chunks.push_back(i * 64 + __builtin_ctzll(word));
+      }
+    }
+    return chunks;
+  }
+
+private:
+  /**
+   * フィルタ用配列．
+   *
+   * i ビット目は words_[i / 64] の下位から (i % 64) ビット目に対応する．
+   */
+  std::vector<std::uint64_t, PageAllocator<std::uint64_t>> words_;
+
+  /**
+   * 前回の Checkpoint() 以降に変更したチャンクのビットマップ．
+   *
+   * c 番目のチャンクは dirty_[c / 64] の下位から (c % 64) ビット目に対応する．
+   */
+  std::vector<std::uint64_t> dirty_;
+
+  /** 前回書き出したか読み込んだファイルのパス．変更したチャンクのみを書き換えられない場合は空とする． */
+  std::string checkpoint_path_;
+
+  /** 前回書き出したか読み込んだファイルを識別する情報． */
+  FilterFileIdentity checkpoint_identity_;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::size_t log2_num_bits_;
+
+  /** Bloom filter におけるハッシュ関数の個数． */
+  std::size_t num_hashes_;
+
+  /** 追加された要素数． */
+  std::size_t size_;
+
+  /** パラメータエラーを表すビットフラグ. */
+  int parameter_error_flags_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_CHECKPOINT_BLOOM_FILTER_H_
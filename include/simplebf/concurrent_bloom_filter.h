@@ -0,0 +1,405 @@
+/**
+ * @file concurrent_bloom_filter.h
+ * @brief 複数スレッドから同時に操作できる Bloom filter 用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_CONCURRENT_BLOOM_FILTER_H_
+#define CPPBF_CONCURRENT_BLOOM_FILTER_H_
+
+#include "hasher.h"
+#include "striped_counter.h"
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 複数スレッドから同時に操作できる Bloom filter 用クラス．
+ *
+ * BloomFilter と同じハッシュ値を用いるため，同じパラメータであれば同じビットが立つ．<br>
+ * フィルタ用配列を64ビットのアトミック変数の配列とし，
+ * Insert() はアトミックな論理和で，Contains() はアトミックな読み出しでビットを操作する．<br>
+ * したがって，Insert() と Contains() は任意のスレッドから同時に呼び出せる．<br>
+ * ただし，パラメータを変更するメンバ関数は他の操作と同時に呼び出してはならない．
+ *
+ * Insert() の完了後に同じ要素に対して呼び出した Contains() は true を返すが，
+ * 実行中の Insert() と同時に呼び出した Contains() の結果は不定である．
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．BloomFilter と同じものを使える．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class ConcurrentBloomFilter {
+public:
+  /** デフォルトコンストラクタ． */
+  ConcurrentBloomFilter() : ConcurrentBloomFilter(kDefaultLog2NumBits) {
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を与えて初期化する．
+   *
+   * @param[in] num_bits フィルタ用配列サイズのビット数．
+   */
+  ConcurrentBloomFilter(std::size_t num_bits)
+    : ConcurrentBloomFilter(num_bits, kNumDefaultNumHashes) {
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数とハッシュ関数の個数を与えて初期化する．
+   *
+   * @param[in] num_bits フィルタ用配列サイズのビット数．
+   * @param[in] num_hashes ハッシュ関数の個数．
+   */
+  ConcurrentBloomFilter(std::size_t num_bits, std::size_t num_hashes)
+    : log2_num_bits_(0), parameter_error_flags_(0) {
+    SetLog2NumBits(num_bits);
+    SetNumHashes(num_hashes);
+  }
+
+  ConcurrentBloomFilter(const ConcurrentBloomFilter&) = delete;
+  ConcurrentBloomFilter& operator=(const ConcurrentBloomFilter&) = delete;
+
+  /**
+   * 要素を追加する．
+   *
+   * 他のスレッドの Insert(), Contains() と同時に呼び出せる．
+   *
+   * @param[in] entry 追加する要素
+   */
+  void Insert(const T& entry) {
+    InsertPositions(HashKey(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を追加する．
+   *
+   * BloomFilter::Insert(const HashedKey&) と同じビットが立つ．<br>
+   * 他のスレッドの Insert(), Contains() と同時に呼び出せる．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void Insert(const HashedKey& key) {
+    InsertPositions(key);
+  }
+
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * 他のスレッドの Insert(), Contains() と同時に呼び出せる．<br>
+   * 確率的な判定なので誤る可能性がある．具体的には以下のとおりである．
+   * * 含まれているのに含まれていないと判定される誤り (false negative) は発生しない
+   * * 含まれていないのに含まれていると判定される誤り (false positive) が発生することがある
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return ContainsPositions(HashKey(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * BloomFilter::Contains(const HashedKey&) と同じ結果を返す．<br>
+   * 他のスレッドの Insert(), Contains() と同時に呼び出せる．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key) const {
+    return ContainsPositions(key);
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * BloomFilter::HashKey() と同じ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * double hashing 向けのハッシュ値を返す．
+   *
+   * BloomFilter::FirstHash() と同じ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return ハッシュ値
+   */
+  std::size_t FirstHash(const T& entry) const {
+    std::size_t hash = ModNumBits(HashPolicy::First(entry));
+    return hash;
+  }
+
+  /**
+   * double hashing 向けのハッシュ値を返す．
+   *
+   * BloomFilter::SecondHash() と同じ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return ハッシュ値
+   */
+  std::size_t SecondHash(const T& entry) const {
+    std::size_t hash = ModNumBits((HashPolicy::Second(entry) << 1) | 1);
+    return hash;
+  }
+
+  /**
+   * 計算済みのハッシュ値から double hashing 向けのハッシュ値を返す．
+   *
+   * BloomFilter::FirstHash(const HashedKey&) と同じ値を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return ハッシュ値
+   */
+  std::size_t FirstHash(const HashedKey& key) const {
+    std::size_t hash = ModNumBits(key.first);
+    return hash;
+  }
+
+  /**
+   * 計算済みのハッシュ値から double hashing 向けのハッシュ値を返す．
+   *
+   * BloomFilter::SecondHash(const HashedKey&) と同じ値を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return ハッシュ値
+   */
+  std::size_t SecondHash(const HashedKey& key) const {
+    std::size_t hash = ModNumBits((key.second << 1) | 1);
+    return hash;
+  }
+
+  /**
+   * 複数のハッシュ関数のハッシュ値を返す．
+   *
+   * BloomFilter::Hash() と同じく enhanced double hashing によるハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 複数のハッシュ値を並べたベクトル
+   */
+  std::vector<std::size_t> Hash(const T& entry) const {
+    std::vector<std::size_t> hashes;
+    hashes.reserve(num_hashes_);
+    ForEachPosition(HashKey(entry), log2_num_bits_, num_hashes_,
+      [&hashes](std::size_t position) { hashes.push_back(position); });
+    return hashes;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  std::size_t NumBits() const {
+    return std::size_t{1} << log2_num_bits_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を設定する．
+   *
+   * BloomFilter::SetLog2NumBits() と同じ制約をもつ．<br>
+   * フィルタ用配列は新たに確保され，追加済みの要素は失われる．
+   *
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @return 指定値が設定できたら true
+   */
+  bool SetLog2NumBits(std::size_t log2_num_bits) {
+    bool successful = true;
+    if (log2_num_bits > kMaxLog2NumBits) {
+      log2_num_bits = kMaxLog2NumBits;
+      parameter_error_flags_ |= kHasLog2NumBitsError;
+      successful = false;
+    }
+    else {
+      ClearParameterError(kHasLog2NumBitsError);
+    }
+
+    log2_num_bits_ = log2_num_bits;
+    std::size_t num_words = (NumBits() + 63) / 64;
+    words_.reset(new std::atomic<std::uint64_t>[num_words]);
+    for (std::size_t i = 0; i < num_words; i++) {
+      words_[i].store(0, std::memory_order_relaxed);
+    }
+    size_.Reset();
+    return successful;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  std::size_t NumHashes() const {
+    return num_hashes_;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を設定する．
+   *
+   * 指定値が設定できたら true を返す．<br>
+   * 指定値が1未満の場合は1を設定し，false を返す．
+   *
+   * @param[in] num_hashes Bloom filter におけるハッシュ関数の個数
+   * @return 指定値が設定できたら true
+   */
+  bool SetNumHashes(std::size_t num_hashes) {
+    if (num_hashes < 1) {
+      num_hashes_ = 1;
+      parameter_error_flags_ |= kHasNumHashesError;
+      return false;
+    }
+
+    num_hashes_ = num_hashes;
+    ClearParameterError(kHasNumHashesError);
+    return true;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を最適値で設定する．
+   *
+   * BloomFilter::SetOptimalNumHashes() と同じ値を設定する．
+   *
+   * @param[in] max_num_entries 追加される要素数の最大値
+   * @return 最適値が設定できたら true
+   */
+  bool SetOptimalNumHashes(std::size_t max_num_entries) {
+    std::size_t num_hashes
+      = static_cast<int>(std::log(2) * NumBits() / max_num_entries);
+    bool successful = SetNumHashes(num_hashes);
+
+    // 内部エラーフラグは強制的に解除
+    ClearParameterError(kHasNumHashesError);
+    return successful;
+  }
+
+  /**
+   * 追加された要素数を返す．
+   *
+   * 他のスレッドが Insert() を実行中の場合，その要素が数えられているかは不定である．
+   *
+   * @return 追加された要素数．
+   */
+  std::size_t Size() const {
+    return size_.Load();
+  }
+
+  /**
+   * パラメータエラーを表すビットフラグを返す．
+   *
+   * @return パラメータエラーを表すビットフラグ．
+   */
+  int ParameterErrorFlags() const {
+    return parameter_error_flags_;
+  }
+
+  /**
+   * パラメータエラーフラグを解除する．
+   *
+   * @param[in] flag パラメータエラーフラグ
+   */
+  void ClearParameterError(int flag = -1) {
+    parameter_error_flags_ &= ~flag;
+  }
+
+  /**
+   * パラメータエラーがあるかを返す．
+   *
+   * @return パラメータエラーがある場合はtrue.
+   */
+  bool HasParameterError() const {
+    return (parameter_error_flags_ != 0);
+  }
+
+private:
+  /**
+   * Hash() と同じ位置のビットをアトミックな論理和で立てる．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void InsertPositions(const HashedKey& key) {
+    ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      words_[position >> 6].fetch_or(1ull << (position & 63), std::memory_order_relaxed);
+    });
+    size_.Add(1);
+  }
+
+  /**
+   * Hash() と同じ位置のビットがすべて立っているかを返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return すべて立っている場合は true
+   */
+  bool ContainsPositions(const HashedKey& key) const {
+    return ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      std::uint64_t word = words_[position >> 6].load(std::memory_order_relaxed);
+      return (word & (1ull << (position & 63))) != 0;
+    });
+  }
+
+  /**
+   * ファイル用配列サイズのビット数で割った余りを返す．
+   *
+   * 配列サイズは2べきである前提とする．
+   *
+   * @param[in] x 値
+   * @return 入力値をファイル用配列サイズのビット数で割った余り
+   */
+  std::size_t ModNumBits(std::size_t x) const {
+    std::size_t mask = NumBits() - 1;
+    return (x & mask);
+  }
+
+public:
+  /** フィルタ用配列サイズのビット数の底2による対数値の設定に対するビットフラグ */
+  static constexpr int kHasLog2NumBitsError = 0x1;
+
+  /** Bloom filter におけるハッシュ関数の個数に対するビットフラグ */
+  static constexpr int kHasNumHashesError = 0x2;
+
+private:
+  /** フィルタ用配列サイズのビット数の底2による対数値のデフォルト値． */
+  static constexpr std::size_t kDefaultLog2NumBits = 8;
+
+  /** Bloom filter におけるハッシュ関数の個数のデフォルト値． */
+  static constexpr std::size_t kNumDefaultNumHashes = 5;
+
+private:
+  /**
+   * Bloom filter 用フィルタ．
+   *
+   * i ビット目は words_[i / 64] の下位から (i % 64) ビット目に対応する．
+   */
+  std::unique_ptr<std::atomic<std::uint64_t>[]> words_;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::size_t log2_num_bits_;
+
+  /** Bloom filter におけるハッシュ関数の個数． */
+  std::size_t num_hashes_;
+
+  /**
+   * 追加された要素数．
+   *
+   * 複数スレッドからの Insert() が同じキャッシュラインを奪い合わないように，スレッドごとに分けて数える．
+   */
+  StripedCounter size_;
+
+  /** パラメータエラーを表すビットフラグ. */
+  int parameter_error_flags_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_CONCURRENT_BLOOM_FILTER_H_
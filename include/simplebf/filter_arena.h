@@ -0,0 +1,251 @@
+/**
+ * @file filter_arena.h
+ * @brief 多数の小さなフィルタ用配列をまとめて確保・解放するアリーナを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_FILTER_ARENA_H_
+#define CPPBF_FILTER_ARENA_H_
+
+#include "bloom_filter.h"
+#include "hasher.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 多数の小さなフィルタ用配列をまとめて確保・解放するアリーナ．
+ *
+ * 大きなブロックを確保し，その先頭から順に切り出して返す．<br>
+ * 個々の配列は解放せず，Reset() または Release() でまとめて解放する．
+ * リクエストやテナントごとに小さなフィルタを作成・破棄する場合に，malloc の呼び出しをほぼなくせる．
+ *
+ * スレッドセーフではない．スレッドごとにアリーナを持つこと．
+ */
+class FilterArena {
+public:
+  /** 切り出したメモリの境界 [bytes]．キャッシュラインに揃える． */
+  static constexpr std::size_t kAlignment = 64;
+
+  /** ブロックのサイズ [bytes] のデフォルト値． */
+  static constexpr std::size_t kDefaultBlockSize = std::size_t{1} << 20;
+
+  /**
+   * ブロックのサイズを与えて初期化する．最初のブロックは初回の Allocate() で確保する．
+   *
+   * @param[in] block_size ブロックのサイズ [bytes]
+   */
+  explicit FilterArena(std::size_t block_size = kDefaultBlockSize);
+
+  /** デストラクタ．すべてのブロックを解放する． */
+  ~FilterArena();
+
+  FilterArena(const FilterArena&) = delete;
+  FilterArena& operator=(const FilterArena&) = delete;
+
+  /**
+   * メモリを切り出す．
+   *
+   * kAlignment に揃えたメモリを返す．内容は不定である．<br>
+   * ブロックのサイズより大きな要求には専用のブロックを確保する．
+   *
+   * @param[in] size サイズ [bytes]
+   * @return 切り出したメモリの先頭
+   */
+  void* Allocate(std::size_t size);
+
+  /**
+   * 切り出したメモリをすべて再利用できるようにする．
+   *
+   * 最初のブロックは解放せずに残すため，同程度の使い方を繰り返す場合は再びブロックを確保しない．<br>
+   * 切り出したメモリを使うフィルタは，呼び出す前に破棄すること．
+   */
+  void Reset();
+
+  /**
+   * すべてのブロックを解放する．
+   *
+   * 切り出したメモリを使うフィルタは，呼び出す前に破棄すること．
+   */
+  void Release();
+
+  /**
+   * 切り出したメモリの合計サイズを返す．
+   *
+   * @return 切り出したメモリの合計サイズ [bytes]
+   */
+  std::size_t BytesAllocated() const {
+    return bytes_allocated_;
+  }
+
+  /**
+   * 確保中のブロックの合計サイズを返す．
+   *
+   * @return 確保中のブロックの合計サイズ [bytes]
+   */
+  std::size_t BytesReserved() const;
+
+  /**
+   * 確保中のブロックの個数を返す．
+   *
+   * @return 確保中のブロックの個数
+   */
+  std::size_t NumBlocks() const {
+    return blocks_.size() + large_blocks_.size();
+  }
+
+private:
+  /**
+   * @brief 確保したブロックを表す構造体．
+   */
+  struct Block {
+    /** 先頭． */
+    char* data;
+
+    /** サイズ [bytes]． */
+    std::size_t size;
+  };
+
+  /**
+   * ブロックを確保する．
+   *
+   * @param[in] size サイズ [bytes]
+   * @return 確保したブロック
+   */
+  static Block AllocateBlock(std::size_t size);
+
+  /**
+   * ブロックを解放する．
+   *
+   * @param[in] block 解放するブロック
+   */
+  static void FreeBlock(const Block& block);
+
+  /** ブロックのサイズ [bytes]． */
+  std::size_t block_size_;
+
+  /** 先頭から順に切り出すブロック．最後のものから切り出す． */
+  std::vector<Block> blocks_;
+
+  /** ブロックのサイズより大きな要求のための専用のブロック． */
+  std::vector<Block> large_blocks_;
+
+  /** 最後のブロックで次に切り出す位置． */
+  char* cursor_;
+
+  /** 最後のブロックの末尾． */
+  char* limit_;
+
+  /** 切り出したメモリの合計サイズ [bytes]． */
+  std::size_t bytes_allocated_;
+};
+
+/**
+ * @brief FilterArena から切り出すアロケータ．
+ *
+ * deallocate() では何もせず，メモリはアリーナでまとめて解放する．<br>
+ * FilterArena から暗黙に変換できるため，BloomFilter のコンストラクタにアリーナを直接渡せる．
+ *
+ * @tparam T 要素の型
+ */
+template <class T>
+class ArenaAllocator {
+  template <class U>
+  friend class ArenaAllocator;
+
+public:
+  /** 要素の型． */
+  using value_type = T;
+
+  /**
+   * アリーナを与えて初期化する．
+   *
+   * @param[in] arena アリーナ
+   */
+  ArenaAllocator(FilterArena& arena) : arena_(&arena) {
+  }
+
+  /**
+   * 他の要素の型のアロケータから初期化する．同じアリーナを使う．
+   *
+   * @param[in] other アロケータ
+   */
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {
+  }
+
+  /**
+   * 要素 n 個分のメモリを切り出す．
+   *
+   * @param[in] n 要素数
+   * @return 切り出したメモリの先頭
+   */
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T)));
+  }
+
+  /**
+   * 何もしない．メモリはアリーナでまとめて解放する．
+   *
+   * @param[in] p 切り出したメモリの先頭
+   * @param[in] n 要素数
+   */
+  void deallocate(T* p, std::size_t n) {
+    static_cast<void>(p);
+    static_cast<void>(n);
+  }
+
+  /**
+   * アリーナを返す．
+   *
+   * @return アリーナ
+   */
+  FilterArena& Arena() const {
+    return *arena_;
+  }
+
+  /**
+   * 同じアリーナを使うかを返す．
+   *
+   * @param[in] lhs アロケータ
+   * @param[in] rhs アロケータ
+   * @return 同じアリーナを使う場合は true
+   */
+  friend bool operator==(const ArenaAllocator& lhs, const ArenaAllocator& rhs) {
+    return lhs.arena_ == rhs.arena_;
+  }
+
+  /**
+   * 異なるアリーナを使うかを返す．
+   *
+   * @param[in] lhs アロケータ
+   * @param[in] rhs アロケータ
+   * @return 異なるアリーナを使う場合は true
+   */
+  friend bool operator!=(const ArenaAllocator& lhs, const ArenaAllocator& rhs) {
+    return !(lhs == rhs);
+  }
+
+private:
+  /** アリーナ． */
+  FilterArena* arena_;
+};
+
+/**
+ * @brief FilterArena にフィルタ用配列を確保する Bloom filter．
+ *
+ * コンストラクタには BloomFilter(num_bits, num_hashes, arena) の形でアリーナを渡す．
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス
+ */
+template <class T, class HashPolicy = Hasher<T>>
+using ArenaBloomFilter = BloomFilter<T, HashPolicy, ArenaAllocator<std::uint64_t>>;
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_FILTER_ARENA_H_
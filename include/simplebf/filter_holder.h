@@ -0,0 +1,485 @@
+/**
+ * @file filter_holder.h
+ * @brief 判定を止めずにフィルタを再構築して差し替えるクラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_FILTER_HOLDER_H_
+#define CPPBF_FILTER_HOLDER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 判定を止めずにフィルタを再構築して差し替えるクラス．
+ *
+ * 現在のフィルタを変更しないものとして判定に使い，新たなフィルタを別のスレッドで構築して
+ * アトミックなポインタの交換で差し替える．<br>
+ * 差し替えたフィルタは，それを読んでいる判定がすべて終わった後に解放する．
+ * 読んでいるかどうかは hazard pointer で管理する．
+ *
+ * 判定では，呼び出したスレッドのハザードレコードに現在のフィルタを登録して読む．
+ * ロックは取らず，他のスレッドを待つこともない．<br>
+ * ハザードレコードはスレッドが初めて判定するときに登録してリストに加え，以降はそのスレッドが使い続ける．
+ * スレッドが終了したレコードは，後に登録するスレッドが再利用する．
+ *
+ * Publish() と Rebuild() は任意のスレッドから呼び出せ，差し替えは1個ずつ行う．<br>
+ * Rebuild() は，クラスが所有する1個の再構築用スレッドで受け付けた順に構築する．
+ *
+ * @tparam Filter フィルタの型．判定は const メンバ関数として呼び出す．
+ */
+template <class Filter>
+class FilterHolder {
+private:
+  struct Record;
+
+public:
+  /**
+   * @brief 判定の間，フィルタが解放されないよう保護するクラス．
+   *
+   * 生存中は呼び出したスレッドのハザードレコードを1個占有する．多数の判定をまとめて行う場合に使う．<br>
+   * 同じスレッドで入れ子に保護する場合は，そのスレッドのハザードレコードを追加で登録する．
+   */
+  class ReadGuard {
+  public:
+    /**
+     * 保持するクラスの現在のフィルタを保護する．
+     *
+     * @param[in] holder 保持するクラス
+     */
+    explicit ReadGuard(const FilterHolder& holder)
+        : record_(holder.ClaimRecord()), filter_(Protect(holder, *record_)) {
+    }
+
+    /** デストラクタ．保護を解除する． */
+    ~ReadGuard() {
+      record_->hazard.store(nullptr, std::memory_order_release);
+      record_->busy = false;
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    /**
+     * 保護しているフィルタを返す．
+     *
+     * @return フィルタ (まだ Publish() されていない場合は nullptr)
+     */
+    const Filter* Get() const {
+      return filter_;
+    }
+
+    /**
+     * 保護しているフィルタのメンバにアクセスする．
+     *
+     * @return フィルタ
+     */
+    const Filter* operator->() const {
+      return filter_;
+    }
+
+  private:
+    /**
+     * 現在のフィルタをハザードレコードに登録して返す．
+     *
+     * 登録した後も現在のフィルタであることを確認することで，解放済みのフィルタを登録しないようにする．
+     *
+     * @param[in] holder 保持するクラス
+     * @param[in,out] record 占有したハザードレコード
+     * @return 現在のフィルタ
+     */
+    static const Filter* Protect(const FilterHolder& holder, Record& record) {
+      const Filter* filter = holder.current_.load(std::memory_order_acquire);
+      while (true) {
+        record.hazard.store(filter, std::memory_order_seq_cst);
+        const Filter* latest = holder.current_.load(std::memory_order_seq_cst);
+        if (latest == filter) {
+          return filter;
+        }
+        filter = latest;
+      }
+    }
+
+  private:
+    /** 占有しているハザードレコード． */
+    Record* record_;
+
+    /** 保護しているフィルタ． */
+    const Filter* filter_;
+  };
+
+  /** デフォルトコンストラクタ．Publish() するまでフィルタをもたない． */
+  FilterHolder() : current_(nullptr), generation_(0), records_(std::make_shared<RecordList>()),
+      stopping_(false) {
+  }
+
+  /**
+   * 最初のフィルタを与えて初期化する．
+   *
+   * @param[in] filter フィルタ
+   */
+  explicit FilterHolder(std::unique_ptr<Filter> filter) : FilterHolder() {
+    Publish(std::move(filter));
+  }
+
+  /**
+   * デストラクタ．受け付けた Rebuild() がすべて終わるのを待ち，すべてのフィルタを解放する．
+   *
+   * 実行中の判定がないときに破棄すること．
+   */
+  ~FilterHolder() {
+    {
+      std::lock_guard<std::mutex> lock(rebuild_mutex_);
+      stopping_ = true;
+    }
+    rebuild_cv_.notify_one();
+    if (rebuilder_.joinable()) {
+      rebuilder_.join();
+    }
+    delete current_.load(std::memory_order_acquire);
+    for (const Filter* filter : retired_) {
+      delete filter;
+    }
+  }
+
+  FilterHolder(const FilterHolder&) = delete;
+  FilterHolder& operator=(const FilterHolder&) = delete;
+
+  /**
+   * 現在のフィルタで要素が含まれているかを確率的に判定する．
+   *
+   * まだ Publish() されていない場合は false を返す．
+   *
+   * @tparam Key 要素の型 (Filter::Contains() が受け付ける型)
+   * @param[in] key 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class Key>
+  bool Contains(const Key& key) const {
+    ReadGuard guard(*this);
+    return guard.Get() != nullptr && guard->Contains(key);
+  }
+
+  /**
+   * 新たなフィルタに差し替える．
+   *
+   * 差し替えたフィルタは，読んでいる判定がなければすぐに，
+   * そうでなければ以降の Publish() または Reclaim() で解放する．
+   *
+   * @param[in] filter 新たなフィルタ
+   */
+  void Publish(std::unique_ptr<Filter> filter) {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    const Filter* old = current_.exchange(filter.release(), std::memory_order_seq_cst);
+    generation_.fetch_add(1, std::memory_order_release);
+    if (old != nullptr) {
+      retired_.push_back(old);
+    }
+    ReclaimLocked();
+  }
+
+  /**
+   * 再構築用のスレッドでフィルタを構築して差し替える．
+   *
+   * 構築を受け付けるとすぐに返る．返り値を破棄しても構築の終了は待たない．<br>
+   * builder が nullptr を返した場合は差し替えない．builder が投げた例外は返り値から取り出せる．<br>
+   * 古いフィルタを読んでいる判定の終了は待たない．その場合，古いフィルタは以降の Publish() または
+   * Reclaim() で解放する．
+   *
+   * @param[in] builder 新たなフィルタを構築する関数
+   * @return 差し替えた場合に true となる結果
+   */
+  std::future<bool> Rebuild(std::function<std::unique_ptr<Filter>()> builder) {
+    std::packaged_task<bool()> task([this, builder = std::move(builder)]() {
+      std::unique_ptr<Filter> filter = builder();
+      if (filter == nullptr) {
+        return false;
+      }
+      Publish(std::move(filter));
+      return true;
+    });
+    std::future<bool> result = task.get_future();
+    {
+      std::lock_guard<std::mutex> lock(rebuild_mutex_);
+      rebuild_tasks_.push_back(std::move(task));
+      if (!rebuilder_.joinable()) {
+        rebuilder_ = std::thread(&FilterHolder::RebuildLoop, this);
+      }
+    }
+    rebuild_cv_.notify_one();
+    return result;
+  }
+
+  /**
+   * 差し替えたフィルタのうち，読んでいる判定がないものを解放する．
+   *
+   * @return まだ解放できないフィルタの個数
+   */
+  std::size_t Reclaim() {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    return ReclaimLocked();
+  }
+
+  /**
+   * 差し替えた回数を返す．
+   *
+   * @return 差し替えた回数 (最初の Publish() を含む)
+   */
+  std::uint64_t Generation() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+private:
+  /**
+   * @brief キャッシュラインを占有するハザードレコード．
+   */
+  struct alignas(64) Record {
+    /** 読んでいるフィルタ． */
+    std::atomic<const Filter*> hazard{nullptr};
+
+    /** いずれかのスレッドが所有している場合は true． */
+    std::atomic<bool> owned{true};
+
+    /** 所有するスレッドの ReadGuard が占有している場合は true (所有するスレッドのみが読み書きする)． */
+    bool busy = false;
+
+    /** リストの次のレコード． */
+    Record* next = nullptr;
+  };
+
+  /**
+   * @brief ハザードレコードのリスト．
+   *
+   * レコードは先頭に追加するのみで，リストを破棄するまで解放しない．<br>
+   * スレッドが終了した後に破棄するクラスがあるため，クラスとスレッドで共有して所有する．
+   */
+  struct RecordList {
+    /** 先頭のレコード． */
+    std::atomic<Record*> head{nullptr};
+
+    /** デストラクタ．すべてのレコードを解放する． */
+    ~RecordList() {
+      Record* record = head.load(std::memory_order_acquire);
+      while (record != nullptr) {
+        Record* next = record->next;
+        delete record;
+        record = next;
+      }
+    }
+
+    /**
+     * 所有されていないレコードを所有し，なければ新たなレコードを追加する．
+     *
+     * @return 所有したレコード
+     */
+    Record* Acquire() {
+      for (Record* record = head.load(std::memory_order_acquire); record != nullptr;
+           record = record->next) {
+        if (!record->owned.load(std::memory_order_relaxed)
+            && !record->owned.exchange(true, std::memory_order_acquire)) {
+          return record;
+        }
+      }
+      Record* record = new Record;
+      record->next = head.load(std::memory_order_relaxed);
+      // Reclaim() が追加を見逃さないよう，seq_cst で追加する．
+      while (!head.compare_exchange_weak(record->next, record,
+                                         std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      }
+      return record;
+    }
+  };
+
+  /**
+   * @brief スレッドが所有するハザードレコード．
+   *
+   * スレッドごとに1個存在し，スレッドの終了時にすべてのレコードの所有を解除する．
+   */
+  class ThreadRecords {
+  public:
+    /** デストラクタ．すべてのレコードの所有を解除する． */
+    ~ThreadRecords() {
+      for (Entry& entry : entries_) {
+        Release(entry);
+      }
+    }
+
+    /**
+     * リストから所有したレコードのうち，ReadGuard が占有していないものを返す．
+     *
+     * 初めて呼び出したとき，およびすべて占有している場合は，リストから新たに所有する．
+     *
+     * @param[in] list ハザードレコードのリスト
+     * @return ハザードレコード
+     */
+    Record* Claim(const std::shared_ptr<RecordList>& list) {
+      Entry& entry = Find(list);
+      for (Record* record : entry.records) {
+        if (!record->busy) {
+          record->busy = true;
+          return record;
+        }
+      }
+      Record* record = list->Acquire();
+      record->busy = true;
+      entry.records.push_back(record);
+      return record;
+    }
+
+  private:
+    /**
+     * @brief 1個のリストから所有したレコード．
+     */
+    struct Entry {
+      /** リスト． */
+      std::shared_ptr<RecordList> list;
+
+      /** 所有したレコード． */
+      std::vector<Record*> records;
+    };
+
+    /**
+     * リストから所有したレコードを返し，まだなければ追加する．
+     *
+     * 追加する際に，破棄されたクラスのリストから所有したレコードを取り除く．
+     *
+     * @param[in] list ハザードレコードのリスト
+     * @return 所有したレコード
+     */
+    Entry& Find(const std::shared_ptr<RecordList>& list) {
+      for (Entry& entry : entries_) {
+        if (entry.list == list) {
+          return entry;
+        }
+      }
+      auto expired = std::remove_if(entries_.begin(), entries_.end(),
+        [](const Entry& entry) { return entry.list.use_count() == 1; });
+      entries_.erase(expired, entries_.end());
+      entries_.push_back(Entry{list, {}});
+      return entries_.back();
+    }
+
+    /**
+     * リストから所有したレコードの所有を解除する．
+     *
+     * @param[in,out] entry リストから所有したレコード
+     */
+    static void Release(Entry& entry) {
+      for (Record* record : entry.records) {
+        record->hazard.store(nullptr, std::memory_order_relaxed);
+        record->owned.store(false, std::memory_order_release);
+      }
+    }
+
+  private:
+    /** リストごとに所有したレコード． */
+    std::vector<Entry> entries_;
+  };
+
+  /**
+   * 呼び出したスレッドのハザードレコードのうち，ReadGuard が占有していないものを占有する．
+   *
+   * @return 占有したハザードレコード
+   */
+  Record* ClaimRecord() const {
+    thread_local ThreadRecords thread_records;
+    return thread_records.Claim(records_);
+  }
+
+  /**
+   * 受け付けた再構築を順に実行する．
+   *
+   * 破棄する場合は，受け付けた再構築をすべて実行してから終了する．
+   */
+  void RebuildLoop() {
+    std::unique_lock<std::mutex> lock(rebuild_mutex_);
+    while (true) {
+      rebuild_cv_.wait(lock, [this]() { return stopping_ || !rebuild_tasks_.empty(); });
+      if (rebuild_tasks_.empty()) {
+        break;
+      }
+      std::packaged_task<bool()> task = std::move(rebuild_tasks_.front());
+      rebuild_tasks_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+  /**
+   * 差し替えたフィルタのうち，どのハザードレコードにも登録されていないものを解放する．
+   *
+   * publish_mutex_ を取得した状態で呼び出す．
+   *
+   * @return まだ解放できないフィルタの個数
+   */
+  std::size_t ReclaimLocked() {
+    std::vector<const Filter*> hazards;
+    for (const Record* record = records_->head.load(std::memory_order_seq_cst); record != nullptr;
+         record = record->next) {
+      const Filter* hazard = record->hazard.load(std::memory_order_seq_cst);
+      if (hazard != nullptr) {
+        hazards.push_back(hazard);
+      }
+    }
+    auto in_use = [&hazards](const Filter* filter) {
+      return std::find(hazards.begin(), hazards.end(), filter) != hazards.end();
+    };
+    auto it = std::partition(retired_.begin(), retired_.end(), in_use);
+    for (auto p = it; p != retired_.end(); ++p) {
+      delete *p;
+    }
+    retired_.erase(it, retired_.end());
+    return retired_.size();
+  }
+
+private:
+  /** 現在のフィルタ． */
+  std::atomic<const Filter*> current_;
+
+  /** 差し替えた回数． */
+  std::atomic<std::uint64_t> generation_;
+
+  /** ハザードレコードのリスト． */
+  std::shared_ptr<RecordList> records_;
+
+  /** 差し替えたが解放していないフィルタ． */
+  std::vector<const Filter*> retired_;
+
+  /** 差し替えと解放を1個ずつ行うためのミューテックス． */
+  std::mutex publish_mutex_;
+
+  /** 以下の再構築用のメンバを保護するミューテックス． */
+  std::mutex rebuild_mutex_;
+
+  /** 再構築用のスレッドを起こすための条件変数． */
+  std::condition_variable rebuild_cv_;
+
+  /** 受け付けたが始めていない再構築． */
+  std::deque<std::packaged_task<bool()>> rebuild_tasks_;
+
+  /** 破棄する場合は true． */
+  bool stopping_;
+
+  /** 再構築用のスレッド (最初の Rebuild() で起動する)． */
+  std::thread rebuilder_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_FILTER_HOLDER_H_
@@ -0,0 +1,239 @@
+/**
+ * @file hasher.h
+ * @brief Bloom filter の要素のハッシュ値を計算する方針クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_HASHER_H_
+#define CPPBF_HASHER_H_
+
+#include "util.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 計算済みのハッシュ値を保持する構造体．
+ *
+ * 方針クラスの First(), Second() の値をフィルタ用配列サイズで割る前の64ビット値のまま保持する．<br>
+ * 配列サイズによらないため，一度計算すれば，同じ方針クラスを使う配列サイズの異なる複数のフィルタに
+ * Insert(), Contains() で渡せる．
+ */
+struct HashedKey {
+  /** double hashing の1個目のハッシュ値． */
+  std::uint64_t first = 0;
+
+  /** double hashing の2個目のハッシュ値． */
+  std::uint64_t second = 0;
+};
+
+/**
+ * 要素のハッシュ値を計算する．
+ *
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス
+ * @tparam T 要素の型
+ * @param[in] entry ハッシュ値を計算したい要素
+ * @return 計算済みのハッシュ値
+ */
+template <class HashPolicy, class T>
+HashedKey MakeHashedKey(const T& entry) {
+  return HashedKey{HashPolicy::First(entry), HashPolicy::Second(entry)};
+}
+
+/**
+ * フィルタ用配列サイズのビット数の底2による対数値の上限．
+ *
+ * 2^33 [bits] = 2^3 * 2^30 [bits] = 8 * (2^10)^3 [bits] = 1 [GB] を限度とする．
+ */
+constexpr std::size_t kMaxLog2NumBits = 33;
+
+/**
+ * 計算済みのハッシュ値に対応するビットの位置を順に関数に与える．
+ *
+ * Enhanced double hashing により，2種類のハッシュ値 h1, h2 について，<br>
+ * i 番目の位置として h1 + i*h2 + (i*i*i - i)/6 をフィルタ用配列サイズのビット数で割った余りを与える．<br>
+ * h2 は2倍して1を足し，配列サイズと互いに素にしてから使う．<br>
+ * すべてのフィルタはこの関数で位置を求めるため，パラメータが同じであれば同じビットが立つ．
+ *
+ * 関数が bool を返す場合，false を返した時点で打ち切る．
+ *
+ * @tparam Function 位置を受け取る関数の型
+ * @param[in] key 計算済みのハッシュ値
+ * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+ * @param[in] num_hashes ハッシュ関数の個数
+ * @param[in] function 位置を受け取る関数
+ * @return 打ち切らなかった場合は true
+ */
+template <class Function>
+constexpr bool ForEachPosition(const HashedKey& key, std::size_t log2_num_bits,
+    std::size_t num_hashes, Function&& function) {
+  std::size_t mask = (std::size_t{1} << log2_num_bits) - 1;
+  std::size_t a = key.first & mask;
+  std::size_t b = ((key.second << 1) | 1) & mask;
+  for (std::size_t i = 0; i < num_hashes; i++) {
+    if constexpr (std::is_same<decltype(function(a)), bool>::value) {
+      if (!function(a)) {
+        return false;
+      }
+    }
+    else {
+      function(a);
+    }
+    a = (a + b) & mask;
+    b = (b + i + 1) & mask;
+  }
+  return true;
+}
+
+/**
+ * @brief 要素のハッシュ値を計算する方針クラス．
+ *
+ * BloomFilter, ConcurrentBloomFilter の第2テンプレート引数の既定値である．<br>
+ * 方針クラスは以下の静的メンバ関数をもつ．
+ * * static std::uint64_t First(const T& entry) : double hashing の1個目のハッシュ値
+ * * static std::uint64_t Second(const T& entry) : 1個目とは異なるハッシュ関数によるハッシュ値
+ *
+ * いずれもフィルタ用配列サイズで割った余りをとって使うため，下位ビットがよく撹拌されている必要がある．<br>
+ * 組み込みの特殊化は std::to_string 可能な数値型と文字列型のみであり，
+ * その他の型を使う場合は，この型を特殊化するか，同じ静的メンバ関数をもつクラスを
+ * テンプレート引数に与える．固定長のバイト列で表される型には ByteHasher が使える．
+ *
+ * @tparam T 要素の型
+ */
+template <class T>
+struct Hasher {
+  static_assert(sizeof(T) == 0,
+    "No hasher for this type. Specialize sbf::Hasher or pass a hasher policy "
+    "(e.g. sbf::ByteHasher) as the second template argument.");
+};
+
+/**
+ * @brief std::to_string 可能な数値型のための方針クラス．
+ *
+ * 1個目は std::hash による，2個目は文字列化したものの djb2 によるハッシュ値を返す．
+ *
+ * @tparam T 要素の型
+ */
+template <class T>
+struct ToStringHasher {
+  /**
+   * double hashing の1個目のハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return ハッシュ値
+   */
+  static std::uint64_t First(const T& entry) {
+    return std::hash<T>{}(entry);
+  }
+
+  /**
+   * double hashing の2個目のハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return ハッシュ値
+   */
+  static std::uint64_t Second(const T& entry) {
+    return hash::Djb2(std::to_string(entry));
+  }
+};
+
+template <> struct Hasher<int> : ToStringHasher<int> {};
+template <> struct Hasher<unsigned int> : ToStringHasher<unsigned int> {};
+template <> struct Hasher<long> : ToStringHasher<long> {};
+template <> struct Hasher<unsigned long> : ToStringHasher<unsigned long> {};
+template <> struct Hasher<long long> : ToStringHasher<long long> {};
+template <> struct Hasher<unsigned long long> : ToStringHasher<unsigned long long> {};
+template <> struct Hasher<float> : ToStringHasher<float> {};
+template <> struct Hasher<double> : ToStringHasher<double> {};
+template <> struct Hasher<long double> : ToStringHasher<long double> {};
+
+/**
+ * @brief 文字列のための方針クラス．
+ *
+ * 1個目は std::hash による，2個目は djb2 によるハッシュ値を返す．<br>
+ * std::string_view を受け取るため，std::string の要素を複製せずに計算できる．
+ */
+template <>
+struct Hasher<std::string> {
+  /**
+   * double hashing の1個目のハッシュ値を返す．
+   *
+   * std::hash<std::string_view> は同じ内容の std::string に対して
+   * std::hash<std::string> と同じ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい文字列
+   * @return ハッシュ値
+   */
+  static std::uint64_t First(std::string_view entry) {
+    return std::hash<std::string_view>{}(entry);
+  }
+
+  /**
+   * double hashing の2個目のハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい文字列
+   * @return ハッシュ値
+   */
+  static std::uint64_t Second(std::string_view entry) {
+    return hash::Djb2(entry);
+  }
+};
+
+/**
+ * @brief std::string_view のための方針クラス．
+ *
+ * 同じ内容の std::string と同じハッシュ値を返す．
+ */
+template <>
+struct Hasher<std::string_view> : Hasher<std::string> {};
+
+/**
+ * @brief 固定長のバイト列で表される型のための方針クラス．
+ *
+ * 要素のオブジェクト表現を hash::HashBytes() で異なるシードにより2回ハッシュする．<br>
+ * UUID や std::array<std::uint8_t, 16> のような型を文字列化せずに扱える．<br>
+ * 値が等しければオブジェクト表現も等しい型 (パディングを含まないトリビアルコピー可能な型) のみを認める．
+ *
+ * @tparam T 要素の型
+ */
+template <class T>
+struct ByteHasher {
+  static_assert(std::is_trivially_copyable<T>::value
+    && std::has_unique_object_representations<T>::value,
+      "ByteHasher only supports trivially copyable types without padding.");
+
+  /**
+   * double hashing の1個目のハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return ハッシュ値
+   */
+  static std::uint64_t First(const T& entry) {
+    return hash::HashBytes(&entry, sizeof(T), 0);
+  }
+
+  /**
+   * double hashing の2個目のハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return ハッシュ値
+   */
+  static std::uint64_t Second(const T& entry) {
+    return hash::HashBytes(&entry, sizeof(T), kSecondSeed);
+  }
+
+private:
+  /** 2個目のハッシュ値のシード． */
+  static constexpr std::uint64_t kSecondSeed = 0x5bd1e9955bd1e995ull;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_HASHER_H_
@@ -0,0 +1,282 @@
+/**
+ * @file insert_log.h
+ * @brief 追加した要素のハッシュ値を記録する先行書き込みログを宣言するヘッダファイル．
+ *
+ * ログは以下のヘッダと，それに続く0個以上のブロックからなる．
+ * 数値はすべてリトルエンディアンで格納する．
+ * | オフセット | サイズ | 内容 |
+ * | ---------: | -----: | :--- |
+ * | 0  | 8 | マジックナンバー "SBFINLOG" |
+ * | 8  | 4 | 書式のバージョン (1) |
+ * | 12 | 4 | 予約 (0) |
+ * | 16 | 8 | 最初の記録より前に追加された要素数 (base) |
+ *
+ * 各ブロックは1回の同期でまとめて書き出した記録であり，以下からなる．
+ * | オフセット | サイズ | 内容 |
+ * | ---------: | -----: | :--- |
+ * | 0  | 8 | 記録の個数 n |
+ * | 8  | 8 | 記録の個数と記録のチェックサム |
+ * | 16 | 16 * n | 記録 (HashedKey の first, second の順) |
+ *
+ * 書き出しの途中で停止した場合，最後のブロックは不完全となる．
+ * 読み込みでは，サイズが足りないかチェックサムが一致しないブロック以降を無視する．
+ */
+
+#ifndef CPPBF_INSERT_LOG_H_
+#define CPPBF_INSERT_LOG_H_
+
+#include "hasher.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/** ログのヘッダのサイズ [bytes]． */
+constexpr std::size_t kInsertLogHeaderSize = 24;
+
+/** ログのブロックのヘッダのサイズ [bytes]． */
+constexpr std::size_t kInsertLogBlockHeaderSize = 16;
+
+/** ログの1個の記録のサイズ [bytes]． */
+constexpr std::size_t kInsertLogRecordSize = 16;
+
+/** ログの1ブロックにまとめる記録の個数の既定値． */
+constexpr std::size_t kDefaultLogBatchSize = 4096;
+
+/** ログを同期する間隔の既定値 [us]． */
+constexpr std::size_t kDefaultLogFlushIntervalUs = 2000;
+
+/**
+ * @brief 追加した要素のハッシュ値を記録する先行書き込みログ．
+ *
+ * Append() は記録をメモリ上のバッファに加えるのみであり，別のスレッドが一定個数か一定時間ごとに
+ * まとめて書き出して同期する (group commit)．<br>
+ * そのため Append() は同期を待たず，同期の回数は追加した要素数によらず抑えられる．
+ * 書き出しが追いつかずにバッファが上限に達した場合のみ，Append() は書き出しを待つ．<br>
+ * 記録が永続化されたことを確認する場合は Sync() を呼び出す．
+ *
+ * 書き出しに失敗した場合，ログの末尾には途中まで書き出したブロックが残りうる．
+ * その後ろに書き出した記録は読み込まれないため，以降に加えた記録は書き出さずに捨て，
+ * Sync() は false を返す．<br>
+ * Open() で開き直すと，完全なブロックまでを残して追記を再開する．
+ *
+ * バッファは Append() のみが書き込み，書き出すスレッドのみが取り出すリングバッファであり，
+ * Append() はロックを取らずに記録を加える．<br>
+ * 書き出すスレッドは同期する間隔ごとにバッファを確認するため，加えた記録は
+ * Sync() を呼び出さなくても同期する間隔と1回の同期にかかる時間のうちに永続化される．
+ *
+ * すべてのメンバ関数は1個のスレッドから呼び出す．
+ */
+class InsertLog {
+public:
+  /**
+   * 1ブロックにまとめる記録の個数と同期する間隔を与えて初期化する．
+   *
+   * @param[in] max_batch_size 1ブロックにまとめる記録の個数 (1以上)
+   * @param[in] flush_interval 同期する間隔
+   */
+  explicit InsertLog(std::size_t max_batch_size = kDefaultLogBatchSize,
+    std::chrono::microseconds flush_interval
+      = std::chrono::microseconds(kDefaultLogFlushIntervalUs));
+
+  /** デストラクタ．記録をすべて書き出して閉じる． */
+  ~InsertLog();
+
+  InsertLog(const InsertLog&) = delete;
+  InsertLog& operator=(const InsertLog&) = delete;
+
+  /**
+   * ログを開いて記録できるようにする．
+   *
+   * ファイルが有効なログであれば，その base を引き継ぎ，不完全なブロックを切り詰めて追記する．<br>
+   * そうでなければ，base を与えた空のログで置き換える．
+   *
+   * @param[in] path ファイルのパス
+   * @param[in] base 新たに作成する場合の，最初の記録より前に追加された要素数
+   * @return 開けた場合は true
+   */
+  bool Open(const std::string& path, std::uint64_t base);
+
+  /**
+   * 記録を加える．
+   *
+   * 開いていない場合は何もしない．
+   *
+   * @param[in] key 追加した要素のハッシュ値
+   */
+  void Append(const HashedKey& key);
+
+  /**
+   * それまでに加えた記録がすべて永続化されるのを待つ．
+   *
+   * @return 永続化された場合は true (書き出しに失敗していた場合は false)
+   */
+  bool Sync();
+
+  /**
+   * 記録をすべて書き出した後，base を与えた空のログに置き換える．
+   *
+   * 一時ファイルに書き出して名前を変更するため，途中で停止しても以前のログか新しいログのいずれかが残る．
+   *
+   * @param[in] base 最初の記録より前に追加された要素数
+   * @return 置き換えた場合は true
+   */
+  bool Reset(std::uint64_t base);
+
+  /** 記録をすべて書き出して閉じる． */
+  void Close();
+
+  /**
+   * 開いているかを返す．
+   *
+   * @return 開いている場合は true
+   */
+  bool IsOpen() const {
+    return fd_ >= 0;
+  }
+
+  /**
+   * 最初の記録より前に追加された要素数を返す．
+   *
+   * @return 最初の記録より前に追加された要素数
+   */
+  std::uint64_t Base() const {
+    return base_;
+  }
+
+  /**
+   * 開いてから加えた記録の個数を返す．
+   *
+   * @return 加えた記録の個数
+   */
+  std::uint64_t NumAppended() const;
+
+  /**
+   * 開いてから加えた記録のうち，永続化された個数を返す．
+   *
+   * @return 永続化された記録の個数
+   */
+  std::uint64_t NumDurable() const;
+
+private:
+  /** バッファの記録を書き出して同期することを繰り返す． */
+  void FlushLoop();
+
+  /**
+   * 記録を1ブロックとして書き出して同期する．
+   *
+   * @param[in] fd ファイル記述子
+   * @param[in] keys 記録
+   * @return 書き出せた場合は true
+   */
+  bool WriteBlock(int fd, const std::vector<HashedKey>& keys);
+
+  /**
+   * 書き出しを待つことなく Append() できる記録の個数．
+   *
+   * 同期を待つ間は，この個数まで次のブロックにまとめる記録をためる．
+   */
+  std::size_t MaxBufferSize() const {
+    return 64 * max_batch_size_;
+  }
+
+  /**
+   * リングバッファの記録を取り出す．
+   *
+   * mutex_ を取得した状態で書き出すスレッドから呼び出す．
+   *
+   * @param[out] keys 取り出した記録
+   */
+  void DrainRing(std::vector<HashedKey>& keys);
+
+private:
+  /** 1ブロックにまとめる記録の個数． */
+  std::size_t max_batch_size_;
+
+  /** 同期する間隔． */
+  std::chrono::microseconds flush_interval_;
+
+  /** ファイルのパス． */
+  std::string path_;
+
+  /** ファイル記述子．開いていない場合は -1 とする． */
+  int fd_;
+
+  /** 最初の記録より前に追加された要素数． */
+  std::uint64_t base_;
+
+  /**
+   * まだ書き出していない記録のリングバッファ．
+   *
+   * 要素数は MaxBufferSize() 以上の2のべき乗とする．
+   */
+  std::unique_ptr<HashedKey[]> ring_;
+
+  /** リングバッファの要素数から1を引いた値． */
+  std::size_t ring_mask_;
+
+  /** 加えた記録の個数．Append() のみが書き込む． */
+  std::atomic<std::uint64_t> tail_;
+
+  /** 書き出すスレッドが取り出した記録の個数．書き出すスレッドのみが書き込む． */
+  std::atomic<std::uint64_t> head_;
+
+  /** 以下のメンバを保護するミューテックス． */
+  mutable std::mutex mutex_;
+
+  /** 書き出すスレッドを起こすための条件変数． */
+  std::condition_variable flush_cv_;
+
+  /** 書き出しの完了を待つための条件変数． */
+  std::condition_variable durable_cv_;
+
+  /** 永続化された記録の個数． */
+  std::uint64_t num_durable_;
+
+  /** Sync() が待っている場合は true． */
+  bool sync_requested_;
+
+  /** 書き出すスレッドがバッファから取り出した記録を書き出している間は true． */
+  bool flushing_;
+
+  /** Close() で書き出すスレッドを終了させる場合は true． */
+  bool closing_;
+
+  /** 書き出しに失敗した場合は true． */
+  bool error_;
+
+  /** 書き出すスレッドがブロックを組み立てるバッファ． */
+  std::vector<char> block_;
+
+  /** 書き出すスレッド． */
+  std::thread flusher_;
+};
+
+/**
+ * ログの記録を順に読み込む．
+ *
+ * 不完全なブロック以降は無視する．
+ *
+ * @param[in] path ファイルのパス
+ * @param[out] base 最初の記録より前に追加された要素数
+ * @param[in] function 記録を受け取る関数
+ * @return ヘッダが有効なログを読み込めた場合は true
+ */
+bool ReplayInsertLog(const std::string& path, std::uint64_t& base,
+  const std::function<void(const HashedKey&)>& function);
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_INSERT_LOG_H_
@@ -0,0 +1,117 @@
+/**
+ * @file line_reader.h
+ * @brief 改行区切りの要素を読み込むクラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_LINE_READER_H_
+#define CPPBF_LINE_READER_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 改行区切りの要素をファイルまたは標準入力から読み込むクラス．
+ *
+ * 通常のファイルはメモリにマップし，それ以外 (標準入力やパイプ) は大きなバッファ単位で読み込む．<br>
+ * 各行はバッファ内を指す std::string_view として返すため，行ごとのメモリ確保は発生しない．<br>
+ * 行末の改行文字 ('\\n') と，その直前の復帰文字 ('\\r') は取り除く．
+ */
+class LineReader {
+public:
+  /**
+   * 読み込むファイルのパスを与えて初期化する．
+   *
+   * パスが "-" の場合は標準入力から読み込む．<br>
+   * ファイルを開けたかは IsOpen() で確認できる．
+   *
+   * @param[in] path ファイルのパス
+   */
+  explicit LineReader(const std::string& path);
+
+  /** デストラクタ． */
+  ~LineReader();
+
+  LineReader(const LineReader&) = delete;
+  LineReader& operator=(const LineReader&) = delete;
+
+  /**
+   * ファイルを開けたかを返す．
+   *
+   * @return ファイルを開けた場合は true
+   */
+  bool IsOpen() const {
+    return fd_ >= 0;
+  }
+
+  /**
+   * 次の行を読み込む．
+   *
+   * 返した行は次に Next() を呼び出すまで有効である．
+   *
+   * @param[out] line 読み込んだ行
+   * @return 行を読み込めた場合は true，末尾に達したか読み込みに失敗した場合は false
+   */
+  bool Next(std::string_view& line);
+
+  /**
+   * 読み込みに失敗したかを返す．
+   *
+   * @return 読み込みに失敗した場合は true
+   */
+  bool HasError() const {
+    return has_error_;
+  }
+
+private:
+  /**
+   * バッファに続きを読み込む．
+   *
+   * 未処理のデータはバッファの先頭に移動し，バッファが一杯であれば拡張する．
+   *
+   * @return 1バイト以上読み込めた場合は true
+   */
+  bool Fill();
+
+public:
+  /** 読み込みバッファの初期サイズ [bytes]． */
+  static constexpr std::size_t kBufferSize = 1 << 20;
+
+private:
+  /** ファイル記述子． */
+  int fd_;
+
+  /** ファイル記述子を閉じる必要がある場合は true． */
+  bool owns_fd_;
+
+  /** マップしたファイルの先頭（マップしていない場合は nullptr）． */
+  char* mapped_;
+
+  /** マップしたファイルのサイズ [bytes]． */
+  std::size_t mapped_size_;
+
+  /** 読み込みバッファ． */
+  std::vector<char> buffer_;
+
+  /** 未処理のデータの先頭． */
+  std::size_t begin_;
+
+  /** 未処理のデータの末尾の次． */
+  std::size_t end_;
+
+  /** 入力の末尾に達した場合は true． */
+  bool eof_;
+
+  /** 読み込みに失敗した場合は true． */
+  bool has_error_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_LINE_READER_H_
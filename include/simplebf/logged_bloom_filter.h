@@ -0,0 +1,308 @@
+/**
+ * @file logged_bloom_filter.h
+ * @brief 追加を先行書き込みログに記録し，停止後に復元できる Bloom filter 用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_LOGGED_BLOOM_FILTER_H_
+#define CPPBF_LOGGED_BLOOM_FILTER_H_
+
+#include "checkpoint_bloom_filter.h"
+#include "hasher.h"
+#include "insert_log.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 追加を先行書き込みログに記録し，停止後に復元できる Bloom filter 用クラス．
+ *
+ * Open() で指定したパスにスナップショットを，そのパスに ".log" を加えたパスに
+ * 追加した要素のハッシュ値のログ (InsertLog) を置く．<br>
+ * Insert() はフィルタにビットを立て，ログのバッファに記録を加える．ログは別のスレッドがまとめて同期するため，
+ * Insert() は同期を待たない．Sync() は，それまでに追加した要素の記録が永続化されるのを待つ．
+ *
+ * Checkpoint() はログを同期した後にスナップショットを書き出し (CheckpointBloomFilter::Checkpoint())，
+ * ログを空にする．<br>
+ * 停止したプロセスは，Open() でスナップショットを読み込み，それより後に追加された要素の記録を
+ * ログから再生することで，同期済みの時点のフィルタ用配列と要素数を正確に復元できる．<br>
+ * ログの base (ログを空にした時点の要素数) とスナップショットの要素数を比べて再生を始める位置を決めるため，
+ * Checkpoint() のどの時点で停止しても，同じ要素を重複して数えることはない．
+ *
+ * BloomFilter と同じく，Insert(), Sync(), Checkpoint() は1個のスレッドから呼び出す．<br>
+ * 位置の計算方法は BloomFilter と同じであり，同じパラメータの BloomFilter と同じビットが立つ．
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class LoggedBloomFilter {
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
+
+public:
+  /**
+   * フィルタ用配列サイズのビット数，ハッシュ関数の個数とログの設定を与えて初期化する．
+   *
+   * Open() したスナップショットがある場合は，そのパラメータで置き換える．<br>
+   * パラメータの制約は BloomFilter と同じであり，制約を満たさない場合は
+   * 最も近い値を設定してパラメータエラーフラグを立てる．
+   *
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @param[in] num_hashes ハッシュ関数の個数
+   * @param[in] max_batch_size ログの1ブロックにまとめる記録の個数
+   * @param[in] flush_interval ログを同期する間隔
+   */
+  LoggedBloomFilter(std::size_t log2_num_bits, std::size_t num_hashes,
+      std::size_t max_batch_size = kDefaultLogBatchSize,
+      std::chrono::microseconds flush_interval
+        = std::chrono::microseconds(kDefaultLogFlushIntervalUs))
+      : filter_(log2_num_bits, num_hashes), log_(max_batch_size, flush_interval) {
+  }
+
+  LoggedBloomFilter(const LoggedBloomFilter&) = delete;
+  LoggedBloomFilter& operator=(const LoggedBloomFilter&) = delete;
+
+  /**
+   * スナップショットとログから復元し，以降の追加を記録できるようにする．
+   *
+   * path にスナップショットがあれば読み込み，ログの記録のうちスナップショットより後のものを再生する．<br>
+   * スナップショットがなければ，コンストラクタのパラメータの空のフィルタにログを再生する．<br>
+   * ログがスナップショットより新しい時点から始まっている場合 (スナップショットが失われた場合) は false を返す．
+   *
+   * @param[in] path スナップショットのパス
+   * @return 開けた場合は true
+   */
+  bool Open(const std::string& path) {
+    if (std::ifstream(path).good() && !filter_.Load(path)) {
+      return false;
+    }
+
+    std::string log_path = path + ".log";
+    std::uint64_t base = 0;
+    std::uint64_t position = 0;
+    std::uint64_t start = filter_.Size();
+    bool replayed = ReplayInsertLog(log_path, base, [&](const HashedKey& key) {
+      if (base + position++ >= start) {
+        filter_.Insert(key);
+      }
+    });
+    if (replayed && base > start) {
+      return false;
+    }
+
+    path_ = path;
+    if (!log_.Open(log_path, filter_.Size())) {
+      return false;
+    }
+    // ログの末尾がフィルタの要素数と一致しない場合は，以降の記録の位置を合わせるために空にする．
+    return log_.Base() + (replayed ? position : 0) == filter_.Size()
+      || log_.Reset(filter_.Size());
+  }
+
+  /**
+   * 要素を追加する．
+   *
+   * @param[in] entry 追加する要素
+   */
+  void Insert(const T& entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列を追加する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 追加する文字列
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  void Insert(std::string_view entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を追加する．
+   *
+   * フィルタにビットを立て，ハッシュ値をログに記録する．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void Insert(const HashedKey& key) {
+    filter_.Insert(key);
+    log_.Append(key);
+  }
+
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return filter_.Contains(entry);
+  }
+
+  /**
+   * 文字列が含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 含まれているかを判定したい文字列
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(std::string_view entry) const {
+    return filter_.Contains(entry);
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key) const {
+    return filter_.Contains(key);
+  }
+
+  /**
+   * それまでに追加した要素の記録が永続化されるのを待つ．
+   *
+   * @return 永続化された場合は true
+   */
+  bool Sync() {
+    return log_.Sync();
+  }
+
+  /**
+   * スナップショットを書き出し，ログを空にする．
+   *
+   * ログを同期してからスナップショットを書き出すため，スナップショットの要素はすべてログにも記録されている．<br>
+   * Open() していない場合は false を返す．
+   *
+   * @return 書き出せた場合は true
+   */
+  bool Checkpoint() {
+    return log_.IsOpen() && log_.Sync() && filter_.Checkpoint(path_)
+      && log_.Reset(filter_.Size());
+  }
+
+  /** ログの記録をすべて書き出して閉じる．以降の追加は記録しない． */
+  void Close() {
+    log_.Close();
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * フィルタ用配列の先頭を返す．
+   *
+   * @return フィルタ用配列の先頭
+   */
+  const std::uint64_t* Data() const {
+    return filter_.Data();
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  std::size_t Log2NumBits() const {
+    return filter_.Log2NumBits();
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  std::size_t NumHashes() const {
+    return filter_.NumHashes();
+  }
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  std::size_t NumWords() const {
+    return filter_.NumWords();
+  }
+
+  /**
+   * 追加された要素数を返す．
+   *
+   * @return 追加された要素数．
+   */
+  std::size_t Size() const {
+    return filter_.Size();
+  }
+
+  /**
+   * パラメータエラーを表すビットフラグを返す．
+   *
+   * @return パラメータエラーを表すビットフラグ．
+   */
+  int ParameterErrorFlags() const {
+    return filter_.ParameterErrorFlags();
+  }
+
+  /**
+   * パラメータエラーがあるかを返す．
+   *
+   * @return パラメータエラーがある場合はtrue.
+   */
+  bool HasParameterError() const {
+    return filter_.HasParameterError();
+  }
+
+  /**
+   * ログを返す．
+   *
+   * @return ログ
+   */
+  const InsertLog& Log() const {
+    return log_;
+  }
+
+public:
+  /** フィルタ用配列サイズのビット数の底2による対数値の設定に対するビットフラグ */
+  static constexpr int kHasLog2NumBitsError = CheckpointBloomFilter<T, HashPolicy>::kHasLog2NumBitsError;
+
+  /** Bloom filter におけるハッシュ関数の個数に対するビットフラグ */
+  static constexpr int kHasNumHashesError = CheckpointBloomFilter<T, HashPolicy>::kHasNumHashesError;
+
+private:
+  /** フィルタ． */
+  CheckpointBloomFilter<T, HashPolicy> filter_;
+
+  /** 追加した要素のハッシュ値のログ． */
+  InsertLog log_;
+
+  /** スナップショットのパス． */
+  std::string path_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_LOGGED_BLOOM_FILTER_H_
@@ -0,0 +1,77 @@
+/**
+ * @file numa.h
+ * @brief NUMA ノードの情報を扱う関数を宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_NUMA_H_
+#define CPPBF_NUMA_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief NUMA ノードの情報を扱う関数のための名前空間．
+ *
+ * libnuma に依存しないよう，ノードの構成は /sys/devices/system/node から読み込む．<br>
+ * 読み込めない環境では，全 CPU が1個のノード0に属するものとして扱う．
+ */
+namespace numa {
+
+/**
+ * "0-3,8,10-11" の形式の CPU 番号の一覧を展開する．
+ *
+ * @param[in] list CPU 番号の一覧
+ * @return CPU 番号を昇順に並べたベクトル
+ */
+std::vector<int> ParseCpuList(const std::string& list);
+
+/**
+ * NUMA ノード数を返す．
+ *
+ * @return NUMA ノード数 (1以上)
+ */
+std::size_t NumNodes();
+
+/**
+ * NUMA ノードに属する CPU 番号を返す．
+ *
+ * @param[in] node ノード番号 (NumNodes() 未満)
+ * @return CPU 番号を昇順に並べたベクトル
+ */
+const std::vector<int>& NodeCpus(std::size_t node);
+
+/**
+ * 呼び出したスレッドが実行されている CPU の NUMA ノードを返す．
+ *
+ * sched_getcpu() と表引きで求め，結果をスレッドごとに保持して一定回数ごとに求め直す．<br>
+ * したがって判定ごとに呼び出せる程度に軽いが，スレッドが他のノードに移動した直後は
+ * 移動前のノードを返すことがある．
+ *
+ * @return ノード番号 (NumNodes() 未満)
+ */
+std::size_t CurrentNode();
+
+/**
+ * NUMA ノードに固定したスレッドで関数を実行し，終了を待つ．
+ *
+ * 関数内で初めて書き込んだメモリのページは，Linux の first-touch の方針によりそのノードに割り当てられる．<br>
+ * スレッドを固定できなかった場合も関数は実行する．
+ *
+ * @param[in] node ノード番号 (NumNodes() 未満)
+ * @param[in] function 実行する関数
+ * @return スレッドをノードに固定できた場合は true
+ */
+bool RunOnNode(std::size_t node, const std::function<void()>& function);
+
+} // namespace numa
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_NUMA_H_
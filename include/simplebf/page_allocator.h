@@ -0,0 +1,397 @@
+/**
+ * @file page_allocator.h
+ * @brief フィルタ用配列をページ単位で確保するアロケータを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_PAGE_ALLOCATOR_H_
+#define CPPBF_PAGE_ALLOCATOR_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief フィルタ用配列に使うページの種類．
+ */
+enum class HugePages {
+  /** 通常のページを使う．kDirectMapThreshold 未満は operator new で，それ以上は mmap で確保する． */
+  kNone,
+
+  /** 2MB 境界に揃えた匿名メモリを確保し，madvise(MADV_HUGEPAGE) で透過的 huge page を要求する． */
+  kTransparent,
+
+  /** MAP_HUGETLB で 2MB の huge page を確保する．確保できない場合は kTransparent とする． */
+  k2MB,
+
+  /** MAP_HUGETLB で 1GB の huge page を確保する．確保できない場合は k2MB とする． */
+  k1GB,
+};
+
+/**
+ * @brief ページ単位で確保したメモリを表す構造体．
+ */
+struct PageMapping {
+  /** 先頭． */
+  void* addr = nullptr;
+
+  /** サイズ [bytes]． */
+  std::size_t length = 0;
+
+  /** MAP_HUGETLB で確保した場合は huge page のサイズ，それ以外は通常のページサイズ [bytes]． */
+  std::size_t page_size = 0;
+
+  /** 透過的 huge page を要求した場合は true． */
+  bool transparent = false;
+};
+
+/** PageAllocator が HugePages::kNone でも mmap で確保するサイズの下限 [bytes]． */
+constexpr std::size_t kDirectMapThreshold = std::size_t{1} << 21;
+
+/**
+ * 匿名メモリをページ単位で確保する．
+ *
+ * 要求したページの種類で確保できない場合は，HugePages の各値の説明のとおりに順に代替する．<br>
+ * 確保したメモリの内容は0である．カーネルは0のページを最初に書き込んだときに割り当てるため，
+ * サイズによらずすぐに返る．
+ *
+ * @param[in] size 必要なサイズ [bytes]
+ * @param[in] request ページの種類 (kNone の場合は通常のページ)
+ * @param[out] mapping 確保したメモリ
+ * @return 確保できた場合は true
+ */
+bool MapPages(std::size_t size, HugePages request, PageMapping& mapping);
+
+/**
+ * MapPages() で確保したメモリを解放する．
+ *
+ * @param[in] mapping 確保したメモリ
+ */
+void UnmapPages(const PageMapping& mapping);
+
+/**
+ * 確保したメモリに実際に使われているページのサイズを返す．
+ *
+ * 透過的 huge page を要求した場合は，/proc/self/smaps の AnonHugePages が0より大きければ
+ * huge page のサイズを，そうでなければ通常のページサイズを返す．
+ *
+ * @param[in] mapping 確保したメモリ
+ * @return ページのサイズ [bytes]
+ */
+std::size_t MappedPageSize(const PageMapping& mapping);
+
+/**
+ * 通常のページサイズを返す．
+ *
+ * @return ページのサイズ [bytes]
+ */
+std::size_t BasePageSize();
+
+/** ZeroMappedPages() がページを返却して遅延して0にするサイズの下限 [bytes]． */
+constexpr std::size_t kLazyZeroThreshold = std::size_t{1} << 24;
+
+/** ZeroPages() が1スレッドあたりに0で埋めるサイズの下限 [bytes]． */
+constexpr std::size_t kMinZeroBytesPerThread = std::size_t{1} << 20;
+
+/**
+ * メモリを0で埋める．
+ *
+ * memset で埋め，num_threads が2以上であれば
+ * 1スレッドあたり kMinZeroBytesPerThread 以上となる範囲で分割して並列に埋める．<br>
+ * 確保の方法によらず使える．
+ *
+ * @param[in,out] data 先頭
+ * @param[in] size サイズ [bytes]
+ * @param[in] num_threads memset に使うスレッド数
+ */
+void ZeroPages(void* data, std::size_t size, std::size_t num_threads = 1);
+
+/**
+ * MapPages() で確保したメモリを0で埋める．
+ *
+ * kLazyZeroThreshold 以上の場合は，範囲に含まれる page_size 単位のページを madvise(MADV_DONTNEED) で
+ * カーネルに返し，次に触れたときに0のページを割り当てさせる．
+ * 前後の半端な部分と，返却できなかった場合は memset で埋める．<br>
+ * MAP_HUGETLB で確保したメモリでは，page_size に huge page のサイズ (PageMapping::page_size) を与えること．<br>
+ * それより小さい場合は ZeroPages() と同じである．
+ *
+ * MADV_DONTNEED で0になるのは MAP_PRIVATE の匿名メモリのみであり，共有メモリやファイルのマッピングでは
+ * 以前の内容が読み込まれる．また，アリーナなど他者が管理するメモリのページを返却してはならない．
+ * そのため，MapPages() で確保したメモリの範囲にのみ使う．
+ *
+ * @param[in,out] data 先頭
+ * @param[in] size サイズ [bytes]
+ * @param[in] page_size 確保したメモリのページのサイズ [bytes]
+ * @param[in] num_threads memset に使うスレッド数
+ */
+void ZeroMappedPages(void* data, std::size_t size, std::size_t page_size,
+  std::size_t num_threads = 1);
+
+/**
+ * 匿名メモリのページを書き込み可能な状態で割り当てさせ，最初の書き込み時のページフォールトをなくす．
+ *
+ * 内容は変えない．madvise(MADV_POPULATE_WRITE) が使えない場合は各ページに同じ値を書き戻す．<br>
+ * 範囲を num_threads 個に分割して並列に処理する．
+ * 他のスレッドが同時に書き込む範囲には使えないことに注意する．
+ *
+ * @param[in,out] data 先頭
+ * @param[in] size サイズ [bytes]
+ * @param[in] num_threads スレッド数
+ */
+void PrefaultPages(void* data, std::size_t size, std::size_t num_threads = 1);
+
+/**
+ * @brief PageAllocator のコピー間で共有する状態．
+ */
+struct PageAllocatorState {
+  /** 確保中のメモリ． */
+  std::vector<PageMapping> mappings;
+};
+
+/**
+ * @brief フィルタ用配列をページ単位で確保するアロケータ．
+ *
+ * HugePages::kNone の場合は，kDirectMapThreshold 未満は operator new で，それ以上は MapPages() で通常のページを確保する．<br>
+ * それ以外の場合は MapPages() で huge page を確保する．
+ * 大きなフィルタでは判定の位置がほぼ毎回異なる 4KB ページとなり TLB ミスが頻発するため，
+ * huge page によりこれを減らせる．
+ *
+ * 確保したメモリは，コピーしたアロケータ間で共有する状態に記録し，
+ * 実際に得られたページのサイズを PageSize() で確認できる．<br>
+ * コンテナのコピー時には状態を共有しない新たなアロケータを使う．
+ *
+ * 算術型の要素を引数なしで構築する場合 (std::vector::resize() など) は値初期化を省き，内容は不定とする．<br>
+ * MapPages() で確保したメモリは0であるため，構築時に全ページに触れることなく0の配列が得られる．
+ * そうでない場合は，利用者が AllocatesZeroPages() を確認して0で埋めること．
+ *
+ * @tparam T 要素の型
+ */
+template <class T>
+class PageAllocator {
+  template <class U>
+  friend class PageAllocator;
+
+public:
+  /** 要素の型． */
+  using value_type = T;
+
+  /** コンテナのムーブ代入時にアロケータも移す． */
+  using propagate_on_container_move_assignment = std::true_type;
+
+  /** コンテナの交換時にアロケータも交換する． */
+  using propagate_on_container_swap = std::true_type;
+
+  /** 異なるアロケータで確保したメモリは解放できない． */
+  using is_always_equal = std::false_type;
+
+  /**
+   * ページの種類を与えて初期化する．
+   *
+   * @param[in] request ページの種類
+   */
+  PageAllocator(HugePages request = HugePages::kNone) : request_(request) {
+    // 通常のメモリ確保では状態を使わないため，余分なメモリ確保を避ける．
+    if (request_ != HugePages::kNone) {
+      state_ = std::make_shared<PageAllocatorState>();
+    }
+  }
+
+  /**
+   * 他の要素の型のアロケータから初期化する．状態は共有する．
+   *
+   * @param[in] other アロケータ
+   */
+  template <class U>
+  PageAllocator(const PageAllocator<U>& other) : request_(other.request_),
+      state_(other.state_) {
+  }
+
+  /**
+   * 要素 n 個分のメモリを確保する．
+   *
+   * @param[in] n 要素数
+   * @return 確保したメモリの先頭
+   */
+  T* allocate(std::size_t n) {
+    if (request_ == HugePages::kNone) {
+      if (n * sizeof(T) < kDirectMapThreshold) {
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      }
+      // 状態をもたないため，解放時はサイズから確保の方法を判断する．
+      PageMapping mapping;
+      if (!MapPages(n * sizeof(T), request_, mapping)) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T*>(mapping.addr);
+    }
+    PageMapping mapping;
+    if (!MapPages(n * sizeof(T), request_, mapping)) {
+      throw std::bad_alloc();
+    }
+    state_->mappings.push_back(mapping);
+    return static_cast<T*>(mapping.addr);
+  }
+
+  /**
+   * allocate() で確保したメモリを解放する．
+   *
+   * @param[in] p 確保したメモリの先頭
+   * @param[in] n 要素数
+   */
+  void deallocate(T* p, std::size_t n) {
+    if (request_ == HugePages::kNone) {
+      if (n * sizeof(T) < kDirectMapThreshold) {
+        ::operator delete(p);
+        return;
+      }
+      PageMapping mapping;
+      mapping.addr = p;
+      mapping.length = n * sizeof(T);
+      UnmapPages(mapping);
+      return;
+    }
+    auto& mappings = state_->mappings;
+    for (auto it = mappings.begin(); it != mappings.end(); ++it) {
+      if (it->addr == p) {
+        UnmapPages(*it);
+        mappings.erase(it);
+        return;
+      }
+    }
+  }
+
+  /**
+   * 要素を構築する．
+   *
+   * @param[out] p 構築する位置
+   * @param[in] args コンストラクタの引数
+   */
+  template <class U, class... Args>
+  void construct(U* p, Args&&... args) {
+    ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  /**
+   * 要素を引数なしで構築する．
+   *
+   * 算術型の場合は値初期化を省き，内容は不定とする．
+   *
+   * @param[out] p 構築する位置
+   */
+  template <class U>
+  void construct(U* p) {
+    if constexpr (std::is_arithmetic<U>::value) {
+      ::new(static_cast<void*>(p)) U;
+    }
+    else {
+      ::new(static_cast<void*>(p)) U();
+    }
+  }
+
+  /**
+   * 要素 n 個分のメモリを確保したときに，その内容が0であるかを返す．
+   *
+   * MapPages() で確保する場合は true となる．
+   *
+   * @param[in] n 要素数
+   * @return 内容が0である場合は true
+   */
+  bool AllocatesZeroPages(std::size_t n) const {
+    return request_ != HugePages::kNone || n * sizeof(T) >= kDirectMapThreshold;
+  }
+
+  /**
+   * コンテナのコピー時に使うアロケータを返す．
+   *
+   * ページの種類が同じで，状態を共有しないアロケータを返す．
+   *
+   * @return アロケータ
+   */
+  PageAllocator select_on_container_copy_construction() const {
+    return PageAllocator(request_);
+  }
+
+  /**
+   * 要求したページの種類を返す．
+   *
+   * @return ページの種類
+   */
+  HugePages Request() const {
+    return request_;
+  }
+
+  /**
+   * 最後に確保したメモリに実際に使われているページのサイズを返す．
+   *
+   * HugePages::kNone の場合や確保中のメモリがない場合は通常のページサイズを返す．
+   *
+   * @return ページのサイズ [bytes]
+   */
+  std::size_t PageSize() const {
+    if (state_ == nullptr || state_->mappings.empty()) {
+      return BasePageSize();
+    }
+    return MappedPageSize(state_->mappings.back());
+  }
+
+  /**
+   * allocate() で確保したメモリのページのサイズを返す．
+   *
+   * MAP_HUGETLB で確保した場合は huge page のサイズ，それ以外は通常のページサイズを返す．
+   * madvise() の範囲をページ境界に揃えるために使う．
+   *
+   * @param[in] p allocate() が返したメモリの先頭
+   * @return ページのサイズ [bytes]
+   */
+  std::size_t MappingPageSize(const T* p) const {
+    if (state_ != nullptr) {
+      for (const PageMapping& mapping : state_->mappings) {
+        if (mapping.addr == p) {
+          return mapping.page_size;
+        }
+      }
+    }
+    return BasePageSize();
+  }
+
+  /**
+   * 互いに確保したメモリを解放できるかを返す．
+   *
+   * @param[in] lhs アロケータ
+   * @param[in] rhs アロケータ
+   * @return 解放できる場合は true
+   */
+  friend bool operator==(const PageAllocator& lhs, const PageAllocator& rhs) {
+    return lhs.request_ == rhs.request_
+      && (lhs.request_ == HugePages::kNone || lhs.state_ == rhs.state_);
+  }
+
+  /**
+   * 互いに確保したメモリを解放できないかを返す．
+   *
+   * @param[in] lhs アロケータ
+   * @param[in] rhs アロケータ
+   * @return 解放できない場合は true
+   */
+  friend bool operator!=(const PageAllocator& lhs, const PageAllocator& rhs) {
+    return !(lhs == rhs);
+  }
+
+private:
+  /** 要求したページの種類． */
+  HugePages request_;
+
+  /** アロケータ間で共有する状態 (HugePages::kNone の場合は nullptr)． */
+  std::shared_ptr<PageAllocatorState> state_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_PAGE_ALLOCATOR_H_
@@ -0,0 +1,372 @@
+/**
+ * @file replicated_bloom_filter.h
+ * @brief NUMA ノードごとに複製を持つ Bloom filter 用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_REPLICATED_BLOOM_FILTER_H_
+#define CPPBF_REPLICATED_BLOOM_FILTER_H_
+
+#include "bloom_filter.h"
+#include "hasher.h"
+#include "numa.h"
+#include "striped_counter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief NUMA ノードごとに複製を持つ Bloom filter 用クラス．
+ *
+ * 判定が大半を占める用途で，複数ソケットのマシンのリモートメモリへのアクセスを避けるためのものである．<br>
+ * フィルタ用配列を NUMA ノードごとに1個ずつ持ち，各複製はそのノードに固定したスレッドで確保して
+ * 0で埋めることで，first-touch によりそのノードのメモリに置く．<br>
+ * Contains() は呼び出したスレッドが実行されているノードの複製のみを読み，
+ * Insert() はすべての複製にビットを立てる．
+ *
+ * ビットの操作は ConcurrentBloomFilter と同じくアトミックに行うため，
+ * Insert() と Contains() は任意のスレッドから同時に呼び出せる．<br>
+ * ただし，Insert() の実行中は複製ごとに反映の時点が異なり，
+ * 同時に呼び出した Contains() の結果はノードによって異なりうる．
+ *
+ * 位置の計算方法は BloomFilter と同じであり，各複製には同じパラメータの BloomFilter と同じビットが立つ．
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class ReplicatedBloomFilter {
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
+
+public:
+  /**
+   * フィルタ用配列サイズのビット数とハッシュ関数の個数を与えて初期化する．
+   *
+   * NUMA ノード数だけ複製を確保する．<br>
+   * パラメータの制約は BloomFilter と同じであり，制約を満たさない場合は
+   * 最も近い値を設定してパラメータエラーフラグを立てる．
+   *
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @param[in] num_hashes ハッシュ関数の個数
+   */
+  ReplicatedBloomFilter(std::size_t log2_num_bits, std::size_t num_hashes)
+    : ReplicatedBloomFilter(log2_num_bits, num_hashes, numa::NumNodes()) {
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数，ハッシュ関数の個数と複製の個数を与えて初期化する．
+   *
+   * 複製 r はノード r % numa::NumNodes() に置く．
+   *
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @param[in] num_hashes ハッシュ関数の個数
+   * @param[in] num_replicas 複製の個数 (1以上)
+   */
+  ReplicatedBloomFilter(std::size_t log2_num_bits, std::size_t num_hashes,
+      std::size_t num_replicas) : log2_num_bits_(log2_num_bits),
+      num_hashes_(num_hashes), num_pinned_(0), parameter_error_flags_(0) {
+    if (log2_num_bits_ > kMaxLog2NumBits) {
+      log2_num_bits_ = kMaxLog2NumBits;
+      parameter_error_flags_ |= kHasLog2NumBitsError;
+    }
+    if (num_hashes_ < 1) {
+      num_hashes_ = 1;
+      parameter_error_flags_ |= kHasNumHashesError;
+    }
+
+    // 各複製は配置先のノードに固定したスレッドで確保し，初めて書き込む．
+    std::size_t num_words = NumWords();
+    replicas_.resize(std::max<std::size_t>(num_replicas, 1));
+    for (std::size_t r = 0; r < replicas_.size(); r++) {
+      bool pinned = numa::RunOnNode(r % numa::NumNodes(), [&]() {
+        replicas_[r].reset(new std::atomic<std::uint64_t>[num_words]);
+        for (std::size_t i = 0; i < num_words; i++) {
+          replicas_[r][i].store(0, std::memory_order_relaxed);
+        }
+      });
+      num_pinned_ += pinned;
+    }
+    for (std::size_t node = 0; node < numa::NumNodes(); node++) {
+      node_replicas_.push_back(node % replicas_.size());
+    }
+  }
+
+  ReplicatedBloomFilter(const ReplicatedBloomFilter&) = delete;
+  ReplicatedBloomFilter& operator=(const ReplicatedBloomFilter&) = delete;
+
+  /**
+   * 要素を追加する．
+   *
+   * @param[in] entry 追加する要素
+   */
+  void Insert(const T& entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列を追加する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 追加する文字列
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  void Insert(std::string_view entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を追加する．
+   *
+   * すべての複製に BloomFilter::Insert(const HashedKey&) と同じビットを立てる．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void Insert(const HashedKey& key) {
+    ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      std::uint64_t bit = 1ull << (position & 63);
+      for (auto&& replica : replicas_) {
+        replica[position >> 6].fetch_or(bit, std::memory_order_relaxed);
+      }
+    });
+    size_.Add(1);
+  }
+
+  /**
+   * BloomFilter の内容をすべての複製に追加する．
+   *
+   * 既存の内容との論理和をとる．<br>
+   * 配列サイズまたはハッシュ関数の個数が異なる場合は何もせず false を返す．
+   *
+   * @tparam Allocator Bloom filter のフィルタ用配列のアロケータ
+   * @param[in] bf Bloom filter
+   * @return 追加できた場合は true
+   */
+  template <class Allocator>
+  bool AddFilter(const BloomFilter<T, HashPolicy, Allocator>& bf) {
+    if (bf.Log2NumBits() != log2_num_bits_ || bf.NumHashes() != num_hashes_) {
+      return false;
+    }
+    const std::uint64_t* words = bf.Data();
+    for (auto&& replica : replicas_) {
+      for (std::size_t i = 0; i < NumWords(); i++) {
+        replica[i].fetch_or(words[i], std::memory_order_relaxed);
+      }
+    }
+    size_.Add(bf.Size());
+    return true;
+  }
+
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * 呼び出したスレッドが実行されているノードの複製を読む．
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列が含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 含まれているかを判定したい文字列
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(std::string_view entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * 呼び出したスレッドが実行されているノードの複製を読む．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key) const {
+    return Contains(key, LocalReplica());
+  }
+
+  /**
+   * 指定した複製で要素が含まれているかを確率的に判定する．
+   *
+   * スレッドをノードに固定しており，LocalReplica() の値を保持しておける場合に使う．<br>
+   * BloomFilter::Contains(const HashedKey&) と同じ結果を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @param[in] replica 複製の番号 (NumReplicas() 未満)
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key, std::size_t replica) const {
+    const std::atomic<std::uint64_t>* words = replicas_[replica].get();
+    return ForEachPosition(key, log2_num_bits_, num_hashes_, [words](std::size_t position) {
+      std::uint64_t word = words[position >> 6].load(std::memory_order_relaxed);
+      return (word & (1ull << (position & 63))) != 0;
+    });
+  }
+
+  /**
+   * 呼び出したスレッドが実行されているノードの複製の番号を返す．
+   *
+   * 複製の個数がノード数より少ない場合は，ノード番号を複製の個数で割った余りを返す．
+   *
+   * @return 複製の番号
+   */
+  std::size_t LocalReplica() const {
+    return node_replicas_[numa::CurrentNode()];
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * 複製の個数を返す．
+   *
+   * @return 複製の個数
+   */
+  std::size_t NumReplicas() const {
+    return replicas_.size();
+  }
+
+  /**
+   * 配置先のノードに固定したスレッドで確保できた複製の個数を返す．
+   *
+   * NumReplicas() より小さい場合，一部の複製は他のノードに置かれている可能性がある．
+   *
+   * @return 固定したスレッドで確保できた複製の個数
+   */
+  std::size_t NumPinnedReplicas() const {
+    return num_pinned_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  std::size_t NumBits() const {
+    return std::size_t{1} << log2_num_bits_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  std::size_t Log2NumBits() const {
+    return log2_num_bits_;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  std::size_t NumHashes() const {
+    return num_hashes_;
+  }
+
+  /**
+   * 複製1個あたりのフィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  std::size_t NumWords() const {
+    return (NumBits() + 63) / 64;
+  }
+
+  /**
+   * 追加された要素数を返す．
+   *
+   * @return 追加された要素数．
+   */
+  std::size_t Size() const {
+    return size_.Load();
+  }
+
+  /**
+   * パラメータエラーを表すビットフラグを返す．
+   *
+   * @return パラメータエラーを表すビットフラグ．
+   */
+  int ParameterErrorFlags() const {
+    return parameter_error_flags_;
+  }
+
+  /**
+   * パラメータエラーがあるかを返す．
+   *
+   * @return パラメータエラーがある場合はtrue.
+   */
+  bool HasParameterError() const {
+    return (parameter_error_flags_ != 0);
+  }
+
+public:
+  /** フィルタ用配列サイズのビット数の底2による対数値の設定に対するビットフラグ */
+  static constexpr int kHasLog2NumBitsError = 0x1;
+
+  /** Bloom filter におけるハッシュ関数の個数に対するビットフラグ */
+  static constexpr int kHasNumHashesError = 0x2;
+
+private:
+  /**
+   * 複製ごとのフィルタ．
+   *
+   * 各複製の i ビット目は replicas_[r][i / 64] の下位から (i % 64) ビット目に対応する．
+   */
+  std::vector<std::unique_ptr<std::atomic<std::uint64_t>[]>> replicas_;
+
+  /** 各ノードから読む複製の番号． */
+  std::vector<std::size_t> node_replicas_;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::size_t log2_num_bits_;
+
+  /** Bloom filter におけるハッシュ関数の個数． */
+  std::size_t num_hashes_;
+
+  /**
+   * 追加された要素数．
+   *
+   * 複数スレッドからの Insert() が同じキャッシュラインを奪い合わないように，スレッドごとに分けて数える．
+   */
+  StripedCounter size_;
+
+  /** 配置先のノードに固定したスレッドで確保できた複製の個数． */
+  std::size_t num_pinned_;
+
+  /** パラメータエラーを表すビットフラグ. */
+  int parameter_error_flags_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_REPLICATED_BLOOM_FILTER_H_
@@ -0,0 +1,304 @@
+/**
+ * @file serialization.h
+ * @brief Bloom filter のファイル入出力用の関数を宣言するヘッダファイル．
+ *
+ * ファイルは以下のヘッダと，それに続くフィルタ用配列からなる．
+ * 数値はすべてリトルエンディアンで格納する．
+ * | オフセット | サイズ | 内容 |
+ * | ---------: | -----: | :--- |
+ * | 0  | 8 | マジックナンバー "SBFILTER" |
+ * | 8  | 4 | 書式のバージョン (1) |
+ * | 12 | 4 | フラグ (kFilterFlagCompressed または 0) |
+ * | 16 | 8 | フィルタ用配列サイズのビット数の底2による対数値 |
+ * | 24 | 8 | ハッシュ関数の個数 |
+ * | 32 | 8 | 追加された要素数 |
+ * | 40 | 8 * NumWords() | フィルタ用配列 (64ビット単位) |
+ *
+ * フラグに kFilterFlagCompressed が立っている場合，フィルタ用配列の代わりに以下を格納する．
+ * | オフセット | サイズ | 内容 |
+ * | ---------: | -----: | :--- |
+ * | 40 | 8 | Rice 符号のパラメータ r |
+ * | 48 | 8 | 立っているビット数 n |
+ * | 56 | 8 | 符号列のサイズ [bytes] |
+ * | 64 | 符号列のサイズ | 符号列 |
+ *
+ * 符号列は，立っているビットの位置を昇順に p_0, p_1, ... としたときの間隔
+ * p_0, p_1 - p_0 - 1, ... を Rice 符号 (Golomb 符号の除数を 2^r に限ったもの) で表したものである．<br>
+ * 各間隔 g は，商 g >> r 個の0と1個の1，続いて下位 r ビットの余りをこの順に並べ，
+ * 各バイトの下位ビットから詰める．最後のバイトの余ったビットは0とする．
+ */
+
+#ifndef CPPBF_SERIALIZATION_H_
+#define CPPBF_SERIALIZATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief ファイルのヘッダを表す構造体．
+ */
+struct FilterHeader {
+  /** 書式のバージョン． */
+  std::uint32_t version = 1;
+
+  /** フラグ． */
+  std::uint32_t flags = 0;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::uint64_t log2_num_bits = 0;
+
+  /** ハッシュ関数の個数． */
+  std::uint64_t num_hashes = 0;
+
+  /** 追加された要素数． */
+  std::uint64_t size = 0;
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  std::size_t NumWords() const {
+    return ((std::uint64_t{1} << log2_num_bits) + 63) / 64;
+  }
+};
+
+/**
+ * @brief 書き出したファイルを識別する情報を表す構造体．
+ *
+ * ファイルが他のファイルに置き換えられたか，他の内容を書き込まれたかを判別するために使う．
+ */
+struct FilterFileIdentity {
+  /** ファイルがあるデバイスの番号． */
+  std::uint64_t device = 0;
+
+  /** ファイルの i-node 番号． */
+  std::uint64_t inode = 0;
+
+  /** ヘッダに記録された追加された要素数． */
+  std::uint64_t size = 0;
+};
+
+/** ファイルのヘッダのサイズ [bytes]． */
+constexpr std::size_t kFilterHeaderSize = 40;
+
+/** 書式のバージョン． */
+constexpr std::uint32_t kFilterFormatVersion = 1;
+
+/** フィルタ用配列を Rice 符号で圧縮して格納していることを表すフラグ． */
+constexpr std::uint32_t kFilterFlagCompressed = 0x1;
+
+/**
+ * ファイルのヘッダを書き出す．
+ *
+ * @param[in,out] out 出力ストリーム
+ * @param[in] header ヘッダ
+ * @return 書き出せた場合は true
+ */
+bool WriteFilterHeader(std::ostream& out, const FilterHeader& header);
+
+/**
+ * ファイルのヘッダを読み込む．
+ *
+ * マジックナンバーかバージョンが一致しない場合や，未知のフラグが立っている場合は false を返す．
+ *
+ * @param[in,out] in 入力ストリーム
+ * @param[out] header ヘッダ
+ * @return 読み込めた場合は true
+ */
+bool ReadFilterHeader(std::istream& in, FilterHeader& header);
+
+/**
+ * フィルタ用配列を書き出す．
+ *
+ * @param[in,out] out 出力ストリーム
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 書き出せた場合は true
+ */
+bool WriteFilterWords(std::ostream& out, const std::uint64_t* words,
+  std::size_t num_words);
+
+/**
+ * フィルタ用配列を読み込む．
+ *
+ * @param[in,out] in 入力ストリーム
+ * @param[out] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 読み込めた場合は true
+ */
+bool ReadFilterWords(std::istream& in, std::uint64_t* words,
+  std::size_t num_words);
+
+/**
+ * フィルタ用配列を圧縮して書き出した場合のサイズを返す．
+ *
+ * WriteCompressedFilterWords() が書き出すバイト数 (ヘッダを除く) を，
+ * 実際に符号化せずに立っているビットの間隔だけから求める．<br>
+ * WriteFilterWords() の 8 * num_words [bytes] と比べて，圧縮するかを判断できる．
+ *
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 圧縮して書き出した場合のサイズ [bytes]
+ */
+std::size_t CompressedFilterSize(const std::uint64_t* words, std::size_t num_words);
+
+/**
+ * フィルタ用配列を Rice 符号で圧縮して書き出す．
+ *
+ * 書式はファイルの説明を参照．ヘッダのフラグには kFilterFlagCompressed を立てておく必要がある．<br>
+ * 立っているビットの割合が小さいほどよく圧縮できる．
+ *
+ * @param[in,out] out 出力ストリーム
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 書き出せた場合は true
+ */
+bool WriteCompressedFilterWords(std::ostream& out, const std::uint64_t* words,
+  std::size_t num_words);
+
+/**
+ * Rice 符号で圧縮されたフィルタ用配列を読み込む．
+ *
+ * 符号列は一定サイズずつ読み込み，復号しながら words に直接ビットを立てる．
+ *
+ * @param[in,out] in 入力ストリーム
+ * @param[out] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 読み込めた場合は true
+ */
+bool ReadCompressedFilterWords(std::istream& in, std::uint64_t* words,
+  std::size_t num_words);
+
+/**
+ * 複数のファイルのフィルタの論理和をとったファイルを作成する．
+ *
+ * 全ファイルのフィルタ用配列サイズとハッシュ関数の個数は一致している必要がある．<br>
+ * 圧縮された入力ファイルも扱えるが，出力ファイルは圧縮しない．<br>
+ * フィルタ用配列は一定サイズずつ読み込んで処理するため，メモリに収まらないフィルタも扱える．<br>
+ * 追加された要素数は各ファイルの値の合計とする (重複する要素があれば実際より大きくなる)．<br>
+ * ReplaceFile() と同じく一時ファイルに書き出してから名前を変更するため，
+ * 出力ファイルを入力ファイルのいずれかとしてもよく，作成に失敗した場合は出力ファイルを変更しない．
+ *
+ * @param[in] input_paths 入力ファイルのパス
+ * @param[in] output_path 出力ファイルのパス
+ * @return 作成できた場合は true
+ */
+bool MergeFilterFiles(const std::vector<std::string>& input_paths,
+  const std::string& output_path);
+
+/**
+ * ストリームに書き出した内容でファイルを作成するか置き換える．
+ *
+ * 同じディレクトリに mkostemp() で作成した一意な一時ファイル (path + ".XXXXXX") に書き出して同期した後に
+ * 名前を変更し，ディレクトリも同期する．<br>
+ * そのため，書き出しの途中で停止しても path には以前の内容か新しい内容のいずれかが残り，
+ * 同じ path への書き出しが同時に行われても互いの一時ファイルを壊さない．<br>
+ * 書き出せなかった場合は一時ファイルを削除し，path を変更しない．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] write 内容を書き出す関数．書き出せた場合は true を返す．
+ * @return 置き換えた場合は true
+ */
+bool ReplaceFile(const std::string& path, const std::function<bool(std::ostream&)>& write);
+
+/**
+ * フィルタを書き出したファイルを作成するか置き換える．
+ *
+ * ReplaceFile() と同じく一意な一時ファイルに書き出して同期した後に名前を変更するため，
+ * 書き出しの途中で停止しても path には以前の内容か新しい内容のいずれかが残る．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] header ヘッダ (フラグは0とする)
+ * @param[in] words フィルタ用配列 (header.NumWords() 個の要素)
+ * @param[out] identity 置き換えた場合に，書き出したファイルを識別する情報 (不要な場合は nullptr)
+ * @return 置き換えた場合は true
+ */
+bool WriteFilterFile(const std::string& path, const FilterHeader& header,
+  const std::uint64_t* words, FilterFileIdentity* identity = nullptr);
+
+/**
+ * ファイルのフィルタ用配列のうち指定されたチャンクとヘッダをその場で書き換える．
+ *
+ * チャンクは words の先頭から chunk_words 個ずつに区切ったものである．<br>
+ * チャンクを書き出して同期した後にヘッダを書き換えて同期する．
+ * ビットは追加で立つのみであるため，途中で停止してもファイルの内容は直前のヘッダの時点の内容を含む．
+ *
+ * 前回書き出したファイルであることを確かめるため，デバイスと i-node 番号，ヘッダの要素数が
+ * identity と一致するファイルのみを書き換える．<br>
+ * 一致しない場合や，ファイルが圧縮されている場合，パラメータまたはサイズが header と異なる場合は
+ * 何もせず false を返す．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] header ヘッダ (フラグは0とする)
+ * @param[in] words フィルタ用配列 (header.NumWords() 個の要素)
+ * @param[in] chunks 書き換えるチャンクの番号 (昇順)
+ * @param[in] chunk_words チャンクの64ビット単位の要素数
+ * @param[in,out] identity 前回書き出したファイルを識別する情報．書き換えた場合は新たなヘッダの要素数とする．
+ * @return 書き換えた場合は true
+ */
+bool UpdateFilterFile(const std::string& path, const FilterHeader& header,
+  const std::uint64_t* words, const std::vector<std::size_t>& chunks,
+  std::size_t chunk_words, FilterFileIdentity& identity);
+
+/**
+ * ファイルを識別する情報を返す．
+ *
+ * @param[in] path ファイルのパス
+ * @param[out] identity ファイルを識別する情報
+ * @return ファイルとヘッダを読み込めた場合は true
+ */
+bool ReadFilterFileIdentity(const std::string& path, FilterFileIdentity& identity);
+
+/**
+ * ファイルのヘッダとフィルタ用配列の立っているビット数を返す．
+ *
+ * フィルタ用配列は一定サイズずつ読み込んで処理する．<br>
+ * 圧縮されたファイルの場合は，格納された立っているビット数を返す．
+ *
+ * @param[in] path ファイルのパス
+ * @param[out] header ヘッダ
+ * @param[out] num_set_bits 立っているビット数
+ * @return 読み込めた場合は true
+ */
+bool ReadFilterStats(const std::string& path, FilterHeader& header,
+  std::uint64_t& num_set_bits);
+
+/**
+ * フィルタ用配列を定数として埋め込む C++ のヘッダファイルを書き出す．
+ *
+ * 以下を定義するヘッダファイルを書き出す．<br>
+ * - name + "Words": フィルタ用配列を表す inline constexpr な std::uint64_t の配列 (64バイト境界に配置)
+ * - name: その配列を参照する inline constexpr な BloomFilterView<type>
+ *
+ * 配列は読み取り専用データとして実行ファイルに格納されるため，起動時の読み込みは不要であり，
+ * 同じ実行ファイルを使う全プロセスでページが共有される．<br>
+ * 要素の判定結果は，同じヘッダとフィルタ用配列を持つ BloomFilter と一致する．
+ *
+ * name_space が空の場合は名前空間で囲まない．
+ *
+ * @param[in,out] out 出力ストリーム
+ * @param[in] header ヘッダ
+ * @param[in] words フィルタ用配列 (header.NumWords() 個の要素)
+ * @param[in] name ビューの変数名 (C++ の識別子)
+ * @param[in] name_space 定義を囲む名前空間 ("a::b" の形式も可)
+ * @param[in] type 要素の型 (BloomFilterView の第1テンプレート引数)
+ * @return 書き出せた場合は true
+ */
+bool WriteFilterSource(std::ostream& out, const FilterHeader& header,
+  const std::uint64_t* words, const std::string& name,
+  const std::string& name_space, const std::string& type);
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_SERIALIZATION_H_
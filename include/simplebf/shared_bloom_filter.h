@@ -0,0 +1,494 @@
+/**
+ * @file shared_bloom_filter.h
+ * @brief 複数プロセスで共有メモリ上のフィルタを参照する Bloom filter 用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_SHARED_BLOOM_FILTER_H_
+#define CPPBF_SHARED_BLOOM_FILTER_H_
+
+#include "bloom_filter.h"
+#include "hasher.h"
+#include "shared_memory.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 共有メモリの先頭に置くヘッダを表す構造体．
+ *
+ * フィルタ用配列はヘッダの直後 (先頭から64バイト目) から置く．
+ */
+struct alignas(64) SharedFilterHeader {
+  /** マジックナンバー．作成側が初期化を終えた時点で kSharedFilterMagic を格納する． */
+  std::atomic<std::uint64_t> magic;
+
+  /** 書式のバージョン． */
+  std::uint32_t version;
+
+  /** フラグ (現在は常に0)． */
+  std::uint32_t flags;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::uint64_t log2_num_bits;
+
+  /** ハッシュ関数の個数． */
+  std::uint64_t num_hashes;
+
+  /** 追加された要素数． */
+  std::atomic<std::uint64_t> size;
+
+  /** 世代番号．フィルタの内容を置き換えている間は奇数となる． */
+  std::atomic<std::uint64_t> generation;
+};
+
+static_assert(sizeof(SharedFilterHeader) == 64, "The shared header must be 64 bytes.");
+
+/** 共有メモリのマジックナンバー ("SBFSHARE" をリトルエンディアンで読んだ値)． */
+constexpr std::uint64_t kSharedFilterMagic = 0x4552414853464253ull;
+
+/** 共有メモリの書式のバージョン． */
+constexpr std::uint32_t kSharedFilterVersion = 1;
+
+/**
+ * @brief 複数プロセスで共有メモリ上のフィルタを参照する Bloom filter 用クラス．
+ *
+ * ヘッダとフィルタ用配列を名前付きの POSIX 共有メモリに置く．<br>
+ * 1個の書き込み側プロセスが Create() で作成して Insert() し，
+ * 任意個の読み込み側プロセスが Open() で同じメモリをマップして Contains() を呼び出す．<br>
+ * 各プロセスが同じフィルタの複製を持つ必要がないため，メモリ使用量と追加の処理はプロセス数によらない．
+ *
+ * 位置の計算方法は BloomFilter と同じであり，ビットの操作は ConcurrentBloomFilter と同じく
+ * アトミックな論理和と読み出しで行う．<br>
+ * Insert() の完了後に他のプロセスが呼び出した Contains() は true を返す．
+ *
+ * Clear(), CopyFrom() はフィルタの内容を置き換える間，世代番号 Generation() を奇数にし，
+ * 終了後に偶数にする．<br>
+ * 読み込み側は，一連の判定の前に Generation() で世代番号を読み，判定の後に Validate() で確かめることで，
+ * 内容の置き換えと重なったかを検出できる．<br>
+ * Contains() はフィルタ用配列を順序の制約のない読み出しで読むため，判定の後の世代番号を
+ * Generation() で読み直して比べるだけでは，判定の読み出しがその後に並べ替えられうる．
+ * Validate() はフェンスを置いてから世代番号を読むため，必ずこちらを使う．
+ * @code
+ * std::uint64_t generation;
+ * bool found;
+ * do {
+ *   generation = reader.Generation();
+ *   found = reader.Contains(key);
+ * } while (!reader.Validate(generation));
+ * @endcode
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class SharedBloomFilter {
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+    "64-bit atomics must be lock-free to be shared across processes.");
+
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
+
+public:
+  /** デフォルトコンストラクタ． */
+  SharedBloomFilter() : header_(nullptr), words_(nullptr), parameter_error_flags_(0) {
+  }
+
+  SharedBloomFilter(const SharedBloomFilter&) = delete;
+  SharedBloomFilter& operator=(const SharedBloomFilter&) = delete;
+
+  /**
+   * 共有メモリにフィルタを作成し，書き込み側として開く．
+   *
+   * パラメータの制約は BloomFilter と同じであり，制約を満たさない場合は
+   * パラメータエラーフラグを立てて false を返す．<br>
+   * 同じ名前の共有メモリが既に存在する場合も false を返す．
+   *
+   * @param[in] name 共有メモリの名前 ("/name" の形式)
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @param[in] num_hashes ハッシュ関数の個数
+   * @return 作成できた場合は true
+   */
+  bool Create(const std::string& name, std::size_t log2_num_bits,
+      std::size_t num_hashes) {
+    Close();
+    parameter_error_flags_ = 0;
+    if (log2_num_bits > kMaxLog2NumBits) {
+      parameter_error_flags_ |= kHasLog2NumBitsError;
+    }
+    if (num_hashes < 1) {
+      parameter_error_flags_ |= kHasNumHashesError;
+    }
+    if (HasParameterError()) {
+      return false;
+    }
+
+    // 作成直後の共有メモリは0で埋められているため，フィルタ用配列の初期化は不要である．
+    std::size_t num_words = ((std::size_t{1} << log2_num_bits) + 63) / 64;
+    if (!memory_.Create(name, sizeof(SharedFilterHeader) + num_words * 8)) {
+      return false;
+    }
+
+    // 読み込み側が初期化途中のヘッダを使わないよう，マジックナンバーは最後に格納する．
+    header_ = new (memory_.Data()) SharedFilterHeader();
+    header_->version = kSharedFilterVersion;
+    header_->flags = 0;
+    header_->log2_num_bits = log2_num_bits;
+    header_->num_hashes = num_hashes;
+    header_->size.store(0, std::memory_order_relaxed);
+    header_->generation.store(0, std::memory_order_relaxed);
+    words_ = reinterpret_cast<std::atomic<std::uint64_t>*>(header_ + 1);
+    header_->magic.store(kSharedFilterMagic, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * 共有メモリのフィルタを読み込み側として開く．
+   *
+   * 共有メモリが存在しない場合，作成側が初期化を終えていない場合，
+   * 書式が一致しない場合は false を返す．
+   *
+   * @param[in] name 共有メモリの名前 ("/name" の形式)
+   * @return 開けた場合は true
+   */
+  bool Open(const std::string& name) {
+    Close();
+    if (!memory_.Open(name, false) || memory_.Size() < sizeof(SharedFilterHeader)) {
+      memory_.Close();
+      return false;
+    }
+
+    auto header = static_cast<SharedFilterHeader*>(memory_.Data());
+    if (header->magic.load(std::memory_order_acquire) != kSharedFilterMagic
+        || header->version != kSharedFilterVersion
+        || header->log2_num_bits > kMaxLog2NumBits || header->num_hashes < 1) {
+      memory_.Close();
+      return false;
+    }
+    std::size_t num_words = ((std::size_t{1} << header->log2_num_bits) + 63) / 64;
+    if (memory_.Size() < sizeof(SharedFilterHeader) + num_words * 8) {
+      memory_.Close();
+      return false;
+    }
+    header_ = header;
+    words_ = reinterpret_cast<std::atomic<std::uint64_t>*>(header_ + 1);
+    return true;
+  }
+
+  /** 共有メモリのマップを解放する．共有メモリ自体は Remove() まで残る． */
+  void Close() {
+    memory_.Close();
+    header_ = nullptr;
+    words_ = nullptr;
+  }
+
+  /**
+   * 共有メモリを削除する．
+   *
+   * 開いているプロセスは，Close() するまで引き続き参照できる．
+   *
+   * @param[in] name 共有メモリの名前
+   * @return 削除できた場合は true
+   */
+  static bool Remove(const std::string& name) {
+    return SharedMemory::Remove(name);
+  }
+
+  /**
+   * 開いているかを返す．
+   *
+   * @return 開いている場合は true
+   */
+  bool IsOpen() const {
+    return header_ != nullptr;
+  }
+
+  /**
+   * 書き込み側として開いているかを返す．
+   *
+   * @return Create() で作成した場合は true
+   */
+  bool IsWritable() const {
+    return IsOpen() && memory_.IsWritable();
+  }
+
+  /**
+   * 要素を追加する．
+   *
+   * 書き込み側でのみ追加できる．読み込み側で呼び出した場合は何もせず false を返す．
+   *
+   * @param[in] entry 追加する要素
+   * @return 追加した場合は true
+   */
+  bool Insert(const T& entry) {
+    return Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列を追加する．
+   *
+   * T が std::string の場合のみ使える．読み込み側で呼び出した場合は何もせず false を返す．
+   *
+   * @param[in] entry 追加する文字列
+   * @return 追加した場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Insert(std::string_view entry) {
+    return Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を追加する．
+   *
+   * BloomFilter::Insert(const HashedKey&) と同じビットが立つ．<br>
+   * 読み込み側のマッピングは読み込み専用であるため，読み込み側で呼び出した場合は何もせず false を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 追加した場合は true
+   */
+  bool Insert(const HashedKey& key) {
+    if (!IsWritable()) {
+      return false;
+    }
+    ForEachPosition(key, Log2NumBits(), header_->num_hashes, [this](std::size_t position) {
+      words_[position >> 6].fetch_or(1ull << (position & 63), std::memory_order_relaxed);
+    });
+    header_->size.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列が含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 含まれているかを判定したい文字列
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(std::string_view entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * BloomFilter::Contains(const HashedKey&) と同じ結果を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key) const {
+    return ForEachPosition(key, Log2NumBits(), header_->num_hashes, [this](std::size_t position) {
+      std::uint64_t word = words_[position >> 6].load(std::memory_order_relaxed);
+      return (word & (1ull << (position & 63))) != 0;
+    });
+  }
+
+  /**
+   * フィルタの内容を BloomFilter の内容で置き換える．
+   *
+   * 書き込み側でのみ呼び出せる．<br>
+   * 配列サイズまたはハッシュ関数の個数が異なる場合は何もせず false を返す．
+   *
+   * @tparam Allocator Bloom filter のフィルタ用配列のアロケータ
+   * @param[in] bf Bloom filter
+   * @return 置き換えた場合は true
+   */
+  template <class Allocator>
+  bool CopyFrom(const BloomFilter<T, HashPolicy, Allocator>& bf) {
+    if (!IsWritable() || bf.Log2NumBits() != Log2NumBits()
+        || bf.NumHashes() != NumHashes()) {
+      return false;
+    }
+    BeginUpdate();
+    const std::uint64_t* words = bf.Data();
+    for (std::size_t i = 0; i < NumWords(); i++) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    header_->size.store(bf.Size(), std::memory_order_relaxed);
+    EndUpdate();
+    return true;
+  }
+
+  /**
+   * 追加された要素をすべて削除する．
+   *
+   * 書き込み側でのみ削除できる．読み込み側で呼び出した場合は何もせず false を返す．
+   *
+   * @return 削除した場合は true
+   */
+  bool Clear() {
+    if (!IsWritable()) {
+      return false;
+    }
+    BeginUpdate();
+    for (std::size_t i = 0; i < NumWords(); i++) {
+      words_[i].store(0, std::memory_order_relaxed);
+    }
+    header_->size.store(0, std::memory_order_relaxed);
+    EndUpdate();
+    return true;
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  std::size_t NumBits() const {
+    return std::size_t{1} << header_->log2_num_bits;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  std::size_t Log2NumBits() const {
+    return header_->log2_num_bits;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  std::size_t NumHashes() const {
+    return header_->num_hashes;
+  }
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  std::size_t NumWords() const {
+    return (NumBits() + 63) / 64;
+  }
+
+  /**
+   * 追加された要素数を返す．
+   *
+   * @return 追加された要素数．
+   */
+  std::size_t Size() const {
+    return header_->size.load(std::memory_order_acquire);
+  }
+
+  /**
+   * 世代番号を返す．
+   *
+   * Clear() または CopyFrom() の実行中は奇数であり，終了するたびに2ずつ増える．<br>
+   * 一連の判定が置き換えと重ならなかったかは，判定の前に読んだ値を Validate() に与えて確かめる．
+   *
+   * @return 世代番号
+   */
+  std::uint64_t Generation() const {
+    return header_->generation.load(std::memory_order_acquire);
+  }
+
+  /**
+   * 一連の判定が内容の置き換えと重ならなかったかを返す．
+   *
+   * 判定の前に Generation() で読んだ世代番号を与える．<br>
+   * 判定の読み出しが世代番号の読み出しより後に並べ替えられないように，acquire フェンスを置いてから
+   * 世代番号を読み直す．
+   *
+   * @param[in] generation 判定の前に Generation() で読んだ世代番号
+   * @return 判定の前の世代番号が偶数であり，判定の後も変わっていない場合は true
+   */
+  bool Validate(std::uint64_t generation) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (generation & 1) == 0
+      && header_->generation.load(std::memory_order_relaxed) == generation;
+  }
+
+  /**
+   * パラメータエラーを表すビットフラグを返す．
+   *
+   * @return パラメータエラーを表すビットフラグ．
+   */
+  int ParameterErrorFlags() const {
+    return parameter_error_flags_;
+  }
+
+  /**
+   * パラメータエラーがあるかを返す．
+   *
+   * @return パラメータエラーがある場合はtrue.
+   */
+  bool HasParameterError() const {
+    return (parameter_error_flags_ != 0);
+  }
+
+private:
+  /** 内容の置き換えを始める．世代番号を奇数にする． */
+  void BeginUpdate() {
+    header_->generation.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  /** 内容の置き換えを終える．世代番号を偶数にする． */
+  void EndUpdate() {
+    header_->generation.fetch_add(1, std::memory_order_release);
+  }
+
+public:
+  /** フィルタ用配列サイズのビット数の底2による対数値の設定に対するビットフラグ */
+  static constexpr int kHasLog2NumBitsError = 0x1;
+
+  /** Bloom filter におけるハッシュ関数の個数に対するビットフラグ */
+  static constexpr int kHasNumHashesError = 0x2;
+
+private:
+  /** マップした共有メモリ． */
+  SharedMemory memory_;
+
+  /** 共有メモリ上のヘッダ (開いていない場合は nullptr)． */
+  SharedFilterHeader* header_;
+
+  /**
+   * 共有メモリ上のフィルタ用配列．
+   *
+   * i ビット目は words_[i / 64] の下位から (i % 64) ビット目に対応する．
+   */
+  std::atomic<std::uint64_t>* words_;
+
+  /** パラメータエラーを表すビットフラグ. */
+  int parameter_error_flags_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_SHARED_BLOOM_FILTER_H_
@@ -0,0 +1,129 @@
+/**
+ * @file shared_memory.h
+ * @brief 名前付きの POSIX 共有メモリを扱うクラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_SHARED_MEMORY_H_
+#define CPPBF_SHARED_MEMORY_H_
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 名前付きの POSIX 共有メモリ (shm_open) をマップするクラス．
+ *
+ * 名前は "/name" の形式とし，同じ名前で開いた全プロセスが同じメモリを参照する．<br>
+ * マップしたメモリはオブジェクトの破棄時または Close() で解放するが，
+ * 共有メモリ自体は Remove() を呼び出すまで残る．
+ */
+class SharedMemory {
+public:
+  /** デフォルトコンストラクタ． */
+  SharedMemory();
+
+  /** デストラクタ． */
+  ~SharedMemory();
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  /**
+   * 共有メモリを新たに作成し，読み書きできるようにマップする．
+   *
+   * 作成直後の内容はすべて0である．<br>
+   * 同じ名前の共有メモリが既に存在する場合は false を返す．
+   *
+   * @param[in] name 共有メモリの名前
+   * @param[in] size サイズ [bytes]
+   * @return 作成できた場合は true
+   */
+  bool Create(const std::string& name, std::size_t size);
+
+  /**
+   * 既存の共有メモリをマップする．
+   *
+   * @param[in] name 共有メモリの名前
+   * @param[in] writable 書き込む場合は true
+   * @return マップできた場合は true
+   */
+  bool Open(const std::string& name, bool writable);
+
+  /** マップしたメモリを解放する． */
+  void Close();
+
+  /**
+   * 共有メモリを削除する．
+   *
+   * マップ済みのプロセスは，解放するまで引き続き参照できる．
+   *
+   * @param[in] name 共有メモリの名前
+   * @return 削除できた場合は true
+   */
+  static bool Remove(const std::string& name);
+
+  /**
+   * マップしているかを返す．
+   *
+   * @return マップしている場合は true
+   */
+  bool IsOpen() const {
+    return data_ != nullptr;
+  }
+
+  /**
+   * 書き込めるかを返す．
+   *
+   * @return 書き込める場合は true
+   */
+  bool IsWritable() const {
+    return writable_;
+  }
+
+  /**
+   * マップしたメモリの先頭を返す．
+   *
+   * @return マップしたメモリの先頭 (マップしていない場合は nullptr)
+   */
+  void* Data() const {
+    return data_;
+  }
+
+  /**
+   * マップしたメモリのサイズを返す．
+   *
+   * @return マップしたメモリのサイズ [bytes]
+   */
+  std::size_t Size() const {
+    return size_;
+  }
+
+private:
+  /**
+   * ファイル記述子の指す共有メモリをマップし，ファイル記述子を閉じる．
+   *
+   * @param[in] fd ファイル記述子
+   * @param[in] size サイズ [bytes]
+   * @param[in] writable 書き込む場合は true
+   * @return マップできた場合は true
+   */
+  bool Map(int fd, std::size_t size, bool writable);
+
+private:
+  /** マップしたメモリの先頭 (マップしていない場合は nullptr)． */
+  void* data_;
+
+  /** マップしたメモリのサイズ [bytes]． */
+  std::size_t size_;
+
+  /** 書き込める場合は true． */
+  bool writable_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_SHARED_MEMORY_H_
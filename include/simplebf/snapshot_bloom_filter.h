@@ -0,0 +1,595 @@
+/**
+ * @file snapshot_bloom_filter.h
+ * @brief 追加を止めずにスナップショットを取れる Bloom filter 用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_SNAPSHOT_BLOOM_FILTER_H_
+#define CPPBF_SNAPSHOT_BLOOM_FILTER_H_
+
+#include "bloom_filter.h"
+#include "hasher.h"
+#include "serialization.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/** SnapshotBloomFilter のページの要素数の底2による対数値．1ページは 64KB となる． */
+constexpr std::size_t kSnapshotLog2PageWords = 13;
+
+/** SnapshotBloomFilter のページの要素数． */
+constexpr std::size_t kSnapshotPageWords = std::size_t{1} << kSnapshotLog2PageWords;
+
+template <class T, class HashPolicy>
+class SnapshotBloomFilter;
+
+/**
+ * @brief SnapshotBloomFilter のある時点の内容．
+ *
+ * フィルタ用配列のページをもとのフィルタと共有し，もとのフィルタは共有中のページに書き込む前にそのページを複製する．<br>
+ * したがって取得後にもとのフィルタへ追加しても内容は変わらない．
+ * 内容を変更する操作はなく，任意のスレッドから同時に読み込める．
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class BloomFilterSnapshot {
+  template <class U, class V>
+  friend class SnapshotBloomFilter;
+
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
+
+public:
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列が含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 含まれているかを判定したい文字列
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(std::string_view entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * 取得した時点のフィルタで BloomFilter::Contains(const HashedKey&) と同じ結果を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key) const {
+    return ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      std::size_t w = position >> 6;
+      std::uint64_t word = data_[w >> kSnapshotLog2PageWords][w & (kSnapshotPageWords - 1)];
+      return (word & (1ull << (position & 63))) != 0;
+    });
+  }
+
+  /**
+   * BloomFilter::Save() と同じ形式でストリームに書き出す．
+   *
+   * 書き出した内容は BloomFilter::Load() で読み込める．
+   *
+   * @param[in,out] out 出力ストリーム
+   * @return 書き出せた場合は true
+   */
+  bool Save(std::ostream& out) const {
+    FilterHeader header;
+    header.log2_num_bits = log2_num_bits_;
+    header.num_hashes = num_hashes_;
+    header.size = size_;
+    if (!WriteFilterHeader(out, header)) {
+      return false;
+    }
+    for (std::size_t p = 0; p < data_.size(); p++) {
+      if (!WriteFilterWords(out, data_[p], PageWords(p))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * 別のスレッドでファイルに書き出す．
+   *
+   * スナップショットを複製してスレッドに渡すため，呼び出し後にこのオブジェクトを破棄してもよい．<br>
+   * もとのフィルタへの追加は書き出しの間も続けられる．<br>
+   * 一時ファイルに書き出して同期してから置き換えるため (ReplaceFile() を参照)，
+   * 書き出しの途中で停止しても path には以前のスナップショットが残る．
+   *
+   * @param[in] path ファイルのパス
+   * @return 書き出せた場合に true となる結果
+   */
+  std::future<bool> SaveAsync(const std::string& path) const {
+    return std::async(std::launch::async, [snapshot = *this, path]() {
+      return ReplaceFile(path, [&snapshot](std::ostream& out) { return snapshot.Save(out); });
+    });
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  std::size_t NumBits() const {
+    return std::size_t{1} << log2_num_bits_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  std::size_t Log2NumBits() const {
+    return log2_num_bits_;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  std::size_t NumHashes() const {
+    return num_hashes_;
+  }
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  std::size_t NumWords() const {
+    return (NumBits() + 63) / 64;
+  }
+
+  /**
+   * 取得した時点の追加された要素数を返す．
+   *
+   * @return 追加された要素数．
+   */
+  std::size_t Size() const {
+    return size_;
+  }
+
+private:
+  /** デフォルトコンストラクタ．SnapshotBloomFilter::Snapshot() でのみ使う． */
+  BloomFilterSnapshot() = default;
+
+  /**
+   * ページの要素数を返す．
+   *
+   * @param[in] page ページの番号
+   * @return ページの要素数
+   */
+  std::size_t PageWords(std::size_t page) const {
+    return std::min(kSnapshotPageWords, NumWords() - (page << kSnapshotLog2PageWords));
+  }
+
+private:
+  /** ページ．一度も書き込まれていないページは nullptr とする． */
+  std::vector<std::shared_ptr<const std::uint64_t[]>> pages_;
+
+  /** 各ページの先頭．nullptr のページは0のページを指す． */
+  std::vector<const std::uint64_t*> data_;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::size_t log2_num_bits_ = 0;
+
+  /** Bloom filter におけるハッシュ関数の個数． */
+  std::size_t num_hashes_ = 0;
+
+  /** 追加された要素数． */
+  std::size_t size_ = 0;
+};
+
+/**
+ * @brief 追加を止めずにスナップショットを取れる Bloom filter 用クラス．
+ *
+ * フィルタ用配列を 64KB のページに分けて参照カウント付きで保持し，Snapshot() ではページを共有する．<br>
+ * スナップショットと共有中のページは，最初に書き込むときにのみ複製する (copy-on-write)．
+ * そのため，大きなフィルタでもスナップショットの取得はページ数に比例する時間で済み，
+ * 以降の追加で複製するのは書き込んだページのみである．<br>
+ * 一度も書き込まれていないページは確保しない．
+ *
+ * BloomFilter と同じく，Insert() と Snapshot() は1個のスレッドから呼び出す．<br>
+ * 取得したスナップショットは任意のスレッドで読み込め，SaveAsync() で別のスレッドから書き出せる．
+ *
+ * 位置の計算方法は BloomFilter と同じであり，同じパラメータの BloomFilter と同じビットが立つ．
+ *
+ * @tparam T 要素の型
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, class HashPolicy = Hasher<T>>
+class SnapshotBloomFilter {
+  /** T が std::string の場合にのみ有効なメンバ関数テンプレートのための型． */
+  template <class U>
+  using EnableIfString
+    = typename std::enable_if<std::is_same<U, std::string>::value, int>::type;
+
+public:
+  /**
+   * フィルタ用配列サイズのビット数とハッシュ関数の個数を与えて初期化する．
+   *
+   * ページは最初に書き込むときに確保する．<br>
+   * パラメータの制約は BloomFilter と同じであり，制約を満たさない場合は
+   * 最も近い値を設定してパラメータエラーフラグを立てる．
+   *
+   * @param[in] log2_num_bits フィルタ用配列サイズのビット数の底2による対数値
+   * @param[in] num_hashes ハッシュ関数の個数
+   */
+  SnapshotBloomFilter(std::size_t log2_num_bits, std::size_t num_hashes)
+      : log2_num_bits_(log2_num_bits), num_hashes_(num_hashes), size_(0),
+      num_copied_pages_(0), parameter_error_flags_(0) {
+    if (log2_num_bits_ > kMaxLog2NumBits) {
+      log2_num_bits_ = kMaxLog2NumBits;
+      parameter_error_flags_ |= kHasLog2NumBitsError;
+    }
+    if (num_hashes_ < 1) {
+      num_hashes_ = 1;
+      parameter_error_flags_ |= kHasNumHashesError;
+    }
+    std::size_t num_pages = (NumWords() + kSnapshotPageWords - 1) >> kSnapshotLog2PageWords;
+    pages_.resize(num_pages);
+    data_.assign(num_pages, ZeroPage());
+    owned_.assign(num_pages, 0);
+  }
+
+  SnapshotBloomFilter(const SnapshotBloomFilter&) = delete;
+  SnapshotBloomFilter& operator=(const SnapshotBloomFilter&) = delete;
+
+  /**
+   * 要素を追加する．
+   *
+   * @param[in] entry 追加する要素
+   */
+  void Insert(const T& entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列を追加する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 追加する文字列
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  void Insert(std::string_view entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を追加する．
+   *
+   * BloomFilter::Insert(const HashedKey&) と同じビットを立てる．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  void Insert(const HashedKey& key) {
+    ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      std::size_t w = position >> 6;
+      WritablePage(w >> kSnapshotLog2PageWords)[w & (kSnapshotPageWords - 1)]
+        |= 1ull << (position & 63);
+    });
+    size_++;
+  }
+
+  /**
+   * BloomFilter の内容を追加する．
+   *
+   * 既存の内容との論理和をとる．<br>
+   * 配列サイズまたはハッシュ関数の個数が異なる場合は何もせず false を返す．
+   *
+   * @tparam Allocator Bloom filter のフィルタ用配列のアロケータ
+   * @param[in] bf Bloom filter
+   * @return 追加できた場合は true
+   */
+  template <class Allocator>
+  bool AddFilter(const BloomFilter<T, HashPolicy, Allocator>& bf) {
+    if (bf.Log2NumBits() != log2_num_bits_ || bf.NumHashes() != num_hashes_) {
+      return false;
+    }
+    const std::uint64_t* words = bf.Data();
+    for (std::size_t p = 0; p < pages_.size(); p++) {
+      std::size_t offset = p << kSnapshotLog2PageWords;
+      std::size_t num_words = PageWords(p);
+      if (std::any_of(words + offset, words + offset + num_words,
+          [](std::uint64_t word) { return word != 0; })) {
+        std::uint64_t* page = WritablePage(p);
+        for (std::size_t i = 0; i < num_words; i++) {
+          page[i] |= words[offset + i];
+        }
+      }
+    }
+    size_ += bf.Size();
+    return true;
+  }
+
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 文字列が含まれているかを確率的に判定する．
+   *
+   * T が std::string の場合のみ使える．
+   *
+   * @param[in] entry 含まれているかを判定したい文字列
+   * @return 含まれている可能性がある場合は true
+   */
+  template <class U = T, EnableIfString<U> = 0>
+  bool Contains(std::string_view entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * BloomFilter::Contains(const HashedKey&) と同じ結果を返す．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const HashedKey& key) const {
+    return ForEachPosition(key, log2_num_bits_, num_hashes_, [this](std::size_t position) {
+      std::size_t w = position >> 6;
+      std::uint64_t word = data_[w >> kSnapshotLog2PageWords][w & (kSnapshotPageWords - 1)];
+      return (word & (1ull << (position & 63))) != 0;
+    });
+  }
+
+  /**
+   * 現在の内容のスナップショットを返す．
+   *
+   * フィルタ用配列は複製せず，すべてのページを共有する．<br>
+   * 以降の追加では，共有中のページに最初に書き込むときにそのページを複製する．
+   *
+   * @return スナップショット
+   */
+  BloomFilterSnapshot<T, HashPolicy> Snapshot() {
+    BloomFilterSnapshot<T, HashPolicy> snapshot;
+    snapshot.pages_.assign(pages_.begin(), pages_.end());
+    snapshot.data_.assign(data_.begin(), data_.end());
+    snapshot.log2_num_bits_ = log2_num_bits_;
+    snapshot.num_hashes_ = num_hashes_;
+    snapshot.size_ = size_;
+    std::fill(owned_.begin(), owned_.end(), 0);
+    return snapshot;
+  }
+
+  /**
+   * BloomFilter::Save() と同じ形式でストリームに書き出す．
+   *
+   * @param[in,out] out 出力ストリーム
+   * @return 書き出せた場合は true
+   */
+  bool Save(std::ostream& out) {
+    return Snapshot().Save(out);
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  std::size_t NumBits() const {
+    return std::size_t{1} << log2_num_bits_;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  std::size_t Log2NumBits() const {
+    return log2_num_bits_;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  std::size_t NumHashes() const {
+    return num_hashes_;
+  }
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  std::size_t NumWords() const {
+    return (NumBits() + 63) / 64;
+  }
+
+  /**
+   * ページ数を返す．
+   *
+   * @return ページ数
+   */
+  std::size_t NumPages() const {
+    return pages_.size();
+  }
+
+  /**
+   * 確保済みのページ数を返す．
+   *
+   * @return 一度でも書き込まれたページ数
+   */
+  std::size_t NumAllocatedPages() const {
+    return pages_.size() - std::count(pages_.begin(), pages_.end(), nullptr);
+  }
+
+  /**
+   * スナップショットと共有していたために複製したページ数の累計を返す．
+   *
+   * @return 複製したページ数の累計
+   */
+  std::size_t NumCopiedPages() const {
+    return num_copied_pages_;
+  }
+
+  /**
+   * 追加された要素数を返す．
+   *
+   * @return 追加された要素数．
+   */
+  std::size_t Size() const {
+    return size_;
+  }
+
+  /**
+   * パラメータエラーを表すビットフラグを返す．
+   *
+   * @return パラメータエラーを表すビットフラグ．
+   */
+  int ParameterErrorFlags() const {
+    return parameter_error_flags_;
+  }
+
+  /**
+   * パラメータエラーがあるかを返す．
+   *
+   * @return パラメータエラーがある場合はtrue.
+   */
+  bool HasParameterError() const {
+    return (parameter_error_flags_ != 0);
+  }
+
+public:
+  /** フィルタ用配列サイズのビット数の底2による対数値の設定に対するビットフラグ */
+  static constexpr int kHasLog2NumBitsError = 0x1;
+
+  /** Bloom filter におけるハッシュ関数の個数に対するビットフラグ */
+  static constexpr int kHasNumHashesError = 0x2;
+
+private:
+  /**
+   * 一度も書き込まれていないページの内容として読む，0のページを返す．
+   *
+   * @return 0のページの先頭
+   */
+  static const std::uint64_t* ZeroPage() {
+    alignas(64) static const std::uint64_t page[kSnapshotPageWords] = {};
+    return page;
+  }
+
+  /**
+   * ページの要素数を返す．
+   *
+   * @param[in] page ページの番号
+   * @return ページの要素数
+   */
+  std::size_t PageWords(std::size_t page) const {
+    return std::min(kSnapshotPageWords, NumWords() - (page << kSnapshotLog2PageWords));
+  }
+
+  /**
+   * 書き込めるページを返す．
+   *
+   * 最後の Snapshot() 以降に初めて書き込む場合は，未確保であれば確保し，
+   * スナップショットと共有中であれば複製する．
+   *
+   * @param[in] page ページの番号
+   * @return ページの先頭
+   */
+  std::uint64_t* WritablePage(std::size_t page) {
+    if (!owned_[page]) {
+      if (pages_[page] == nullptr || pages_[page].use_count() > 1) {
+        std::size_t num_words = PageWords(page);
+        std::shared_ptr<std::uint64_t[]> copy(new std::uint64_t[num_words]);
+        std::copy(data_[page], data_[page] + num_words, copy.get());
+        num_copied_pages_ += (pages_[page] != nullptr);
+        pages_[page] = std::move(copy);
+        data_[page] = pages_[page].get();
+      }
+      else {
+        // 他のスレッドで解放されたスナップショットの読み込みが，以降の書き込みより前に完了したことを保証する．
+        std::atomic_thread_fence(std::memory_order_acquire);
+      }
+      owned_[page] = 1;
+    }
+    return pages_[page].get();
+  }
+
+private:
+  /** ページ．一度も書き込まれていないページは nullptr とする． */
+  std::vector<std::shared_ptr<std::uint64_t[]>> pages_;
+
+  /**
+   * 各ページの先頭．
+   *
+   * nullptr のページは0のページを指す．i ビット目は data_[i / 64 / kSnapshotPageWords] の
+   * (i / 64 % kSnapshotPageWords) 番目の要素の下位から (i % 64) ビット目に対応する．
+   */
+  std::vector<const std::uint64_t*> data_;
+
+  /** 最後の Snapshot() 以降に書き込み可能にしたページは1． */
+  std::vector<std::uint8_t> owned_;
+
+  /** フィルタ用配列サイズのビット数の底2による対数値． */
+  std::size_t log2_num_bits_;
+
+  /** Bloom filter におけるハッシュ関数の個数． */
+  std::size_t num_hashes_;
+
+  /** 追加された要素数． */
+  std::size_t size_;
+
+  /** 複製したページ数の累計． */
+  std::size_t num_copied_pages_;
+
+  /** パラメータエラーを表すビットフラグ. */
+  int parameter_error_flags_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_SNAPSHOT_BLOOM_FILTER_H_
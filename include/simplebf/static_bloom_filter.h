@@ -0,0 +1,176 @@
+/**
+ * @file static_bloom_filter.h
+ * @brief パラメータをコンパイル時に固定した Bloom filter 用クラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_STATIC_BLOOM_FILTER_H_
+#define CPPBF_STATIC_BLOOM_FILTER_H_
+
+#include "hasher.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief パラメータをコンパイル時に固定した Bloom filter 用クラス．
+ *
+ * フィルタ用配列サイズとハッシュ関数の個数をテンプレート引数で与える．<br>
+ * フィルタ用配列は std::array で保持するため，動的なメモリ確保を行わず，他のオブジェクトに埋め込める．<br>
+ * 位置の計算に使うマスクとループの回数は定数となり，判定のループは展開されるため，
+ * 小さなフィルタを頻繁に判定する場合に BloomFilter より高速である．
+ *
+ * 位置の計算方法は BloomFilter と同じであり，同じパラメータの BloomFilter と同じビットが立つ．<br>
+ * HashedKey を受け取るメンバ関数は constexpr であり，コンパイル時にフィルタを構築できる．
+ *
+ * @tparam T 要素の型
+ * @tparam Log2Bits フィルタ用配列サイズのビット数の底2による対数値 (33以下)
+ * @tparam K ハッシュ関数の個数 (1以上)
+ * @tparam HashPolicy 要素のハッシュ値を計算する方針クラス．詳細は Hasher を参照．
+ */
+template <class T, std::size_t Log2Bits, std::size_t K,
+  class HashPolicy = Hasher<T>>
+class StaticBloomFilter {
+  static_assert(Log2Bits <= kMaxLog2NumBits, "The filter size must not exceed 2^33 bits.");
+  static_assert(K >= 1, "At least one hash function is required.");
+
+public:
+  /** デフォルトコンストラクタ． */
+  constexpr StaticBloomFilter() : words_{}, size_(0) {
+  }
+
+  /**
+   * 要素を追加する．
+   *
+   * @param[in] entry 追加する要素
+   */
+  void Insert(const T& entry) {
+    Insert(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素を追加する．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   */
+  constexpr void Insert(const HashedKey& key) {
+    ForEachPosition(key, Log2Bits, K, [this](std::size_t position) {
+      words_[position >> 6] |= std::uint64_t{1} << (position & 63);
+    });
+    size_++;
+  }
+
+  /**
+   * 要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] entry 要素が含まれているかを判定したい要素
+   * @return 含まれている可能性がある場合は true
+   */
+  bool Contains(const T& entry) const {
+    return Contains(MakeHashedKey<HashPolicy>(entry));
+  }
+
+  /**
+   * 計算済みのハッシュ値で要素が含まれているかを確率的に判定する．
+   *
+   * @param[in] key 計算済みのハッシュ値
+   * @return 含まれている可能性がある場合は true
+   */
+  constexpr bool Contains(const HashedKey& key) const {
+    return ForEachPosition(key, Log2Bits, K, [this](std::size_t position) {
+      return ((words_[position >> 6] >> (position & 63)) & 1) != 0;
+    });
+  }
+
+  /**
+   * 配列サイズによらない計算済みのハッシュ値を返す．
+   *
+   * @param[in] entry ハッシュ値を計算したい要素
+   * @return 計算済みのハッシュ値
+   */
+  static HashedKey HashKey(const T& entry) {
+    return MakeHashedKey<HashPolicy>(entry);
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数を返す．
+   *
+   * @return フィルタ用配列サイズのビット数
+   */
+  static constexpr std::size_t NumBits() {
+    return kNumBits;
+  }
+
+  /**
+   * フィルタ用配列サイズのビット数の底2による対数値を返す．
+   *
+   * @return フィルタ用配列サイズのビット数の底2による対数値
+   */
+  static constexpr std::size_t Log2NumBits() {
+    return Log2Bits;
+  }
+
+  /**
+   * Bloom filter におけるハッシュ関数の個数を返す．
+   *
+   * @return Bloom filter におけるハッシュ関数の個数
+   */
+  static constexpr std::size_t NumHashes() {
+    return K;
+  }
+
+  /**
+   * フィルタ用配列の64ビット単位の要素数を返す．
+   *
+   * @return フィルタ用配列の64ビット単位の要素数
+   */
+  static constexpr std::size_t NumWords() {
+    return kNumWords;
+  }
+
+  /**
+   * 追加された要素数を返す．
+   *
+   * @return 追加された要素数．
+   */
+  constexpr std::size_t Size() const {
+    return size_;
+  }
+
+  /**
+   * フィルタ用配列の先頭を返す．
+   *
+   * i ビット目は Data()[i / 64] の下位から (i % 64) ビット目に対応する．
+   *
+   * @return フィルタ用配列の先頭
+   */
+  constexpr const std::uint64_t* Data() const {
+    return words_.data();
+  }
+
+private:
+  /** フィルタ用配列サイズのビット数． */
+  static constexpr std::size_t kNumBits = std::size_t{1} << Log2Bits;
+
+  /** フィルタ用配列の64ビット単位の要素数． */
+  static constexpr std::size_t kNumWords = (kNumBits + 63) / 64;
+
+private:
+  /**
+   * Bloom filter 用フィルタ．
+   *
+   * i ビット目は words_[i / 64] の下位から (i % 64) ビット目に対応する．
+   */
+  std::array<std::uint64_t, kNumWords> words_;
+
+  /** 追加された要素数． */
+  std::size_t size_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_STATIC_BLOOM_FILTER_H_
@@ -0,0 +1,97 @@
+/**
+ * @file striped_counter.h
+ * @brief 複数スレッドから同時に加算できるカウンタを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_STRIPED_COUNTER_H_
+#define CPPBF_STRIPED_COUNTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * @brief 複数スレッドから同時に加算できるカウンタ．
+ *
+ * 値をキャッシュラインごとに分けた kNumStripes 個のアトミック変数に分散し，
+ * 各スレッドは自身に割り当てられた1個にのみ加算する．<br>
+ * そのため，複数スレッドが同時に加算しても同じキャッシュラインを奪い合わない．
+ * Load() はすべての値の和を返す．
+ *
+ * Add() と Load() は任意のスレッドから同時に呼び出せる．
+ * 実行中の Add() と同時に呼び出した Load() は，その加算の前後いずれかの値を返す．<br>
+ * Reset() は他の操作と同時に呼び出してはならない．
+ */
+class StripedCounter {
+public:
+  /** 値を0として初期化する． */
+  StripedCounter() : stripes_(new Stripe[kNumStripes]) {
+  }
+
+  /**
+   * 値を加算する．
+   *
+   * @param[in] value 加算する値
+   */
+  void Add(std::size_t value) {
+    stripes_[ThisThreadStripe()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  /**
+   * 値を返す．
+   *
+   * @return 値
+   */
+  std::size_t Load() const {
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < kNumStripes; i++) {
+      sum += stripes_[i].value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  /** 値を0にする． */
+  void Reset() {
+    for (std::size_t i = 0; i < kNumStripes; i++) {
+      stripes_[i].value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+public:
+  /** 値を分散するアトミック変数の個数 (2のべき乗)． */
+  static constexpr std::size_t kNumStripes = 64;
+
+private:
+  /** キャッシュラインを占有するアトミック変数． */
+  struct alignas(64) Stripe {
+    /** 値． */
+    std::atomic<std::size_t> value{0};
+  };
+
+  /**
+   * 呼び出したスレッドが加算するアトミック変数の番号を返す．
+   *
+   * スレッドが初めて呼び出したときに，順に番号を割り当てる．
+   *
+   * @return アトミック変数の番号
+   */
+  static std::size_t ThisThreadStripe() {
+    static std::atomic<std::size_t> next_stripe{0};
+    thread_local std::size_t stripe
+      = next_stripe.fetch_add(1, std::memory_order_relaxed) & (kNumStripes - 1);
+    return stripe;
+  }
+
+private:
+  /** 値を分散するアトミック変数． */
+  std::unique_ptr<Stripe[]> stripes_;
+};
+
+} // namespace sbf
+
+#endif // #ifndef CPPBF_STRIPED_COUNTER_H_
@@ -7,7 +7,9 @@
 #define CPPBF_UTIL_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 /**
  * @brief Bloom filter のための名前空間．
@@ -27,10 +29,49 @@ namespace hash {
  * @param[in] str 文字列
  * @return ハッシュ値
  */
-std::size_t Djb2(const std::string& str);
+std::size_t Djb2(std::string_view str);
+
+/**
+ * Daniel J. Bernstein によるハッシュ関数によるハッシュ値を返す．
+ *
+ * 同じバイト列を表す文字列に対する Djb2(std::string_view) と同じ値を返す．
+ *
+ * @param[in] data バイト列の先頭
+ * @param[in] size バイト列のサイズ [bytes]
+ * @return ハッシュ値
+ */
+std::size_t Djb2(const void* data, std::size_t size);
+
+/**
+ * バイト列の64ビットハッシュ値を返す．
+ *
+ * 8バイト単位で読み込み，splitmix64 の撹拌関数で混ぜ合わせる．<br>
+ * Djb2() より高速であり，すべてのビットがよく撹拌される．<br>
+ * seed が異なれば互いに独立とみなせるハッシュ値を返す．
+ *
+ * @param[in] data バイト列の先頭
+ * @param[in] size バイト列のサイズ [bytes]
+ * @param[in] seed シード
+ * @return ハッシュ値
+ */
+std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t seed);
 
 } // namespace hash 
 
+/**
+ * 見積もられた偽陽性率を返す．
+ *
+ * 各ビットにフラグが立つ事象を独立とみなした近似値
+ * (1 - (1 - 1/m)^(kn))^k を返す．
+ *
+ * @param[in] num_bits Bloom filter の配列のビット数 m
+ * @param[in] num_hashes ハッシュ関数の個数 k
+ * @param[in] num_entries 追加された要素数 n
+ * @return 見積もられた偽陽性率
+ */
+double EstimatedFalsePositiveRate(std::size_t num_bits, std::size_t num_hashes,
+  std::size_t num_entries);
+
 } // namespace sbf
 
 #endif // #ifndef CPPBF_UTIL_H_
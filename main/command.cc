@@ -0,0 +1,571 @@
+/**
+ * @file command.cc
+ * @brief サブコマンドを定義するソースファイル．
+ */
+
+#include "command.h"
+#include "json.h"
+#include "simplebf/line_reader.h"
+#include "simplebf/serialization.h"
+#include "simplebf/util.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief コマンドラインプログラムのための名前空間．
+ */
+namespace cli {
+
+namespace {
+
+/**
+ * "--name=value" 形式の引数から値を取り出す．
+ *
+ * @param[in] arg 引数
+ * @param[in] name オプション名 ("--name=" の形式)
+ * @param[out] value 値
+ * @return 引数が指定されたオプションの場合は true
+ */
+bool MatchOption(const std::string& arg, const std::string& name,
+    std::string& value) {
+  if (arg.rfind(name, 0) != 0) {
+    return false;
+  }
+  value = arg.substr(name.size());
+  return true;
+}
+
+/**
+ * サブコマンドのヘルプを表示する．
+ *
+ * @param[in] path この実行ファイルへのパス
+ * @param[in] out 出力ストリーム（省略時 std::cout）
+ * @return 出力ストリームへの参照
+ */
+std::ostream& ShowCommandHelp(const std::string& path,
+    std::ostream& out = std::cout) {
+  out << "Bloom filter のファイルを操作するサブコマンド．\n";
+  out << "\n";
+  out << "Usage:\n";
+  out << "  " << path << " build [options] output [input]\n";
+  out << "  " << path << " query [options] filter [input]\n";
+  out << "  " << path << " merge output input...\n";
+  out << "  " << path << " stats [--json] filter...\n";
+  out << "  " << path << " fold [options] input output\n";
+  out << "  " << path << " embed [options] filter output\n";
+  out << "\n";
+  out << "Commands:\n";
+  out << "  build: 改行区切りの要素を input (省略時または \"-\" の場合は標準入力) から読み込んで\n";
+  out << "    フィルタを構築し，output に書き出す\n";
+  out << "  query: filter を読み込み，改行区切りの要素を input から読み込んで判定する\n";
+  out << "  merge: フィルタ用配列サイズとハッシュ関数の個数が等しい input の論理和を output に書き出す\n";
+  out << "    フィルタは一定サイズずつ読み込むため，メモリに収まらないフィルタも扱える\n";
+  out << "  stats: filter の設定と充填率，偽陽性率の見積もりを出力する\n";
+  out << "  fold: input のフィルタ用配列を折りたたんで縮小し，output に書き出す\n";
+  out << "  embed: filter のフィルタ用配列を定数として埋め込む C++ のヘッダファイルを output\n";
+  out << "    (\"-\" の場合は標準出力) に書き出す\n";
+  out << "\n";
+  out << "Options:\n";
+  out << "  --log2-num-bits=N: build で，フィルタ用配列のビット数の底2による対数値（省略時13）\n";
+  out << "  --num-hashes=K: build で，ハッシュ関数の個数（省略時は --expected-entries から最適値を設定）\n";
+  out << "  --expected-entries=N: build で，追加する要素数の見込み（省略時1024）\n";
+  out << "  --output=matches|bitmap: query で，含まれると判定された行を出力するか，\n";
+  out << "    各行の判定結果を下位ビットから詰めたビットマップを出力するか（省略時 matches）\n";
+  out << "  --compress: build, fold で，小さくなる場合はフィルタ用配列を Rice 符号で圧縮して書き出す\n";
+  out << "    圧縮したファイルも query, merge, stats, fold でそのまま読み込める\n";
+  out << "  --json: stats で，結果を JSON 形式で出力する\n";
+  out << "  --factor=F: fold で，縮小率（2べき，省略時2）\n";
+  out << "  --max-fpr=P: fold で，追加された要素数から見積もった偽陽性率が P 以下となる\n";
+  out << "    最大の縮小率を選ぶ（--factor より優先）\n";
+  out << "  --name=NAME: embed で，sbf::BloomFilterView の変数名（省略時 kFilter）\n";
+  out << "    フィルタ用配列の変数名は NAME に Words を付けたものとなる\n";
+  out << "  --namespace=NS: embed で，定義を囲む名前空間（省略時は囲まない）\n";
+  out << "  --type=TYPE: embed で，要素の型（省略時 std::string）\n";
+  out << "\n";
+  out << "Examples:\n";
+  out << "  " << path << " build --log2-num-bits=24 --expected-entries=1000000 part0.sbf keys0.txt\n";
+  out << "  " << path << " merge all.sbf part0.sbf part1.sbf\n";
+  out << "  " << path << " query all.sbf < access.log\n";
+  out << "  " << path << " stats all.sbf\n";
+  out << "  " << path << " fold --max-fpr=0.01 all.sbf all-small.sbf\n";
+  out << "  " << path << " embed --name=kBlocklist --namespace=app blocklist.sbf blocklist.h\n";
+  return out;
+}
+
+/**
+ * フィルタをファイルに書き出す．
+ *
+ * compress が true の場合，圧縮したほうが小さくなるときのみ圧縮して書き出す．<br>
+ * 一時ファイルに書き出してから置き換えるため (sbf::ReplaceFile() を参照)，
+ * 途中で停止しても以前のファイルは壊れない．
+ *
+ * @param[in] bf フィルタ
+ * @param[in] output_path 出力ファイルのパス
+ * @param[in] compress 圧縮を試みる場合は true
+ * @return 書き出せた場合は true
+ */
+bool SaveFilter(const sbf::BloomFilter<std::string>& bf,
+    const std::string& output_path, bool compress) {
+  std::size_t raw_size = sbf::kFilterHeaderSize + bf.NumWords() * sizeof(std::uint64_t);
+  bool compressed = compress && bf.CompressedSize() < raw_size;
+  return sbf::ReplaceFile(output_path, [&bf, compressed](std::ostream& output) {
+    return compressed ? bf.SaveCompressed(output) : bf.Save(output);
+  });
+}
+
+/**
+ * build サブコマンドを実行する．
+ *
+ * @param[in] path この実行ファイルへのパス
+ * @param[in] args サブコマンドの引数
+ * @return 終了コード
+ */
+int RunBuild(const std::string& path, const std::vector<std::string>& args) {
+  std::size_t log2_num_bits = 13;
+  std::optional<std::size_t> num_hashes;
+  std::size_t expected_entries = 1024;
+  bool compress = false;
+  std::vector<std::string> positional;
+  for (auto&& arg : args) {
+    std::string value;
+    if (arg == "--compress") {
+      compress = true;
+    }
+    else if (MatchOption(arg, "--log2-num-bits=", value)) {
+      log2_num_bits = std::strtoull(value.c_str(), nullptr, 10);
+    }
+    else if (MatchOption(arg, "--num-hashes=", value)) {
+      num_hashes = std::strtoull(value.c_str(), nullptr, 10);
+    }
+    else if (MatchOption(arg, "--expected-entries=", value)) {
+      expected_entries = std::strtoull(value.c_str(), nullptr, 10);
+    }
+    else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.empty() || positional.size() > 2 || expected_entries == 0) {
+    ShowCommandHelp(path, std::cerr);
+    return 1;
+  }
+  const std::string& output_path = positional[0];
+  std::string input_path = (positional.size() > 1) ? positional[1] : "-";
+
+  using bf_t = sbf::BloomFilter<std::string>;
+  bf_t bf(log2_num_bits);
+  if ((bf.ParameterErrorFlags() & bf_t::kHasLog2NumBitsError) != 0) {
+    std::cerr << "Failed to set the size of filter list." << std::endl;
+    return 1;
+  }
+  if (num_hashes) {
+    bf.SetNumHashes(num_hashes.value());
+  }
+  else {
+    bf.SetOptimalNumHashes(expected_entries);
+  }
+
+  if (!InsertLines(input_path, bf)) {
+    std::cerr << "Failed to read " << input_path << std::endl;
+    return 1;
+  }
+
+  if (!SaveFilter(bf, output_path, compress)) {
+    std::cerr << "Failed to write " << output_path << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * query サブコマンドを実行する．
+ *
+ * @param[in] path この実行ファイルへのパス
+ * @param[in] args サブコマンドの引数
+ * @return 終了コード
+ */
+int RunQuery(const std::string& path, const std::vector<std::string>& args) {
+  bool output_bitmap = false;
+  std::vector<std::string> positional;
+  for (auto&& arg : args) {
+    if (arg == "--output=matches") {
+      output_bitmap = false;
+    }
+    else if (arg == "--output=bitmap") {
+      output_bitmap = true;
+    }
+    else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.empty() || positional.size() > 2) {
+    ShowCommandHelp(path, std::cerr);
+    return 1;
+  }
+  const std::string& filter_path = positional[0];
+  std::string input_path = (positional.size() > 1) ? positional[1] : "-";
+
+  sbf::BloomFilter<std::string> bf;
+  std::ifstream input(filter_path, std::ios::binary);
+  if (!bf.Load(input)) {
+    std::cerr << "Failed to load " << filter_path << std::endl;
+    return 1;
+  }
+
+  std::size_t num_queries = 0;
+  std::size_t num_matches = 0;
+  if (!QueryLines(input_path, bf, output_bitmap, num_queries, num_matches)) {
+    std::cerr << "Failed to read " << input_path << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * merge サブコマンドを実行する．
+ *
+ * @param[in] path この実行ファイルへのパス
+ * @param[in] args サブコマンドの引数
+ * @return 終了コード
+ */
+int RunMerge(const std::string& path, const std::vector<std::string>& args) {
+  if (args.size() < 2) {
+    ShowCommandHelp(path, std::cerr);
+    return 1;
+  }
+  std::vector<std::string> input_paths(args.begin() + 1, args.end());
+  if (!sbf::MergeFilterFiles(input_paths, args[0])) {
+    std::cerr << "Failed to merge filters. "
+              << "All filters must have the same size and number of hash functions."
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * stats サブコマンドを実行する．
+ *
+ * 偽陽性率は，充填率 p とハッシュ関数の個数 k から p^k として見積もった値と，
+ * 追加された要素数から sbf::EstimatedFalsePositiveRate() で見積もった値を出力する．
+ *
+ * @param[in] path この実行ファイルへのパス
+ * @param[in] args サブコマンドの引数
+ * @return 終了コード
+ */
+int RunStats(const std::string& path, const std::vector<std::string>& args) {
+  bool json = false;
+  std::vector<std::string> filter_paths;
+  for (auto&& arg : args) {
+    if (arg == "--json") {
+      json = true;
+    }
+    else {
+      filter_paths.push_back(arg);
+    }
+  }
+  if (filter_paths.empty()) {
+    ShowCommandHelp(path, std::cerr);
+    return 1;
+  }
+
+  if (json) {
+    std::cout << "[\n";
+  }
+  for (std::size_t i = 0; i < filter_paths.size(); i++) {
+    sbf::FilterHeader header;
+    std::uint64_t num_set_bits = 0;
+    if (!sbf::ReadFilterStats(filter_paths[i], header, num_set_bits)) {
+      std::cerr << "Failed to read " << filter_paths[i] << std::endl;
+      return 1;
+    }
+    std::uint64_t num_bits = std::uint64_t{1} << header.log2_num_bits;
+    bool compressed = (header.flags & sbf::kFilterFlagCompressed) != 0;
+    double fill_ratio = static_cast<double>(num_set_bits) / num_bits;
+    double measured_fp = std::pow(fill_ratio, header.num_hashes);
+    double estimated_fp = sbf::EstimatedFalsePositiveRate(num_bits,
+      header.num_hashes, header.size);
+
+    if (json) {
+      std::cout << "  {\"path\": " << JsonString{filter_paths[i]} << ", "
+                << "\"num_bits\": " << num_bits << ", "
+                << "\"num_hashes\": " << header.num_hashes << ", "
+                << "\"num_entries\": " << header.size << ", "
+                << "\"compressed\": " << (compressed ? "true" : "false") << ", "
+                << "\"num_set_bits\": " << num_set_bits << ", "
+                << "\"fill_ratio\": " << JsonNumber{fill_ratio} << ", "
+                << "\"fill_false_positive_rate\": " << JsonNumber{measured_fp} << ", "
+                << "\"estimated_false_positive_rate\": " << JsonNumber{estimated_fp} << "}"
+                << (i + 1 < filter_paths.size() ? "," : "") << "\n";
+      continue;
+    }
+
+    if (i > 0) {
+      std::cout << "\n";
+    }
+    std::cout << "[" << filter_paths[i] << "]\n";
+    std::cout << "The filter size               : " << num_bits << " [bits]\n";
+    std::cout << "The number of hash functions  : " << header.num_hashes << "\n";
+    std::cout << "The number of entries         : " << header.size << "\n";
+    std::cout << "Compressed                    : " << (compressed ? "yes" : "no") << "\n";
+    std::cout << "The number of set bits        : " << num_set_bits << "\n";
+    std::cout << "Fill ratio                    : " << fill_ratio << "\n";
+    std::cout << "False Positive Rate from fill : " << measured_fp << "\n";
+    std::cout << "Estimated False Positive Rate : " << estimated_fp << "\n";
+  }
+  if (json) {
+    std::cout << "]\n";
+  }
+  std::cout << std::flush;
+  return 0;
+}
+
+/**
+ * fold サブコマンドを実行する．
+ *
+ * @param[in] path この実行ファイルへのパス
+ * @param[in] args サブコマンドの引数
+ * @return 終了コード
+ */
+int RunFold(const std::string& path, const std::vector<std::string>& args) {
+  std::size_t factor = 2;
+  std::optional<double> max_fpr;
+  bool compress = false;
+  std::vector<std::string> positional;
+  for (auto&& arg : args) {
+    std::string value;
+    if (arg == "--compress") {
+      compress = true;
+    }
+    else if (MatchOption(arg, "--factor=", value)) {
+      factor = std::strtoull(value.c_str(), nullptr, 10);
+    }
+    else if (MatchOption(arg, "--max-fpr=", value)) {
+      max_fpr = std::strtod(value.c_str(), nullptr);
+    }
+    else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() != 2) {
+    ShowCommandHelp(path, std::cerr);
+    return 1;
+  }
+
+  sbf::BloomFilter<std::string> bf;
+  std::ifstream input(positional[0], std::ios::binary);
+  if (!bf.Load(input)) {
+    std::cerr << "Failed to load " << positional[0] << std::endl;
+    return 1;
+  }
+
+  if (max_fpr) {
+    // 見積もりが上限を超えない範囲で縮小率を倍にしていく．
+    factor = 1;
+    while (factor * 2 <= bf.NumBits()
+        && sbf::EstimatedFalsePositiveRate(bf.NumBits() / (factor * 2),
+          bf.NumHashes(), bf.Size()) <= max_fpr.value()) {
+      factor *= 2;
+    }
+  }
+  if (!bf.Fold(factor)) {
+    std::cerr << "Failed to fold by " << factor
+              << ". The factor must be a power of two not exceeding the filter size."
+              << std::endl;
+    return 1;
+  }
+
+  if (!SaveFilter(bf, positional[1], compress)) {
+    std::cerr << "Failed to write " << positional[1] << std::endl;
+    return 1;
+  }
+  std::cerr << "Folded by " << factor << " to " << bf.NumBits() << " [bits], "
+            << "expected false positive rate " << bf.ExpectedFalsePositiveRate()
+            << std::endl;
+  return 0;
+}
+
+/**
+ * embed サブコマンドを実行する．
+ *
+ * @param[in] path この実行ファイルへのパス
+ * @param[in] args サブコマンドの引数
+ * @return 終了コード
+ */
+int RunEmbed(const std::string& path, const std::vector<std::string>& args) {
+  std::string name = "kFilter";
+  std::string name_space;
+  std::string type = "std::string";
+  std::vector<std::string> positional;
+  for (auto&& arg : args) {
+    std::string value;
+    if (MatchOption(arg, "--name=", value)) {
+      name = value;
+    }
+    else if (MatchOption(arg, "--namespace=", value)) {
+      name_space = value;
+    }
+    else if (MatchOption(arg, "--type=", value)) {
+      type = value;
+    }
+    else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() != 2) {
+    ShowCommandHelp(path, std::cerr);
+    return 1;
+  }
+
+  // 圧縮されたファイルも読み込めるように，一度フィルタとして読み込む．
+  sbf::BloomFilter<std::string> bf;
+  std::ifstream input(positional[0], std::ios::binary);
+  if (!bf.Load(input)) {
+    std::cerr << "Failed to load " << positional[0] << std::endl;
+    return 1;
+  }
+
+  sbf::FilterHeader header;
+  header.log2_num_bits = bf.Log2NumBits();
+  header.num_hashes = bf.NumHashes();
+  header.size = bf.Size();
+  std::ofstream file;
+  if (positional[1] != "-") {
+    file.open(positional[1]);
+  }
+  std::ostream& output = (positional[1] == "-") ? std::cout : file;
+  if (!sbf::WriteFilterSource(output, header, bf.Data(), name, name_space, type)
+      || !output.flush()) {
+    std::cerr << "Failed to write " << positional[1]
+              << ". The name and namespace must be C++ identifiers." << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace
+
+/**
+ * 改行区切りの要素をファイルまたは標準入力から読み込んでフィルタに追加する．
+ *
+ * @param[in] path ファイルのパス（"-" の場合は標準入力）
+ * @param[in,out] bf フィルタ
+ * @return 読み込めた場合は true
+ */
+bool InsertLines(const std::string& path, sbf::BloomFilter<std::string>& bf) {
+  sbf::LineReader reader(path);
+  if (!reader.IsOpen()) {
+    return false;
+  }
+
+  std::string_view line;
+  while (reader.Next(line)) {
+    bf.Insert(line);
+  }
+  return !reader.HasError();
+}
+
+/**
+ * 改行区切りの要素をファイルまたは標準入力から読み込んで判定し，結果を標準出力に出力する．
+ *
+ * @param[in] path ファイルのパス（"-" の場合は標準入力）
+ * @param[in] bf フィルタ
+ * @param[in] output_bitmap ビットマップを出力する場合は true
+ * @param[out] num_queries 判定した要素数
+ * @param[out] num_matches 含まれると判定された要素数
+ * @return 読み込めた場合は true
+ */
+bool QueryLines(const std::string& path, const sbf::BloomFilter<std::string>& bf,
+    bool output_bitmap, std::size_t& num_queries, std::size_t& num_matches) {
+  sbf::LineReader reader(path);
+  if (!reader.IsOpen()) {
+    return false;
+  }
+
+  // 出力バッファは標準出力を閉じるまで有効である必要がある．
+  static std::vector<char> output_buffer(sbf::LineReader::kBufferSize);
+  std::setvbuf(stdout, output_buffer.data(), _IOFBF, output_buffer.size());
+
+  num_queries = 0;
+  num_matches = 0;
+  std::string_view line;
+  unsigned char bits = 0;
+  while (reader.Next(line)) {
+    bool contained = bf.Contains(line);
+    if (output_bitmap) {
+      bits |= static_cast<unsigned char>(contained) << (num_queries & 7);
+      if ((num_queries & 7) == 7) {
+        std::fputc(bits, stdout);
+        bits = 0;
+      }
+    }
+    else if (contained) {
+      std::fwrite(line.data(), 1, line.size(), stdout);
+      std::fputc('\n', stdout);
+    }
+    num_queries++;
+    num_matches += contained;
+  }
+  if (output_bitmap && (num_queries & 7) != 0) {
+    std::fputc(bits, stdout);
+  }
+  std::fflush(stdout);
+  return !reader.HasError();
+}
+
+/**
+ * サブコマンド名かを返す．
+ *
+ * @param[in] name 名前
+ * @return サブコマンド名の場合は true
+ */
+bool IsCommand(const std::string& name) {
+  return name == "build" || name == "query" || name == "merge" || name == "stats"
+    || name == "fold" || name == "embed";
+}
+
+/**
+ * サブコマンドを実行する．
+ *
+ * @param[in] argc コマンドライン引数の数
+ * @param[in] argv コマンドライン引数
+ * @return 終了コード
+ */
+int RunCommand(int argc, char **argv) {
+  std::string path(argv[0]);
+  std::string command(argv[1]);
+  std::vector<std::string> args;
+  for (int i = 2; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--help" || arg == "-h") {
+      ShowCommandHelp(path);
+      return 0;
+    }
+    args.push_back(arg);
+  }
+
+  if (command == "build") {
+    return RunBuild(path, args);
+  }
+  if (command == "query") {
+    return RunQuery(path, args);
+  }
+  if (command == "merge") {
+    return RunMerge(path, args);
+  }
+  if (command == "fold") {
+    return RunFold(path, args);
+  }
+  if (command == "embed") {
+    return RunEmbed(path, args);
+  }
+  return RunStats(path, args);
+}
+
+} // namespace cli
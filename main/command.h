@@ -0,0 +1,67 @@
+/**
+ * @file command.h
+ * @brief サブコマンドを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_MAIN_COMMAND_H_
+#define CPPBF_MAIN_COMMAND_H_
+
+#include "simplebf/bloom_filter.h"
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief コマンドラインプログラムのための名前空間．
+ */
+namespace cli {
+
+/**
+ * 改行区切りの要素をファイルまたは標準入力から読み込んでフィルタに追加する．
+ *
+ * 各行は読み込みバッファ内の std::string_view のまま Bloom filter に渡すため，
+ * 行ごとのコピーやメモリ確保は発生しない．
+ *
+ * @param[in] path ファイルのパス（"-" の場合は標準入力）
+ * @param[in,out] bf フィルタ
+ * @return 読み込めた場合は true
+ */
+bool InsertLines(const std::string& path, sbf::BloomFilter<std::string>& bf);
+
+/**
+ * 改行区切りの要素をファイルまたは標準入力から読み込んで判定し，結果を標準出力に出力する．
+ *
+ * output_bitmap が false の場合は含まれると判定された行を，
+ * true の場合は各行の判定結果を下位ビットから詰めたビットマップを出力する．
+ *
+ * @param[in] path ファイルのパス（"-" の場合は標準入力）
+ * @param[in] bf フィルタ
+ * @param[in] output_bitmap ビットマップを出力する場合は true
+ * @param[out] num_queries 判定した要素数
+ * @param[out] num_matches 含まれると判定された要素数
+ * @return 読み込めた場合は true
+ */
+bool QueryLines(const std::string& path, const sbf::BloomFilter<std::string>& bf,
+  bool output_bitmap, std::size_t& num_queries, std::size_t& num_matches);
+
+/**
+ * サブコマンド名かを返す．
+ *
+ * @param[in] name 名前
+ * @return サブコマンド名の場合は true
+ */
+bool IsCommand(const std::string& name);
+
+/**
+ * サブコマンドを実行する．
+ *
+ * argv[1] をサブコマンド名とし，それ以降をサブコマンドの引数とする．
+ *
+ * @param[in] argc コマンドライン引数の数
+ * @param[in] argv コマンドライン引数
+ * @return 終了コード
+ */
+int RunCommand(int argc, char **argv);
+
+} // namespace cli
+
+#endif // #ifndef CPPBF_MAIN_COMMAND_H_
@@ -0,0 +1,100 @@
+/**
+ * @file json.h
+ * @brief 結果を JSON 形式で出力するための補助関数を宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_MAIN_JSON_H_
+#define CPPBF_MAIN_JSON_H_
+
+#include <cmath>
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+
+/**
+ * @brief コマンドラインプログラムのための名前空間．
+ */
+namespace cli {
+
+/**
+ * @brief JSON の数値として出力する値．
+ *
+ * JSON は NaN や無限大を表せないため，有限でない値は null として出力する．
+ */
+struct JsonNumber {
+  /** 値． */
+  double value;
+};
+
+/**
+ * @brief JSON の文字列として出力する値．
+ *
+ * 引用符で囲み，引用符，バックスラッシュと制御文字をエスケープして出力する．
+ */
+struct JsonString {
+  /** 値． */
+  std::string_view value;
+};
+
+/**
+ * 値を JSON の数値として出力する．
+ *
+ * @param[in] out 出力ストリーム
+ * @param[in] number 値
+ * @return 出力ストリームへの参照
+ */
+inline std::ostream& operator<<(std::ostream& out, const JsonNumber& number) {
+  if (std::isfinite(number.value)) {
+    out << number.value;
+  }
+  else {
+    out << "null";
+  }
+  return out;
+}
+
+/**
+ * 値を JSON の文字列として出力する．
+ *
+ * @param[in] out 出力ストリーム
+ * @param[in] str 値
+ * @return 出力ストリームへの参照
+ */
+inline std::ostream& operator<<(std::ostream& out, const JsonString& str) {
+  out << '"';
+  for (char c : str.value) {
+    switch (c) {
+    case '"':
+      out << "\\\"";
+      break;
+    case '\\':
+      out << "\\\\";
+      break;
+    case '\n':
+      out << "\\n";
+      break;
+    case '\r':
+      out << "\\r";
+      break;
+    case '\t':
+      out << "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+        out << escaped;
+      }
+      else {
+        out << c;
+      }
+      break;
+    }
+  }
+  out << '"';
+  return out;
+}
+
+} // namespace cli
+
+#endif // #ifndef CPPBF_MAIN_JSON_H_
@@ -0,0 +1,215 @@
+/**
+ * @file key_generator.h
+ * @brief テスト用の要素を生成するクラスを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_MAIN_KEY_GENERATOR_H_
+#define CPPBF_MAIN_KEY_GENERATOR_H_
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+
+/**
+ * @brief コマンドラインプログラムのための名前空間．
+ */
+namespace cli {
+
+/**
+ * 64ビット整数を全単射で撹拌する．
+ *
+ * splitmix64 の最終段と同じ処理であり，xorshift と奇数の乗算のみからなるため全単射である．<br>
+ * したがって，異なる入力からは必ず異なる出力が得られる．
+ *
+ * @param[in] x 入力値
+ * @return 撹拌した値
+ */
+constexpr std::uint64_t Mix(std::uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+/**
+ * @brief テスト用の要素を生成するクラス．
+ *
+ * i 番目の要素を Mix(i ^ Mix(seed)) の10進表記とする．<br>
+ * Mix() は全単射なので，異なる番号からは必ず異なる要素が得られる．<br>
+ * したがって，番号の範囲を分ければ，集合を保持せずに互いに素な集合を生成できる．
+ */
+class KeyGenerator {
+public:
+  /**
+   * 乱数シードを与えて初期化する．
+   *
+   * @param[in] seed 乱数シード
+   */
+  explicit KeyGenerator(std::uint64_t seed) : seed_(Mix(seed)) {
+  }
+
+  /**
+   * 指定された番号の要素を生成する．
+   *
+   * 出力先の領域を再利用するため，十分な容量があればメモリ確保は発生しない．
+   *
+   * @param[in] index 要素の番号
+   * @param[out] key 生成した要素の出力先
+   */
+  void Generate(std::uint64_t index, std::string& key) const {
+    char buffer[20];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), Mix(index ^ seed_));
+    key.assign(buffer, result.ptr);
+  }
+
+private:
+  /** 撹拌済みの乱数シード． */
+  std::uint64_t seed_;
+};
+
+/**
+ * @brief テスト用の集合を表すクラス．
+ *
+ * KeyGenerator で生成される，番号が [first, last) の要素からなる集合を表す．<br>
+ * 要素は走査時に1個ずつ生成するため，集合全体をメモリに保持しない．
+ */
+class KeyRange {
+public:
+  /**
+   * @brief KeyRange の要素を走査するイテレータ．
+   *
+   * 参照先は走査のたびに上書きされる．
+   */
+  class Iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::string;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string*;
+    using reference = const std::string&;
+
+    /**
+     * 要素生成器と番号を与えて初期化する．
+     *
+     * @param[in] generator 要素生成器
+     * @param[in] index 要素の番号
+     */
+    Iterator(const KeyGenerator& generator, std::uint64_t index)
+      : generator_(&generator), index_(index) {
+    }
+
+    /**
+     * 現在の要素を返す．
+     *
+     * @return 現在の要素
+     */
+    const std::string& operator*() const {
+      generator_->Generate(index_, key_);
+      return key_;
+    }
+
+    /**
+     * 次の要素に進める．
+     *
+     * @return このイテレータへの参照
+     */
+    Iterator& operator++() {
+      index_++;
+      return *this;
+    }
+
+    /**
+     * 指している要素が異なるかを返す．
+     *
+     * @param[in] other 比較対象のイテレータ
+     * @return 指している要素が異なる場合は true
+     */
+    bool operator!=(const Iterator& other) const {
+      return index_ != other.index_;
+    }
+
+  private:
+    /** 要素生成器． */
+    const KeyGenerator* generator_;
+
+    /** 要素の番号． */
+    std::uint64_t index_;
+
+    /** 生成した要素． */
+    mutable std::string key_;
+  };
+
+  /**
+   * 要素生成器と番号の範囲を与えて初期化する．
+   *
+   * @param[in] generator 要素生成器
+   * @param[in] first 先頭の要素の番号
+   * @param[in] last 末尾の要素の次の番号
+   */
+  KeyRange(const KeyGenerator& generator, std::uint64_t first,
+      std::uint64_t last) : generator_(generator), first_(first), last_(last) {
+  }
+
+  /**
+   * 先頭を指すイテレータを返す．
+   *
+   * @return 先頭を指すイテレータ
+   */
+  Iterator begin() const {
+    return Iterator(generator_, first_);
+  }
+
+  /**
+   * 末尾の次を指すイテレータを返す．
+   *
+   * @return 末尾の次を指すイテレータ
+   */
+  Iterator end() const {
+    return Iterator(generator_, last_);
+  }
+
+  /**
+   * 要素数を返す．
+   *
+   * @return 要素数
+   */
+  std::size_t size() const {
+    return last_ - first_;
+  }
+
+  /**
+   * 集合を num_parts 個に分割したうちの part 番目を返す．
+   *
+   * 複数のスレッドで分担して走査する場合に用いる．<br>
+   * 分割した集合の要素数の差は高々1である．
+   *
+   * @param[in] part 分割した集合の番号 (0以上 num_parts 未満)
+   * @param[in] num_parts 分割数
+   * @return 分割した集合
+   */
+  KeyRange Slice(std::size_t part, std::size_t num_parts) const {
+    std::uint64_t n = size();
+    std::uint64_t first = first_ + n / num_parts * part + std::min<std::uint64_t>(part, n % num_parts);
+    std::uint64_t last = first + n / num_parts + (part < n % num_parts ? 1 : 0);
+    return KeyRange(generator_, first, last);
+  }
+
+private:
+  /** 要素生成器． */
+  KeyGenerator generator_;
+
+  /** 先頭の要素の番号． */
+  std::uint64_t first_;
+
+  /** 末尾の要素の次の番号． */
+  std::uint64_t last_;
+};
+
+} // namespace cli
+
+#endif // #ifndef CPPBF_MAIN_KEY_GENERATOR_H_
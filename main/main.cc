@@ -3,96 +3,277 @@
  * @brief メインメソッドをもつソースファイル．
  */
 
+#include "command.h"
+#include "json.h"
+#include "key_generator.h"
+#include "sweep.h"
 #include "simplebf/util.h"
 #include "simplebf/bloom_filter.h"
+#include "simplebf/concurrent_bloom_filter.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <optional>
-#include <set>
 #include <string>
 #include <random>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace {
 
+using cli::JsonNumber;
+using cli::JsonString;
+using cli::KeyGenerator;
+using cli::KeyRange;
+using cli::Mix;
+
 /**
- * テスト用の集合をランダムに生成する．
+ * 文字列集合内のデータサイズの合計を返す．
  *
- * @param[in] size 要素数
- * @param[in,out] rnd 乱数生成器
- * @return 指定された要素数の集合
+ * @param[in] set 文字列集合
+ * @return データサイズ [bits]
  */
-std::set<std::string> GenerateTestSet(std::size_t size, std::mt19937_64& rnd) {
-  std::set<std::string> s;
-  for (std::size_t i = 0; i < size; i++) {
-    std::string entry;
-    while (true) {
-      entry = std::to_string(rnd());
-      if (s.count(entry) == 0) {
-        break;
-      }
-    }
-    s.insert(entry);
+std::size_t TotalSize(const KeyRange& set) {
+  std::size_t total_size = 0;
+  for (auto&& str : set) {
+    // null 文字 (\0) も合わせたビット数を追加する．
+    total_size += (str.size() + 1) * 8;
   }
 
-  return s;
+  return total_size;
 }
 
 /**
- * 指定された集合と共通部分をもたないテスト用の集合をランダムに生成する．
+ * 計測用クロックの値を返す．
+ *
+ * 要素1個あたりの処理時間をサンプリングするため，オーバーヘッドの小さいクロックを用いる．<br>
+ * x86 ではタイムスタンプカウンタ (rdtsc) を，それ以外では std::chrono::steady_clock を用いる．<br>
+ * 単位は環境依存なので，ナノ秒への換算は MeasurePhase() で行う．
  *
- * @param[in] size 要素数
- * @param[in] target_set 集合
- * @param[in,out] rnd 乱数生成器
- * @return 指定された要素数の集合
+ * @return クロックの値
  */
-std::set<std::string> GenerateTestSet(std::size_t size,
-    const std::set<std::string>& target_set, std::mt19937_64& rnd) {
-  std::set<std::string> s;
-  for (std::size_t i = 0; i < size; i++) {
-    std::string entry;
-    while (true) {
-      entry = std::to_string(rnd());
-      if (s.count(entry) == 0 && target_set.count(entry) == 0) {
-        break;
-      }
-    }
-    s.insert(entry);
-  }
+inline std::uint64_t ReadClock() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
 
-  return s;
+/**
+ * 計測フェーズごとの性能を表す構造体．
+ */
+struct PhaseStats {
+  /** フェーズ名． */
+  std::string name;
+
+  /** 処理した要素数． */
+  std::size_t num_ops = 0;
+
+  /** 経過時間 [ns]． */
+  double elapsed_ns = 0;
+
+  /** スループット [ops/sec]． */
+  double ops_per_sec = 0;
+
+  /** 要素1個あたりの平均処理時間 [ns/op]． */
+  double ns_per_op = 0;
+
+  /** 要素1個あたりの処理時間の50パーセンタイル [ns]． */
+  double p50_ns = 0;
+
+  /** 要素1個あたりの処理時間の99パーセンタイル [ns]． */
+  double p99_ns = 0;
+
+  /** 要素1個あたりの処理時間の99.9パーセンタイル [ns]． */
+  double p999_ns = 0;
+};
+
+/** 間隔を自動で決める場合の処理時間のサンプル数の最大値． */
+constexpr std::size_t kMaxLatencySamples = 1 << 20;
+
+/**
+ * サンプリングした処理時間のパーセンタイル値を返す．
+ *
+ * @param[in,out] samples 処理時間のサンプル（要素の順序は変更される）
+ * @param[in] percentile パーセンタイル (0以上100以下)
+ * @return パーセンタイル値
+ */
+std::uint64_t Percentile(std::vector<std::uint64_t>& samples, double percentile) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::size_t index = static_cast<std::size_t>(
+    percentile / 100 * (samples.size() - 1));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
 }
 
 /**
- * 文字列集合内のデータサイズの合計を返す．
+ * 集合の各要素に処理を適用し，その性能を計測する．
  *
- * @param[in] set 文字列集合
- * @return データサイズ [bits]
+ * 全体の経過時間は std::chrono::steady_clock で計測する．<br>
+ * 要素1個あたりの処理時間は sample_interval 個に1個の割合で ReadClock() により計測し，
+ * 全体の経過時間との比からナノ秒に換算する．<br>
+ * sample_interval が0の場合は，サンプル数が kMaxLatencySamples 以下となる間隔を用いる．
+ *
+ * @param[in] name フェーズ名
+ * @param[in] entries 集合
+ * @param[in] op 各要素に適用する処理
+ * @param[in] sample_interval 処理時間をサンプリングする間隔
+ * @return 計測結果
  */
-std::size_t TotalSize(const std::set<std::string>& set) {
-  std::size_t total_size = 0;
-  for (auto&& str : set) {
-    // null 文字 (\0) も合わせたビット数を追加する．
-    total_size += (str.size() + 1) * 8;
+template <class Container, class Op>
+PhaseStats MeasurePhase(const std::string& name, const Container& entries,
+    Op op, std::size_t sample_interval) {
+  if (sample_interval == 0) {
+    sample_interval = std::max<std::size_t>(1,
+      (entries.size() + kMaxLatencySamples - 1) / kMaxLatencySamples);
+  }
+  std::vector<std::uint64_t> samples;
+  samples.reserve(entries.size() / sample_interval + 1);
+
+  auto start_time = std::chrono::steady_clock::now();
+  std::uint64_t start_clock = ReadClock();
+  std::size_t countdown = 0;
+  for (auto&& entry : entries) {
+    if (countdown == 0) {
+      std::uint64_t t0 = ReadClock();
+      op(entry);
+      samples.push_back(ReadClock() - t0);
+      countdown = sample_interval;
+    }
+    else {
+      op(entry);
+    }
+    countdown--;
+  }
+  std::uint64_t end_clock = ReadClock();
+  auto end_time = std::chrono::steady_clock::now();
+
+  PhaseStats stats;
+  stats.name = name;
+  stats.num_ops = entries.size();
+  stats.elapsed_ns = std::chrono::duration<double, std::nano>(
+    end_time - start_time).count();
+  if (stats.num_ops > 0 && stats.elapsed_ns > 0) {
+    stats.ops_per_sec = stats.num_ops / stats.elapsed_ns * 1e9;
+    stats.ns_per_op = stats.elapsed_ns / stats.num_ops;
   }
 
-  return total_size;
+  // クロックの単位からナノ秒への換算係数
+  double ns_per_tick = (end_clock > start_clock)
+    ? stats.elapsed_ns / (end_clock - start_clock) : 0;
+  stats.p50_ns = Percentile(samples, 50) * ns_per_tick;
+  stats.p99_ns = Percentile(samples, 99) * ns_per_tick;
+  stats.p999_ns = Percentile(samples, 99.9) * ns_per_tick;
+  return stats;
+}
+
+/**
+ * 計測フェーズの性能を出力する．
+ *
+ * @param[in] stats 計測結果
+ * @param[in] out 出力ストリーム（省略時 std::cout）
+ * @return 出力ストリームへの参照
+ */
+std::ostream& PrintPhaseStats(const PhaseStats& stats,
+    std::ostream& out = std::cout) {
+  out << "[" << stats.name << " performance]\n";
+  out << "The number of operations      : " << stats.num_ops << "\n";
+  out << "Throughput                    : " << stats.ops_per_sec << " [ops/sec]\n";
+  out << "Mean latency                  : " << stats.ns_per_op << " [ns/op]\n";
+  out << "Latency p50 / p99 / p99.9     : " << stats.p50_ns << " / "
+      << stats.p99_ns << " / " << stats.p999_ns << " [ns]\n";
+  return out;
 }
 
 /**
- * 見積もられた偽陽性率を返す．
+ * 計測フェーズの性能を JSON 形式で出力する．
  *
- * @param[in] num_bits Bloom filter の配列のビット数
- * @param[in] num_hashes ハッシュ関数の個数
- * @param[in] num_entries 追加された要素数
+ * @param[in] stats 計測結果
+ * @param[in] out 出力ストリーム（省略時 std::cout）
+ * @return 出力ストリームへの参照
  */
-double EstimatedFalsePositiveRatio(std::size_t num_bits, std::size_t num_hashes,
-    std::size_t num_entries) {
-  std::size_t m = num_bits;
-  std::size_t k = num_hashes;
-  std::size_t n = num_entries;
-  double ratio = std::exp(k*std::log(1 - std::exp(k*n*std::log(1 - 1.0/m))));
-  return ratio;
+std::ostream& PrintPhaseStatsJson(const PhaseStats& stats,
+    std::ostream& out = std::cout) {
+  out << "{\"name\": " << JsonString{stats.name} << ", "
+      << "\"num_ops\": " << stats.num_ops << ", "
+      << "\"elapsed_ns\": " << JsonNumber{stats.elapsed_ns} << ", "
+      << "\"ops_per_sec\": " << JsonNumber{stats.ops_per_sec} << ", "
+      << "\"ns_per_op\": " << JsonNumber{stats.ns_per_op} << ", "
+      << "\"p50_ns\": " << JsonNumber{stats.p50_ns} << ", "
+      << "\"p99_ns\": " << JsonNumber{stats.p99_ns} << ", "
+      << "\"p999_ns\": " << JsonNumber{stats.p999_ns} << "}";
+  return out;
 }
 
+/**
+ * コマンドライン引数で与えるパラメータを表す構造体．
+ */
+struct Parameters {
+  /** Bloom filter 用配列のビット数の底2による対数値． */
+  std::size_t log2_num_bits = 13;
+
+  /** 追加する要素数． */
+  std::size_t num_entries = 1024;
+
+  /** 偽陽性テストに使う要素数． */
+  std::size_t num_challenges = 1024;
+
+  /** 乱数シード． */
+  std::optional<std::uint32_t> seed;
+
+  /** 結果を JSON 形式で出力する場合は true． */
+  bool json = false;
+
+  /** 処理時間をサンプリングする間隔（0の場合は自動）． */
+  std::size_t sample_interval = 0;
+
+  /** マルチスレッドベンチマークのスレッド数（0の場合はマルチスレッドベンチマークを実行しない）． */
+  std::size_t num_threads = 0;
+
+  /** マルチスレッドベンチマークにおける判定操作の割合． */
+  double read_ratio = 0.9;
+
+  /** マルチスレッドベンチマークで全スレッドが1個のフィルタを共有する場合は true． */
+  bool shared_filter = true;
+
+  /** フィルタに追加する要素を読み込むファイルのパス（"-" の場合は標準入力）． */
+  std::optional<std::string> build_path;
+
+  /** 判定する要素を読み込むファイルのパス（"-" の場合は標準入力）． */
+  std::optional<std::string> query_path;
+
+  /** 判定結果をビットマップで出力する場合は true． */
+  bool output_bitmap = false;
+
+  /** ハッシュ関数の個数（省略時は要素数から最適値を設定）． */
+  std::optional<std::size_t> num_hashes;
+
+  /** パラメータスイープを実行する場合は true． */
+  bool sweep = false;
+
+  /** パラメータスイープで評価するフィルタ用配列のビット数の底2による対数値． */
+  std::optional<std::string> sweep_bits;
+
+  /** パラメータスイープで評価するハッシュ関数の個数． */
+  std::string sweep_hashes = "1:12";
+
+  /** パラメータスイープで評価するフィルタの種類． */
+  std::vector<std::string> sweep_variants = {"bloom", "concurrent"};
+
+  /** フィルタ用配列に使うページの種類． */
+  sbf::HugePages huge_pages = sbf::HugePages::kNone;
+};
+
 /**
  * ヘルプを表示する．
  *
@@ -104,105 +285,554 @@ std::ostream& ShowHelp(const std::string& path, std::ostream& out = std::cout) {
   out << "Bloom filter のサンプル実装プログラム．\n";
   out << "\n";
   out << "Usage:\n";
-  out << "  " << path << " [log2_num_bits] [num_entries] [num_challenges] [seed]\n";
+  out << "  " << path << " [options] [log2_num_bits] [num_entries] [num_challenges] [seed]\n";
+  out << "  " << path << " build|query|merge|stats [options] ...\n";
   out << "  " << path << " --help\n";
   out << "\n";
+  out << "サブコマンドの詳細は " << path << " build --help を参照．\n";
+  out << "\n";
   out << "Arguments:\n";
   out << "  log2_num_bits: Bloom filter 用配列のビット数の底2による対数値（省略時13）\n";
   out << "  num_entries: 追加する要素数（省略時1024）\n";
   out << "  num_challenges: 偽陽性のテストに使う要素数（省略時1024）\n";
   out << "  seed: 乱数シード（省略時はシード値を乱数で指定）\n";
   out << "\n";
+  out << "Options:\n";
+  out << "  --json: 結果を JSON 形式で出力する\n";
+  out << "  --sample-interval=N: N 個に1個の割合で処理時間を計測する（省略時は自動）\n";
+  out << "  --threads=N: N 個のスレッドで追加と判定を混在させたベンチマークを実行する\n";
+  out << "  --read-ratio=R: --threads 指定時の判定操作の割合（省略時0.9）\n";
+  out << "  --filter=shared|per-thread: --threads 指定時に全スレッドでフィルタを共有するか，\n";
+  out << "    スレッドごとにフィルタをもつか（省略時 shared）\n";
+  out << "  --build-from=PATH: 改行区切りの要素をファイル (\"-\" の場合は標準入力) から読み込んでフィルタを構築する\n";
+  out << "    num_entries は要素数の見込みとしてハッシュ関数の個数の決定に使う\n";
+  out << "  --query-from=PATH: --build-from で構築したフィルタに対し，改行区切りの要素を判定する\n";
+  out << "  --output=matches|bitmap: --query-from 指定時に，含まれると判定された行を出力するか，\n";
+  out << "    各行の判定結果を下位ビットから詰めたビットマップを出力するか（省略時 matches）\n";
+  out << "  --num-hashes=K: ハッシュ関数の個数（省略時は num_entries から最適値を設定）\n";
+  out << "  --sweep: 同じ要素に対してパラメータの全組み合わせを評価し，偽陽性率と処理時間の表を出力する\n";
+  out << "    フィルタの作成は --threads で指定した個数（省略時はコア数）のスレッドで並列に行い，\n";
+  out << "    処理時間は設定ごとに他の設定と同時に実行せずに計測する\n";
+  out << "  --sweep-bits=SPEC: --sweep で評価する log2_num_bits（省略時は log2_num_bits のみ）\n";
+  out << "  --sweep-hashes=SPEC: --sweep で評価するハッシュ関数の個数（1 以上 " << cli::kMaxSweepNumHashes << " 以下，省略時 1:12）\n";
+  out << "    SPEC は a:b (a 以上 b 以下) または a,b,c の形式で指定する\n";
+  out << "  --sweep-variants=bloom,concurrent: --sweep で評価するフィルタの種類（省略時は両方）\n";
+  out << "  --huge-pages=none|thp|2mb|1gb: フィルタ用配列に使うページの種類（省略時 none）\n";
+  out << "    thp は透過的 huge page を要求し，2mb と 1gb は確保できない場合に順に小さいページとする\n";
+  out << "\n";
   out << "Examples:\n";
   out << "  " << path << "\n";
   out << "  " << path << " 15\n";
   out << "  " << path << " 15 4096\n";
   out << "  " << path << " 15 4096 1000000\n";
   out << "  " << path << " 15 4096 1000000 1234\n";
+  out << "  " << path << " --json --sample-interval=16 20 100000 1000000\n";
+  out << "  " << path << " --threads=8 --read-ratio=0.5 24 1000000 10000000\n";
+  out << "  " << path << " --build-from=keys.txt --query-from=- 24 1000000 < log.txt\n";
+  out << "  " << path << " --sweep --sweep-bits=16:24 --sweep-hashes=1,2,4,8 20 100000 1000000\n";
   return out;
 }
 
 /**
  * コマンドライン引数を解析してパラメータを返す．
  *
+ * "--" で始まる引数はオプションとして，それ以外は位置引数として扱う．
+ *
  * @param[in] argc コマンドライン引数の数
  * @param[in] argv コマンドライン引数
- * @param[out] log2_num_bits Bloom filter 要配列のビット数の底2による対数値
- * @param[out] num_entries 追加する要素数
- * @param[out] num_challenges 偽陽性テストに使う要素数
+ * @param[out] params パラメータ
  * @return この関数の実行後にただちに終了する場合は true
  */
-bool ParseArguments(int argc, char **argv, std::size_t& log2_num_bits,
-    std::size_t& num_entries, std::size_t& num_challenges,
-    std::optional<std::uint32_t>& seed) {
-  if (argc > 1) {
-    if (std::string(argv[1]) == "--help" || 
-        std::string(argv[1]) == "-h") {
+bool ParseArguments(int argc, char **argv, Parameters& params) {
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--help" || arg == "-h") {
       ShowHelp(std::string(argv[0]));
       return true;
     }
+    else if (arg == "--json") {
+      params.json = true;
+    }
+    else if (arg.rfind("--sample-interval=", 0) == 0) {
+      params.sample_interval = std::strtoull(
+        arg.substr(arg.find('=') + 1).c_str(), nullptr, 10);
+    }
+    else if (arg.rfind("--threads=", 0) == 0) {
+      params.num_threads = std::strtoull(
+        arg.substr(arg.find('=') + 1).c_str(), nullptr, 10);
+    }
+    else if (arg.rfind("--read-ratio=", 0) == 0) {
+      double value = std::strtod(arg.substr(arg.find('=') + 1).c_str(), nullptr);
+      params.read_ratio = std::min(std::max(value, 0.0), 1.0);
+    }
+    else if (arg == "--filter=shared") {
+      params.shared_filter = true;
+    }
+    else if (arg == "--filter=per-thread") {
+      params.shared_filter = false;
+    }
+    else if (arg.rfind("--build-from=", 0) == 0) {
+      params.build_path = arg.substr(arg.find('=') + 1);
+    }
+    else if (arg.rfind("--query-from=", 0) == 0) {
+      params.query_path = arg.substr(arg.find('=') + 1);
+    }
+    else if (arg == "--output=matches") {
+      params.output_bitmap = false;
+    }
+    else if (arg == "--output=bitmap") {
+      params.output_bitmap = true;
+    }
+    else if (arg == "--sweep") {
+      params.sweep = true;
+    }
+    else if (arg.rfind("--sweep-bits=", 0) == 0) {
+      params.sweep_bits = arg.substr(arg.find('=') + 1);
+    }
+    else if (arg.rfind("--sweep-hashes=", 0) == 0) {
+      params.sweep_hashes = arg.substr(arg.find('=') + 1);
+    }
+    else if (arg.rfind("--sweep-variants=", 0) == 0) {
+      std::string spec = arg.substr(arg.find('=') + 1);
+      params.sweep_variants.clear();
+      for (std::size_t begin = 0; begin <= spec.size();) {
+        std::size_t end = std::min(spec.find(',', begin), spec.size());
+        params.sweep_variants.push_back(spec.substr(begin, end - begin));
+        begin = end + 1;
+      }
+    }
+    else if (arg == "--huge-pages=none") {
+      params.huge_pages = sbf::HugePages::kNone;
+    }
+    else if (arg == "--huge-pages=thp") {
+      params.huge_pages = sbf::HugePages::kTransparent;
+    }
+    else if (arg == "--huge-pages=2mb") {
+      params.huge_pages = sbf::HugePages::k2MB;
+    }
+    else if (arg == "--huge-pages=1gb") {
+      params.huge_pages = sbf::HugePages::k1GB;
+    }
+    else if (arg.rfind("--num-hashes=", 0) == 0) {
+      params.num_hashes = std::strtoull(
+        arg.substr(arg.find('=') + 1).c_str(), nullptr, 10);
+    }
+    else {
+      args.push_back(arg);
+    }
   }
 
-  constexpr std::size_t kDefaultLog2NumBits = 13;
-  log2_num_bits = kDefaultLog2NumBits;
-  if (argc > 1) {
-    std::size_t value = std::atoi(argv[1]);
-    log2_num_bits = value;
+  if (args.size() > 0) {
+    std::size_t value = std::atoi(args[0].c_str());
+    params.log2_num_bits = value;
   }
 
-  constexpr std::size_t kDefaultNumEntries = 1024;
-  num_entries = kDefaultNumEntries;
-  if (argc > 2) {
-    std::size_t value = std::atoi(argv[2]);
+  if (args.size() > 1) {
+    std::size_t value = std::strtoull(args[1].c_str(), nullptr, 10);
     if (value > 0) {
-      num_entries = value;
+      params.num_entries = value;
     }
   }
 
-  constexpr std::size_t kDefaultNumChallenges = 1024;
-  num_challenges = kDefaultNumChallenges;
-  if (argc > 3) {
-    int value = std::atoi(argv[3]);
+  if (args.size() > 2) {
+    std::size_t value = std::strtoull(args[2].c_str(), nullptr, 10);
     if (value > 0) {
-      num_challenges = value;
+      params.num_challenges = value;
     }
   }
 
-  seed = std::nullopt;
-  if (argc > 4) {
-    seed = std::atoi(argv[4]);
+  if (args.size() > 3) {
+    params.seed = std::strtoul(args[3].c_str(), nullptr, 10);
   }
 
   return false;
 }
 
-} // namespace
+/**
+ * スレッドごとの計測結果を表す構造体．
+ */
+struct ThreadStats {
+  /** 処理した操作の数． */
+  std::size_t num_ops = 0;
+
+  /** 処理した判定操作の数． */
+  std::size_t num_reads = 0;
+
+  /** 含まれると判定された数． */
+  std::size_t num_positives = 0;
+
+  /** 経過時間 [ns]． */
+  double elapsed_ns = 0;
+
+  /** スループット [ops/sec]． */
+  double ops_per_sec = 0;
+};
 
 /**
- * メインメソッド
+ * 全スレッドの計測結果を表す構造体．
+ */
+struct MultiThreadStats {
+  /** スレッドごとの計測結果． */
+  std::vector<ThreadStats> threads;
+
+  /** 全スレッドの処理が終わるまでの経過時間 [ns]． */
+  double elapsed_ns = 0;
+
+  /** 全スレッドの合計スループット [ops/sec]． */
+  double ops_per_sec = 0;
+
+  /** フィルタのハッシュ関数の個数． */
+  std::size_t num_hashes = 0;
+
+  /** フィルタ用配列サイズの設定に失敗した場合は true． */
+  bool parameter_error = false;
+};
+
+/**
+ * i 番目の操作が判定操作かを返す．
  *
- * @param[in] argc コマンドライン引数の数
- * @param[in] argv コマンドライン引数
- * @return int 終了コード
+ * 番号を撹拌した値を [0, 1) の一様乱数とみなし，read_ratio 未満であれば判定操作とする．
+ *
+ * @param[in] index 操作の番号
+ * @param[in] read_ratio 判定操作の割合
+ * @return 判定操作の場合は true
  */
-int main(int argc, char **argv) {
-  // コマンドライン引数の解析
-  std::size_t log2_num_bits;
-  std::size_t num_entries;
-  std::size_t num_challenges;
-  std::optional<std::uint32_t> seed; 
-  bool should_exit = ParseArguments(argc, argv, log2_num_bits,
-    num_entries, num_challenges, seed);
-  if (should_exit) {
+bool IsReadOperation(std::uint64_t index, double read_ratio) {
+  return (Mix(index) >> 11) * 0x1.0p-53 < read_ratio;
+}
+
+/**
+ * 追加と判定を混在させた操作をフィルタに適用する．
+ *
+ * start が true になるまで待ってから計測を開始する．
+ *
+ * @tparam Filter フィルタの型
+ * @param[in,out] bf フィルタ
+ * @param[in] keys 操作対象の要素の集合
+ * @param[in] read_ratio 判定操作の割合
+ * @param[in] start 計測開始を表すフラグ
+ * @return 計測結果
+ */
+template <class Filter>
+ThreadStats RunMixedWorkload(Filter& bf, const KeyRange& keys,
+    double read_ratio, const std::atomic<bool>& start) {
+  while (!start.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+
+  ThreadStats stats;
+  auto start_time = std::chrono::steady_clock::now();
+  for (auto&& key : keys) {
+    if (IsReadOperation(stats.num_ops, read_ratio)) {
+      stats.num_reads++;
+      if (bf.Contains(key)) {
+        stats.num_positives++;
+      }
+    }
+    else {
+      bf.Insert(key);
+    }
+    stats.num_ops++;
+  }
+  auto end_time = std::chrono::steady_clock::now();
+
+  stats.elapsed_ns = std::chrono::duration<double, std::nano>(
+    end_time - start_time).count();
+  if (stats.elapsed_ns > 0) {
+    stats.ops_per_sec = stats.num_ops / stats.elapsed_ns * 1e9;
+  }
+  return stats;
+}
+
+/**
+ * 複数のスレッドで追加と判定を混在させた操作を実行し，その性能を計測する．
+ *
+ * 各スレッドは operations を分割した集合を担当する．<br>
+ * 計測前に，フィルタには prefill の全要素を追加しておく．<br>
+ * params.shared_filter が true の場合は全スレッドで1個の ConcurrentBloomFilter を共有し，
+ * false の場合は各スレッドが自身の BloomFilter を構築して用いる．
+ *
+ * @param[in] params パラメータ
+ * @param[in] prefill 計測前に追加する要素の集合
+ * @param[in] operations 操作対象の要素の集合
+ * @param[in] num_threads スレッド数
+ * @return 計測結果
+ */
+MultiThreadStats RunMultiThreadBenchmark(const Parameters& params,
+    const KeyRange& prefill, const KeyRange& operations,
+    std::size_t num_threads) {
+  MultiThreadStats result;
+  result.threads.resize(num_threads);
+  std::atomic<bool> start(false);
+  std::atomic<std::size_t> num_ready(0);
+  std::atomic<bool> failed(false);
+
+  // 共有フィルタ（共有しない場合は最小サイズで確保する）
+  using shared_bf_t = sbf::ConcurrentBloomFilter<std::string>;
+  shared_bf_t shared_bf(params.shared_filter ? params.log2_num_bits : 0);
+  if (params.shared_filter) {
+    if ((shared_bf.ParameterErrorFlags() & shared_bf_t::kHasLog2NumBitsError) != 0) {
+      result.parameter_error = true;
+      return result;
+    }
+    shared_bf.SetOptimalNumHashes(prefill.size());
+    for (auto&& entry : prefill) {
+      shared_bf.Insert(entry);
+    }
+    result.num_hashes = shared_bf.NumHashes();
+  }
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      const auto& keys = operations.Slice(t, num_threads);
+      if (params.shared_filter) {
+        num_ready++;
+        result.threads[t] = RunMixedWorkload(shared_bf, keys,
+          params.read_ratio, start);
+        return;
+      }
+
+      // 各スレッドでフィルタを構築し，そのスレッドからメモリに触れる．
+      using bf_t = sbf::BloomFilter<std::string>;
+      bf_t bf(params.log2_num_bits);
+      if ((bf.ParameterErrorFlags() & bf_t::kHasLog2NumBitsError) != 0) {
+        failed = true;
+      }
+      bf.SetOptimalNumHashes(prefill.size());
+      for (auto&& entry : prefill) {
+        bf.Insert(entry);
+      }
+      if (t == 0) {
+        result.num_hashes = bf.NumHashes();
+      }
+      num_ready++;
+      result.threads[t] = RunMixedWorkload(bf, keys, params.read_ratio, start);
+    });
+  }
+
+  // 全スレッドの準備が整ってから同時に開始する．
+  while (num_ready.load() < num_threads) {
+    std::this_thread::yield();
+  }
+  auto start_time = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  auto end_time = std::chrono::steady_clock::now();
+
+  result.parameter_error = failed;
+  result.elapsed_ns = std::chrono::duration<double, std::nano>(
+    end_time - start_time).count();
+  if (result.elapsed_ns > 0) {
+    result.ops_per_sec = operations.size() / result.elapsed_ns * 1e9;
+  }
+  return result;
+}
+
+/**
+ * マルチスレッドベンチマークを実行して結果を出力する．
+ *
+ * まず1スレッドで実行して基準値とし，次に指定されたスレッド数で実行する．<br>
+ * スケーリング効率は，合計スループットを (スレッド数 * 1スレッドのスループット) で割った値とし，
+ * スレッドごとのスケーリング効率は，各スレッドのスループットを1スレッドのスループットで割った値とする．
+ *
+ * @param[in] params パラメータ
+ * @param[in] generator 要素生成器
+ * @return 終了コード
+ */
+int RunMultiThreaded(const Parameters& params, const KeyGenerator& generator) {
+  KeyRange prefill(generator, 0, params.num_entries);
+  KeyRange operations(generator, params.num_entries,
+    params.num_entries + params.num_challenges);
+
+  const auto& baseline = RunMultiThreadBenchmark(params, prefill, operations, 1);
+  if (baseline.parameter_error) {
+    std::cerr << "Failed to set the size of filter list." << std::endl;
+    return 1;
+  }
+  const auto& stats = RunMultiThreadBenchmark(params, prefill, operations,
+    params.num_threads);
+
+  std::size_t num_threads = params.num_threads;
+  double efficiency = (baseline.ops_per_sec > 0)
+    ? stats.ops_per_sec / (num_threads * baseline.ops_per_sec) : 0;
+  const char* filter_mode = params.shared_filter ? "shared" : "per-thread";
+
+  if (params.json) {
+    std::cout << "{\n";
+    std::cout << "  \"num_threads\": " << num_threads << ",\n";
+    std::cout << "  \"filter\": " << JsonString{filter_mode} << ",\n";
+    std::cout << "  \"read_ratio\": " << params.read_ratio << ",\n";
+    std::cout << "  \"num_entries\": " << params.num_entries << ",\n";
+    std::cout << "  \"num_operations\": " << operations.size() << ",\n";
+    std::cout << "  \"num_bits\": " << (1ull << params.log2_num_bits) << ",\n";
+    std::cout << "  \"num_hashes\": " << stats.num_hashes << ",\n";
+    std::cout << "  \"baseline_ops_per_sec\": " << JsonNumber{baseline.ops_per_sec} << ",\n";
+    std::cout << "  \"ops_per_sec\": " << JsonNumber{stats.ops_per_sec} << ",\n";
+    std::cout << "  \"elapsed_ns\": " << JsonNumber{stats.elapsed_ns} << ",\n";
+    std::cout << "  \"scaling_efficiency\": " << JsonNumber{efficiency} << ",\n";
+    std::cout << "  \"threads\": [\n";
+    for (std::size_t t = 0; t < num_threads; t++) {
+      const auto& thread = stats.threads[t];
+      std::cout << "    {\"num_ops\": " << thread.num_ops
+                << ", \"num_reads\": " << thread.num_reads
+                << ", \"num_positives\": " << thread.num_positives
+                << ", \"elapsed_ns\": " << JsonNumber{thread.elapsed_ns}
+                << ", \"ops_per_sec\": " << JsonNumber{thread.ops_per_sec}
+                << ", \"scaling_efficiency\": " << JsonNumber{
+                  baseline.ops_per_sec > 0 ? thread.ops_per_sec / baseline.ops_per_sec : 0}
+                << "}" << (t + 1 < num_threads ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n";
+    std::cout << "}" << std::endl;
     return 0;
   }
 
-  // 乱数生成器の生成
-  std::mt19937_64 rnd(seed ? seed.value() : std::random_device{}());
+  std::cout << "[Multi-threaded benchmark setting]\n";
+  std::cout << "The number of threads         : " << num_threads << "\n";
+  std::cout << "Filter                        : " << filter_mode << "\n";
+  std::cout << "Read ratio                    : " << params.read_ratio << "\n";
+  std::cout << "The number of entries         : " << params.num_entries << "\n";
+  std::cout << "The number of operations      : " << operations.size() << "\n";
+  std::cout << "The filter size               : " << (1ull << params.log2_num_bits) << " [bits]\n";
+  std::cout << "The number of hash functions  : " << stats.num_hashes << "\n";
+  std::cout << "\n";
+
+  std::cout << "[Multi-threaded benchmark]\n";
+  std::cout << "Throughput (1 thread)         : " << baseline.ops_per_sec << " [ops/sec]\n";
+  std::string label = "Throughput (" + std::to_string(num_threads) + " threads)";
+  label.resize(std::max<std::size_t>(label.size(), 30), ' ');
+  std::cout << label << ": " << stats.ops_per_sec << " [ops/sec]\n";
+  std::cout << "Scaling efficiency            : " << efficiency << "\n";
+  for (std::size_t t = 0; t < num_threads; t++) {
+    const auto& thread = stats.threads[t];
+    label = "Thread " + std::to_string(t);
+    label.resize(30, ' ');
+    std::cout << label << ": " << thread.ops_per_sec << " [ops/sec], efficiency "
+              << (baseline.ops_per_sec > 0 ? thread.ops_per_sec / baseline.ops_per_sec : 0)
+              << "\n";
+  }
+  std::cout << std::flush;
+  return 0;
+}
+
+/**
+ * ファイルまたは標準入力から読み込んだ要素でフィルタを構築し，別の入力の各要素を判定する．
+ *
+ * 判定結果は標準出力に，構築したフィルタの情報は標準エラー出力に出力する．
+ *
+ * @param[in] params パラメータ
+ * @return 終了コード
+ */
+int RunStream(const Parameters& params) {
+  using bf_t = sbf::BloomFilter<std::string>;
+  // ハッシュ関数の個数は後で設定する．
+  bf_t bf(params.log2_num_bits, 1, params.huge_pages);
+  if ((bf.ParameterErrorFlags() & bf_t::kHasLog2NumBitsError) != 0) {
+    std::cerr << "Failed to set the size of filter list." << std::endl;
+    return 1;
+  }
+  if (params.num_hashes) {
+    bf.SetNumHashes(params.num_hashes.value());
+  }
+  else {
+    bf.SetOptimalNumHashes(params.num_entries);
+  }
+
+  // フィルタの構築
+  auto start_time = std::chrono::steady_clock::now();
+  if (!cli::InsertLines(params.build_path.value(), bf)) {
+    std::cerr << "Failed to read " << params.build_path.value() << std::endl;
+    return 1;
+  }
+  auto end_time = std::chrono::steady_clock::now();
+  double elapsed_ns = std::chrono::duration<double, std::nano>(
+    end_time - start_time).count();
+
+  std::cerr << "The number of entries         : " << bf.Size() << "\n";
+  std::cerr << "The filter size               : " << bf.NumBits() << " [bits]\n";
+  std::cerr << "The number of hash functions  : " << bf.NumHashes() << "\n";
+  std::cerr << "Page size                     : " << bf.PageSize() << " [bytes]\n";
+  std::cerr << "Estimated False Positive Rate : "
+            << sbf::EstimatedFalsePositiveRate(bf.NumBits(), bf.NumHashes(), bf.Size()) << "\n";
+  std::cerr << "Build throughput              : "
+            << (elapsed_ns > 0 ? bf.Size() / elapsed_ns * 1e9 : 0) << " [ops/sec]"
+            << std::endl;
+
+  if (!params.query_path) {
+    return 0;
+  }
+
+  // 判定
+  std::size_t num_queries = 0;
+  std::size_t num_matches = 0;
+  if (!cli::QueryLines(params.query_path.value(), bf, params.output_bitmap,
+      num_queries, num_matches)) {
+    std::cerr << "Failed to read " << params.query_path.value() << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The number of queries         : " << num_queries << "\n";
+  std::cerr << "The number of matches         : " << num_matches << std::endl;
+  return 0;
+}
+
+/**
+ * パラメータスイープを実行する．
+ *
+ * @param[in] params パラメータ
+ * @return 終了コード
+ */
+int RunSweep(const Parameters& params) {
+  cli::SweepOptions options;
+  std::string bits = params.sweep_bits
+    ? params.sweep_bits.value() : std::to_string(params.log2_num_bits);
+  if (!cli::ParseSweepList(bits, options.log2_num_bits)
+      || !cli::ParseSweepList(params.sweep_hashes, options.num_hashes)) {
+    std::cerr << "Invalid sweep range." << std::endl;
+    return 1;
+  }
+  for (auto&& num_hashes : options.num_hashes) {
+    if (num_hashes < 1 || num_hashes > cli::kMaxSweepNumHashes) {
+      std::cerr << "The number of hash functions must be between 1 and "
+                << cli::kMaxSweepNumHashes << "." << std::endl;
+      return 1;
+    }
+  }
+  for (auto&& variant : params.sweep_variants) {
+    if (variant != "bloom" && variant != "concurrent") {
+      std::cerr << "Unknown filter variant: " << variant << std::endl;
+      return 1;
+    }
+  }
+  options.variants = params.sweep_variants;
+  options.num_entries = params.num_entries;
+  options.num_challenges = params.num_challenges;
+  options.seed = params.seed ? params.seed.value() : std::random_device{}();
+  options.num_threads = (params.num_threads > 0)
+    ? params.num_threads : std::max(1u, std::thread::hardware_concurrency());
+  options.json = params.json;
+  return cli::RunSweep(options);
+}
+
+/**
+ * 1スレッドで精度と性能を計測して結果を出力する．
+ *
+ * @param[in] params パラメータ
+ * @param[in] generator 要素生成器
+ * @return 終了コード
+ */
+int RunSingleThreaded(const Parameters& params, const KeyGenerator& generator) {
+  std::size_t num_entries = params.num_entries;
+  std::size_t num_challenges = params.num_challenges;
 
   // 配列サイズを設定して Bloom filter クラスを初期化．
   using bf_t = sbf::BloomFilter<std::string>;
-  bf_t bf(log2_num_bits);
+  // ハッシュ関数の個数は後で設定する．
+  bf_t bf(params.log2_num_bits, 1, params.huge_pages);
   if (bf.HasParameterError()) {
     if ((bf.ParameterErrorFlags() & bf_t::kHasLog2NumBitsError)
         != 0) {
@@ -212,63 +842,136 @@ int main(int argc, char **argv) {
   }
 
   // テスト集合を取得
-  const auto& test_set = GenerateTestSet(num_entries, rnd);
+  // 要素の番号が [0, num_entries) のものをテスト集合，
+  // [num_entries, num_entries + num_challenges) のものを偽陽性テスト用の集合とする．
+  KeyRange test_set(generator, 0, num_entries);
   std::size_t total_size = TotalSize(test_set);
 
-  // テスト設定を出力
-  std::cout << "[Test setting]\n";
-  std::cout << "The number of entries         : " << num_entries << "\n";
-  std::cout << "The total data size           : " << total_size << " [bits]\n";
-  std::cout << "\n";
-
   // 要素数の最大値から最適なハッシュ関数の個数を設定．
   bool successful = bf.SetOptimalNumHashes(num_entries);
   if (!successful) {
     std::cerr << "Warning: Failed to set optimal number of hash functions" << std::endl;
   }
 
-  // Bloom filter 設定を出力
-  std::cout << "[Bloom filter setting]\n";
-  std::cout << "The filter size               : " << bf.NumBits() << " [bits]\n";
-  std::cout << "The number of hash functions  : " << bf.NumHashes() << "\n";
-  std::cout << "\n";
-
   // Bloom filter に要素を追加
-  for (auto&& entry : test_set) {
-    bf.Insert(entry);
-  }
-
-  // テスト結果を出力
-  std::cout << "[Bloom filter test]\n";
+  const auto& insert_stats = MeasurePhase("Insert", test_set,
+    [&bf](const std::string& entry) { bf.Insert(entry); },
+    params.sample_interval);
 
   // True Positive の計算
   std::size_t count = 0;
-  for (auto&& entry : test_set) {
-    if (bf.Contains(entry)) {
-      count++;
-    }
-  }
+  const auto& tp_stats = MeasurePhase("True positive query", test_set,
+    [&bf, &count](const std::string& entry) {
+      if (bf.Contains(entry)) {
+        count++;
+      }
+    },
+    params.sample_interval);
   double true_positive_ratio = static_cast<double>(count) / num_entries;
-  std::cout << "True Positive Rate            : " << true_positive_ratio << std::endl;
-
   double estimated_tp = 1.0;
-  std::cout << "Estimated True Positive Rate  : " << estimated_tp << std::endl;
 
   // False Positive の計算
   std::size_t contains = 0;
-  const auto& challenge_set = GenerateTestSet(num_challenges, test_set, rnd);
-  for (auto&& entry : challenge_set) {
-    if (bf.Contains(entry)) {
-      contains++;
-    }
-  }
+  KeyRange challenge_set(generator, num_entries, num_entries + num_challenges);
+  const auto& fp_stats = MeasurePhase("False positive query", challenge_set,
+    [&bf, &contains](const std::string& entry) {
+      if (bf.Contains(entry)) {
+        contains++;
+      }
+    },
+    params.sample_interval);
   double false_positive_ratio = static_cast<double>(contains) / num_challenges;
-  std::cout << "False Positive Rate           : " << false_positive_ratio << std::endl;
 
-  double estimated_fp = EstimatedFalsePositiveRatio(bf.NumBits(),
+  double estimated_fp = sbf::EstimatedFalsePositiveRate(bf.NumBits(),
     bf.NumHashes(), num_entries);
 
+  if (params.json) {
+    std::cout << "{\n";
+    std::cout << "  \"num_entries\": " << num_entries << ",\n";
+    std::cout << "  \"num_challenges\": " << num_challenges << ",\n";
+    std::cout << "  \"total_size_bits\": " << total_size << ",\n";
+    std::cout << "  \"num_bits\": " << bf.NumBits() << ",\n";
+    std::cout << "  \"num_hashes\": " << bf.NumHashes() << ",\n";
+    std::cout << "  \"page_size\": " << bf.PageSize() << ",\n";
+    std::cout << "  \"true_positive_rate\": " << JsonNumber{true_positive_ratio} << ",\n";
+    std::cout << "  \"estimated_true_positive_rate\": " << JsonNumber{estimated_tp} << ",\n";
+    std::cout << "  \"false_positive_rate\": " << JsonNumber{false_positive_ratio} << ",\n";
+    std::cout << "  \"estimated_false_positive_rate\": " << JsonNumber{estimated_fp} << ",\n";
+    std::cout << "  \"sample_interval\": " << params.sample_interval << ",\n";
+    std::cout << "  \"phases\": [\n";
+    std::cout << "    ";
+    PrintPhaseStatsJson(insert_stats) << ",\n";
+    std::cout << "    ";
+    PrintPhaseStatsJson(tp_stats) << ",\n";
+    std::cout << "    ";
+    PrintPhaseStatsJson(fp_stats) << "\n";
+    std::cout << "  ]\n";
+    std::cout << "}" << std::endl;
+    return 0;
+  }
+
+  // テスト設定を出力
+  std::cout << "[Test setting]\n";
+  std::cout << "The number of entries         : " << num_entries << "\n";
+  std::cout << "The total data size           : " << total_size << " [bits]\n";
+  std::cout << "\n";
+
+  // Bloom filter 設定を出力
+  std::cout << "[Bloom filter setting]\n";
+  std::cout << "The filter size               : " << bf.NumBits() << " [bits]\n";
+  std::cout << "The number of hash functions  : " << bf.NumHashes() << "\n";
+  std::cout << "Page size                     : " << bf.PageSize() << " [bytes]\n";
+  std::cout << "\n";
+
+  // テスト結果を出力
+  std::cout << "[Bloom filter test]\n";
+  std::cout << "True Positive Rate            : " << true_positive_ratio << std::endl;
+  std::cout << "Estimated True Positive Rate  : " << estimated_tp << std::endl;
+  std::cout << "False Positive Rate           : " << false_positive_ratio << std::endl;
   std::cout << "Estimated False Positive Rate : " << estimated_fp << std::endl;
+  std::cout << "\n";
+
+  // 性能を出力
+  PrintPhaseStats(insert_stats) << "\n";
+  PrintPhaseStats(tp_stats) << "\n";
+  PrintPhaseStats(fp_stats);
 
   return 0;
 }
+
+} // namespace
+
+/**
+ * メインメソッド
+ *
+ * @param[in] argc コマンドライン引数の数
+ * @param[in] argv コマンドライン引数
+ * @return int 終了コード
+ */
+int main(int argc, char **argv) {
+  // サブコマンドの実行
+  if (argc > 1 && cli::IsCommand(argv[1])) {
+    return cli::RunCommand(argc, argv);
+  }
+
+  // コマンドライン引数の解析
+  Parameters params;
+  bool should_exit = ParseArguments(argc, argv, params);
+  if (should_exit) {
+    return 0;
+  }
+
+  // 要素生成器の生成
+  KeyGenerator generator(params.seed ? params.seed.value() : std::random_device{}());
+
+  if (params.build_path) {
+    return RunStream(params);
+  }
+  if (params.sweep) {
+    return RunSweep(params);
+  }
+  if (params.num_threads > 0) {
+    return RunMultiThreaded(params, generator);
+  }
+  return RunSingleThreaded(params, generator);
+}
@@ -0,0 +1,345 @@
+/**
+ * @file sweep.cc
+ * @brief パラメータスイープを定義するソースファイル．
+ */
+
+#include "sweep.h"
+#include "json.h"
+#include "key_generator.h"
+#include "simplebf/bloom_filter.h"
+#include "simplebf/concurrent_bloom_filter.h"
+#include "simplebf/util.h"
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+/**
+ * @brief コマンドラインプログラムのための名前空間．
+ */
+namespace cli {
+
+namespace {
+
+/** ParseSweepList() で1個の列に指定できる数値の個数の上限． */
+constexpr std::size_t kMaxSweepListSize = 1024;
+
+/**
+ * @brief 1個の設定を表す構造体．
+ */
+struct SweepConfig {
+  /** フィルタの種類． */
+  std::string variant;
+
+  /** フィルタ用配列のビット数の底2による対数値． */
+  std::size_t log2_num_bits = 0;
+
+  /** ハッシュ関数の個数． */
+  std::size_t num_hashes = 0;
+};
+
+/**
+ * @brief 1個の設定の評価結果を表す構造体．
+ */
+struct SweepResult {
+  /** 偽陽性率の計測値． */
+  double false_positive_rate = 0;
+
+  /** 偽陽性率の見積もり． */
+  double estimated_false_positive_rate = 0;
+
+  /** 要素1個あたりの追加の処理時間 [ns]． */
+  double ns_per_insert = 0;
+
+  /** 要素1個あたりの判定の処理時間 [ns]． */
+  double ns_per_query = 0;
+
+  /** パレート最適の場合は true． */
+  bool pareto = false;
+
+  /** フィルタ用配列サイズの設定に失敗した場合は true． */
+  bool parameter_error = false;
+};
+
+/**
+ * フィルタを作成して要素を追加し，偽陽性率と処理時間を計測する．
+ *
+ * 処理時間を他の設定の評価に影響されずに計測するため，追加と判定は timing_mutex を排他的に
+ * ロックして実行する．<br>
+ * フィルタの作成と破棄は共有ロックで実行するため，他のスレッドの作成や破棄とは並列に進むが，
+ * 計測中の設定とは同時に実行しない．
+ *
+ * @tparam Filter フィルタの型
+ * @param[in] config 設定
+ * @param[in] entries 追加する要素
+ * @param[in] challenges 偽陽性テストに使う要素
+ * @param[in,out] timing_mutex 処理時間の計測を他の設定の評価と排他するためのミューテックス
+ * @return 評価結果
+ */
+template <class Filter>
+SweepResult Evaluate(const SweepConfig& config, const std::vector<std::string>& entries,
+    const std::vector<std::string>& challenges, std::shared_mutex& timing_mutex) {
+  std::unique_ptr<Filter> bf;
+  {
+    std::shared_lock<std::shared_mutex> lock(timing_mutex);
+    bf.reset(new Filter(config.log2_num_bits, config.num_hashes));
+  }
+  SweepResult result;
+  // フィルタが補正したパラメータを元の値として表示しないよう，いずれのエラーも評価しない．
+  if (bf->HasParameterError()) {
+    result.parameter_error = true;
+    return result;
+  }
+
+  std::chrono::steady_clock::time_point start_time;
+  std::chrono::steady_clock::time_point middle_time;
+  std::chrono::steady_clock::time_point end_time;
+  std::size_t num_positives = 0;
+  {
+    std::unique_lock<std::shared_mutex> lock(timing_mutex);
+    start_time = std::chrono::steady_clock::now();
+    for (auto&& entry : entries) {
+      bf->Insert(entry);
+    }
+    middle_time = std::chrono::steady_clock::now();
+    for (auto&& entry : challenges) {
+      num_positives += bf->Contains(entry);
+    }
+    end_time = std::chrono::steady_clock::now();
+  }
+
+  result.ns_per_insert = std::chrono::duration<double, std::nano>(
+    middle_time - start_time).count() / entries.size();
+  result.ns_per_query = std::chrono::duration<double, std::nano>(
+    end_time - middle_time).count() / challenges.size();
+  result.false_positive_rate
+    = static_cast<double>(num_positives) / challenges.size();
+  result.estimated_false_positive_rate = sbf::EstimatedFalsePositiveRate(
+    bf->NumBits(), bf->NumHashes(), entries.size());
+
+  std::shared_lock<std::shared_mutex> lock(timing_mutex);
+  bf.reset();
+  return result;
+}
+
+/**
+ * 1個の設定を評価する．
+ *
+ * @param[in] config 設定
+ * @param[in] entries 追加する要素
+ * @param[in] challenges 偽陽性テストに使う要素
+ * @param[in,out] timing_mutex 処理時間の計測を他の設定の評価と排他するためのミューテックス
+ * @return 評価結果
+ */
+SweepResult EvaluateConfig(const SweepConfig& config,
+    const std::vector<std::string>& entries,
+    const std::vector<std::string>& challenges, std::shared_mutex& timing_mutex) {
+  if (config.variant == "concurrent") {
+    return Evaluate<sbf::ConcurrentBloomFilter<std::string>>(config, entries, challenges,
+      timing_mutex);
+  }
+  return Evaluate<sbf::BloomFilter<std::string>>(config, entries, challenges, timing_mutex);
+}
+
+/**
+ * 10進表記の非負整数を解析する．
+ *
+ * @param[in] str 文字列
+ * @param[out] value 値
+ * @return 文字列全体が範囲内の非負整数を表す場合は true
+ */
+bool ParseSize(const std::string& str, std::size_t& value) {
+  if (str.empty() || !std::isdigit(static_cast<unsigned char>(str[0]))) {
+    return false;
+  }
+  char* end = nullptr;
+  errno = 0;
+  unsigned long long parsed = std::strtoull(str.c_str(), &end, 10);
+  if (*end != '\0' || errno == ERANGE || parsed > std::numeric_limits<std::size_t>::max()) {
+    return false;
+  }
+  value = static_cast<std::size_t>(parsed);
+  return true;
+}
+
+/**
+ * パレート最適な設定に印をつける．
+ *
+ * フィルタ用配列のビット数，偽陽性率の計測値，判定の処理時間のすべてが以下であり，
+ * いずれかが真に小さい設定が存在しない場合にパレート最適とする．
+ *
+ * @param[in] configs 設定
+ * @param[in,out] results 評価結果
+ */
+void MarkPareto(const std::vector<SweepConfig>& configs,
+    std::vector<SweepResult>& results) {
+  for (std::size_t i = 0; i < results.size(); i++) {
+    if (results[i].parameter_error) {
+      continue;
+    }
+    bool dominated = false;
+    for (std::size_t j = 0; j < results.size() && !dominated; j++) {
+      if (i == j || results[j].parameter_error) {
+        continue;
+      }
+      bool no_worse = configs[j].log2_num_bits <= configs[i].log2_num_bits
+        && results[j].false_positive_rate <= results[i].false_positive_rate
+        && results[j].ns_per_query <= results[i].ns_per_query;
+      bool better = configs[j].log2_num_bits < configs[i].log2_num_bits
+        || results[j].false_positive_rate < results[i].false_positive_rate
+        || results[j].ns_per_query < results[i].ns_per_query;
+      dominated = no_worse && better;
+    }
+    results[i].pareto = !dominated;
+  }
+}
+
+} // namespace
+
+/**
+ * "a:b" (a 以上 b 以下) または "a,b,c" 形式の数値の列を解析する．
+ *
+ * @param[in] spec 数値の列を表す文字列
+ * @param[out] values 数値の列
+ * @return 解析できた場合は true
+ */
+bool ParseSweepList(const std::string& spec, std::vector<std::size_t>& values) {
+  values.clear();
+  std::size_t colon = spec.find(':');
+  if (colon != std::string::npos) {
+    std::size_t first = 0;
+    std::size_t last = 0;
+    if (!ParseSize(spec.substr(0, colon), first) || !ParseSize(spec.substr(colon + 1), last)
+        || last < first || last - first >= kMaxSweepListSize) {
+      return false;
+    }
+    for (std::size_t value = first; values.size() <= last - first; value++) {
+      values.push_back(value);
+    }
+    return true;
+  }
+
+  std::size_t begin = 0;
+  while (begin <= spec.size()) {
+    std::size_t end = spec.find(',', begin);
+    if (end == std::string::npos) {
+      end = spec.size();
+    }
+    std::size_t value = 0;
+    if (!ParseSize(spec.substr(begin, end - begin), value)
+        || values.size() >= kMaxSweepListSize) {
+      return false;
+    }
+    values.push_back(value);
+    begin = end + 1;
+  }
+  return !values.empty();
+}
+
+/**
+ * 全設定の組み合わせについて偽陽性率と処理時間を計測し，結果の表を出力する．
+ *
+ * @param[in] options 設定
+ * @return 終了コード
+ */
+int RunSweep(const SweepOptions& options) {
+  // 要素を一度だけ生成する．
+  KeyGenerator generator(options.seed);
+  KeyRange entry_range(generator, 0, options.num_entries);
+  KeyRange challenge_range(generator, options.num_entries,
+    options.num_entries + options.num_challenges);
+  std::vector<std::string> entries(entry_range.begin(), entry_range.end());
+  std::vector<std::string> challenges(challenge_range.begin(), challenge_range.end());
+
+  std::vector<SweepConfig> configs;
+  for (auto&& variant : options.variants) {
+    for (auto&& log2_num_bits : options.log2_num_bits) {
+      for (auto&& num_hashes : options.num_hashes) {
+        configs.push_back({variant, log2_num_bits, num_hashes});
+      }
+    }
+  }
+
+  // 各スレッドは未評価の設定を1個ずつ取り出して評価する．
+  std::vector<SweepResult> results(configs.size());
+  std::atomic<std::size_t> next(0);
+  std::shared_mutex timing_mutex;
+  std::vector<std::thread> threads;
+  std::size_t num_threads = std::max<std::size_t>(1,
+    std::min(options.num_threads, configs.size()));
+  for (std::size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&]() {
+      for (std::size_t i = next++; i < configs.size(); i = next++) {
+        results[i] = EvaluateConfig(configs[i], entries, challenges, timing_mutex);
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  MarkPareto(configs, results);
+
+  if (options.json) {
+    std::cout << "{\n";
+    std::cout << "  \"num_entries\": " << options.num_entries << ",\n";
+    std::cout << "  \"num_challenges\": " << options.num_challenges << ",\n";
+    std::cout << "  \"num_threads\": " << num_threads << ",\n";
+    std::cout << "  \"results\": [\n";
+    for (std::size_t i = 0; i < configs.size(); i++) {
+      const auto& result = results[i];
+      std::cout << "    {\"variant\": " << JsonString{configs[i].variant} << ", "
+                << "\"log2_num_bits\": " << configs[i].log2_num_bits << ", "
+                << "\"num_hashes\": " << configs[i].num_hashes << ", "
+                << "\"parameter_error\": " << (result.parameter_error ? "true" : "false") << ", "
+                << "\"false_positive_rate\": " << JsonNumber{result.false_positive_rate} << ", "
+                << "\"estimated_false_positive_rate\": " << JsonNumber{result.estimated_false_positive_rate} << ", "
+                << "\"ns_per_insert\": " << JsonNumber{result.ns_per_insert} << ", "
+                << "\"ns_per_query\": " << JsonNumber{result.ns_per_query} << ", "
+                << "\"pareto\": " << (result.pareto ? "true" : "false") << "}"
+                << (i + 1 < configs.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n";
+    std::cout << "}" << std::endl;
+    return 0;
+  }
+
+  std::cout << "[Sweep setting]\n";
+  std::cout << "The number of entries         : " << options.num_entries << "\n";
+  std::cout << "The number of challenges      : " << options.num_challenges << "\n";
+  std::cout << "The number of threads         : " << num_threads << "\n";
+  std::cout << "\n";
+  std::cout << "[Sweep result] (* : Pareto optimal in bits, measured FPR and ns/query)\n";
+  char line[256];
+  std::snprintf(line, sizeof(line), "  %-10s %13s %10s %13s %13s %10s %10s\n",
+    "variant", "log2_num_bits", "num_hashes", "measured_fpr", "estimated_fpr",
+    "ns/insert", "ns/query");
+  std::cout << line;
+  for (std::size_t i = 0; i < configs.size(); i++) {
+    const auto& result = results[i];
+    if (result.parameter_error) {
+      std::snprintf(line, sizeof(line), "  %-10s %13zu %10zu %s\n",
+        configs[i].variant.c_str(), configs[i].log2_num_bits,
+        configs[i].num_hashes, "Invalid filter parameters.");
+    }
+    else {
+      std::snprintf(line, sizeof(line), "%c %-10s %13zu %10zu %13.6g %13.6g %10.2f %10.2f\n",
+        result.pareto ? '*' : ' ', configs[i].variant.c_str(),
+        configs[i].log2_num_bits, configs[i].num_hashes,
+        result.false_positive_rate, result.estimated_false_positive_rate,
+        result.ns_per_insert, result.ns_per_query);
+    }
+    std::cout << line;
+  }
+  std::cout << std::flush;
+  return 0;
+}
+
+} // namespace cli
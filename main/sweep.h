@@ -0,0 +1,78 @@
+/**
+ * @file sweep.h
+ * @brief パラメータスイープを宣言するヘッダファイル．
+ */
+
+#ifndef CPPBF_MAIN_SWEEP_H_
+#define CPPBF_MAIN_SWEEP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief コマンドラインプログラムのための名前空間．
+ */
+namespace cli {
+
+/** パラメータスイープで評価できるハッシュ関数の個数の上限． */
+constexpr std::size_t kMaxSweepNumHashes = 64;
+
+/**
+ * @brief パラメータスイープの設定を表す構造体．
+ */
+struct SweepOptions {
+  /** 評価するフィルタ用配列のビット数の底2による対数値． */
+  std::vector<std::size_t> log2_num_bits;
+
+  /** 評価するハッシュ関数の個数 (1以上 kMaxSweepNumHashes 以下)． */
+  std::vector<std::size_t> num_hashes;
+
+  /** 評価するフィルタの種類 ("bloom" または "concurrent")． */
+  std::vector<std::string> variants;
+
+  /** 追加する要素数． */
+  std::size_t num_entries = 1024;
+
+  /** 偽陽性テストに使う要素数． */
+  std::size_t num_challenges = 1024;
+
+  /** 乱数シード． */
+  std::uint64_t seed = 0;
+
+  /** 設定を並列に評価するスレッド数． */
+  std::size_t num_threads = 1;
+
+  /** 結果を JSON 形式で出力する場合は true． */
+  bool json = false;
+};
+
+/**
+ * "a:b" (a 以上 b 以下) または "a,b,c" 形式の数値の列を解析する．
+ *
+ * 数値でない値，範囲外の値や1024個を超える列は解析できないものとする．
+ *
+ * @param[in] spec 数値の列を表す文字列
+ * @param[out] values 数値の列
+ * @return 解析できた場合は true
+ */
+bool ParseSweepList(const std::string& spec, std::vector<std::size_t>& values);
+
+/**
+ * 全設定の組み合わせについて偽陽性率と処理時間を計測し，結果の表を出力する．
+ *
+ * 要素は一度だけ生成してメモリに保持し，全設定で共有する．<br>
+ * 設定は num_threads 個のスレッドで並列に評価するが，処理時間を計測する追加と判定は
+ * 1個の設定ずつ実行し，他の設定の評価と同時には実行しない．<br>
+ * フィルタ用配列のビット数，偽陽性率，判定の処理時間のいずれについても
+ * 他の設定に劣らない設定をパレート最適として印をつける．
+ *
+ * @param[in] options 設定
+ * @return 終了コード
+ */
+int RunSweep(const SweepOptions& options);
+
+} // namespace cli
+
+#endif // #ifndef CPPBF_MAIN_SWEEP_H_
@@ -0,0 +1,14 @@
+#!/bin/bash
+version=1.7.1
+
+if [ ! -e "/usr/local/lib/libbenchmark.a" ]; then
+  git clone https://github.com/google/benchmark.git -b v${version}
+  cd benchmark
+  mkdir build
+  cd build
+  cmake .. -DCMAKE_BUILD_TYPE=Release -DBENCHMARK_ENABLE_TESTING=OFF
+  make
+  sudo make install
+  cd ../../
+  rm -rf benchmark
+fi
@@ -0,0 +1,119 @@
+/**
+ * @file filter_arena.cc
+ * @brief 多数の小さなフィルタ用配列をまとめて確保・解放するアリーナを定義するソースファイル．
+ */
+
+#include "simplebf/filter_arena.h"
+#include <new>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * ブロックのサイズを与えて初期化する．
+ *
+ * @param[in] block_size ブロックのサイズ [bytes]
+ */
+FilterArena::FilterArena(std::size_t block_size) : block_size_(block_size),
+    cursor_(nullptr), limit_(nullptr), bytes_allocated_(0) {
+}
+
+/** デストラクタ．すべてのブロックを解放する． */
+FilterArena::~FilterArena() {
+  Release();
+}
+
+/**
+ * メモリを切り出す．
+ *
+ * @param[in] size サイズ [bytes]
+ * @return 切り出したメモリの先頭
+ */
+void* FilterArena::Allocate(std::size_t size) {
+  size = (size + kAlignment - 1) & ~(kAlignment - 1);
+  bytes_allocated_ += size;
+  if (size > block_size_) {
+    large_blocks_.push_back(AllocateBlock(size));
+    return large_blocks_.back().data;
+  }
+  if (static_cast<std::size_t>(limit_ - cursor_) < size) {
+    blocks_.push_back(AllocateBlock(block_size_));
+    cursor_ = blocks_.back().data;
+    limit_ = cursor_ + block_size_;
+  }
+  void* p = cursor_;
+  cursor_ += size;
+  return p;
+}
+
+/**
+ * 切り出したメモリをすべて再利用できるようにする．
+ */
+void FilterArena::Reset() {
+  for (auto&& block : large_blocks_) {
+    FreeBlock(block);
+  }
+  large_blocks_.clear();
+  for (std::size_t i = 1; i < blocks_.size(); i++) {
+    FreeBlock(blocks_[i]);
+  }
+  if (!blocks_.empty()) {
+    blocks_.resize(1);
+    cursor_ = blocks_.front().data;
+    limit_ = cursor_ + blocks_.front().size;
+  }
+  bytes_allocated_ = 0;
+}
+
+/**
+ * すべてのブロックを解放する．
+ */
+void FilterArena::Release() {
+  Reset();
+  for (auto&& block : blocks_) {
+    FreeBlock(block);
+  }
+  blocks_.clear();
+  cursor_ = nullptr;
+  limit_ = nullptr;
+}
+
+/**
+ * 確保中のブロックの合計サイズを返す．
+ *
+ * @return 確保中のブロックの合計サイズ [bytes]
+ */
+std::size_t FilterArena::BytesReserved() const {
+  std::size_t total = 0;
+  for (auto&& block : blocks_) {
+    total += block.size;
+  }
+  for (auto&& block : large_blocks_) {
+    total += block.size;
+  }
+  return total;
+}
+
+/**
+ * ブロックを確保する．
+ *
+ * @param[in] size サイズ [bytes]
+ * @return 確保したブロック
+ */
+FilterArena::Block FilterArena::AllocateBlock(std::size_t size) {
+  void* data = ::operator new(size, std::align_val_t{kAlignment});
+  return Block{static_cast<char*>(data), size};
+}
+
+/**
+ * ブロックを解放する．
+ *
+ * @param[in] block 解放するブロック
+ */
+void FilterArena::FreeBlock(const Block& block) {
+  ::operator delete(block.data, std::align_val_t{kAlignment});
+}
+
+} // namespace sbf
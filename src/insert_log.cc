@@ -0,0 +1,464 @@
+/**
+ * @file insert_log.cc
+ * @brief 追加した要素のハッシュ値を記録する先行書き込みログを定義するソースファイル．
+ */
+
+#include "simplebf/insert_log.h"
+#include "simplebf/serialization.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+namespace {
+
+/** マジックナンバー． */
+constexpr char kInsertLogMagic[8] = {'S', 'B', 'F', 'I', 'N', 'L', 'O', 'G'};
+
+/** 書式のバージョン． */
+constexpr std::uint32_t kInsertLogVersion = 1;
+
+/**
+ * 値をリトルエンディアンでバッファに格納する．
+ *
+ * @param[in] value 値
+ * @param[in] size 値のサイズ [bytes]
+ * @param[out] buffer 格納先
+ */
+void StoreLittleEndian(std::uint64_t value, std::size_t size, char* buffer) {
+  for (std::size_t i = 0; i < size; i++) {
+    buffer[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+/**
+ * リトルエンディアンで格納された値を返す．
+ *
+ * @param[in] buffer 格納先
+ * @param[in] size 値のサイズ [bytes]
+ * @return 値
+ */
+std::uint64_t LoadLittleEndian(const char* buffer, std::size_t size) {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(buffer[i])) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * ブロックのチェックサムを返す．
+ *
+ * 記録の個数と各記録を64ビット単位で FNV-1a と同様に撹拌する．
+ *
+ * @param[in] num_records 記録の個数
+ * @param[in] records 記録 (リトルエンディアン)
+ * @return チェックサム
+ */
+std::uint64_t BlockChecksum(std::uint64_t num_records, const char* records) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  hash = (hash ^ num_records) * 0x100000001b3ull;
+  for (std::uint64_t i = 0; i < num_records * kInsertLogRecordSize; i += 8) {
+    hash = (hash ^ LoadLittleEndian(records + i, 8)) * 0x100000001b3ull;
+  }
+  return hash ^ (hash >> 32);
+}
+
+/**
+ * ログのヘッダと完全なブロックを読み込む．
+ *
+ * 記録の個数がファイルの残りのサイズに収まらないブロックは，記録を読み込む前に不完全とみなす．
+ * そのため，壊れたブロックのヘッダによって大きなメモリを確保することはない．
+ *
+ * @param[in,out] in 入力ストリーム
+ * @param[out] base 最初の記録より前に追加された要素数
+ * @param[in] function 記録を受け取る関数 (空の場合は呼び出さない)
+ * @param[out] valid_size 完全なブロックまでのサイズ [bytes]
+ * @return ヘッダが有効な場合は true
+ */
+bool ScanInsertLog(std::istream& in, std::uint64_t& base,
+    const std::function<void(const HashedKey&)>& function, std::uint64_t& valid_size) {
+  char header[kInsertLogHeaderSize];
+  if (!in.read(header, sizeof(header))
+      || std::memcmp(header, kInsertLogMagic, sizeof(kInsertLogMagic)) != 0
+      || LoadLittleEndian(header + 8, 4) != kInsertLogVersion) {
+    return false;
+  }
+  base = LoadLittleEndian(header + 16, 8);
+  valid_size = kInsertLogHeaderSize;
+
+  in.seekg(0, std::ios::end);
+  std::streamoff file_size = in.tellg();
+  in.seekg(kInsertLogHeaderSize, std::ios::beg);
+  if (!in || file_size < static_cast<std::streamoff>(kInsertLogHeaderSize)) {
+    return false;
+  }
+
+  std::vector<char> records;
+  char block_header[kInsertLogBlockHeaderSize];
+  while (in.read(block_header, sizeof(block_header))) {
+    std::uint64_t num_records = LoadLittleEndian(block_header, 8);
+    std::uint64_t remaining = file_size - valid_size - kInsertLogBlockHeaderSize;
+    if (num_records == 0 || num_records > remaining / kInsertLogRecordSize) {
+      break;
+    }
+    records.resize(num_records * kInsertLogRecordSize);
+    if (!in.read(records.data(), records.size())
+        || BlockChecksum(num_records, records.data()) != LoadLittleEndian(block_header + 8, 8)) {
+      break;
+    }
+    if (function) {
+      for (std::uint64_t i = 0; i < num_records; i++) {
+        const char* record = records.data() + i * kInsertLogRecordSize;
+        function(HashedKey{LoadLittleEndian(record, 8), LoadLittleEndian(record + 8, 8)});
+      }
+    }
+    valid_size += kInsertLogBlockHeaderSize + records.size();
+  }
+  return true;
+}
+
+/**
+ * ファイル記述子にすべて書き出す．
+ *
+ * @param[in] fd ファイル記述子
+ * @param[in] data 書き出すデータ
+ * @param[in] size 書き出すサイズ [bytes]
+ * @return 書き出せた場合は true
+ */
+bool WriteAll(int fd, const char* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+/**
+ * 空のログを作成するか，既存のファイルを空のログで置き換える．
+ *
+ * 一時ファイルに書き出して同期した後に名前を変更し，ディレクトリも同期する (ReplaceFile() を参照)．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] base 最初の記録より前に追加された要素数
+ * @return 作成できた場合は true
+ */
+bool CreateInsertLog(const std::string& path, std::uint64_t base) {
+  char header[kInsertLogHeaderSize] = {};
+  std::memcpy(header, kInsertLogMagic, sizeof(kInsertLogMagic));
+  StoreLittleEndian(kInsertLogVersion, 4, header + 8);
+  StoreLittleEndian(base, 8, header + 16);
+
+  return ReplaceFile(path, [&header](std::ostream& out) {
+    return static_cast<bool>(out.write(header, sizeof(header)));
+  });
+}
+
+/**
+ * 追記するためにログを開く．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] size 追記を始める位置 [bytes]．これより後ろは切り詰める．
+ * @return ファイル記述子 (開けなかった場合は -1)
+ */
+int OpenForAppend(const std::string& path, std::uint64_t size) {
+  int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0
+      || ::lseek(fd, static_cast<off_t>(size), SEEK_SET) < 0 || ::fdatasync(fd) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+} // namespace
+
+/**
+ * 1ブロックにまとめる記録の個数と同期する間隔を与えて初期化する．
+ *
+ * @param[in] max_batch_size 1ブロックにまとめる記録の個数 (1以上)
+ * @param[in] flush_interval 同期する間隔
+ */
+InsertLog::InsertLog(std::size_t max_batch_size, std::chrono::microseconds flush_interval)
+    : max_batch_size_(max_batch_size < 1 ? 1 : max_batch_size),
+    flush_interval_(flush_interval), fd_(-1), base_(0), ring_mask_(0), tail_(0), head_(0),
+    num_durable_(0), sync_requested_(false), flushing_(false), closing_(false),
+    error_(false) {
+}
+
+/** デストラクタ．記録をすべて書き出して閉じる． */
+InsertLog::~InsertLog() {
+  Close();
+}
+
+/**
+ * ログを開いて記録できるようにする．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] base 新たに作成する場合の，最初の記録より前に追加された要素数
+ * @return 開けた場合は true
+ */
+bool InsertLog::Open(const std::string& path, std::uint64_t base) {
+  Close();
+  std::uint64_t existing_base = 0;
+  std::uint64_t valid_size = 0;
+  bool valid = false;
+  {
+    std::ifstream in(path, std::ios::binary);
+    valid = in && ScanInsertLog(in, existing_base, nullptr, valid_size);
+  }
+  if (valid) {
+    base = existing_base;
+  }
+  else if (CreateInsertLog(path, base)) {
+    valid_size = kInsertLogHeaderSize;
+  }
+  else {
+    return false;
+  }
+
+  int fd = OpenForAppend(path, valid_size);
+  if (fd < 0) {
+    return false;
+  }
+  path_ = path;
+  fd_ = fd;
+  base_ = base;
+  if (ring_ == nullptr) {
+    std::size_t capacity = 1;
+    while (capacity < MaxBufferSize()) {
+      capacity <<= 1;
+    }
+    ring_.reset(new HashedKey[capacity]);
+    ring_mask_ = capacity - 1;
+  }
+  tail_.store(0, std::memory_order_relaxed);
+  head_.store(0, std::memory_order_relaxed);
+  num_durable_ = 0;
+  sync_requested_ = false;
+  flushing_ = false;
+  closing_ = false;
+  error_ = false;
+  flusher_ = std::thread(&InsertLog::FlushLoop, this);
+  return true;
+}
+
+/**
+ * 記録を加える．
+ *
+ * @param[in] key 追加した要素のハッシュ値
+ */
+void InsertLog::Append(const HashedKey& key) {
+  if (fd_ < 0) {
+    return;
+  }
+  std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) >= MaxBufferSize()) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flush_cv_.notify_one();
+    durable_cv_.wait(lock, [this, tail]() {
+      return tail - head_.load(std::memory_order_acquire) < MaxBufferSize();
+    });
+  }
+  ring_[tail & ring_mask_] = key;
+  tail_.store(tail + 1, std::memory_order_release);
+
+  // 1ブロック分たまったら書き出すスレッドを起こす．ロックを取らないため起こし損ねることがあるが，
+  // その場合も同期する間隔が経過すれば書き出される．
+  if (tail + 1 - head_.load(std::memory_order_relaxed) == max_batch_size_) {
+    flush_cv_.notify_one();
+  }
+}
+
+/**
+ * それまでに加えた記録がすべて永続化されるのを待つ．
+ *
+ * @return 永続化された場合は true
+ */
+bool InsertLog::Sync() {
+  if (fd_ < 0) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::uint64_t target = tail_.load(std::memory_order_relaxed);
+  if (num_durable_ < target) {
+    sync_requested_ = true;
+    flush_cv_.notify_one();
+    durable_cv_.wait(lock, [this, target]() { return num_durable_ >= target || error_; });
+  }
+  return !error_;
+}
+
+/**
+ * 記録をすべて書き出した後，base を与えた空のログに置き換える．
+ *
+ * @param[in] base 最初の記録より前に追加された要素数
+ * @return 置き換えた場合は true
+ */
+bool InsertLog::Reset(std::uint64_t base) {
+  if (!Sync()) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  durable_cv_.wait(lock, [this]() { return !flushing_; });
+  int fd = -1;
+  if (!CreateInsertLog(path_, base)
+      || (fd = OpenForAppend(path_, kInsertLogHeaderSize)) < 0) {
+    error_ = true;
+    return false;
+  }
+  ::close(fd_);
+  fd_ = fd;
+  base_ = base;
+  return true;
+}
+
+/** 記録をすべて書き出して閉じる． */
+void InsertLog::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  flush_cv_.notify_one();
+  flusher_.join();
+  ::close(fd_);
+  fd_ = -1;
+}
+
+/**
+ * 開いてから加えた記録の個数を返す．
+ *
+ * @return 加えた記録の個数
+ */
+std::uint64_t InsertLog::NumAppended() const {
+  return tail_.load(std::memory_order_relaxed);
+}
+
+/**
+ * 開いてから加えた記録のうち，永続化された個数を返す．
+ *
+ * @return 永続化された記録の個数
+ */
+std::uint64_t InsertLog::NumDurable() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_durable_;
+}
+
+/**
+ * バッファの記録を書き出して同期することを繰り返す．
+ *
+ * 記録が1ブロック分たまるか，Sync() が呼び出されるか，同期する間隔が経過するたびに，
+ * リングバッファの記録をすべて取り出して書き出す．書き出しの間もバッファには記録を加えられる．<br>
+ * 書き出しに失敗した後は，途中まで書き出したブロックの後ろに書き出さないよう，記録を取り出して捨てる．
+ */
+void InsertLog::FlushLoop() {
+  std::vector<HashedKey> batch;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    flush_cv_.wait_for(lock, flush_interval_, [this]() {
+      return closing_ || sync_requested_
+        || tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed)
+          >= max_batch_size_;
+    });
+    sync_requested_ = false;
+    DrainRing(batch);
+    if (batch.empty()) {
+      if (closing_) {
+        break;
+      }
+      continue;
+    }
+
+    // バッファが空くのを待っている Append() を起こす．
+    durable_cv_.notify_all();
+    if (error_) {
+      // 途中まで書き出したブロックより後ろの記録は読み込まれないため，書き出さない．
+      batch.clear();
+      continue;
+    }
+    flushing_ = true;
+    int fd = fd_;
+    lock.unlock();
+    bool written = WriteBlock(fd, batch);
+    lock.lock();
+    flushing_ = false;
+    if (written) {
+      num_durable_ += batch.size();
+    }
+    else {
+      error_ = true;
+    }
+    batch.clear();
+    durable_cv_.notify_all();
+  }
+}
+
+/**
+ * リングバッファの記録を取り出す．
+ *
+ * @param[out] keys 取り出した記録
+ */
+void InsertLog::DrainRing(std::vector<HashedKey>& keys) {
+  std::uint64_t head = head_.load(std::memory_order_relaxed);
+  std::uint64_t tail = tail_.load(std::memory_order_acquire);
+  for (std::uint64_t i = head; i < tail; i++) {
+    keys.push_back(ring_[i & ring_mask_]);
+  }
+  head_.store(tail, std::memory_order_release);
+}
+
+/**
+ * 記録を1ブロックとして書き出して同期する．
+ *
+ * @param[in] fd ファイル記述子
+ * @param[in] keys 記録
+ * @return 書き出せた場合は true
+ */
+bool InsertLog::WriteBlock(int fd, const std::vector<HashedKey>& keys) {
+  block_.resize(kInsertLogBlockHeaderSize + keys.size() * kInsertLogRecordSize);
+  char* records = block_.data() + kInsertLogBlockHeaderSize;
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    StoreLittleEndian(keys[i].first, 8, records + i * kInsertLogRecordSize);
+    StoreLittleEndian(keys[i].second, 8, records + i * kInsertLogRecordSize + 8);
+  }
+  StoreLittleEndian(keys.size(), 8, block_.data());
+  StoreLittleEndian(BlockChecksum(keys.size(), records), 8, block_.data() + 8);
+  return WriteAll(fd, block_.data(), block_.size()) && ::fdatasync(fd) == 0;
+}
+
+/**
+ * ログの記録を順に読み込む．
+ *
+ * @param[in] path ファイルのパス
+ * @param[out] base 最初の記録より前に追加された要素数
+ * @param[in] function 記録を受け取る関数
+ * @return ヘッダが有効なログを読み込めた場合は true
+ */
+bool ReplayInsertLog(const std::string& path, std::uint64_t& base,
+    const std::function<void(const HashedKey&)>& function) {
+  std::ifstream in(path, std::ios::binary);
+  std::uint64_t valid_size = 0;
+  return in && ScanInsertLog(in, base, function, valid_size);
+}
+
+} // namespace sbf
@@ -0,0 +1,135 @@
+/**
+ * @file line_reader.cc
+ * @brief 改行区切りの要素を読み込むクラスを定義するソースファイル．
+ */
+
+#include "simplebf/line_reader.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/**
+ * 読み込むファイルのパスを与えて初期化する．
+ *
+ * パスが "-" の場合は標準入力から読み込む．
+ *
+ * @param[in] path ファイルのパス
+ */
+LineReader::LineReader(const std::string& path) : fd_(-1), owns_fd_(false),
+    mapped_(nullptr), mapped_size_(0), begin_(0), end_(0), eof_(false),
+    has_error_(false) {
+  if (path == "-") {
+    fd_ = STDIN_FILENO;
+  }
+  else {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    owns_fd_ = (fd_ >= 0);
+  }
+  if (fd_ < 0) {
+    return;
+  }
+
+  // 通常のファイルはメモリにマップする．
+  struct stat st;
+  if (::fstat(fd_, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (addr != MAP_FAILED) {
+      ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+      mapped_ = static_cast<char*>(addr);
+      mapped_size_ = st.st_size;
+      end_ = mapped_size_;
+      eof_ = true;
+      return;
+    }
+  }
+
+  buffer_.resize(kBufferSize);
+}
+
+/** デストラクタ． */
+LineReader::~LineReader() {
+  if (mapped_ != nullptr) {
+    ::munmap(mapped_, mapped_size_);
+  }
+  if (owns_fd_) {
+    ::close(fd_);
+  }
+}
+
+/**
+ * 次の行を読み込む．
+ *
+ * @param[out] line 読み込んだ行
+ * @return 行を読み込めた場合は true，末尾に達したか読み込みに失敗した場合は false
+ */
+bool LineReader::Next(std::string_view& line) {
+  if (fd_ < 0) {
+    return false;
+  }
+
+  while (true) {
+    const char* data = (mapped_ != nullptr) ? mapped_ : buffer_.data();
+    const char* first = data + begin_;
+    const char* last = data + end_;
+    const char* newline = static_cast<const char*>(
+      std::memchr(first, '\n', last - first));
+
+    if (newline != nullptr || (eof_ && first != last)) {
+      // 改行がない場合は末尾までを最後の行とする．
+      const char* line_end = (newline != nullptr) ? newline : last;
+      begin_ = (line_end - data) + (newline != nullptr ? 1 : 0);
+      if (line_end != first && *(line_end - 1) == '\r') {
+        line_end--;
+      }
+      line = std::string_view(first, line_end - first);
+      return true;
+    }
+
+    if (eof_ || !Fill()) {
+      return false;
+    }
+  }
+}
+
+/**
+ * バッファに続きを読み込む．
+ *
+ * @return 1バイト以上読み込めた場合は true
+ */
+bool LineReader::Fill() {
+  // 未処理のデータを先頭に移動し，一杯であればバッファを拡張する．
+  std::size_t remaining = end_ - begin_;
+  std::memmove(buffer_.data(), buffer_.data() + begin_, remaining);
+  begin_ = 0;
+  end_ = remaining;
+  if (end_ == buffer_.size()) {
+    buffer_.resize(buffer_.size() * 2);
+  }
+
+  while (true) {
+    ssize_t n = ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+    if (n > 0) {
+      end_ += n;
+      return true;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    has_error_ = (n < 0);
+    eof_ = true;
+
+    // 改行で終わらない最後の行を処理させるため，未処理のデータがあれば true を返す．
+    return (end_ > begin_);
+  }
+}
+
+} // namespace sbf
@@ -0,0 +1,210 @@
+/**
+ * @file numa.cc
+ * @brief NUMA ノードの情報を扱う関数を定義するソースファイル．
+ */
+
+#include "simplebf/numa.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+namespace numa {
+
+namespace {
+
+/** CurrentNode() が CPU 番号を取得し直す呼び出し回数の間隔． */
+constexpr unsigned kNodeRefreshInterval = 1024;
+
+/**
+ * @brief NUMA ノードの構成を表す構造体．
+ */
+struct Topology {
+  /** 各ノードに属する CPU 番号． */
+  std::vector<std::vector<int>> node_cpus;
+
+  /** 各 CPU 番号の属するノード番号． */
+  std::vector<std::size_t> cpu_node;
+};
+
+/**
+ * ファイルの1行目を読み込む．
+ *
+ * @param[in] path ファイルのパス
+ * @param[out] line 読み込んだ行
+ * @return 読み込めた場合は true
+ */
+bool ReadFirstLine(const std::string& path, std::string& line) {
+  std::ifstream input(path);
+  return static_cast<bool>(std::getline(input, line));
+}
+
+/**
+ * NUMA ノードの構成を読み込む．
+ *
+ * ノード番号が連続していない場合は，小さい順に0から番号を振り直す．
+ *
+ * @return NUMA ノードの構成
+ */
+Topology LoadTopology() {
+  Topology topology;
+  std::string line;
+  const std::string root = "/sys/devices/system/node/";
+  if (ReadFirstLine(root + "online", line)) {
+    for (int node : ParseCpuList(line)) {
+      std::string cpus;
+      if (ReadFirstLine(root + "node" + std::to_string(node) + "/cpulist", cpus)) {
+        std::vector<int> list = ParseCpuList(cpus);
+        if (!list.empty()) {
+          topology.node_cpus.push_back(list);
+        }
+      }
+    }
+  }
+
+  if (topology.node_cpus.empty()) {
+    std::vector<int> cpus;
+    unsigned num_cpus = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned cpu = 0; cpu < num_cpus; cpu++) {
+      cpus.push_back(cpu);
+    }
+    topology.node_cpus.push_back(cpus);
+  }
+
+  for (std::size_t node = 0; node < topology.node_cpus.size(); node++) {
+    for (int cpu : topology.node_cpus[node]) {
+      if (topology.cpu_node.size() <= static_cast<std::size_t>(cpu)) {
+        topology.cpu_node.resize(cpu + 1, 0);
+      }
+      topology.cpu_node[cpu] = node;
+    }
+  }
+  return topology;
+}
+
+/**
+ * NUMA ノードの構成を返す．
+ *
+ * 初回の呼び出し時に読み込む．
+ *
+ * @return NUMA ノードの構成
+ */
+const Topology& GetTopology() {
+  static const Topology topology = LoadTopology();
+  return topology;
+}
+
+} // namespace
+
+/**
+ * "0-3,8,10-11" の形式の CPU 番号の一覧を展開する．
+ *
+ * @param[in] list CPU 番号の一覧
+ * @return CPU 番号を昇順に並べたベクトル
+ */
+std::vector<int> ParseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  const char* p = list.c_str();
+  while (*p != '\0') {
+    char* end = nullptr;
+    long first = std::strtol(p, &end, 10);
+    if (end == p) {
+      break;
+    }
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      last = std::strtol(p + 1, &end, 10);
+      p = end;
+    }
+    for (long cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+    if (*p != ',') {
+      break;
+    }
+    p++;
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+/**
+ * NUMA ノード数を返す．
+ *
+ * @return NUMA ノード数 (1以上)
+ */
+std::size_t NumNodes() {
+  return GetTopology().node_cpus.size();
+}
+
+/**
+ * NUMA ノードに属する CPU 番号を返す．
+ *
+ * @param[in] node ノード番号 (NumNodes() 未満)
+ * @return CPU 番号を昇順に並べたベクトル
+ */
+const std::vector<int>& NodeCpus(std::size_t node) {
+  return GetTopology().node_cpus[node];
+}
+
+/**
+ * 呼び出したスレッドが実行されている CPU の NUMA ノードを返す．
+ *
+ * @return ノード番号 (NumNodes() 未満)
+ */
+std::size_t CurrentNode() {
+  // スレッドごとに結果を保持し，kNodeRefreshInterval 回に1回だけ CPU 番号を取得し直す．
+  thread_local std::size_t node = 0;
+  thread_local unsigned countdown = 0;
+  if (countdown-- > 0) {
+    return node;
+  }
+  countdown = kNodeRefreshInterval - 1;
+
+  const Topology& topology = GetTopology();
+  int cpu = ::sched_getcpu();
+  if (cpu < 0 || static_cast<std::size_t>(cpu) >= topology.cpu_node.size()) {
+    node = 0;
+  }
+  else {
+    node = topology.cpu_node[cpu];
+  }
+  return node;
+}
+
+/**
+ * NUMA ノードに固定したスレッドで関数を実行し，終了を待つ．
+ *
+ * @param[in] node ノード番号 (NumNodes() 未満)
+ * @param[in] function 実行する関数
+ * @return スレッドをノードに固定できた場合は true
+ */
+bool RunOnNode(std::size_t node, const std::function<void()>& function) {
+  bool pinned = false;
+  std::thread thread([&]() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : NodeCpus(node)) {
+      if (cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &set);
+      }
+    }
+    pinned = (::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0);
+    function();
+  });
+  thread.join();
+  return pinned;
+}
+
+} // namespace numa
+
+} // namespace sbf
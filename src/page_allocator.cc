@@ -0,0 +1,307 @@
+/**
+ * @file page_allocator.cc
+ * @brief フィルタ用配列をページ単位で確保する関数を定義するソースファイル．
+ */
+
+#include "simplebf/page_allocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+namespace {
+
+/** 2MB の huge page のサイズ [bytes]． */
+constexpr std::size_t k2MBPageSize = std::size_t{1} << 21;
+
+/** 1GB の huge page のサイズ [bytes]． */
+constexpr std::size_t k1GBPageSize = std::size_t{1} << 30;
+
+/**
+ * 値を2べきの倍数に切り上げる．
+ *
+ * @param[in] value 値
+ * @param[in] alignment 2べきの倍数
+ * @return 切り上げた値
+ */
+std::size_t RoundUp(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * 通常のページで匿名メモリを確保する．
+ *
+ * @param[in] size 必要なサイズ [bytes]
+ * @param[out] mapping 確保したメモリ
+ * @return 確保できた場合は true
+ */
+bool MapAnonymous(std::size_t size, PageMapping& mapping) {
+  std::size_t length = RoundUp(size, BasePageSize());
+  void* addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  mapping.addr = addr;
+  mapping.length = length;
+  mapping.page_size = BasePageSize();
+  mapping.transparent = false;
+  return true;
+}
+
+/**
+ * MAP_HUGETLB で huge page を確保する．
+ *
+ * @param[in] size 必要なサイズ [bytes]
+ * @param[in] page_size huge page のサイズ [bytes]
+ * @param[out] mapping 確保したメモリ
+ * @return 確保できた場合は true
+ */
+bool MapHugeTlb(std::size_t size, std::size_t page_size, PageMapping& mapping) {
+  std::size_t length = RoundUp(size, page_size);
+  int log2_page_size = __builtin_ctzll(page_size);
+  void* addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (log2_page_size << MAP_HUGE_SHIFT),
+    -1, 0);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  mapping.addr = addr;
+  mapping.length = length;
+  mapping.page_size = page_size;
+  mapping.transparent = false;
+  return true;
+}
+
+/**
+ * 2MB 境界に揃えた匿名メモリを確保し，透過的 huge page を要求する．
+ *
+ * 境界に揃えるため 2MB 多く確保し，前後の余りを解放する．<br>
+ * 透過的 huge page が無効な環境では通常のページとなる．
+ *
+ * @param[in] size 必要なサイズ [bytes]
+ * @param[out] mapping 確保したメモリ
+ * @return 確保できた場合は true
+ */
+bool MapTransparent(std::size_t size, PageMapping& mapping) {
+  std::size_t length = RoundUp(size, k2MBPageSize);
+  void* addr = ::mmap(nullptr, length + k2MBPageSize, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  auto begin = reinterpret_cast<std::uintptr_t>(addr);
+  std::uintptr_t aligned = RoundUp(begin, k2MBPageSize);
+  if (aligned > begin) {
+    ::munmap(addr, aligned - begin);
+  }
+  std::size_t tail = begin + length + k2MBPageSize - (aligned + length);
+  if (tail > 0) {
+    ::munmap(reinterpret_cast<void*>(aligned + length), tail);
+  }
+#ifdef MADV_HUGEPAGE
+  ::madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+#endif
+
+  mapping.addr = reinterpret_cast<void*>(aligned);
+  mapping.length = length;
+  mapping.page_size = BasePageSize();
+  mapping.transparent = true;
+  return true;
+}
+
+/**
+ * 範囲を分割し，複数のスレッドで並列に関数を実行する．
+ *
+ * 1スレッドあたり kMinZeroBytesPerThread 以上となるようにスレッド数を減らす．<br>
+ * 最初の部分は呼び出したスレッドで実行する．
+ *
+ * @param[in] begin 先頭
+ * @param[in] size サイズ [bytes]
+ * @param[in] num_threads スレッド数
+ * @param[in] function 部分の先頭とサイズを受け取る関数
+ */
+template <class Function>
+void ParallelForRange(char* begin, std::size_t size, std::size_t num_threads,
+    const Function& function) {
+  num_threads = std::max<std::size_t>(
+    1, std::min(num_threads, size / kMinZeroBytesPerThread));
+  if (num_threads == 1) {
+    function(begin, size);
+    return;
+  }
+  std::size_t chunk = (size + num_threads - 1) / num_threads;
+  std::vector<std::thread> threads;
+  for (std::size_t offset = chunk; offset < size; offset += chunk) {
+    threads.emplace_back([&function, begin, offset, chunk, size]() {
+      function(begin + offset, std::min(chunk, size - offset));
+    });
+  }
+  function(begin, std::min(chunk, size));
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace
+
+/**
+ * 匿名メモリをページ単位で確保する．
+ *
+ * @param[in] size 必要なサイズ [bytes]
+ * @param[in] request ページの種類 (kNone 以外)
+ * @param[out] mapping 確保したメモリ
+ * @return 確保できた場合は true
+ */
+bool MapPages(std::size_t size, HugePages request, PageMapping& mapping) {
+  size = std::max<std::size_t>(size, 1);
+  if (request == HugePages::kNone) {
+    return MapAnonymous(size, mapping);
+  }
+  if (request == HugePages::k1GB && MapHugeTlb(size, k1GBPageSize, mapping)) {
+    return true;
+  }
+  if ((request == HugePages::k1GB || request == HugePages::k2MB)
+      && MapHugeTlb(size, k2MBPageSize, mapping)) {
+    return true;
+  }
+  return MapTransparent(size, mapping);
+}
+
+/**
+ * MapPages() で確保したメモリを解放する．
+ *
+ * @param[in] mapping 確保したメモリ
+ */
+void UnmapPages(const PageMapping& mapping) {
+  if (mapping.addr != nullptr) {
+    ::munmap(mapping.addr, mapping.length);
+  }
+}
+
+/**
+ * 確保したメモリに実際に使われているページのサイズを返す．
+ *
+ * @param[in] mapping 確保したメモリ
+ * @return ページのサイズ [bytes]
+ */
+std::size_t MappedPageSize(const PageMapping& mapping) {
+  if (!mapping.transparent) {
+    return mapping.page_size;
+  }
+
+  // 確保したメモリを含む領域の AnonHugePages を探す．
+  auto addr = reinterpret_cast<std::uintptr_t>(mapping.addr);
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool in_mapping = false;
+  while (std::getline(smaps, line)) {
+    std::size_t dash = line.find('-');
+    std::size_t space = line.find(' ');
+    if (dash != std::string::npos && space != std::string::npos && dash < space
+        && line.find(':') > space) {
+      std::uintptr_t begin = std::strtoull(line.c_str(), nullptr, 16);
+      std::uintptr_t end = std::strtoull(line.c_str() + dash + 1, nullptr, 16);
+      in_mapping = (begin <= addr && addr < end);
+    }
+    else if (in_mapping && line.rfind("AnonHugePages:", 0) == 0) {
+      std::size_t kb = std::strtoull(line.c_str() + 14, nullptr, 10);
+      return kb > 0 ? k2MBPageSize : mapping.page_size;
+    }
+  }
+  return mapping.page_size;
+}
+
+/**
+ * 通常のページサイズを返す．
+ *
+ * @return ページのサイズ [bytes]
+ */
+std::size_t BasePageSize() {
+  static const std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+  return page_size;
+}
+
+/**
+ * メモリを0で埋める．
+ *
+ * @param[in,out] data 先頭
+ * @param[in] size サイズ [bytes]
+ * @param[in] num_threads memset に使うスレッド数
+ */
+void ZeroPages(void* data, std::size_t size, std::size_t num_threads) {
+  ParallelForRange(static_cast<char*>(data), size, num_threads,
+    [](char* first, std::size_t length) {
+      std::memset(first, 0, length);
+    });
+}
+
+/**
+ * MapPages() で確保したメモリを0で埋める．
+ *
+ * @param[in,out] data 先頭
+ * @param[in] size サイズ [bytes]
+ * @param[in] page_size 確保したメモリのページのサイズ [bytes]
+ * @param[in] num_threads memset に使うスレッド数
+ */
+void ZeroMappedPages(void* data, std::size_t size, std::size_t page_size,
+    std::size_t num_threads) {
+  auto* begin = static_cast<char*>(data);
+  if (size >= kLazyZeroThreshold) {
+    // ページ境界の内側のみを返却する．MAP_HUGETLB の場合，カーネルは半端な終端を
+    // 失敗とせずに huge page の境界へ切り下げるため，ページ全体のみを渡す．
+    auto address = reinterpret_cast<std::uintptr_t>(begin);
+    std::size_t head = RoundUp(address, page_size) - address;
+    std::size_t length = head < size ? (size - head) & ~(page_size - 1) : 0;
+    if (length > 0 && ::madvise(begin + head, length, MADV_DONTNEED) == 0) {
+      ZeroPages(begin, head, num_threads);
+      ZeroPages(begin + head + length, size - head - length, num_threads);
+      return;
+    }
+  }
+  ZeroPages(data, size, num_threads);
+}
+
+/**
+ * 匿名メモリのページを書き込み可能な状態で割り当てさせる．
+ *
+ * @param[in,out] data 先頭
+ * @param[in] size サイズ [bytes]
+ * @param[in] num_threads スレッド数
+ */
+void PrefaultPages(void* data, std::size_t size, std::size_t num_threads) {
+  std::size_t page_size = BasePageSize();
+  ParallelForRange(static_cast<char*>(data), size, num_threads,
+      [page_size](char* first, std::size_t length) {
+    auto address = reinterpret_cast<std::uintptr_t>(first);
+    std::uintptr_t page_begin = address & ~(page_size - 1);
+#ifdef MADV_POPULATE_WRITE
+    if (::madvise(reinterpret_cast<void*>(page_begin),
+        address + length - page_begin, MADV_POPULATE_WRITE) == 0) {
+      return;
+    }
+#endif
+    // 各ページの1バイトを読んで書き戻す．
+    for (std::uintptr_t page = page_begin; page < address + length; page += page_size) {
+      auto* p = reinterpret_cast<volatile char*>(std::max(page, address));
+      *p = *p;
+    }
+  });
+}
+
+} // namespace sbf
@@ -0,0 +1,1191 @@
+/**
+ * @file serialization.cc
+ * @brief Bloom filter のファイル入出力用の関数を定義するソースファイル．
+ */
+
+#include "simplebf/serialization.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+namespace {
+
+/** マジックナンバー． */
+constexpr char kFilterMagic[8] = {'S', 'B', 'F', 'I', 'L', 'T', 'E', 'R'};
+
+/** ファイルを一度に読み書きする64ビット単位の要素数． */
+constexpr std::size_t kChunkWords = 8192;
+
+/**
+ * 値をリトルエンディアンでバッファに格納する．
+ *
+ * @param[in] value 値
+ * @param[in] size 値のサイズ [bytes]
+ * @param[out] buffer 格納先
+ */
+void StoreLittleEndian(std::uint64_t value, std::size_t size, char* buffer) {
+  for (std::size_t i = 0; i < size; i++) {
+    buffer[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+/**
+ * リトルエンディアンで格納された値を返す．
+ *
+ * @param[in] buffer 格納先
+ * @param[in] size 値のサイズ [bytes]
+ * @return 値
+ */
+std::uint64_t LoadLittleEndian(const char* buffer, std::size_t size) {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(buffer[i])) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * 64ビット値のバイト順をリトルエンディアンとホストの間で変換する．
+ *
+ * @param[in,out] words 値の配列
+ * @param[in] num_words 値の個数
+ */
+void SwapToLittleEndian(std::uint64_t* words, std::size_t num_words) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  for (std::size_t i = 0; i < num_words; i++) {
+    words[i] = __builtin_bswap64(words[i]);
+  }
+#else
+  static_cast<void>(words);
+  static_cast<void>(num_words);
+#endif
+}
+
+/** 圧縮したフィルタ用配列の符号列の前に置く情報のサイズ [bytes]． */
+constexpr std::size_t kCompressedPreambleSize = 24;
+
+/** 符号列を一度に読み書きするサイズ [bytes]． */
+constexpr std::size_t kStreamBufferSize = 1 << 16;
+
+/**
+ * フィルタ用配列の立っているビット数を返す．
+ *
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 立っているビット数
+ */
+std::uint64_t CountSetBits(const std::uint64_t* words, std::size_t num_words) {
+  std::uint64_t num_set_bits = 0;
+  for (std::size_t i = 0; i < num_words; i++) {
+    num_set_bits += __builtin_popcountll(words[i]);
+  }
+  return num_set_bits;
+}
+
+/**
+ * フィルタ用配列の立っているビットの間隔を昇順に処理する．
+ *
+ * @tparam Function 間隔を受け取る関数の型
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @param[in] function 間隔を受け取る関数
+ */
+template <class Function>
+void ForEachGap(const std::uint64_t* words, std::size_t num_words,
+    Function function) {
+  std::uint64_t next = 0;
+  for (std::size_t i = 0; i < num_words; i++) {
+    for (std::uint64_t word = words[i]; word != 0; word &= word - 1) {
+      std::uint64_t position = i * 64 + __builtin_ctzll(word);
+      function(position - next);
+      next = position + 1;
+    }
+  }
+}
+
+/**
+ * 立っているビットの間隔を符号化する Rice 符号のパラメータと符号列のビット数を返す．
+ *
+ * 間隔を幾何分布とみなしたときの最適な Golomb 符号の除数 M に対し，
+ * 2^r <= M < 2^(r+1) となる r と r+1 のうち符号列が短くなるほうを選ぶ．<br>
+ * 参考：R. Gallager and D. van Voorhis, "Optimal source codes for geometrically
+ * distributed integer alphabets", IEEE Trans. Inf. Theory, 1975.
+ *
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @param[out] num_code_bits 符号列のビット数
+ * @return Rice 符号のパラメータ
+ */
+std::uint64_t ChooseRiceParameter(const std::uint64_t* words, std::size_t num_words,
+    std::uint64_t& num_code_bits) {
+  std::uint64_t num_set_bits = CountSetBits(words, num_words);
+  double p = static_cast<double>(num_set_bits) / (64 * static_cast<double>(num_words));
+  std::uint64_t parameter = 0;
+  if (p > 0 && p < 1) {
+    double divisor = std::log(2 - p) / -std::log(1 - p);
+    parameter = divisor < 2 ? 0 : static_cast<std::uint64_t>(std::log2(divisor));
+  }
+
+  std::uint64_t num_quotient_bits[2] = {0, 0};
+  ForEachGap(words, num_words, [&](std::uint64_t gap) {
+    num_quotient_bits[0] += gap >> parameter;
+    num_quotient_bits[1] += gap >> (parameter + 1);
+  });
+  std::uint64_t num_bits0 = num_quotient_bits[0] + num_set_bits * (1 + parameter);
+  std::uint64_t num_bits1 = num_quotient_bits[1] + num_set_bits * (2 + parameter);
+  num_code_bits = std::min(num_bits0, num_bits1);
+  return num_bits0 <= num_bits1 ? parameter : parameter + 1;
+}
+
+/**
+ * @brief ビット列を各バイトの下位ビットから詰めて書き出すクラス．
+ */
+class BitWriter {
+public:
+  /**
+   * 出力ストリームを与えて初期化する．
+   *
+   * @param[in,out] out 出力ストリーム
+   */
+  explicit BitWriter(std::ostream& out) : out_(out), accumulator_(0), num_bits_(0) {
+    buffer_.reserve(kStreamBufferSize);
+  }
+
+  /**
+   * 値の下位 n ビットを書き出す．
+   *
+   * @param[in] value 値
+   * @param[in] n ビット数 (32以下)
+   */
+  void Write(std::uint64_t value, std::size_t n) {
+    accumulator_ |= (value & ((std::uint64_t{1} << n) - 1)) << num_bits_;
+    num_bits_ += n;
+    while (num_bits_ >= 8) {
+      buffer_.push_back(static_cast<char>(accumulator_ & 0xff));
+      accumulator_ >>= 8;
+      num_bits_ -= 8;
+    }
+    if (buffer_.size() >= kStreamBufferSize) {
+      FlushBuffer();
+    }
+  }
+
+  /**
+   * 間隔を Rice 符号で書き出す．
+   *
+   * @param[in] gap 間隔
+   * @param[in] parameter Rice 符号のパラメータ
+   */
+  void WriteRice(std::uint64_t gap, std::uint64_t parameter) {
+    for (std::uint64_t q = gap >> parameter; ; q -= 32) {
+      if (q < 32) {
+        Write(std::uint64_t{1} << q, q + 1);
+        break;
+      }
+      Write(0, 32);
+    }
+    for (std::uint64_t shift = 0; shift < parameter; shift += 32) {
+      Write(gap >> shift, std::min<std::uint64_t>(32, parameter - shift));
+    }
+  }
+
+  /**
+   * 残りのビットを書き出す．
+   *
+   * @return 書き出せた場合は true
+   */
+  bool Finish() {
+    if (num_bits_ > 0) {
+      buffer_.push_back(static_cast<char>(accumulator_ & 0xff));
+      accumulator_ = 0;
+      num_bits_ = 0;
+    }
+    FlushBuffer();
+    return static_cast<bool>(out_);
+  }
+
+private:
+  /** バッファの内容を出力ストリームに書き出す． */
+  void FlushBuffer() {
+    out_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+
+  /** 出力ストリーム． */
+  std::ostream& out_;
+
+  /** 書き出し待ちのバイト列． */
+  std::vector<char> buffer_;
+
+  /** バイトに満たないビット列． */
+  std::uint64_t accumulator_;
+
+  /** accumulator_ の有効なビット数． */
+  std::size_t num_bits_;
+};
+
+/**
+ * @brief 各バイトの下位ビットから詰められたビット列を読み込むクラス．
+ */
+class BitReader {
+public:
+  /**
+   * 入力ストリームとビット列のサイズを与えて初期化する．
+   *
+   * @param[in,out] in 入力ストリーム
+   * @param[in] num_bytes ビット列のサイズ [bytes]
+   */
+  BitReader(std::istream& in, std::uint64_t num_bytes) : in_(in),
+      remaining_bytes_(num_bytes), position_(0), accumulator_(0), num_bits_(0) {
+  }
+
+  /**
+   * 読み込むビット列のサイズを設定し直す．
+   *
+   * @param[in] num_bytes ビット列のサイズ [bytes]
+   */
+  void Reset(std::uint64_t num_bytes) {
+    remaining_bytes_ = num_bytes;
+    buffer_.clear();
+    position_ = 0;
+    accumulator_ = 0;
+    num_bits_ = 0;
+  }
+
+  /**
+   * 1が現れるまでの0の個数を読み込む．
+   *
+   * @param[out] count 0の個数
+   * @return 読み込めた場合は true
+   */
+  bool ReadUnary(std::uint64_t& count) {
+    count = 0;
+    while (true) {
+      if (accumulator_ != 0) {
+        std::size_t n = __builtin_ctzll(accumulator_);
+        count += n;
+        Consume(n + 1);
+        return true;
+      }
+      count += num_bits_;
+      num_bits_ = 0;
+      if (!Refill()) {
+        return false;
+      }
+    }
+  }
+
+  /**
+   * n ビットの値を読み込む．
+   *
+   * @param[in] n ビット数 (32以下)
+   * @param[out] value 値
+   * @return 読み込めた場合は true
+   */
+  bool Read(std::size_t n, std::uint64_t& value) {
+    if (num_bits_ < n && (!Refill() || num_bits_ < n)) {
+      return false;
+    }
+    value = accumulator_ & ((std::uint64_t{1} << n) - 1);
+    Consume(n);
+    return true;
+  }
+
+  /**
+   * Rice 符号で表された間隔を読み込む．
+   *
+   * @param[in] parameter Rice 符号のパラメータ
+   * @param[out] gap 間隔
+   * @return 読み込めた場合は true
+   */
+  bool ReadRice(std::uint64_t parameter, std::uint64_t& gap) {
+    std::uint64_t q;
+    if (!ReadUnary(q)) {
+      return false;
+    }
+    gap = q << parameter;
+    for (std::uint64_t shift = 0; shift < parameter; shift += 32) {
+      std::uint64_t value;
+      if (!Read(std::min<std::uint64_t>(32, parameter - shift), value)) {
+        return false;
+      }
+      gap |= value << shift;
+    }
+    return true;
+  }
+
+private:
+  /**
+   * 有効なビット数が57以上となるまで，または入力の終わりまでバイトを補充する．
+   *
+   * @return 有効なビットが1個以上ある場合は true
+   */
+  bool Refill() {
+    // 8バイト以上残っていれば，収まるだけのバイトをまとめて補充する．
+    if (num_bits_ <= 56 && buffer_.size() - position_ >= 8) {
+      std::uint64_t chunk;
+      std::memcpy(&chunk, buffer_.data() + position_, sizeof(chunk));
+      SwapToLittleEndian(&chunk, 1);
+      std::size_t num_bytes = (64 - num_bits_) / 8;
+      if (num_bytes < 8) {
+        chunk &= (std::uint64_t{1} << (8 * num_bytes)) - 1;
+      }
+      accumulator_ |= chunk << num_bits_;
+      num_bits_ += 8 * num_bytes;
+      position_ += num_bytes;
+      return true;
+    }
+    while (num_bits_ <= 56) {
+      if (position_ == buffer_.size()) {
+        if (remaining_bytes_ == 0) {
+          break;
+        }
+        buffer_.resize(std::min<std::uint64_t>(kStreamBufferSize, remaining_bytes_));
+        if (!in_.read(buffer_.data(), buffer_.size())) {
+          buffer_.clear();
+          remaining_bytes_ = 0;
+          break;
+        }
+        remaining_bytes_ -= buffer_.size();
+        position_ = 0;
+      }
+      accumulator_ |= static_cast<std::uint64_t>(
+        static_cast<unsigned char>(buffer_[position_++])) << num_bits_;
+      num_bits_ += 8;
+    }
+    return num_bits_ > 0;
+  }
+
+  /**
+   * 有効なビットを n ビット読み捨てる．
+   *
+   * @param[in] n ビット数
+   */
+  void Consume(std::size_t n) {
+    accumulator_ = (n >= 64) ? 0 : (accumulator_ >> n);
+    num_bits_ -= n;
+  }
+
+  /** 入力ストリーム． */
+  std::istream& in_;
+
+  /** 入力ストリームに残っているビット列のサイズ [bytes]． */
+  std::uint64_t remaining_bytes_;
+
+  /** 読み込んだバイト列． */
+  std::vector<char> buffer_;
+
+  /** buffer_ の次に読むバイトの位置． */
+  std::size_t position_;
+
+  /** 読み込み済みで未処理のビット列． */
+  std::uint64_t accumulator_;
+
+  /** accumulator_ の有効なビット数． */
+  std::size_t num_bits_;
+};
+
+/**
+ * @brief フィルタ用配列を先頭から一定サイズずつ読み込むクラス．
+ *
+ * 圧縮されていない配列と圧縮された配列の両方を扱う．
+ */
+class FilterWordReader {
+public:
+  /**
+   * 入力ストリームを与えて初期化する．
+   *
+   * @param[in,out] in ヘッダを読み込んだ後の入力ストリーム
+   * @param[in] compressed 圧縮されている場合は true
+   * @param[in] num_bits フィルタ用配列のビット数
+   */
+  FilterWordReader(std::istream& in, bool compressed, std::uint64_t num_bits)
+    : in_(in), compressed_(compressed), num_bits_(num_bits), parameter_(0),
+      num_set_bits_(0), num_decoded_(0), next_(0), pending_(0),
+      has_pending_(false), base_(0), reader_(in, 0) {
+  }
+
+  /**
+   * 圧縮されている場合は符号列の前の情報を読み込む．
+   *
+   * @return 読み込めた場合は true
+   */
+  bool Open() {
+    if (!compressed_) {
+      return true;
+    }
+    char buffer[kCompressedPreambleSize];
+    if (!in_.read(buffer, sizeof(buffer))) {
+      return false;
+    }
+    parameter_ = LoadLittleEndian(buffer, 8);
+    num_set_bits_ = LoadLittleEndian(buffer + 8, 8);
+    reader_.Reset(LoadLittleEndian(buffer + 16, 8));
+    return parameter_ < 64 && num_set_bits_ <= num_bits_;
+  }
+
+  /**
+   * 続く n 個の要素を読み込む．
+   *
+   * 圧縮されている場合は，words を0で初期化してから，範囲内の位置を復号してビットを立てる．
+   *
+   * @param[out] words フィルタ用配列
+   * @param[in] n 要素数
+   * @return 読み込めた場合は true
+   */
+  bool Read(std::uint64_t* words, std::size_t n) {
+    if (!compressed_) {
+      return ReadFilterWords(in_, words, n);
+    }
+
+    std::fill(words, words + n, 0);
+    std::uint64_t end = base_ + 64 * static_cast<std::uint64_t>(n);
+    while (num_decoded_ < num_set_bits_) {
+      if (!has_pending_) {
+        std::uint64_t gap;
+        if (!reader_.ReadRice(parameter_, gap)) {
+          return false;
+        }
+        pending_ = next_ + gap;
+        if (pending_ < next_ || pending_ >= num_bits_) {
+          return false;
+        }
+        next_ = pending_ + 1;
+        has_pending_ = true;
+      }
+      if (pending_ >= end) {
+        break;
+      }
+      words[(pending_ - base_) >> 6] |= std::uint64_t{1} << (pending_ & 63);
+      has_pending_ = false;
+      num_decoded_++;
+    }
+    base_ = end;
+    return true;
+  }
+
+  /**
+   * 圧縮されている場合に，格納された立っているビット数を返す．
+   *
+   * @return 立っているビット数
+   */
+  std::uint64_t NumSetBits() const {
+    return num_set_bits_;
+  }
+
+  /**
+   * 圧縮されている場合に，立っているビットをすべて復号したかを返す．
+   *
+   * @return 復号し終えた場合，または圧縮されていない場合は true
+   */
+  bool Finished() const {
+    return !compressed_ || num_decoded_ == num_set_bits_;
+  }
+
+private:
+  /** 入力ストリーム． */
+  std::istream& in_;
+
+  /** 圧縮されている場合は true． */
+  bool compressed_;
+
+  /** フィルタ用配列のビット数． */
+  std::uint64_t num_bits_;
+
+  /** Rice 符号のパラメータ． */
+  std::uint64_t parameter_;
+
+  /** 立っているビット数． */
+  std::uint64_t num_set_bits_;
+
+  /** 復号してビットを立てた個数． */
+  std::uint64_t num_decoded_;
+
+  /** 次の間隔の起点となる位置． */
+  std::uint64_t next_;
+
+  /** 復号済みでまだビットを立てていない位置． */
+  std::uint64_t pending_;
+
+  /** pending_ が有効な場合は true． */
+  bool has_pending_;
+
+  /** 次に読み込む要素の先頭のビット位置． */
+  std::uint64_t base_;
+
+  /** 符号列を読み込むクラス． */
+  BitReader reader_;
+};
+
+/**
+ * ファイルのヘッダをバッファに格納する．
+ *
+ * @param[in] header ヘッダ
+ * @param[out] buffer 格納先 (kFilterHeaderSize [bytes])
+ */
+void EncodeFilterHeader(const FilterHeader& header, char* buffer) {
+  std::memcpy(buffer, kFilterMagic, sizeof(kFilterMagic));
+  StoreLittleEndian(header.version, 4, buffer + 8);
+  StoreLittleEndian(header.flags, 4, buffer + 12);
+  StoreLittleEndian(header.log2_num_bits, 8, buffer + 16);
+  StoreLittleEndian(header.num_hashes, 8, buffer + 24);
+  StoreLittleEndian(header.size, 8, buffer + 32);
+}
+
+/**
+ * バッファに格納されたファイルのヘッダを取り出す．
+ *
+ * @param[in] buffer 格納先 (kFilterHeaderSize [bytes])
+ * @param[out] header ヘッダ
+ * @return 有効なヘッダの場合は true
+ */
+bool DecodeFilterHeader(const char* buffer, FilterHeader& header) {
+  if (std::memcmp(buffer, kFilterMagic, sizeof(kFilterMagic)) != 0) {
+    return false;
+  }
+  header.version = LoadLittleEndian(buffer + 8, 4);
+  header.flags = LoadLittleEndian(buffer + 12, 4);
+  header.log2_num_bits = LoadLittleEndian(buffer + 16, 8);
+  header.num_hashes = LoadLittleEndian(buffer + 24, 8);
+  header.size = LoadLittleEndian(buffer + 32, 8);
+  return header.version == kFilterFormatVersion && header.log2_num_bits < 64
+    && (header.flags & ~kFilterFlagCompressed) == 0;
+}
+
+/**
+ * ファイルの指定された位置にすべて書き出す．
+ *
+ * @param[in] fd ファイル記述子
+ * @param[in] data 書き出すデータ
+ * @param[in] size 書き出すサイズ [bytes]
+ * @param[in] offset ファイル中の位置 [bytes]
+ * @return 書き出せた場合は true
+ */
+bool WriteAt(int fd, const void* data, std::size_t size, std::uint64_t offset) {
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+/**
+ * フィルタ用配列の一部をファイルの対応する位置に書き出す．
+ *
+ * @param[in] fd ファイル記述子
+ * @param[in] words フィルタ用配列
+ * @param[in] begin 書き出す最初の要素の番号
+ * @param[in] end 書き出す最後の要素の次の番号
+ * @return 書き出せた場合は true
+ */
+bool WriteFilterWordsAt(int fd, const std::uint64_t* words, std::size_t begin,
+    std::size_t end) {
+  std::uint64_t offset = kFilterHeaderSize + begin * sizeof(std::uint64_t);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  std::unique_ptr<std::uint64_t[]> chunk(new std::uint64_t[kChunkWords]);
+  for (std::size_t i = begin; i < end; i += kChunkWords) {
+    std::size_t n = std::min(kChunkWords, end - i);
+    std::copy(words + i, words + i + n, chunk.get());
+    SwapToLittleEndian(chunk.get(), n);
+    if (!WriteAt(fd, chunk.get(), n * sizeof(std::uint64_t), offset)) {
+      return false;
+    }
+    offset += n * sizeof(std::uint64_t);
+  }
+  return true;
+#else
+  return WriteAt(fd, words + begin, (end - begin) * sizeof(std::uint64_t), offset);
+#endif
+}
+
+/**
+ * ファイルの内容を永続化する．
+ *
+ * @param[in] path ファイルのパス
+ * @return 永続化できた場合は true
+ */
+bool SyncFile(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool synced = ::fdatasync(fd) == 0;
+  return ::close(fd) == 0 && synced;
+}
+
+/**
+ * ファイルを置き換えるための一意な一時ファイルを同じディレクトリに作成する．
+ *
+ * @param[in] path 置き換えるファイルのパス
+ * @param[out] temporary_path 一時ファイルのパス
+ * @return 一時ファイルのファイル記述子 (作成できなかった場合は -1)
+ */
+int CreateTemporaryFile(const std::string& path, std::string& temporary_path) {
+  std::string name = path + ".XXXXXX";
+  int fd = ::mkostemp(name.data(), O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  // mkostemp() は所有者のみが読み書きできるファイルを作成するため，以前と同じ権限にする．
+  ::fchmod(fd, 0644);
+  temporary_path = name;
+  return fd;
+}
+
+/**
+ * 同期済みの一時ファイルの名前を変更してファイルを置き換える．
+ *
+ * 置き換えを永続化するため，ディレクトリも同期する．<br>
+ * 置き換えられなかった場合は一時ファイルを削除する．
+ *
+ * @param[in] temporary_path 一時ファイルのパス
+ * @param[in] path 置き換えるファイルのパス
+ * @return 置き換えた場合は true
+ */
+bool ReplaceWithTemporaryFile(const std::string& temporary_path, const std::string& path) {
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+  std::size_t slash = path.find_last_of('/');
+  std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+  int directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (directory_fd >= 0) {
+    ::fsync(directory_fd);
+    ::close(directory_fd);
+  }
+  return true;
+}
+
+/**
+ * 複数のフィルタ用配列の論理和を一定サイズずつ求めて書き出す．
+ *
+ * @param[in,out] readers 各フィルタ用配列を読み込むオブジェクト (ヘッダは読み込み済み)
+ * @param[in] num_words フィルタ用配列の要素数
+ * @param[in,out] out 出力ストリーム
+ * @return 書き出せた場合は true
+ */
+bool WriteMergedFilterWords(std::vector<std::unique_ptr<FilterWordReader>>& readers,
+    std::size_t num_words, std::ostream& out) {
+  std::unique_ptr<std::uint64_t[]> accumulated(new std::uint64_t[kChunkWords]);
+  std::unique_ptr<std::uint64_t[]> chunk(new std::uint64_t[kChunkWords]);
+  for (std::size_t offset = 0; offset < num_words; offset += kChunkWords) {
+    std::size_t n = std::min(kChunkWords, num_words - offset);
+    if (!readers[0]->Read(accumulated.get(), n)) {
+      return false;
+    }
+    for (std::size_t i = 1; i < readers.size(); i++) {
+      if (!readers[i]->Read(chunk.get(), n)) {
+        return false;
+      }
+      for (std::size_t j = 0; j < n; j++) {
+        accumulated[j] |= chunk[j];
+      }
+    }
+    if (!WriteFilterWords(out, accumulated.get(), n)) {
+      return false;
+    }
+  }
+  for (auto&& reader : readers) {
+    if (!reader->Finished()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * C++ の識別子として使える文字列かを返す．
+ *
+ * @param[in] name 文字列
+ * @return 識別子として使える場合は true
+ */
+bool IsIdentifier(const std::string& name) {
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+    return false;
+  }
+  return std::all_of(name.begin(), name.end(), [](char c) {
+    return c == '_' || std::isalnum(static_cast<unsigned char>(c));
+  });
+}
+
+/**
+ * "a::b" 形式の名前空間を要素に分割する．
+ *
+ * @param[in] name_space 名前空間
+ * @param[out] names 名前空間の要素
+ * @return 各要素が識別子として使える場合は true
+ */
+bool SplitNamespace(const std::string& name_space, std::vector<std::string>& names) {
+  names.clear();
+  if (name_space.empty()) {
+    return true;
+  }
+  std::size_t begin = 0;
+  while (true) {
+    std::size_t end = name_space.find("::", begin);
+    names.push_back(name_space.substr(begin, end - begin));
+    if (!IsIdentifier(names.back())) {
+      return false;
+    }
+    if (end == std::string::npos) {
+      return true;
+    }
+    begin = end + 2;
+  }
+}
+
+} // namespace
+
+/**
+ * ファイルのヘッダを書き出す．
+ *
+ * @param[in,out] out 出力ストリーム
+ * @param[in] header ヘッダ
+ * @return 書き出せた場合は true
+ */
+bool WriteFilterHeader(std::ostream& out, const FilterHeader& header) {
+  char buffer[kFilterHeaderSize];
+  EncodeFilterHeader(header, buffer);
+  out.write(buffer, sizeof(buffer));
+  return static_cast<bool>(out);
+}
+
+/**
+ * ファイルのヘッダを読み込む．
+ *
+ * @param[in,out] in 入力ストリーム
+ * @param[out] header ヘッダ
+ * @return 読み込めた場合は true
+ */
+bool ReadFilterHeader(std::istream& in, FilterHeader& header) {
+  char buffer[kFilterHeaderSize];
+  return in.read(buffer, sizeof(buffer)) && DecodeFilterHeader(buffer, header);
+}
+
+/**
+ * フィルタ用配列を書き出す．
+ *
+ * @param[in,out] out 出力ストリーム
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 書き出せた場合は true
+ */
+bool WriteFilterWords(std::ostream& out, const std::uint64_t* words,
+    std::size_t num_words) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  std::unique_ptr<std::uint64_t[]> chunk(new std::uint64_t[kChunkWords]);
+  for (std::size_t i = 0; i < num_words; i += kChunkWords) {
+    std::size_t n = std::min(kChunkWords, num_words - i);
+    std::copy(words + i, words + i + n, chunk.get());
+    SwapToLittleEndian(chunk.get(), n);
+    out.write(reinterpret_cast<const char*>(chunk.get()), n * sizeof(std::uint64_t));
+  }
+#else
+  out.write(reinterpret_cast<const char*>(words), num_words * sizeof(std::uint64_t));
+#endif
+  return static_cast<bool>(out);
+}
+
+/**
+ * フィルタ用配列を読み込む．
+ *
+ * @param[in,out] in 入力ストリーム
+ * @param[out] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 読み込めた場合は true
+ */
+bool ReadFilterWords(std::istream& in, std::uint64_t* words,
+    std::size_t num_words) {
+  if (!in.read(reinterpret_cast<char*>(words), num_words * sizeof(std::uint64_t))) {
+    return false;
+  }
+  SwapToLittleEndian(words, num_words);
+  return true;
+}
+
+/**
+ * フィルタ用配列を圧縮して書き出した場合のサイズを返す．
+ *
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 圧縮して書き出した場合のサイズ [bytes]
+ */
+std::size_t CompressedFilterSize(const std::uint64_t* words, std::size_t num_words) {
+  std::uint64_t num_code_bits = 0;
+  ChooseRiceParameter(words, num_words, num_code_bits);
+  return kCompressedPreambleSize + (num_code_bits + 7) / 8;
+}
+
+/**
+ * フィルタ用配列を Rice 符号で圧縮して書き出す．
+ *
+ * @param[in,out] out 出力ストリーム
+ * @param[in] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 書き出せた場合は true
+ */
+bool WriteCompressedFilterWords(std::ostream& out, const std::uint64_t* words,
+    std::size_t num_words) {
+  std::uint64_t num_set_bits = CountSetBits(words, num_words);
+  std::uint64_t num_code_bits = 0;
+  std::uint64_t parameter = ChooseRiceParameter(words, num_words, num_code_bits);
+  std::uint64_t num_bytes = (num_code_bits + 7) / 8;
+
+  char buffer[kCompressedPreambleSize];
+  StoreLittleEndian(parameter, 8, buffer);
+  StoreLittleEndian(num_set_bits, 8, buffer + 8);
+  StoreLittleEndian(num_bytes, 8, buffer + 16);
+  out.write(buffer, sizeof(buffer));
+
+  BitWriter writer(out);
+  ForEachGap(words, num_words, [&](std::uint64_t gap) {
+    writer.WriteRice(gap, parameter);
+  });
+  return writer.Finish();
+}
+
+/**
+ * Rice 符号で圧縮されたフィルタ用配列を読み込む．
+ *
+ * @param[in,out] in 入力ストリーム
+ * @param[out] words フィルタ用配列
+ * @param[in] num_words フィルタ用配列の要素数
+ * @return 読み込めた場合は true
+ */
+bool ReadCompressedFilterWords(std::istream& in, std::uint64_t* words,
+    std::size_t num_words) {
+  FilterWordReader reader(in, true, 64 * static_cast<std::uint64_t>(num_words));
+  return reader.Open() && reader.Read(words, num_words) && reader.Finished();
+}
+
+/**
+ * 複数のファイルのフィルタの論理和をとったファイルを作成する．
+ *
+ * @param[in] input_paths 入力ファイルのパス
+ * @param[in] output_path 出力ファイルのパス
+ * @return 作成できた場合は true
+ */
+bool MergeFilterFiles(const std::vector<std::string>& input_paths,
+    const std::string& output_path) {
+  if (input_paths.empty()) {
+    return false;
+  }
+
+  // 全ファイルのヘッダを読み込んでパラメータが一致するかを確認する．
+  std::vector<std::unique_ptr<std::ifstream>> inputs;
+  std::vector<std::unique_ptr<FilterWordReader>> readers;
+  FilterHeader merged;
+  for (std::size_t i = 0; i < input_paths.size(); i++) {
+    inputs.emplace_back(new std::ifstream(input_paths[i], std::ios::binary));
+    FilterHeader header;
+    if (!ReadFilterHeader(*inputs.back(), header)) {
+      return false;
+    }
+    readers.emplace_back(new FilterWordReader(*inputs.back(),
+      (header.flags & kFilterFlagCompressed) != 0,
+      std::uint64_t{1} << header.log2_num_bits));
+    if (!readers.back()->Open()) {
+      return false;
+    }
+    if (i == 0) {
+      merged = header;
+      merged.flags = 0;
+      continue;
+    }
+    if (header.log2_num_bits != merged.log2_num_bits
+        || header.num_hashes != merged.num_hashes) {
+      return false;
+    }
+    merged.size += header.size;
+  }
+
+  // 出力ファイルが入力ファイルのいずれかであってもよいように，一時ファイルに書き出してから置き換える．
+  return ReplaceFile(output_path, [&](std::ostream& output) {
+    return WriteFilterHeader(output, merged)
+      && WriteMergedFilterWords(readers, merged.NumWords(), output);
+  });
+}
+
+/**
+ * ストリームに書き出した内容でファイルを作成するか置き換える．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] write 内容を書き出す関数
+ * @return 置き換えた場合は true
+ */
+bool ReplaceFile(const std::string& path, const std::function<bool(std::ostream&)>& write) {
+  std::string temporary_path;
+  int fd = CreateTemporaryFile(path, temporary_path);
+  if (fd < 0) {
+    return false;
+  }
+  ::close(fd);
+  bool written = false;
+  {
+    std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+    written = output && write(output) && output.flush();
+  }
+  if (!written || !SyncFile(temporary_path)) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+  return ReplaceWithTemporaryFile(temporary_path, path);
+}
+
+/**
+ * ファイルを一時ファイルに書き出して置き換える．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] header ヘッダ
+ * @param[in] words フィルタ用配列 (header.NumWords() 個の要素)
+ * @return 置き換えた場合は true
+ */
+bool WriteFilterFile(const std::string& path, const FilterHeader& header,
+    const std::uint64_t* words, FilterFileIdentity* identity) {
+  std::string temporary_path;
+  int fd = CreateTemporaryFile(path, temporary_path);
+  if (fd < 0) {
+    return false;
+  }
+  char buffer[kFilterHeaderSize];
+  EncodeFilterHeader(header, buffer);
+  struct stat status;
+  bool written = WriteAt(fd, buffer, sizeof(buffer), 0)
+    && WriteFilterWordsAt(fd, words, 0, header.NumWords())
+    && ::fdatasync(fd) == 0 && ::fstat(fd, &status) == 0;
+  written = ::close(fd) == 0 && written;
+  if (!written) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+  if (!ReplaceWithTemporaryFile(temporary_path, path)) {
+    return false;
+  }
+  // 名前を変更しても i-node は変わらないため，一時ファイルの情報を返す．
+  if (identity != nullptr) {
+    identity->device = status.st_dev;
+    identity->inode = status.st_ino;
+    identity->size = header.size;
+  }
+  return true;
+}
+
+/**
+ * ファイルのフィルタ用配列のうち指定されたチャンクとヘッダを書き換える．
+ *
+ * @param[in] path ファイルのパス
+ * @param[in] header ヘッダ
+ * @param[in] words フィルタ用配列 (header.NumWords() 個の要素)
+ * @param[in] chunks 書き換えるチャンクの番号 (昇順)
+ * @param[in] chunk_words チャンクの64ビット単位の要素数
+ * @return 書き換えた場合は true
+ */
+bool UpdateFilterFile(const std::string& path, const FilterHeader& header,
+    const std::uint64_t* words, const std::vector<std::size_t>& chunks,
+    std::size_t chunk_words, FilterFileIdentity& identity) {
+  int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  // 前回書き出したファイルのうち，圧縮されておらず，パラメータとサイズが一致するもののみ書き換える．
+  char buffer[kFilterHeaderSize];
+  FilterHeader current;
+  struct stat status;
+  std::size_t num_words = header.NumWords();
+  bool matched = ::pread(fd, buffer, sizeof(buffer), 0) == sizeof(buffer)
+    && DecodeFilterHeader(buffer, current) && current.flags == 0
+    && current.log2_num_bits == header.log2_num_bits
+    && current.num_hashes == header.num_hashes
+    && current.size == identity.size
+    && ::fstat(fd, &status) == 0
+    && static_cast<std::uint64_t>(status.st_dev) == identity.device
+    && static_cast<std::uint64_t>(status.st_ino) == identity.inode
+    && static_cast<std::uint64_t>(status.st_size)
+      == kFilterHeaderSize + num_words * sizeof(std::uint64_t);
+
+  // 隣接するチャンクはまとめて書き出す．
+  bool written = matched;
+  for (std::size_t i = 0; written && i < chunks.size();) {
+    std::size_t j = i + 1;
+    while (j < chunks.size() && chunks[j] == chunks[j - 1] + 1) {
+      j++;
+    }
+    std::size_t begin = chunks[i] * chunk_words;
+    std::size_t end = std::min(num_words, (chunks[j - 1] + 1) * chunk_words);
+    written = WriteFilterWordsAt(fd, words, begin, end);
+    i = j;
+  }
+
+  // フィルタ用配列を永続化してからヘッダを書き換える．
+  EncodeFilterHeader(header, buffer);
+  written = written && ::fdatasync(fd) == 0
+    && WriteAt(fd, buffer, sizeof(buffer), 0) && ::fdatasync(fd) == 0;
+  written = ::close(fd) == 0 && written;
+  if (written) {
+    identity.size = header.size;
+  }
+  return written;
+}
+
+/**
+ * ファイルを識別する情報を返す．
+ *
+ * @param[in] path ファイルのパス
+ * @param[out] identity ファイルを識別する情報
+ * @return ファイルとヘッダを読み込めた場合は true
+ */
+bool ReadFilterFileIdentity(const std::string& path, FilterFileIdentity& identity) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  char buffer[kFilterHeaderSize];
+  FilterHeader header;
+  struct stat status;
+  bool read = ::pread(fd, buffer, sizeof(buffer), 0) == sizeof(buffer)
+    && DecodeFilterHeader(buffer, header) && ::fstat(fd, &status) == 0;
+  ::close(fd);
+  if (!read) {
+    return false;
+  }
+  identity.device = status.st_dev;
+  identity.inode = status.st_ino;
+  identity.size = header.size;
+  return true;
+}
+
+/**
+ * ファイルのヘッダとフィルタ用配列の立っているビット数を返す．
+ *
+ * @param[in] path ファイルのパス
+ * @param[out] header ヘッダ
+ * @param[out] num_set_bits 立っているビット数
+ * @return 読み込めた場合は true
+ */
+bool ReadFilterStats(const std::string& path, FilterHeader& header,
+    std::uint64_t& num_set_bits) {
+  std::ifstream input(path, std::ios::binary);
+  if (!ReadFilterHeader(input, header)) {
+    return false;
+  }
+  if ((header.flags & kFilterFlagCompressed) != 0) {
+    FilterWordReader reader(input, true, std::uint64_t{1} << header.log2_num_bits);
+    if (!reader.Open()) {
+      return false;
+    }
+    num_set_bits = reader.NumSetBits();
+    return true;
+  }
+
+  num_set_bits = 0;
+  std::unique_ptr<std::uint64_t[]> chunk(new std::uint64_t[kChunkWords]);
+  std::size_t num_words = header.NumWords();
+  for (std::size_t offset = 0; offset < num_words; offset += kChunkWords) {
+    std::size_t n = std::min(kChunkWords, num_words - offset);
+    if (!ReadFilterWords(input, chunk.get(), n)) {
+      return false;
+    }
+    for (std::size_t j = 0; j < n; j++) {
+      num_set_bits += __builtin_popcountll(chunk[j]);
+    }
+  }
+  return true;
+}
+
+/**
+ * フィルタ用配列を定数として埋め込む C++ のヘッダファイルを書き出す．
+ *
+ * @param[in,out] out 出力ストリーム
+ * @param[in] header ヘッダ
+ * @param[in] words フィルタ用配列 (header.NumWords() 個の要素)
+ * @param[in] name ビューの変数名 (C++ の識別子)
+ * @param[in] name_space 定義を囲む名前空間 ("a::b" の形式も可)
+ * @param[in] type 要素の型 (BloomFilterView の第1テンプレート引数)
+ * @return 書き出せた場合は true
+ */
+bool WriteFilterSource(std::ostream& out, const FilterHeader& header,
+    const std::uint64_t* words, const std::string& name,
+    const std::string& name_space, const std::string& type) {
+  std::vector<std::string> names;
+  if (!IsIdentifier(name) || !SplitNamespace(name_space, names) || type.empty()) {
+    return false;
+  }
+
+  // インクルードガードは名前空間と変数名から作る．
+  std::string guard = "SIMPLEBF_EMBEDDED_";
+  for (auto&& part : names) {
+    guard += part + "_";
+  }
+  guard += name + "_H_";
+  std::transform(guard.begin(), guard.end(), guard.begin(),
+    [](char c) { return std::toupper(static_cast<unsigned char>(c)); });
+
+  out << "// Generated by simplebf embed. Do not edit.\n";
+  out << "\n";
+  out << "#ifndef " << guard << "\n";
+  out << "#define " << guard << "\n";
+  out << "\n";
+  out << "#include \"simplebf/bloom_filter_view.h\"\n";
+  out << "#include <cstdint>\n";
+  out << "\n";
+  for (auto&& part : names) {
+    out << "namespace " << part << " {\n";
+  }
+  if (!names.empty()) {
+    out << "\n";
+  }
+
+  std::size_t num_words = header.NumWords();
+  out << "alignas(64) inline constexpr std::uint64_t " << name << "Words["
+      << num_words << "] = {\n";
+  std::ios::fmtflags flags = out.flags();
+  for (std::size_t i = 0; i < num_words; i++) {
+    out << ((i % 4 == 0) ? "  " : " ") << "0x" << std::hex << std::setw(16)
+        << std::setfill('0') << words[i] << std::dec << "ull,"
+        << ((i % 4 == 3 || i + 1 == num_words) ? "\n" : "");
+  }
+  out.flags(flags);
+  out << "};\n";
+  out << "\n";
+  out << "inline constexpr sbf::BloomFilterView<" << type << "> " << name << "(\n";
+  out << "  " << name << "Words, " << header.log2_num_bits << ", "
+      << header.num_hashes << ", " << header.size << ");\n";
+
+  if (!names.empty()) {
+    out << "\n";
+  }
+  for (auto it = names.rbegin(); it != names.rend(); ++it) {
+    out << "} // namespace " << *it << "\n";
+  }
+  out << "\n";
+  out << "#endif // #ifndef " << guard << "\n";
+  return static_cast<bool>(out);
+}
+
+} // namespace sbf
@@ -0,0 +1,113 @@
+/**
+ * @file shared_memory.cc
+ * @brief 名前付きの POSIX 共有メモリを扱うクラスを定義するソースファイル．
+ */
+
+#include "simplebf/shared_memory.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Bloom filter のための名前空間．
+ */
+namespace sbf {
+
+/** デフォルトコンストラクタ． */
+SharedMemory::SharedMemory() : data_(nullptr), size_(0), writable_(false) {
+}
+
+/** デストラクタ． */
+SharedMemory::~SharedMemory() {
+  Close();
+}
+
+/**
+ * 共有メモリを新たに作成し，読み書きできるようにマップする．
+ *
+ * @param[in] name 共有メモリの名前
+ * @param[in] size サイズ [bytes]
+ * @return 作成できた場合は true
+ */
+bool SharedMemory::Create(const std::string& name, std::size_t size) {
+  Close();
+  int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  if (::ftruncate(fd, size) != 0) {
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    return false;
+  }
+  if (!Map(fd, size, true)) {
+    ::shm_unlink(name.c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 既存の共有メモリをマップする．
+ *
+ * @param[in] name 共有メモリの名前
+ * @param[in] writable 書き込む場合は true
+ * @return マップできた場合は true
+ */
+bool SharedMemory::Open(const std::string& name, bool writable) {
+  Close();
+  int fd = ::shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  return Map(fd, st.st_size, writable);
+}
+
+/** マップしたメモリを解放する． */
+void SharedMemory::Close() {
+  if (data_ != nullptr) {
+    ::munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  writable_ = false;
+}
+
+/**
+ * 共有メモリを削除する．
+ *
+ * @param[in] name 共有メモリの名前
+ * @return 削除できた場合は true
+ */
+bool SharedMemory::Remove(const std::string& name) {
+  return ::shm_unlink(name.c_str()) == 0;
+}
+
+/**
+ * ファイル記述子の指す共有メモリをマップし，ファイル記述子を閉じる．
+ *
+ * @param[in] fd ファイル記述子
+ * @param[in] size サイズ [bytes]
+ * @param[in] writable 書き込む場合は true
+ * @return マップできた場合は true
+ */
+bool SharedMemory::Map(int fd, std::size_t size, bool writable) {
+  int protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  void* addr = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  data_ = addr;
+  size_ = size;
+  writable_ = writable;
+  return true;
+}
+
+} // namespace sbf
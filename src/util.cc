@@ -4,6 +4,8 @@
  */
 
 #include "simplebf/util.h"
+#include <cmath>
+#include <cstring>
 
 /**
  * @brief Bloom filter のための名前空間．
@@ -15,6 +17,23 @@ namespace sbf {
  */
 namespace hash {
 
+namespace {
+
+/**
+ * splitmix64 の撹拌関数により64ビット値を撹拌する．
+ *
+ * @param[in] x 値
+ * @return 撹拌した値
+ */
+std::uint64_t Mix64(std::uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+} // namespace
+
 /**
  * Daniel J. Bernstein によるハッシュ関数によるハッシュ値を返す．
  *
@@ -23,7 +42,7 @@ namespace hash {
  * @param[in] str 文字列
  * @return ハッシュ値
  */
-std::size_t Djb2(const std::string& str) {
+std::size_t Djb2(std::string_view str) {
   static constexpr std::size_t kHashDjb2 = 5381;
   std::size_t hash = kHashDjb2;
   for (char c : str) {
@@ -33,6 +52,59 @@ std::size_t Djb2(const std::string& str) {
   return hash;
 }
 
+/**
+ * Daniel J. Bernstein によるハッシュ関数によるハッシュ値を返す．
+ *
+ * @param[in] data バイト列の先頭
+ * @param[in] size バイト列のサイズ [bytes]
+ * @return ハッシュ値
+ */
+std::size_t Djb2(const void* data, std::size_t size) {
+  return Djb2(std::string_view(static_cast<const char*>(data), size));
+}
+
+/**
+ * バイト列の64ビットハッシュ値を返す．
+ *
+ * @param[in] data バイト列の先頭
+ * @param[in] size バイト列のサイズ [bytes]
+ * @param[in] seed シード
+ * @return ハッシュ値
+ */
+std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t seed) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  std::uint64_t hash = Mix64(seed ^ size);
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes + i, 8);
+    hash = Mix64(hash ^ word);
+  }
+  if (i < size) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, bytes + i, size - i);
+    hash = Mix64(hash ^ word);
+  }
+  return hash;
+}
+
 } // namespace hash 
 
+/**
+ * 見積もられた偽陽性率を返す．
+ *
+ * @param[in] num_bits Bloom filter の配列のビット数 m
+ * @param[in] num_hashes ハッシュ関数の個数 k
+ * @param[in] num_entries 追加された要素数 n
+ * @return 見積もられた偽陽性率
+ */
+double EstimatedFalsePositiveRate(std::size_t num_bits, std::size_t num_hashes,
+    std::size_t num_entries) {
+  double m = num_bits;
+  double k = num_hashes;
+  double n = num_entries;
+  double ratio = std::exp(k*std::log(1 - std::exp(k*n*std::log(1 - 1.0/m))));
+  return ratio;
+}
+
 } // namespace sbf
@@ -0,0 +1,101 @@
+/**
+ * @file gtest_bit_sliced_index.cc
+ * @brief ビットスライス索引に対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bit_sliced_index.h"
+#include "simplebf/bloom_filter.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * ビットスライス索引のテストケース．
+ */
+class BitSlicedIndexTest : public ::testing::Test {
+};
+
+/**
+ * 各シャードの判定結果が個別の BloomFilter と一致することを確認する．
+ */
+TEST_F(BitSlicedIndexTest, SameAsBloomFilters) {
+  constexpr std::size_t kNumShards = 130;
+  sbf::BitSlicedIndex<std::string> index(kNumShards, 12, 4);
+  std::vector<sbf::BloomFilter<std::string>> filters(kNumShards,
+    sbf::BloomFilter<std::string>(12, 4));
+  EXPECT_FALSE(index.HasParameterError());
+  EXPECT_EQ(3u, index.WordsPerRow());
+
+  for (std::size_t shard = 0; shard < kNumShards; shard++) {
+    for (int i = 0; i < 20; i++) {
+      std::string entry = std::to_string(shard * 1000 + i);
+      index.Insert(shard, entry);
+      filters[shard].Insert(entry);
+    }
+  }
+
+  std::vector<std::uint64_t> candidates;
+  for (int key = 0; key < 200000; key += 997) {
+    std::string entry = std::to_string(key);
+    index.Query(entry, candidates);
+    ASSERT_EQ(index.WordsPerRow(), candidates.size());
+    for (std::size_t shard = 0; shard < kNumShards; shard++) {
+      bool candidate = (candidates[shard / 64] >> (shard % 64)) & 1;
+      EXPECT_EQ(filters[shard].Contains(entry), candidate);
+    }
+  }
+}
+
+/**
+ * 要素を追加したシャードが必ず候補に含まれることを確認する．
+ */
+TEST_F(BitSlicedIndexTest, Candidates) {
+  sbf::BitSlicedIndex<std::string> index(1000, 16, 5);
+  index.Insert(3, std::string("alpha"));
+  index.Insert(999, std::string("alpha"));
+  index.Insert(500, std::string("beta"));
+
+  auto shards = index.Candidates("alpha");
+  EXPECT_EQ((std::vector<std::size_t>{3, 999}), shards);
+
+  std::vector<std::uint64_t> candidates;
+  EXPECT_TRUE(index.Query(std::string_view("beta"), candidates));
+  EXPECT_TRUE(index.Query(sbf::BloomFilter<std::string>::HashKey("beta"), candidates));
+  EXPECT_EQ(1ull << (500 % 64), candidates[500 / 64]);
+  EXPECT_TRUE(index.Candidates("gamma").empty());
+}
+
+/**
+ * BloomFilter の内容をシャードに追加できることを確認する．
+ */
+TEST_F(BitSlicedIndexTest, AddFilter) {
+  sbf::BitSlicedIndex<int> index(70, 10, 3);
+  sbf::BloomFilter<int> bf(10, 3);
+  for (int i = 0; i < 50; i++) {
+    bf.Insert(i);
+  }
+  EXPECT_TRUE(index.AddFilter(65, bf));
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ((std::vector<std::size_t>{65}), index.Candidates(i));
+  }
+
+  // パラメータが異なるフィルタは追加できない
+  EXPECT_FALSE(index.AddFilter(0, sbf::BloomFilter<int>(11, 3)));
+  EXPECT_FALSE(index.AddFilter(0, sbf::BloomFilter<int>(10, 4)));
+}
+
+/**
+ * パラメータが不正の場合にエラーとわかることを確認する．
+ */
+TEST_F(BitSlicedIndexTest, ErrorParameters) {
+  using index_t = sbf::BitSlicedIndex<int>;
+  index_t index(1, 2, 0);
+  EXPECT_TRUE(index.HasParameterError());
+  EXPECT_TRUE((index.ParameterErrorFlags() & index_t::kHasNumHashesError) != 0);
+  EXPECT_EQ(1u, index.NumHashes());
+}
+
+} // namespace
@@ -5,6 +5,12 @@
 
 #include <gtest/gtest.h>
 #include "simplebf/bloom_filter.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/mman.h>
 
 namespace {
 
@@ -334,6 +340,184 @@ TEST_F(BloomFilterTest, OptimalNumHashes) {
   EXPECT_FALSE(bf.HasParameterError());
 }
 
+/**
+ * std::string_view やバイト列で追加・判定した結果が std::string と一致することを確認する．
+ */
+TEST_F(BloomFilterTest, StringView) {
+  using bf_t = sbf::BloomFilter<std::string>;
+  bf_t bf(16, 4);
+  std::string buffer("alpha,beta,gamma");
+  std::string_view view(buffer);
+  bf.Insert(view.substr(0, 5));
+  bf.Insert(buffer.data() + 6, 4);
+  bf.Insert(std::string("gamma"));
+
+  EXPECT_TRUE(bf.Contains(std::string("alpha")));
+  EXPECT_TRUE(bf.Contains(std::string("beta")));
+  EXPECT_TRUE(bf.Contains(view.substr(11)));
+  EXPECT_TRUE(bf.Contains("gamma", 5));
+  EXPECT_EQ(3u, bf.Size());
+
+  std::string entry("delta");
+  EXPECT_EQ(bf.FirstHash(entry), bf.FirstHash(std::string_view(entry)));
+  EXPECT_EQ(bf.SecondHash(entry), bf.SecondHash(std::string_view(entry)));
+}
+
+/**
+ * 計算済みのハッシュ値で配列サイズの異なる複数のフィルタを操作できることを確認する．
+ */
+TEST_F(BloomFilterTest, HashedKey) {
+  using bf_t = sbf::BloomFilter<std::string>;
+  std::vector<bf_t> filters;
+  for (std::size_t log2_num_bits = 6; log2_num_bits <= 20; log2_num_bits += 7) {
+    filters.emplace_back(log2_num_bits, 3);
+  }
+
+  std::string entry("partition-key");
+  sbf::HashedKey key = bf_t::HashKey(entry);
+  EXPECT_EQ(key.first, bf_t::HashKey(std::string_view(entry)).first);
+  EXPECT_EQ(key.second, bf_t::HashKey(std::string_view(entry)).second);
+  for (auto&& bf : filters) {
+    EXPECT_EQ(bf.FirstHash(entry), bf.FirstHash(key));
+    EXPECT_EQ(bf.SecondHash(entry), bf.SecondHash(key));
+
+    bf.Insert(key);
+    EXPECT_TRUE(bf.Contains(entry));
+    EXPECT_TRUE(bf.Contains(key));
+
+    bf_t other(bf.Log2NumBits(), bf.NumHashes());
+    other.Insert(entry);
+    EXPECT_TRUE(std::equal(bf.Data(), bf.Data() + bf.NumWords(), other.Data()));
+  }
+}
+
+/**
+ * 折りたたんだフィルタが小さい配列サイズで構築したフィルタと一致することを確認する．
+ */
+TEST_F(BloomFilterTest, Fold) {
+  using bf_t = sbf::BloomFilter<std::string>;
+  for (std::size_t factor : {1, 2, 4, 256, 1024}) {
+    bf_t large(12, 3);
+    bf_t small(12, 3);
+    small.Fold(factor);
+    for (int i = 0; i < 100; i++) {
+      large.Insert(std::to_string(i));
+      small.Insert(std::to_string(i));
+    }
+    EXPECT_TRUE(large.Fold(factor));
+    EXPECT_EQ(small.NumBits(), large.NumBits());
+    EXPECT_EQ(4096u / factor, large.NumBits());
+    EXPECT_EQ(100u, large.Size());
+    EXPECT_TRUE(std::equal(small.Data(), small.Data() + small.NumWords(), large.Data()));
+    for (int i = 0; i < 100; i++) {
+      EXPECT_TRUE(large.Contains(std::to_string(i)));
+    }
+  }
+}
+
+/**
+ * 折りたたみで偽陽性率の期待値が増加し，不正な縮小率は拒否されることを確認する．
+ */
+TEST_F(BloomFilterTest, FoldFalsePositiveRate) {
+  using bf_t = sbf::BloomFilter<int>;
+  bf_t bf(16, 4);
+  EXPECT_DOUBLE_EQ(0.0, bf.ExpectedFalsePositiveRate());
+  for (int i = 0; i < 1000; i++) {
+    bf.Insert(i);
+  }
+  double before = bf.ExpectedFalsePositiveRate();
+  EXPECT_TRUE(bf.Fold(8));
+  EXPECT_EQ(13u, bf.Log2NumBits());
+  EXPECT_GT(bf.ExpectedFalsePositiveRate(), before);
+
+  EXPECT_FALSE(bf.Fold(0));
+  EXPECT_FALSE(bf.Fold(3));
+  EXPECT_FALSE(bf.Fold(std::size_t{1} << 14));
+  EXPECT_EQ(13u, bf.Log2NumBits());
+}
+
+/**
+ * 削除後のフィルタが配列を確保し直さずに空になり，再び要素を追加できることを確認する．<br>
+ * ページを返却する大きさのフィルタと，複数スレッドで0埋めするフィルタを含む．
+ */
+TEST_F(BloomFilterTest, Clear) {
+  using bf_t = sbf::BloomFilter<int>;
+  for (std::size_t log2_num_bits : {6, 16, 24, 28}) {
+    for (std::size_t num_threads : {1, 4}) {
+      bf_t bf(log2_num_bits, 4);
+      for (int i = 0; i < 1000; i++) {
+        bf.Insert(i);
+      }
+      const std::uint64_t* data = bf.Data();
+      bf.Clear(num_threads);
+      EXPECT_EQ(data, bf.Data());
+      EXPECT_EQ(0u, bf.Size());
+      EXPECT_EQ(log2_num_bits, bf.Log2NumBits());
+      EXPECT_EQ(4u, bf.NumHashes());
+      EXPECT_TRUE(std::all_of(bf.Data(), bf.Data() + bf.NumWords(),
+        [](std::uint64_t word) { return word == 0; }));
+
+      bf.Insert(1);
+      EXPECT_TRUE(bf.Contains(1));
+      EXPECT_EQ(1u, bf.Size());
+    }
+  }
+}
+
+/**
+ * 配列のうち物理メモリに割り当てられているページの個数を返す．
+ *
+ * @param[in] data 配列の先頭
+ * @param[in] size 配列のサイズ [bytes]
+ * @return 割り当てられているページの個数
+ */
+std::size_t ResidentPages(const void* data, std::size_t size) {
+  std::size_t page_size = sbf::BasePageSize();
+  auto address = reinterpret_cast<std::uintptr_t>(data);
+  std::uintptr_t begin = address & ~(page_size - 1);
+  std::vector<unsigned char> residency((address + size - begin + page_size - 1) / page_size);
+  if (::mincore(reinterpret_cast<void*>(begin), address + size - begin, residency.data()) != 0) {
+    return 0;
+  }
+  return std::count_if(residency.begin(), residency.end(),
+    [](unsigned char r) { return (r & 1) != 0; });
+}
+
+/**
+ * 大きなフィルタの構築時に配列のページに触れず，Prefault() で全ページが割り当てられることを確認する．
+ */
+TEST_F(BloomFilterTest, LazyZero) {
+  using bf_t = sbf::BloomFilter<int>;
+  bf_t bf(28, 4);
+  std::size_t size = bf.NumWords() * sizeof(std::uint64_t);
+  std::size_t num_pages = size / sbf::BasePageSize();
+  EXPECT_LT(ResidentPages(bf.Data(), size), num_pages / 16);
+
+  bf.Prefault(4);
+  EXPECT_EQ(num_pages, ResidentPages(bf.Data(), size));
+  EXPECT_TRUE(std::all_of(bf.Data(), bf.Data() + bf.NumWords(),
+    [](std::uint64_t word) { return word == 0; }));
+  bf.Insert(1);
+  EXPECT_TRUE(bf.Contains(1));
+}
+
+/**
+ * 配列を縮めてから広げた場合も，増えた要素が0になることを確認する．
+ */
+TEST_F(BloomFilterTest, ResizeZeroes) {
+  using bf_t = sbf::BloomFilter<int>;
+  for (std::size_t log2_num_bits : {12, 28}) {
+    bf_t bf(log2_num_bits, 4);
+    for (int i = 0; i < 10000; i++) {
+      bf.Insert(i);
+    }
+    bf.SetLog2NumBits(8);
+    bf.SetLog2NumBits(log2_num_bits);
+    EXPECT_TRUE(std::all_of(bf.Data() + 4, bf.Data() + bf.NumWords(),
+      [](std::uint64_t word) { return word == 0; }));
+  }
+}
+
 } // namespace
 
 
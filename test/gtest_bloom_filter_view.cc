@@ -0,0 +1,95 @@
+/**
+ * @file gtest_bloom_filter_view.cc
+ * @brief 読み取り専用の Bloom filter に対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/bloom_filter_view.h"
+#include "simplebf/static_bloom_filter.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace {
+
+/**
+ * コンパイル時に2個の要素を追加したフィルタ用配列を返す．
+ *
+ * @return フィルタ用配列
+ */
+constexpr std::array<std::uint64_t, 16> MakeConstantWords() {
+  sbf::StaticBloomFilter<int, 10, 3> bf;
+  bf.Insert(sbf::HashedKey{1, 2});
+  bf.Insert(sbf::HashedKey{100, 200});
+  std::array<std::uint64_t, 16> words{};
+  for (std::size_t i = 0; i < words.size(); i++) {
+    words[i] = bf.Data()[i];
+  }
+  return words;
+}
+
+/** 定数として埋め込んだフィルタ用配列． */
+constexpr std::array<std::uint64_t, 16> kConstantWords = MakeConstantWords();
+
+/** 定数として埋め込んだフィルタ用配列を参照するビュー． */
+constexpr sbf::BloomFilterView<int> kConstantView(kConstantWords.data(), 10, 3, 2);
+
+/**
+ * 読み取り専用の Bloom filter のテストケース．
+ */
+class BloomFilterViewTest : public ::testing::Test {
+};
+
+/**
+ * BloomFilter の配列を参照したビューの判定結果が一致することを確認する．
+ */
+TEST_F(BloomFilterViewTest, SameAsBloomFilter) {
+  sbf::BloomFilter<std::string> bf(12, 5);
+  for (int i = 0; i < 300; i++) {
+    bf.Insert(std::to_string(i));
+  }
+  sbf::BloomFilterView<std::string> view = bf.View();
+  EXPECT_EQ(bf.Data(), view.Data());
+  EXPECT_EQ(bf.NumBits(), view.NumBits());
+  EXPECT_EQ(bf.NumHashes(), view.NumHashes());
+  EXPECT_EQ(300u, view.Size());
+  EXPECT_EQ(bf.NumWords(), view.NumWords());
+
+  for (int i = 0; i < 1000; i++) {
+    std::string entry = std::to_string(i);
+    EXPECT_EQ(bf.Contains(entry), view.Contains(entry));
+    EXPECT_EQ(bf.Contains(entry), view.Contains(std::string_view(entry)));
+    EXPECT_EQ(bf.Contains(entry), view.Contains(view.HashKey(entry)));
+  }
+}
+
+/**
+ * 64ビット未満の配列サイズでも判定できることを確認する．
+ */
+TEST_F(BloomFilterViewTest, SmallFilter) {
+  sbf::BloomFilter<int> bf(3, 2);
+  bf.Insert(7);
+  sbf::BloomFilterView<int> view(bf.Data(), 3, 2, 1);
+  EXPECT_EQ(1u, view.NumWords());
+  EXPECT_TRUE(view.Contains(7));
+}
+
+/**
+ * 定数の配列を参照するビューをコンパイル時に判定できることを確認する．
+ */
+TEST_F(BloomFilterViewTest, Constexpr) {
+  static_assert(kConstantView.Size() == 2);
+  static_assert(kConstantView.Contains(sbf::HashedKey{1, 2}));
+  static_assert(kConstantView.Contains(sbf::HashedKey{100, 200}));
+
+  sbf::BloomFilter<int> runtime(10, 3);
+  runtime.Insert(sbf::HashedKey{1, 2});
+  runtime.Insert(sbf::HashedKey{100, 200});
+  for (std::uint64_t key = 0; key < 1000; key++) {
+    sbf::HashedKey hashed{key, key * 7};
+    EXPECT_EQ(runtime.Contains(hashed), kConstantView.Contains(hashed));
+  }
+}
+
+} // namespace
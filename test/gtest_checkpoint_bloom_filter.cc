@@ -0,0 +1,262 @@
+/**
+ * @file gtest_checkpoint_bloom_filter.cc
+ * @brief 変更したチャンクのみをファイルに書き出せる Bloom filter 用クラスに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/checkpoint_bloom_filter.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+namespace {
+
+/**
+ * 変更したチャンクのみをファイルに書き出せる Bloom filter 用クラスのテストケース．
+ */
+class CheckpointBloomFilterTest : public ::testing::Test {
+protected:
+  /** テストの前にファイルのパスを決める． */
+  void SetUp() override {
+    path_ = ::testing::TempDir() + "checkpoint_bloom_filter.bin";
+  }
+
+  /** テストの後にファイルを削除する． */
+  void TearDown() override {
+    std::remove(path_.c_str());
+  }
+
+  /**
+   * ファイルの i-node 番号を返す．
+   *
+   * 全体を書き出した場合は一時ファイルで置き換えるため番号が変わり，
+   * 変更したチャンクのみを書き換えた場合は変わらない．
+   *
+   * @param[in] path ファイルのパス
+   * @return i-node 番号
+   */
+  static ino_t Inode(const std::string& path) {
+    struct stat status;
+    return ::stat(path.c_str(), &status) == 0 ? status.st_ino : 0;
+  }
+
+  /**
+   * ファイルを BloomFilter に読み込む．
+   *
+   * @param[in] path ファイルのパス
+   * @param[out] bf 読み込む Bloom filter
+   * @return 読み込めた場合は true
+   */
+  static bool LoadBloomFilter(const std::string& path, sbf::BloomFilter<std::string>& bf) {
+    std::ifstream in(path, std::ios::binary);
+    return bf.Load(in);
+  }
+
+protected:
+  /** テストで書き出すファイルのパス． */
+  std::string path_;
+};
+
+/**
+ * BloomFilter と同じビットが立ち，同じ判定結果となることを確認する．
+ */
+TEST_F(CheckpointBloomFilterTest, SameAsBloomFilter) {
+  for (std::size_t log2_num_bits : {8, 20}) {
+    sbf::CheckpointBloomFilter<std::string> bf(log2_num_bits, 4);
+    sbf::BloomFilter<std::string> expected(log2_num_bits, 4);
+    EXPECT_FALSE(bf.HasParameterError());
+    for (int i = 0; i < 1000; i++) {
+      bf.Insert(std::to_string(i));
+      expected.Insert(std::to_string(i));
+    }
+    for (int i = 0; i < 2000; i++) {
+      EXPECT_EQ(expected.Contains(std::to_string(i)), bf.Contains(std::to_string(i)));
+    }
+    ASSERT_EQ(expected.NumWords(), bf.NumWords());
+    EXPECT_TRUE(std::equal(expected.Data(), expected.Data() + expected.NumWords(), bf.Data()));
+
+    std::stringstream ss;
+    sbf::BloomFilter<std::string> loaded;
+    ASSERT_TRUE(bf.Save(ss));
+    ASSERT_TRUE(loaded.Load(ss));
+    EXPECT_EQ(1000u, loaded.Size());
+  }
+}
+
+/**
+ * 2回目以降の書き出しでは変更したチャンクのみをその場で書き換え，ファイルの内容が一致することを確認する．
+ */
+TEST_F(CheckpointBloomFilterTest, Incremental) {
+  // 64チャンクのフィルタ．
+  sbf::CheckpointBloomFilter<std::string> bf(25, 1);
+  ASSERT_EQ(64u, bf.NumChunks());
+  EXPECT_EQ(0u, bf.NumDirtyChunks());
+  bf.Insert("a");
+  EXPECT_EQ(1u, bf.NumDirtyChunks());
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_EQ(0u, bf.NumDirtyChunks());
+  ino_t inode = Inode(path_);
+
+  for (int i = 0; i < 3; i++) {
+    bf.Insert(std::to_string(i));
+  }
+  EXPECT_LE(bf.NumDirtyChunks(), 3u);
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_EQ(inode, Inode(path_));
+
+  sbf::BloomFilter<std::string> loaded;
+  ASSERT_TRUE(LoadBloomFilter(path_, loaded));
+  EXPECT_EQ(4u, loaded.Size());
+  EXPECT_TRUE(std::equal(bf.Data(), bf.Data() + bf.NumWords(), loaded.Data()));
+
+  // 変更がなくても書き出せる．
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_EQ(inode, Inode(path_));
+}
+
+/**
+ * 別のファイルや置き換えられたファイルには全体を書き出すことを確認する．
+ */
+TEST_F(CheckpointBloomFilterTest, FullWrite) {
+  sbf::CheckpointBloomFilter<std::string> bf(20, 4);
+  bf.Insert("a");
+  ASSERT_TRUE(bf.Checkpoint(path_));
+
+  // 異なるパラメータのフィルタで置き換えられたファイル．
+  sbf::BloomFilter<std::string> other(19, 4);
+  {
+    std::ofstream out(path_, std::ios::binary);
+    ASSERT_TRUE(other.Save(out));
+  }
+  bf.Insert("b");
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  sbf::BloomFilter<std::string> loaded;
+  ASSERT_TRUE(LoadBloomFilter(path_, loaded));
+  EXPECT_EQ(20u, loaded.Log2NumBits());
+  EXPECT_TRUE(loaded.Contains("a"));
+  EXPECT_TRUE(loaded.Contains("b"));
+
+  // 別のパスに書き出した後は，以前のパスにも全体を書き出す．
+  std::string other_path = path_ + ".other";
+  ASSERT_TRUE(bf.Checkpoint(other_path));
+  ino_t inode = Inode(path_);
+  bf.Insert("c");
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_NE(inode, Inode(path_));
+  std::remove(other_path.c_str());
+
+  EXPECT_FALSE(bf.Checkpoint(::testing::TempDir() + "missing/filter.bin"));
+}
+
+/**
+ * 書き出しの間にパラメータの同じファイルで置き換えられた場合や，
+ * 他の内容を書き込まれた場合は全体を書き出すことを確認する．
+ */
+TEST_F(CheckpointBloomFilterTest, ReplacedBetweenCheckpoints) {
+  sbf::CheckpointBloomFilter<std::string> bf(20, 4);
+  bf.Insert("a");
+  ASSERT_TRUE(bf.Checkpoint(path_));
+
+  // パラメータ，サイズと要素数の同じフィルタを書き出したファイルで置き換える．
+  sbf::BloomFilter<std::string> other(20, 4);
+  other.Insert("x");
+  std::string other_path = path_ + ".other";
+  {
+    std::ofstream out(other_path, std::ios::binary);
+    ASSERT_TRUE(other.Save(out));
+  }
+  ASSERT_EQ(0, std::rename(other_path.c_str(), path_.c_str()));
+  ino_t inode = Inode(path_);
+
+  bf.Insert("b");
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_NE(inode, Inode(path_));
+  sbf::BloomFilter<std::string> loaded;
+  ASSERT_TRUE(LoadBloomFilter(path_, loaded));
+  EXPECT_EQ(2u, loaded.Size());
+  EXPECT_TRUE(std::equal(bf.Data(), bf.Data() + bf.NumWords(), loaded.Data()));
+
+  // 同じファイルにパラメータとサイズが同じで要素数の異なるフィルタを書き込む．
+  other.Insert("y");
+  other.Insert("z");
+  {
+    std::ofstream out(path_, std::ios::binary);
+    ASSERT_TRUE(other.Save(out));
+  }
+  inode = Inode(path_);
+  bf.Insert("c");
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_NE(inode, Inode(path_));
+  ASSERT_TRUE(LoadBloomFilter(path_, loaded));
+  EXPECT_EQ(3u, loaded.Size());
+  EXPECT_TRUE(std::equal(bf.Data(), bf.Data() + bf.NumWords(), loaded.Data()));
+
+  // 置き換えられていなければ，再び変更したチャンクのみを書き換える．
+  inode = Inode(path_);
+  bf.Insert("d");
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_EQ(inode, Inode(path_));
+}
+
+/**
+ * 読み込んだファイルに変更したチャンクのみを書き出せることと，読み込めない場合は内容を変えないことを確認する．
+ */
+TEST_F(CheckpointBloomFilterTest, Load) {
+  sbf::BloomFilter<std::string> source(22, 4);
+  source.Insert("a");
+  {
+    std::ofstream out(path_, std::ios::binary);
+    ASSERT_TRUE(source.Save(out));
+  }
+  ino_t inode = Inode(path_);
+
+  sbf::CheckpointBloomFilter<std::string> bf(8, 1);
+  ASSERT_TRUE(bf.Load(path_));
+  EXPECT_EQ(22u, bf.Log2NumBits());
+  EXPECT_EQ(4u, bf.NumHashes());
+  EXPECT_EQ(1u, bf.Size());
+  EXPECT_TRUE(bf.Contains("a"));
+  EXPECT_EQ(0u, bf.NumDirtyChunks());
+
+  bf.Insert("b");
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_EQ(inode, Inode(path_));
+  sbf::BloomFilter<std::string> loaded;
+  ASSERT_TRUE(LoadBloomFilter(path_, loaded));
+  EXPECT_TRUE(loaded.Contains("b"));
+  EXPECT_EQ(2u, loaded.Size());
+
+  EXPECT_FALSE(bf.Load(path_ + ".missing"));
+  EXPECT_EQ(22u, bf.Log2NumBits());
+  EXPECT_TRUE(bf.Contains("b"));
+}
+
+/**
+ * BloomFilter の内容を取り込むと値が変わったチャンクのみを記録することと，パラメータエラーを確認する．
+ */
+TEST_F(CheckpointBloomFilterTest, AddFilter) {
+  sbf::BloomFilter<std::string> source(25, 1);
+  source.Insert("a");
+  sbf::CheckpointBloomFilter<std::string> bf(25, 1);
+  EXPECT_TRUE(bf.AddFilter(source));
+  EXPECT_TRUE(bf.Contains("a"));
+  EXPECT_EQ(1u, bf.NumDirtyChunks());
+  ASSERT_TRUE(bf.Checkpoint(path_));
+  EXPECT_TRUE(bf.AddFilter(source));
+  EXPECT_EQ(0u, bf.NumDirtyChunks());
+
+  sbf::BloomFilter<std::string> other(19, 1);
+  EXPECT_FALSE(bf.AddFilter(other));
+
+  sbf::CheckpointBloomFilter<std::string> error(34, 0);
+  EXPECT_EQ(33u, error.Log2NumBits());
+  EXPECT_EQ(1u, error.NumHashes());
+  EXPECT_EQ(error.kHasLog2NumBitsError | error.kHasNumHashesError,
+    error.ParameterErrorFlags());
+}
+
+} // namespace
@@ -0,0 +1,122 @@
+/**
+ * @file gtest_concurrent_bloom_filter.cc
+ * @brief 複数スレッドから同時に操作できる Bloom filter に対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/concurrent_bloom_filter.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * 複数スレッドから同時に操作できる Bloom filter のテストケース．
+ */
+class ConcurrentBloomFilterTest : public ::testing::Test {
+};
+
+/**
+ * デフォルトコンストラクタで要素の追加・判定・サイズ取得ができることを確認する．
+ */
+TEST_F(ConcurrentBloomFilterTest, NormalDefaultConstructor) {
+  using bf_t = sbf::ConcurrentBloomFilter<std::string>;
+  bf_t bf;
+  bf.Insert(std::string("a"));
+  bf.Insert(std::string("b"));
+  bf.Insert(std::string("c"));
+  EXPECT_TRUE(bf.Contains(std::string("a")));
+  EXPECT_TRUE(bf.Contains(std::string("b")));
+  EXPECT_TRUE(bf.Contains(std::string("c")));
+  EXPECT_FALSE(bf.Contains(std::string("d")));
+  EXPECT_EQ(3, bf.Size());
+}
+
+/**
+ * 64ビット未満の配列サイズでも要素の追加・判定ができることを確認する．
+ */
+TEST_F(ConcurrentBloomFilterTest, SmallFilter) {
+  using bf_t = sbf::ConcurrentBloomFilter<int>;
+  bf_t bf(2, 2);
+  bf.Insert(1);
+  EXPECT_TRUE(bf.Contains(1));
+  EXPECT_EQ(4, bf.NumBits());
+}
+
+/**
+ * BloomFilter と同じハッシュ値となることを確認する．
+ */
+TEST_F(ConcurrentBloomFilterTest, SameHashAsBloomFilter) {
+  sbf::BloomFilter<std::string> bf(16, 7);
+  sbf::ConcurrentBloomFilter<std::string> cbf(16, 7);
+  EXPECT_EQ(bf.Hash("abc"), cbf.Hash("abc"));
+
+  sbf::BloomFilter<double> dbf(16, 7);
+  sbf::ConcurrentBloomFilter<double> dcbf(16, 7);
+  EXPECT_EQ(dbf.Hash(1.5), dcbf.Hash(1.5));
+}
+
+/**
+ * 複数スレッドから同時に追加しても偽陰性が発生しないことを確認する．
+ */
+TEST_F(ConcurrentBloomFilterTest, ConcurrentInsert) {
+  using bf_t = sbf::ConcurrentBloomFilter<int>;
+  constexpr int kNumThreads = 4;
+  constexpr int kNumEntries = 10000;
+  bf_t bf(16, 3);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&bf, t]() {
+      for (int i = t; i < kNumEntries; i += kNumThreads) {
+        bf.Insert(i);
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < kNumEntries; i++) {
+    EXPECT_TRUE(bf.Contains(i));
+  }
+  EXPECT_EQ(kNumEntries, bf.Size());
+}
+
+/**
+ * 配列サイズとハッシュ関数の個数が不正の場合にエラーとわかることを確認する．
+ */
+TEST_F(ConcurrentBloomFilterTest, ErrorParameters) {
+  using bf_t = sbf::ConcurrentBloomFilter<std::string>;
+  bf_t bf(2, 0);
+  EXPECT_TRUE(bf.HasParameterError());
+  EXPECT_TRUE((bf.ParameterErrorFlags() & bf_t::kHasNumHashesError) != 0);
+  EXPECT_TRUE((bf.ParameterErrorFlags() & bf_t::kHasLog2NumBitsError) == 0);
+
+  bf.SetNumHashes(2);
+  EXPECT_FALSE(bf.HasParameterError());
+}
+
+/**
+ * 計算済みのハッシュ値で BloomFilter と同じビットが立つことを確認する．
+ */
+TEST_F(ConcurrentBloomFilterTest, HashedKey) {
+  sbf::ConcurrentBloomFilter<std::string> concurrent(12, 4);
+  sbf::BloomFilter<std::string> bf(12, 4);
+  for (int i = 0; i < 100; i++) {
+    std::string entry = std::to_string(i);
+    concurrent.Insert(sbf::ConcurrentBloomFilter<std::string>::HashKey(entry));
+    bf.Insert(entry);
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(concurrent.Contains(sbf::BloomFilter<std::string>::HashKey(std::to_string(i))));
+  }
+  auto key = sbf::BloomFilter<std::string>::HashKey("abc");
+  EXPECT_EQ(bf.FirstHash(key), concurrent.FirstHash(key));
+  EXPECT_EQ(bf.SecondHash(key), concurrent.SecondHash(key));
+  EXPECT_EQ(100, concurrent.Size());
+}
+
+} // namespace
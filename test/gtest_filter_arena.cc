@@ -0,0 +1,167 @@
+/**
+ * @file gtest_filter_arena.cc
+ * @brief 多数の小さなフィルタ用配列をまとめて確保・解放するアリーナに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/bit_sliced_index.h"
+#include "simplebf/filter_arena.h"
+#include "simplebf/page_allocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+
+namespace {
+
+/**
+ * 多数の小さなフィルタ用配列をまとめて確保・解放するアリーナのテストケース．
+ */
+class FilterArenaTest : public ::testing::Test {
+};
+
+/**
+ * 切り出したメモリが境界に揃い，重ならず，ブロックのサイズを超える要求にも応じることを確認する．
+ */
+TEST_F(FilterArenaTest, Allocate) {
+  sbf::FilterArena arena(4096);
+  EXPECT_EQ(0u, arena.NumBlocks());
+
+  auto* a = static_cast<char*>(arena.Allocate(100));
+  auto* b = static_cast<char*>(arena.Allocate(1));
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(a) % sbf::FilterArena::kAlignment);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(b) % sbf::FilterArena::kAlignment);
+  EXPECT_EQ(a + 128, b);
+  EXPECT_EQ(192u, arena.BytesAllocated());
+  EXPECT_EQ(1u, arena.NumBlocks());
+
+  // 専用のブロックを確保し，元のブロックからの切り出しを続ける．
+  auto* large = static_cast<char*>(arena.Allocate(10000));
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(large) % sbf::FilterArena::kAlignment);
+  EXPECT_EQ(2u, arena.NumBlocks());
+  EXPECT_EQ(b + 64, static_cast<char*>(arena.Allocate(64)));
+
+  // 残りに収まらない場合は新たなブロックを確保する．
+  arena.Allocate(4000);
+  EXPECT_EQ(3u, arena.NumBlocks());
+  EXPECT_EQ(4096u * 2 + 10048u, arena.BytesReserved());
+
+  arena.Reset();
+  EXPECT_EQ(1u, arena.NumBlocks());
+  EXPECT_EQ(0u, arena.BytesAllocated());
+  EXPECT_EQ(a, static_cast<char*>(arena.Allocate(8)));
+
+  arena.Release();
+  EXPECT_EQ(0u, arena.NumBlocks());
+  EXPECT_EQ(0u, arena.BytesReserved());
+}
+
+/**
+ * アリーナに確保したフィルタが通常のフィルタと同じビットを立て，確保が1回のみであることを確認する．
+ */
+TEST_F(FilterArenaTest, ArenaBloomFilter) {
+  sbf::FilterArena arena;
+  sbf::BloomFilter<std::string> expected(12, 4);
+  std::vector<sbf::ArenaBloomFilter<std::string>> filters;
+  for (int f = 0; f < 100; f++) {
+    filters.emplace_back(12, 4, arena);
+  }
+  // 各フィルタは 512 [bytes] をちょうど1回確保する．
+  EXPECT_EQ(100u * 512, arena.BytesAllocated());
+  EXPECT_EQ(1u, arena.NumBlocks());
+
+  for (int i = 0; i < 100; i++) {
+    expected.Insert(std::to_string(i));
+    filters[i].Insert(std::to_string(i));
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(filters[i].Contains(std::to_string(i)));
+    EXPECT_EQ(1u, filters[i].Size());
+  }
+
+  std::vector<std::uint64_t> merged(expected.NumWords(), 0);
+  sbf::BitSlicedIndex<std::string> index(1, 12, 4);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(index.AddFilter(0, filters[i]));
+    for (std::size_t w = 0; w < merged.size(); w++) {
+      merged[w] |= filters[i].Data()[w];
+    }
+  }
+  for (std::size_t w = 0; w < merged.size(); w++) {
+    EXPECT_EQ(expected.Data()[w], merged[w]);
+  }
+  for (int i = 100; i < 1000; i++) {
+    EXPECT_EQ(expected.Contains(std::to_string(i)), !index.Candidates(std::to_string(i)).empty());
+  }
+}
+
+/**
+ * アリーナに確保したフィルタのコピーが同じアリーナに別の配列をもつことを確認する．
+ */
+TEST_F(FilterArenaTest, Copy) {
+  sbf::FilterArena arena;
+  sbf::ArenaBloomFilter<std::string> bf(12, 4, arena);
+  bf.Insert("a");
+  sbf::ArenaBloomFilter<std::string> copied(bf);
+  EXPECT_NE(bf.Data(), copied.Data());
+  EXPECT_EQ(2u * 512, arena.BytesAllocated());
+  EXPECT_TRUE(copied.Contains("a"));
+
+  copied.Insert("b");
+  EXPECT_TRUE(copied.Contains("b"));
+  EXPECT_FALSE(bf.Contains("b"));
+}
+
+/**
+ * 配列のうち物理メモリに割り当てられているページの個数を返す．
+ *
+ * @param[in] data 配列の先頭
+ * @param[in] size 配列のサイズ [bytes]
+ * @return 割り当てられているページの個数
+ */
+std::size_t ResidentPages(const void* data, std::size_t size) {
+  std::size_t page_size = sbf::BasePageSize();
+  auto address = reinterpret_cast<std::uintptr_t>(data);
+  std::uintptr_t begin = address & ~(page_size - 1);
+  std::vector<unsigned char> residency((address + size - begin + page_size - 1) / page_size);
+  if (::mincore(reinterpret_cast<void*>(begin), address + size - begin, residency.data()) != 0) {
+    return 0;
+  }
+  return std::count_if(residency.begin(), residency.end(),
+    [](unsigned char r) { return (r & 1) != 0; });
+}
+
+/**
+ * ページを返却する大きさのフィルタを削除しても，アリーナのページを返却せずに0で埋めることを確認する．
+ */
+TEST_F(FilterArenaTest, ClearLargeFilter) {
+  sbf::FilterArena arena;
+  sbf::ArenaBloomFilter<int> bf(28, 4, arena);
+  sbf::ArenaBloomFilter<int> neighbor(12, 4, arena);
+  std::size_t size = bf.NumWords() * sizeof(std::uint64_t);
+  ASSERT_GE(size, sbf::kLazyZeroThreshold);
+  for (int i = 0; i < 1000; i++) {
+    bf.Insert(i);
+    neighbor.Insert(i);
+  }
+  bf.Prefault(4);
+  std::size_t num_resident = ResidentPages(bf.Data(), size);
+
+  const std::uint64_t* data = bf.Data();
+  bf.Clear(4);
+  EXPECT_EQ(data, bf.Data());
+  EXPECT_EQ(0u, bf.Size());
+  EXPECT_TRUE(std::all_of(bf.Data(), bf.Data() + bf.NumWords(),
+    [](std::uint64_t word) { return word == 0; }));
+  EXPECT_EQ(num_resident, ResidentPages(bf.Data(), size));
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(neighbor.Contains(i));
+  }
+
+  bf.Insert(1);
+  EXPECT_TRUE(bf.Contains(1));
+}
+
+} // namespace
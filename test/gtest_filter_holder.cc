@@ -0,0 +1,284 @@
+/**
+ * @file gtest_filter_holder.cc
+ * @brief 判定を止めずにフィルタを再構築して差し替えるクラスに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/filter_holder.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * 生存しているインスタンス数を数えるフィルタ．
+ */
+class CountingFilter {
+public:
+  /**
+   * 判定結果を与えて初期化する．
+   *
+   * @param[in] value 判定結果
+   * @param[in,out] num_alive 生存しているインスタンス数
+   */
+  CountingFilter(int value, std::atomic<int>& num_alive)
+      : value_(value), num_alive_(num_alive) {
+    num_alive_++;
+  }
+
+  /** デストラクタ． */
+  ~CountingFilter() {
+    num_alive_--;
+  }
+
+  /**
+   * 要素が判定結果に一致するかを返す．
+   *
+   * @param[in] key 要素
+   * @return 一致する場合は true
+   */
+  bool Contains(int key) const {
+    return key == value_;
+  }
+
+private:
+  /** 判定結果． */
+  int value_;
+
+  /** 生存しているインスタンス数． */
+  std::atomic<int>& num_alive_;
+};
+
+/**
+ * 判定を止めずにフィルタを再構築して差し替えるクラスのテストケース．
+ */
+class FilterHolderTest : public ::testing::Test {
+protected:
+  /** テストに使う Bloom filter の型． */
+  using bf_t = sbf::BloomFilter<std::string>;
+
+  /**
+   * 指定された範囲の要素を追加したフィルタを作成する．
+   *
+   * @param[in] begin 最初の要素の番号
+   * @param[in] end 最後の要素の次の番号
+   * @return フィルタ
+   */
+  static std::unique_ptr<bf_t> MakeFilter(int begin, int end) {
+    auto bf = std::make_unique<bf_t>(20, 4);
+    for (int i = begin; i < end; i++) {
+      bf->Insert(std::to_string(i));
+    }
+    return bf;
+  }
+};
+
+/**
+ * 差し替えた後のフィルタで判定することを確認する．
+ */
+TEST_F(FilterHolderTest, Publish) {
+  sbf::FilterHolder<bf_t> holder;
+  EXPECT_FALSE(holder.Contains("0"));
+  EXPECT_EQ(0u, holder.Generation());
+
+  holder.Publish(MakeFilter(0, 100));
+  EXPECT_EQ(1u, holder.Generation());
+  EXPECT_TRUE(holder.Contains("0"));
+  EXPECT_TRUE(holder.Contains(std::string("99")));
+
+  holder.Publish(MakeFilter(100, 200));
+  EXPECT_EQ(2u, holder.Generation());
+  EXPECT_TRUE(holder.Contains("100"));
+  EXPECT_EQ(0u, holder.Reclaim());
+}
+
+/**
+ * 別のスレッドで構築したフィルタに差し替え，構築に失敗した場合は差し替えないことを確認する．
+ */
+TEST_F(FilterHolderTest, Rebuild) {
+  sbf::FilterHolder<bf_t> holder(MakeFilter(0, 100));
+  EXPECT_TRUE(holder.Rebuild([] { return MakeFilter(100, 200); }).get());
+  EXPECT_EQ(2u, holder.Generation());
+  EXPECT_TRUE(holder.Contains("150"));
+
+  EXPECT_FALSE(holder.Rebuild([] { return std::unique_ptr<bf_t>(); }).get());
+  EXPECT_EQ(2u, holder.Generation());
+  EXPECT_TRUE(holder.Contains("150"));
+}
+
+/**
+ * Rebuild() の返り値を破棄しても構築の終了を待たず，構築したフィルタに差し替えることを確認する．
+ */
+TEST_F(FilterHolderTest, DiscardedRebuild) {
+  sbf::FilterHolder<bf_t> holder(MakeFilter(0, 100));
+  std::atomic<bool> released(false);
+  holder.Rebuild([&released] {
+    while (!released.load()) {
+      std::this_thread::yield();
+    }
+    return MakeFilter(100, 200);
+  });
+  EXPECT_EQ(1u, holder.Generation());
+  EXPECT_TRUE(holder.Contains("0"));
+  released.store(true);
+  while (holder.Generation() < 2) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(holder.Contains("150"));
+
+  // 破棄する前に受け付けた再構築は実行される．
+  std::atomic<int> num_alive(0);
+  std::atomic<bool> built(false);
+  {
+    sbf::FilterHolder<CountingFilter> counting;
+    counting.Rebuild([&] {
+      built.store(true);
+      return std::make_unique<CountingFilter>(1, num_alive);
+    });
+  }
+  EXPECT_TRUE(built.load());
+  EXPECT_EQ(0, num_alive.load());
+}
+
+/**
+ * 読んでいるフィルタは差し替えても解放されず，読み終えた後に解放されることを確認する．
+ */
+TEST_F(FilterHolderTest, Reclaim) {
+  std::atomic<int> num_alive(0);
+  {
+    sbf::FilterHolder<CountingFilter> holder(std::make_unique<CountingFilter>(1, num_alive));
+    {
+      sbf::FilterHolder<CountingFilter>::ReadGuard guard(holder);
+      holder.Publish(std::make_unique<CountingFilter>(2, num_alive));
+      EXPECT_EQ(2, num_alive.load());
+      EXPECT_EQ(1u, holder.Reclaim());
+      EXPECT_TRUE(guard->Contains(1));
+      EXPECT_TRUE(holder.Contains(2));
+    }
+    EXPECT_EQ(0u, holder.Reclaim());
+    EXPECT_EQ(1, num_alive.load());
+
+    // Rebuild() は読み終えるのを待たずに終了し，読み終えた後の Reclaim() で解放する．
+    std::atomic<bool> started(false);
+    std::atomic<bool> reading(true);
+    std::thread reader([&] {
+      sbf::FilterHolder<CountingFilter>::ReadGuard guard(holder);
+      started.store(true);
+      while (reading.load()) {
+        EXPECT_TRUE(guard->Contains(2));
+      }
+    });
+    while (!started.load()) {
+      std::this_thread::yield();
+    }
+    EXPECT_TRUE(holder.Rebuild([&] { return std::make_unique<CountingFilter>(3, num_alive); }).get());
+    EXPECT_EQ(3u, holder.Generation());
+    EXPECT_TRUE(holder.Contains(3));
+    EXPECT_EQ(2, num_alive.load());
+    reading.store(false);
+    reader.join();
+    EXPECT_EQ(0u, holder.Reclaim());
+    EXPECT_EQ(1, num_alive.load());
+  }
+  EXPECT_EQ(0, num_alive.load());
+}
+
+/**
+ * 同じスレッドで入れ子に保護しても，それぞれのフィルタが解放されないことを確認する．
+ */
+TEST_F(FilterHolderTest, NestedGuards) {
+  std::atomic<int> num_alive(0);
+  sbf::FilterHolder<CountingFilter> holder(std::make_unique<CountingFilter>(1, num_alive));
+  {
+    sbf::FilterHolder<CountingFilter>::ReadGuard outer(holder);
+    holder.Publish(std::make_unique<CountingFilter>(2, num_alive));
+    {
+      sbf::FilterHolder<CountingFilter>::ReadGuard inner(holder);
+      holder.Publish(std::make_unique<CountingFilter>(3, num_alive));
+      EXPECT_EQ(2u, holder.Reclaim());
+      EXPECT_TRUE(outer->Contains(1));
+      EXPECT_TRUE(inner->Contains(2));
+      EXPECT_TRUE(holder.Contains(3));
+    }
+    EXPECT_EQ(1u, holder.Reclaim());
+    EXPECT_EQ(2, num_alive.load());
+  }
+  EXPECT_EQ(0u, holder.Reclaim());
+  EXPECT_EQ(1, num_alive.load());
+}
+
+/**
+ * 保護したまま待つスレッドが多数あっても判定が待たされず，
+ * 終了したスレッドのハザードレコードを再利用することを確認する．
+ */
+TEST_F(FilterHolderTest, ManyReaders) {
+  constexpr int kNumThreads = 200;
+  std::atomic<int> num_alive(0);
+  sbf::FilterHolder<CountingFilter> holder(std::make_unique<CountingFilter>(1, num_alive));
+  for (int round = 0; round < 2; round++) {
+    std::atomic<int> num_started(0);
+    std::atomic<bool> reading(true);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < kNumThreads; t++) {
+      readers.emplace_back([&] {
+        sbf::FilterHolder<CountingFilter>::ReadGuard guard(holder);
+        num_started++;
+        while (reading.load()) {
+          std::this_thread::yield();
+        }
+        EXPECT_TRUE(guard->Contains(1));
+      });
+    }
+    while (num_started.load() < kNumThreads) {
+      std::this_thread::yield();
+    }
+    EXPECT_TRUE(holder.Contains(1));
+    reading.store(false);
+    for (auto& reader : readers) {
+      reader.join();
+    }
+  }
+  EXPECT_EQ(1, num_alive.load());
+}
+
+/**
+ * 多数のスレッドが判定する間に差し替えを繰り返しても，常にいずれかの世代のフィルタで判定することを確認する．
+ */
+TEST_F(FilterHolderTest, ConcurrentReaders) {
+  std::atomic<int> num_alive(0);
+  sbf::FilterHolder<CountingFilter> holder(std::make_unique<CountingFilter>(0, num_alive));
+  std::atomic<bool> done(false);
+  std::atomic<int> num_errors(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 8; t++) {
+    readers.emplace_back([&] {
+      while (!done.load(std::memory_order_relaxed)) {
+        sbf::FilterHolder<CountingFilter>::ReadGuard guard(holder);
+        bool found = false;
+        for (int value = 0; value <= 100; value++) {
+          found |= guard->Contains(value);
+        }
+        num_errors += !found;
+      }
+    });
+  }
+  for (int value = 1; value <= 100; value++) {
+    ASSERT_TRUE(holder.Rebuild([&num_alive, value] {
+      return std::make_unique<CountingFilter>(value, num_alive);
+    }).get());
+  }
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, num_errors.load());
+  EXPECT_EQ(0u, holder.Reclaim());
+  EXPECT_EQ(1, num_alive.load());
+  EXPECT_TRUE(holder.Contains(100));
+}
+
+} // namespace
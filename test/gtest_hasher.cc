@@ -0,0 +1,164 @@
+/**
+ * @file gtest_hasher.cc
+ * @brief ハッシュ値を計算する方針クラスに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/concurrent_bloom_filter.h"
+#include "simplebf/hasher.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+/**
+ * 16バイトの識別子．
+ */
+struct Uuid {
+  /** 上位64ビット． */
+  std::uint64_t high;
+
+  /** 下位64ビット． */
+  std::uint64_t low;
+};
+
+/**
+ * 2個の整数からなる複合キー．
+ */
+struct CompositeKey {
+  /** 区画番号． */
+  int partition;
+
+  /** 区画内の番号． */
+  int id;
+};
+
+/**
+ * 複合キーのための利用者定義の方針クラス．
+ */
+struct CompositeKeyHasher {
+  /**
+   * double hashing の1個目のハッシュ値を返す．
+   *
+   * @param[in] key ハッシュ値を計算したい要素
+   * @return ハッシュ値
+   */
+  static std::uint64_t First(const CompositeKey& key) {
+    std::uint64_t packed = (static_cast<std::uint64_t>(key.partition) << 32)
+      | static_cast<std::uint32_t>(key.id);
+    return sbf::hash::HashBytes(&packed, sizeof(packed), 1);
+  }
+
+  /**
+   * double hashing の2個目のハッシュ値を返す．
+   *
+   * @param[in] key ハッシュ値を計算したい要素
+   * @return ハッシュ値
+   */
+  static std::uint64_t Second(const CompositeKey& key) {
+    std::uint64_t packed = (static_cast<std::uint64_t>(key.partition) << 32)
+      | static_cast<std::uint32_t>(key.id);
+    return sbf::hash::HashBytes(&packed, sizeof(packed), 2);
+  }
+};
+
+/**
+ * ハッシュ値を計算する方針クラスのテストケース．
+ */
+class HasherTest : public ::testing::Test {
+};
+
+/**
+ * 組み込みの方針クラスが従来と同じハッシュ値を返すことを確認する．
+ */
+TEST_F(HasherTest, BuiltIn) {
+  std::string str("simplebf");
+  EXPECT_EQ(std::hash<std::string>{}(str), sbf::Hasher<std::string>::First(str));
+  EXPECT_EQ(sbf::hash::Djb2(str), sbf::Hasher<std::string>::Second(str));
+  EXPECT_EQ(sbf::Hasher<std::string>::First(str),
+    sbf::Hasher<std::string_view>::First(std::string_view(str)));
+  EXPECT_EQ(std::hash<int>{}(42), sbf::Hasher<int>::First(42));
+  EXPECT_EQ(sbf::hash::Djb2("42"), sbf::Hasher<int>::Second(42));
+}
+
+/**
+ * バイト列のハッシュ値がシードと内容により変わることを確認する．
+ */
+TEST_F(HasherTest, HashBytes) {
+  std::array<std::uint8_t, 16> a{};
+  std::array<std::uint8_t, 16> b{};
+  b[15] = 1;
+  EXPECT_EQ(sbf::hash::HashBytes(a.data(), a.size(), 0),
+    sbf::hash::HashBytes(a.data(), a.size(), 0));
+  EXPECT_NE(sbf::hash::HashBytes(a.data(), a.size(), 0),
+    sbf::hash::HashBytes(b.data(), b.size(), 0));
+  EXPECT_NE(sbf::hash::HashBytes(a.data(), a.size(), 0),
+    sbf::hash::HashBytes(a.data(), a.size(), 1));
+  EXPECT_NE(sbf::hash::HashBytes(a.data(), 15, 0),
+    sbf::hash::HashBytes(a.data(), 16, 0));
+}
+
+/**
+ * ByteHasher により固定長のバイト列を文字列化せずに扱えることを確認する．
+ */
+TEST_F(HasherTest, ByteHasher) {
+  using key_t = std::array<std::uint8_t, 16>;
+  sbf::BloomFilter<key_t, sbf::ByteHasher<key_t>> bf(16, 4);
+  sbf::ConcurrentBloomFilter<Uuid, sbf::ByteHasher<Uuid>> uuids(16, 4);
+  for (std::uint8_t i = 0; i < 100; i++) {
+    key_t key{};
+    key[0] = i;
+    bf.Insert(key);
+    uuids.Insert(Uuid{i, ~static_cast<std::uint64_t>(i)});
+  }
+  for (std::uint8_t i = 0; i < 100; i++) {
+    key_t key{};
+    key[0] = i;
+    EXPECT_TRUE(bf.Contains(key));
+    EXPECT_TRUE(uuids.Contains(Uuid{i, ~static_cast<std::uint64_t>(i)}));
+  }
+  EXPECT_EQ(100u, bf.Size());
+}
+
+/**
+ * 利用者定義の方針クラスで複合キーを扱えることを確認する．
+ */
+TEST_F(HasherTest, CustomPolicy) {
+  sbf::BloomFilter<CompositeKey, CompositeKeyHasher> bf(16, 4);
+  bf.Insert(CompositeKey{1, 2});
+  bf.Insert(CompositeKey{3, 4});
+  EXPECT_TRUE(bf.Contains(CompositeKey{1, 2}));
+  EXPECT_TRUE(bf.Contains(CompositeKey{3, 4}));
+  EXPECT_FALSE(bf.Contains(CompositeKey{2, 1}));
+}
+
+/**
+ * ForEachPosition() が enhanced double hashing の位置を順に与え，false で打ち切ることを確認する．
+ */
+TEST_F(HasherTest, ForEachPosition) {
+  sbf::HashedKey key{0x0123456789abcdefull, 0xfedcba9876543210ull};
+  std::size_t log2_num_bits = 12;
+  std::size_t mask = (std::size_t{1} << log2_num_bits) - 1;
+  std::vector<std::size_t> positions;
+  EXPECT_TRUE(sbf::ForEachPosition(key, log2_num_bits, 7, [&positions](std::size_t position) {
+    positions.push_back(position);
+  }));
+  ASSERT_EQ(7u, positions.size());
+  std::size_t h1 = key.first;
+  std::size_t h2 = (key.second << 1) | 1;
+  for (std::size_t i = 0; i < positions.size(); i++) {
+    EXPECT_EQ((h1 + i * h2 + (i * i * i - i) / 6) & mask, positions[i]);
+  }
+
+  std::size_t num_calls = 0;
+  EXPECT_FALSE(sbf::ForEachPosition(key, log2_num_bits, 7, [&num_calls](std::size_t) {
+    return ++num_calls < 3;
+  }));
+  EXPECT_EQ(3u, num_calls);
+}
+
+} // namespace
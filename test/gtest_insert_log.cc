@@ -0,0 +1,281 @@
+/**
+ * @file gtest_insert_log.cc
+ * @brief 追加した要素のハッシュ値を記録する先行書き込みログに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/insert_log.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * 追加した要素のハッシュ値を記録する先行書き込みログのテストケース．
+ */
+class InsertLogTest : public ::testing::Test {
+protected:
+  /** テストの前にファイルのパスを決める． */
+  void SetUp() override {
+    path_ = ::testing::TempDir() + "insert_log.log";
+    std::remove(path_.c_str());
+  }
+
+  /** テストの後にファイルを削除する． */
+  void TearDown() override {
+    std::remove(path_.c_str());
+  }
+
+  /**
+   * テスト用の記録を返す．
+   *
+   * @param[in] i 記録の番号
+   * @return 記録
+   */
+  static sbf::HashedKey Key(std::uint64_t i) {
+    return sbf::HashedKey{i * 0x9e3779b97f4a7c15ull, ~i};
+  }
+
+  /**
+   * ログの記録をすべて読み込む．
+   *
+   * @param[in] path ファイルのパス
+   * @param[out] base 最初の記録より前に追加された要素数
+   * @param[out] keys 記録
+   * @return 読み込めた場合は true
+   */
+  static bool Replay(const std::string& path, std::uint64_t& base,
+      std::vector<sbf::HashedKey>& keys) {
+    keys.clear();
+    return sbf::ReplayInsertLog(path, base, [&keys](const sbf::HashedKey& key) {
+      keys.push_back(key);
+    });
+  }
+
+protected:
+  /** テストで書き出すファイルのパス． */
+  std::string path_;
+};
+
+/**
+ * 加えた記録が同期されて順に読み込めることを確認する．
+ */
+TEST_F(InsertLogTest, AppendAndReplay) {
+  sbf::InsertLog log(1000);
+  ASSERT_TRUE(log.Open(path_, 5));
+  EXPECT_TRUE(log.IsOpen());
+  EXPECT_EQ(5u, log.Base());
+  for (std::uint64_t i = 0; i < 10000; i++) {
+    log.Append(Key(i));
+  }
+  EXPECT_TRUE(log.Sync());
+  EXPECT_EQ(10000u, log.NumAppended());
+  EXPECT_EQ(10000u, log.NumDurable());
+  log.Append(Key(10000));
+  log.Close();
+  EXPECT_FALSE(log.IsOpen());
+
+  std::uint64_t base = 0;
+  std::vector<sbf::HashedKey> keys;
+  ASSERT_TRUE(Replay(path_, base, keys));
+  EXPECT_EQ(5u, base);
+  ASSERT_EQ(10001u, keys.size());
+  for (std::uint64_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(Key(i).first, keys[i].first);
+    EXPECT_EQ(Key(i).second, keys[i].second);
+  }
+  EXPECT_FALSE(Replay(path_ + ".missing", base, keys));
+}
+
+/**
+ * 不完全なブロックを無視し，開き直すと切り詰めて追記することを確認する．
+ */
+TEST_F(InsertLogTest, TornTail) {
+  {
+    sbf::InsertLog log(10);
+    ASSERT_TRUE(log.Open(path_, 0));
+    for (std::uint64_t i = 0; i < 10; i++) {
+      log.Append(Key(i));
+    }
+    ASSERT_TRUE(log.Sync());
+    for (std::uint64_t i = 10; i < 20; i++) {
+      log.Append(Key(i));
+    }
+  }
+  // 2個目のブロックの途中で停止した状態にする．
+  std::uint64_t complete = sbf::kInsertLogHeaderSize + sbf::kInsertLogBlockHeaderSize
+    + 10 * sbf::kInsertLogRecordSize;
+  ASSERT_EQ(0, ::truncate(path_.c_str(), complete + 20));
+
+  std::uint64_t base = 0;
+  std::vector<sbf::HashedKey> keys;
+  ASSERT_TRUE(Replay(path_, base, keys));
+  EXPECT_EQ(10u, keys.size());
+
+  {
+    sbf::InsertLog log(10);
+    ASSERT_TRUE(log.Open(path_, 100));
+    EXPECT_EQ(0u, log.Base());
+    log.Append(Key(10));
+  }
+  ASSERT_TRUE(Replay(path_, base, keys));
+  ASSERT_EQ(11u, keys.size());
+  EXPECT_EQ(Key(10).first, keys.back().first);
+}
+
+/**
+ * 記録の個数が壊れたブロックは，記録を読み込まずに不完全なブロックとして扱うことを確認する．
+ */
+TEST_F(InsertLogTest, CorruptBlockHeader) {
+  {
+    sbf::InsertLog log(10);
+    ASSERT_TRUE(log.Open(path_, 0));
+    for (std::uint64_t i = 0; i < 10; i++) {
+      log.Append(Key(i));
+    }
+  }
+  // 記録の個数が 2^32 - 1 の壊れたブロックを続ける．
+  {
+    std::ofstream out(path_, std::ios::binary | std::ios::app);
+    char block_header[sbf::kInsertLogBlockHeaderSize] = {
+      '\xff', '\xff', '\xff', '\xff', 0, 0, 0, 0};
+    out.write(block_header, sizeof(block_header));
+    out.write(std::string(100, 'x').data(), 100);
+  }
+
+  std::uint64_t base = 0;
+  std::vector<sbf::HashedKey> keys;
+  ASSERT_TRUE(Replay(path_, base, keys));
+  EXPECT_EQ(10u, keys.size());
+
+  sbf::InsertLog log(10);
+  ASSERT_TRUE(log.Open(path_, 0));
+  log.Append(Key(10));
+  ASSERT_TRUE(log.Sync());
+  log.Close();
+  ASSERT_TRUE(Replay(path_, base, keys));
+  ASSERT_EQ(11u, keys.size());
+  EXPECT_EQ(Key(10).first, keys.back().first);
+}
+
+/**
+ * Reset() で空のログに置き換わり，以降の記録のみを読み込めることを確認する．
+ */
+TEST_F(InsertLogTest, Reset) {
+  sbf::InsertLog log;
+  ASSERT_TRUE(log.Open(path_, 0));
+  for (std::uint64_t i = 0; i < 100; i++) {
+    log.Append(Key(i));
+  }
+  ASSERT_TRUE(log.Reset(100));
+  EXPECT_EQ(100u, log.Base());
+  EXPECT_EQ(100u, log.NumDurable());
+  log.Append(Key(100));
+  ASSERT_TRUE(log.Sync());
+
+  std::uint64_t base = 0;
+  std::vector<sbf::HashedKey> keys;
+  ASSERT_TRUE(Replay(path_, base, keys));
+  EXPECT_EQ(100u, base);
+  ASSERT_EQ(1u, keys.size());
+  EXPECT_EQ(Key(100).second, keys[0].second);
+
+  sbf::InsertLog closed;
+  EXPECT_FALSE(closed.Sync());
+  closed.Append(Key(0));
+  EXPECT_EQ(0u, closed.NumAppended());
+}
+
+/**
+ * 1ブロックに満たない記録も，Sync() を呼び出さずに同期する間隔のうちに永続化されることを確認する．
+ */
+TEST_F(InsertLogTest, FlushInterval) {
+  for (std::size_t max_batch_size : {1000, 1}) {
+    sbf::InsertLog log(max_batch_size, std::chrono::microseconds(1000));
+    ASSERT_TRUE(log.Open(path_, 0));
+    for (std::uint64_t i = 0; i < 10; i++) {
+      log.Append(Key(i));
+    }
+    // 同期する間隔に対して十分に長い時間のうちに永続化されることを確認する．
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (log.NumDurable() < 10 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(10u, log.NumDurable());
+
+    std::uint64_t base = 0;
+    std::vector<sbf::HashedKey> keys;
+    ASSERT_TRUE(Replay(path_, base, keys));
+    EXPECT_EQ(10u, keys.size());
+    log.Close();
+    std::remove(path_.c_str());
+  }
+}
+
+/**
+ * 書き出しに失敗した後は記録を書き出さず，永続化された記録の個数も増えないことを確認する．
+ */
+TEST_F(InsertLogTest, WriteError) {
+  sbf::InsertLog log(1000);
+  ASSERT_TRUE(log.Open(path_, 0));
+  for (std::uint64_t i = 0; i < 100; i++) {
+    log.Append(Key(i));
+  }
+  ASSERT_TRUE(log.Sync());
+  ASSERT_EQ(100u, log.NumDurable());
+
+  // ファイルサイズの上限を設けて，次のブロックを途中までしか書き出せないようにする．
+  struct stat status;
+  ASSERT_EQ(0, ::stat(path_.c_str(), &status));
+  struct rlimit limit;
+  ASSERT_EQ(0, ::getrlimit(RLIMIT_FSIZE, &limit));
+  struct rlimit reduced = limit;
+  reduced.rlim_cur = status.st_size + 1000;
+  auto handler = std::signal(SIGXFSZ, SIG_IGN);
+  ASSERT_EQ(0, ::setrlimit(RLIMIT_FSIZE, &reduced));
+  for (std::uint64_t i = 100; i < 1100; i++) {
+    log.Append(Key(i));
+  }
+  bool synced = log.Sync();
+  ::setrlimit(RLIMIT_FSIZE, &limit);
+  std::signal(SIGXFSZ, handler);
+  EXPECT_FALSE(synced);
+  EXPECT_EQ(100u, log.NumDurable());
+
+  // 上限を戻しても書き出さない．
+  ASSERT_EQ(0, ::stat(path_.c_str(), &status));
+  for (std::uint64_t i = 1100; i < 1200; i++) {
+    log.Append(Key(i));
+  }
+  EXPECT_FALSE(log.Sync());
+  EXPECT_EQ(100u, log.NumDurable());
+  log.Close();
+  struct stat closed_status;
+  ASSERT_EQ(0, ::stat(path_.c_str(), &closed_status));
+  EXPECT_EQ(status.st_size, closed_status.st_size);
+
+  std::uint64_t base = 0;
+  std::vector<sbf::HashedKey> keys;
+  ASSERT_TRUE(Replay(path_, base, keys));
+  ASSERT_EQ(100u, keys.size());
+
+  // 開き直すと，途中まで書き出したブロックを切り詰めて追記を再開する．
+  ASSERT_TRUE(log.Open(path_, 0));
+  log.Append(Key(100));
+  EXPECT_TRUE(log.Sync());
+  log.Close();
+  ASSERT_TRUE(Replay(path_, base, keys));
+  ASSERT_EQ(101u, keys.size());
+  EXPECT_EQ(Key(100).first, keys[100].first);
+  EXPECT_EQ(Key(100).second, keys[100].second);
+}
+
+} // namespace
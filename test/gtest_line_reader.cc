@@ -0,0 +1,122 @@
+/**
+ * @file gtest_line_reader.cc
+ * @brief 改行区切りの要素を読み込むクラスに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/line_reader.h"
+#include <cstdio>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * 改行区切りの要素を読み込むクラスのテストケース．
+ */
+class LineReaderTest : public ::testing::Test {
+protected:
+  /**
+   * 一時ファイルに文字列を書き込んでそのパスを返す．
+   *
+   * @param[in] content 書き込む文字列
+   * @return 一時ファイルのパス
+   */
+  std::string WriteTempFile(const std::string& content) {
+    path_ = ::testing::TempDir() + "gtest_line_reader.txt";
+    std::ofstream ofs(path_, std::ios::binary);
+    ofs << content;
+    return path_;
+  }
+
+  /** 一時ファイルを削除する． */
+  void TearDown() override {
+    if (!path_.empty()) {
+      std::remove(path_.c_str());
+    }
+  }
+
+  /**
+   * 全行を読み込む．
+   *
+   * @param[in,out] reader 読み込み器
+   * @return 読み込んだ行を並べたベクトル
+   */
+  std::vector<std::string> ReadAll(sbf::LineReader& reader) {
+    std::vector<std::string> lines;
+    std::string_view line;
+    while (reader.Next(line)) {
+      lines.emplace_back(line);
+    }
+    return lines;
+  }
+
+  /** 一時ファイルのパス． */
+  std::string path_;
+};
+
+/**
+ * 改行区切りの各行を読み込めることを確認する．
+ */
+TEST_F(LineReaderTest, Normal) {
+  sbf::LineReader reader(WriteTempFile("a\nbb\n\nccc\n"));
+  ASSERT_TRUE(reader.IsOpen());
+  std::vector<std::string> expect = {"a", "bb", "", "ccc"};
+  EXPECT_EQ(expect, ReadAll(reader));
+  EXPECT_FALSE(reader.HasError());
+}
+
+/**
+ * 改行で終わらない最後の行と復帰文字を扱えることを確認する．
+ */
+TEST_F(LineReaderTest, NoTrailingNewline) {
+  sbf::LineReader reader(WriteTempFile("a\r\nb"));
+  std::vector<std::string> expect = {"a", "b"};
+  EXPECT_EQ(expect, ReadAll(reader));
+}
+
+/**
+ * 空のファイルから行が読み込まれないことを確認する．
+ */
+TEST_F(LineReaderTest, Empty) {
+  sbf::LineReader reader(WriteTempFile(""));
+  ASSERT_TRUE(reader.IsOpen());
+  EXPECT_TRUE(ReadAll(reader).empty());
+}
+
+/**
+ * パイプからバッファサイズを超える行を読み込めることを確認する．
+ */
+TEST_F(LineReaderTest, Pipe) {
+  std::string long_line(sbf::LineReader::kBufferSize + 10, 'x');
+  std::string content = "a\n" + long_line + "\nb\n";
+  WriteTempFile(content);
+
+  // 標準入力をパイプに差し替えて読み込む．
+  FILE* pipe = ::popen(("cat " + path_).c_str(), "r");
+  ASSERT_NE(nullptr, pipe);
+  int saved_stdin = ::dup(0);
+  ::dup2(::fileno(pipe), 0);
+  {
+    sbf::LineReader reader("-");
+    std::vector<std::string> expect = {"a", long_line, "b"};
+    EXPECT_EQ(expect, ReadAll(reader));
+  }
+  ::dup2(saved_stdin, 0);
+  ::close(saved_stdin);
+  ::pclose(pipe);
+}
+
+/**
+ * 存在しないファイルを開けないことを確認する．
+ */
+TEST_F(LineReaderTest, NotFound) {
+  sbf::LineReader reader("/nonexistent/gtest_line_reader.txt");
+  EXPECT_FALSE(reader.IsOpen());
+  std::string_view line;
+  EXPECT_FALSE(reader.Next(line));
+}
+
+} // namespace
@@ -0,0 +1,190 @@
+/**
+ * @file gtest_logged_bloom_filter.cc
+ * @brief 追加を先行書き込みログに記録し，停止後に復元できる Bloom filter 用クラスに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/logged_bloom_filter.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+
+/**
+ * 追加を先行書き込みログに記録し，停止後に復元できる Bloom filter 用クラスのテストケース．
+ */
+class LoggedBloomFilterTest : public ::testing::Test {
+protected:
+  /** テストに使う Bloom filter の型． */
+  using bf_t = sbf::LoggedBloomFilter<std::string>;
+
+  /** テストの前にファイルのパスを決める． */
+  void SetUp() override {
+    path_ = ::testing::TempDir() + "logged_bloom_filter.bin";
+    TearDown();
+  }
+
+  /** テストの後にファイルを削除する． */
+  void TearDown() override {
+    std::remove(path_.c_str());
+    std::remove((path_ + ".log").c_str());
+  }
+
+  /**
+   * ファイルを複製する．
+   *
+   * @param[in] from 複製元のパス
+   * @param[in] to 複製先のパス
+   */
+  static void CopyFile(const std::string& from, const std::string& to) {
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary);
+    out << in.rdbuf();
+  }
+
+  /**
+   * 同じ要素を追加した BloomFilter と同じ内容であるかを返す．
+   *
+   * @param[in] bf 復元したフィルタ
+   * @param[in] expected 同じ要素を追加した BloomFilter
+   * @return フィルタ用配列と要素数が一致する場合は true
+   */
+  static bool SameAs(const bf_t& bf, const sbf::BloomFilter<std::string>& expected) {
+    return bf.NumWords() == expected.NumWords() && bf.Size() == expected.Size()
+      && std::equal(expected.Data(), expected.Data() + expected.NumWords(), bf.Data());
+  }
+
+protected:
+  /** スナップショットのパス． */
+  std::string path_;
+};
+
+/**
+ * スナップショットがなくてもログのみから復元できることを確認する．
+ */
+TEST_F(LoggedBloomFilterTest, RecoverFromLog) {
+  sbf::BloomFilter<std::string> expected(20, 4);
+  {
+    bf_t bf(20, 4);
+    ASSERT_TRUE(bf.Open(path_));
+    for (int i = 0; i < 10000; i++) {
+      bf.Insert(std::to_string(i));
+      expected.Insert(std::to_string(i));
+    }
+    ASSERT_TRUE(bf.Sync());
+    EXPECT_EQ(10000u, bf.Log().NumDurable());
+  }
+
+  bf_t recovered(20, 4);
+  ASSERT_TRUE(recovered.Open(path_));
+  EXPECT_TRUE(SameAs(recovered, expected));
+  EXPECT_TRUE(recovered.Contains("0"));
+}
+
+/**
+ * スナップショットとその後のログから復元でき，スナップショットのパラメータを使うことを確認する．
+ */
+TEST_F(LoggedBloomFilterTest, RecoverFromSnapshot) {
+  sbf::BloomFilter<std::string> expected(22, 3);
+  {
+    bf_t bf(22, 3);
+    ASSERT_TRUE(bf.Open(path_));
+    for (int i = 0; i < 1000; i++) {
+      bf.Insert(std::to_string(i));
+      expected.Insert(std::to_string(i));
+    }
+    ASSERT_TRUE(bf.Checkpoint());
+    EXPECT_EQ(1000u, bf.Log().Base());
+    for (int i = 1000; i < 1500; i++) {
+      bf.Insert(std::to_string(i));
+      expected.Insert(std::to_string(i));
+    }
+    ASSERT_TRUE(bf.Sync());
+  }
+
+  bf_t recovered(8, 1);
+  ASSERT_TRUE(recovered.Open(path_));
+  EXPECT_EQ(22u, recovered.Log2NumBits());
+  EXPECT_EQ(3u, recovered.NumHashes());
+  EXPECT_TRUE(SameAs(recovered, expected));
+
+  // 復元した後も続けて記録できる．
+  recovered.Insert("x");
+  expected.Insert("x");
+  ASSERT_TRUE(recovered.Checkpoint());
+  recovered.Insert("y");
+  expected.Insert("y");
+  recovered.Close();
+  bf_t again(8, 1);
+  ASSERT_TRUE(again.Open(path_));
+  EXPECT_TRUE(SameAs(again, expected));
+}
+
+/**
+ * スナップショットを書き出した後，ログを空にする前に停止しても要素を重複して数えないことを確認する．
+ */
+TEST_F(LoggedBloomFilterTest, CrashDuringCheckpoint) {
+  sbf::BloomFilter<std::string> expected(20, 4);
+  std::string saved_log = path_ + ".saved";
+  {
+    bf_t bf(20, 4);
+    ASSERT_TRUE(bf.Open(path_));
+    for (int i = 0; i < 100; i++) {
+      bf.Insert(std::to_string(i));
+      expected.Insert(std::to_string(i));
+    }
+    ASSERT_TRUE(bf.Checkpoint());
+    for (int i = 100; i < 300; i++) {
+      bf.Insert(std::to_string(i));
+      expected.Insert(std::to_string(i));
+    }
+    ASSERT_TRUE(bf.Sync());
+    CopyFile(path_ + ".log", saved_log);
+    ASSERT_TRUE(bf.Checkpoint());
+  }
+  // スナップショットは新しく，ログは空にする前の状態．
+  CopyFile(saved_log, path_ + ".log");
+  std::remove(saved_log.c_str());
+
+  bf_t recovered(20, 4);
+  ASSERT_TRUE(recovered.Open(path_));
+  EXPECT_TRUE(SameAs(recovered, expected));
+  // ログは空にせず，末尾に追記する．
+  EXPECT_EQ(100u, recovered.Log().Base());
+  recovered.Insert("x");
+  expected.Insert("x");
+  recovered.Close();
+  bf_t again(20, 4);
+  ASSERT_TRUE(again.Open(path_));
+  EXPECT_TRUE(SameAs(again, expected));
+}
+
+/**
+ * スナップショットが失われ，ログが途中から始まっている場合は開けないことを確認する．
+ */
+TEST_F(LoggedBloomFilterTest, LostSnapshot) {
+  {
+    bf_t bf(20, 4);
+    ASSERT_TRUE(bf.Open(path_));
+    bf.Insert("a");
+    ASSERT_TRUE(bf.Checkpoint());
+    bf.Insert("b");
+  }
+  std::remove(path_.c_str());
+  bf_t recovered(20, 4);
+  EXPECT_FALSE(recovered.Open(path_));
+
+  bf_t not_opened(20, 4);
+  not_opened.Insert("a");
+  EXPECT_FALSE(not_opened.Checkpoint());
+  EXPECT_FALSE(not_opened.Sync());
+
+  bf_t error(34, 0);
+  EXPECT_EQ(error.kHasLog2NumBitsError | error.kHasNumHashesError,
+    error.ParameterErrorFlags());
+}
+
+} // namespace
@@ -0,0 +1,48 @@
+/**
+ * @file gtest_numa.cc
+ * @brief NUMA ノードの情報を扱う関数に対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/numa.h"
+#include <vector>
+
+namespace {
+
+/**
+ * NUMA ノードの情報を扱う関数のテストケース．
+ */
+class NumaTest : public ::testing::Test {
+};
+
+/**
+ * CPU 番号の一覧を展開できることを確認する．
+ */
+TEST_F(NumaTest, ParseCpuList) {
+  EXPECT_EQ((std::vector<int>{0}), sbf::numa::ParseCpuList("0"));
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}),
+    sbf::numa::ParseCpuList("0-3,8,10-11\n"));
+  EXPECT_TRUE(sbf::numa::ParseCpuList("").empty());
+}
+
+/**
+ * 現在のノードと各ノードの CPU が取得でき，ノードに固定したスレッドで関数を実行できることを確認する．
+ */
+TEST_F(NumaTest, Nodes) {
+  std::size_t num_nodes = sbf::numa::NumNodes();
+  ASSERT_GE(num_nodes, 1u);
+  EXPECT_LT(sbf::numa::CurrentNode(), num_nodes);
+  for (std::size_t node = 0; node < num_nodes; node++) {
+    EXPECT_FALSE(sbf::numa::NodeCpus(node).empty());
+
+    std::size_t current = num_nodes;
+    bool pinned = sbf::numa::RunOnNode(node, [&]() {
+      current = sbf::numa::CurrentNode();
+    });
+    if (pinned) {
+      EXPECT_EQ(node, current);
+    }
+  }
+}
+
+} // namespace
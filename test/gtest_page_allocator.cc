@@ -0,0 +1,144 @@
+/**
+ * @file gtest_page_allocator.cc
+ * @brief フィルタ用配列をページ単位で確保するアロケータに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/page_allocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * フィルタ用配列をページ単位で確保するアロケータのテストケース．
+ */
+class PageAllocatorTest : public ::testing::Test {
+protected:
+  /** 全てのページの種類． */
+  const std::vector<sbf::HugePages> kAllRequests = {
+    sbf::HugePages::kNone, sbf::HugePages::kTransparent,
+    sbf::HugePages::k2MB, sbf::HugePages::k1GB,
+  };
+};
+
+/**
+ * 各ページの種類で0に初期化された配列を確保でき，読み書きできることを確認する．<br>
+ * huge page が利用できない環境では小さいページで確保されることも含む．
+ */
+TEST_F(PageAllocatorTest, Vector) {
+  for (auto request : kAllRequests) {
+    sbf::PageAllocator<std::uint64_t> allocator(request);
+    std::vector<std::uint64_t, sbf::PageAllocator<std::uint64_t>> words(1 << 16, 0, allocator);
+    for (std::size_t i = 0; i < words.size(); i++) {
+      EXPECT_EQ(0u, words[i]);
+      words[i] = i;
+    }
+    for (std::size_t i = 0; i < words.size(); i++) {
+      EXPECT_EQ(i, words[i]);
+    }
+    EXPECT_EQ(request, words.get_allocator().Request());
+    EXPECT_GE(words.get_allocator().PageSize(), sbf::BasePageSize());
+  }
+}
+
+/**
+ * huge page に確保したフィルタが通常のフィルタと同じ判定結果となることを確認する．
+ */
+TEST_F(PageAllocatorTest, SameAsDefault) {
+  sbf::BloomFilter<std::string> expected(16, 4);
+  for (auto request : kAllRequests) {
+    sbf::BloomFilter<std::string> bf(16, 4, request);
+    EXPECT_FALSE(bf.HasParameterError());
+    EXPECT_EQ(request, bf.PageRequest());
+    EXPECT_GE(bf.PageSize(), sbf::BasePageSize());
+    for (int i = 0; i < 1000; i++) {
+      bf.Insert(std::to_string(i));
+      if (request == sbf::HugePages::kNone) {
+        expected.Insert(std::to_string(i));
+      }
+    }
+    for (std::size_t w = 0; w < bf.NumWords(); w++) {
+      ASSERT_EQ(expected.Data()[w], bf.Data()[w]);
+    }
+    for (int i = 1000; i < 2000; i++) {
+      EXPECT_EQ(expected.Contains(std::to_string(i)), bf.Contains(std::to_string(i)));
+    }
+  }
+}
+
+/**
+ * コピーしたフィルタが別の配列をもち，ページの種類を引き継ぐことを確認する．
+ */
+TEST_F(PageAllocatorTest, Copy) {
+  sbf::BloomFilter<std::string> bf(16, 4, sbf::HugePages::kTransparent);
+  bf.Insert("a");
+  sbf::BloomFilter<std::string> copied(bf);
+  EXPECT_NE(bf.Data(), copied.Data());
+  EXPECT_EQ(sbf::HugePages::kTransparent, copied.PageRequest());
+  EXPECT_TRUE(copied.Contains("a"));
+
+  copied.Insert("b");
+  EXPECT_TRUE(copied.Contains("b"));
+  EXPECT_FALSE(bf.Contains("b"));
+
+  sbf::BloomFilter<std::string> moved(std::move(copied));
+  EXPECT_TRUE(moved.Contains("b"));
+  EXPECT_EQ(sbf::HugePages::kTransparent, moved.PageRequest());
+}
+
+/**
+ * 通常のメモリ確保では通常のページサイズを返し，アロケータが互いに等しいことを確認する．
+ */
+TEST_F(PageAllocatorTest, None) {
+  sbf::PageAllocator<std::uint64_t> lhs;
+  sbf::PageAllocator<char> rhs;
+  EXPECT_EQ(sbf::HugePages::kNone, lhs.Request());
+  EXPECT_EQ(sbf::BasePageSize(), lhs.PageSize());
+  EXPECT_TRUE(lhs == sbf::PageAllocator<std::uint64_t>(rhs));
+
+  sbf::PageAllocator<std::uint64_t> huge(sbf::HugePages::k2MB);
+  EXPECT_TRUE(huge == huge);
+  EXPECT_TRUE(huge != sbf::PageAllocator<std::uint64_t>(sbf::HugePages::k2MB));
+
+  // huge page を確保できない環境では通常のページで代替する．
+  std::uint64_t* p = huge.allocate(1024);
+  std::size_t page_size = huge.MappingPageSize(p);
+  EXPECT_TRUE(page_size == sbf::BasePageSize() || page_size == (std::size_t{1} << 21));
+  huge.deallocate(p, 1024);
+  EXPECT_EQ(sbf::BasePageSize(), lhs.MappingPageSize(nullptr));
+}
+
+/**
+ * 境界に揃っていない範囲を0で埋め，範囲外は変えないことを確認する．<br>
+ * ページを返却する大きさと，複数スレッドで memset する大きさを含む．<br>
+ * 範囲より大きなページのサイズを与えた場合も，返却せずに0で埋める．
+ */
+TEST_F(PageAllocatorTest, ZeroPages) {
+  for (auto request : {sbf::HugePages::kNone, sbf::HugePages::kTransparent}) {
+    for (std::size_t size : {std::size_t{100}, std::size_t{1} << 22, sbf::kLazyZeroThreshold + 4097}) {
+      // 0 は ZeroPages()，それ以外は ZeroMappedPages() に与えるページのサイズ．
+      // 2MB と 1GB は huge page のサイズに揃えた範囲のみを返却する場合を確かめる．
+      for (std::size_t page_size : {std::size_t{0}, sbf::BasePageSize(),
+          std::size_t{1} << 21, std::size_t{1} << 30}) {
+        sbf::PageAllocator<char> allocator(request);
+        std::vector<char, sbf::PageAllocator<char>> bytes(size + 2, 1, allocator);
+        if (page_size == 0) {
+          sbf::ZeroPages(bytes.data() + 1, size, 4);
+        }
+        else {
+          sbf::ZeroMappedPages(bytes.data() + 1, size, page_size, 4);
+        }
+        EXPECT_EQ(1, bytes.front());
+        EXPECT_EQ(1, bytes.back());
+        EXPECT_EQ(size, static_cast<std::size_t>(
+          std::count(bytes.begin() + 1, bytes.end() - 1, 0)));
+      }
+    }
+  }
+}
+
+} // namespace
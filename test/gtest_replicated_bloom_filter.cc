@@ -0,0 +1,100 @@
+/**
+ * @file gtest_replicated_bloom_filter.cc
+ * @brief NUMA ノードごとに複製を持つ Bloom filter に対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/numa.h"
+#include "simplebf/replicated_bloom_filter.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * NUMA ノードごとに複製を持つ Bloom filter のテストケース．
+ */
+class ReplicatedBloomFilterTest : public ::testing::Test {
+};
+
+/**
+ * 全複製の判定結果が BloomFilter と一致することを確認する．
+ */
+TEST_F(ReplicatedBloomFilterTest, SameAsBloomFilter) {
+  sbf::ReplicatedBloomFilter<std::string> rbf(12, 5, 3);
+  sbf::BloomFilter<std::string> bf(12, 5);
+  EXPECT_EQ(3u, rbf.NumReplicas());
+  EXPECT_LT(rbf.LocalReplica(), rbf.NumReplicas());
+  for (int i = 0; i < 300; i++) {
+    rbf.Insert(std::to_string(i));
+    bf.Insert(std::to_string(i));
+  }
+  EXPECT_EQ(300u, rbf.Size());
+
+  for (int i = 0; i < 1000; i++) {
+    std::string entry = std::to_string(i);
+    EXPECT_EQ(bf.Contains(entry), rbf.Contains(entry));
+    EXPECT_EQ(bf.Contains(entry), rbf.Contains(std::string_view(entry)));
+    for (std::size_t r = 0; r < rbf.NumReplicas(); r++) {
+      EXPECT_EQ(bf.Contains(entry), rbf.Contains(rbf.HashKey(entry), r));
+    }
+  }
+}
+
+/**
+ * 既定ではノード数だけ複製を持ち，BloomFilter の内容を追加できることを確認する．
+ */
+TEST_F(ReplicatedBloomFilterTest, AddFilter) {
+  sbf::ReplicatedBloomFilter<int> rbf(10, 3);
+  EXPECT_EQ(sbf::numa::NumNodes(), rbf.NumReplicas());
+  EXPECT_LE(rbf.NumPinnedReplicas(), rbf.NumReplicas());
+
+  sbf::BloomFilter<int> bf(10, 3);
+  for (int i = 0; i < 50; i++) {
+    bf.Insert(i);
+  }
+  EXPECT_TRUE(rbf.AddFilter(bf));
+  EXPECT_EQ(50u, rbf.Size());
+  for (int i = 0; i < 50; i++) {
+    EXPECT_TRUE(rbf.Contains(i));
+  }
+  EXPECT_FALSE(rbf.AddFilter(sbf::BloomFilter<int>(11, 3)));
+}
+
+/**
+ * 複数スレッドから同時に追加した要素がすべての複製で含まれると判定されることを確認する．
+ */
+TEST_F(ReplicatedBloomFilterTest, MultiThread) {
+  sbf::ReplicatedBloomFilter<int> rbf(16, 4, 2);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&rbf, t]() {
+      for (int i = 0; i < 1000; i++) {
+        rbf.Insert(t * 1000 + i);
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(4000u, rbf.Size());
+  for (int i = 0; i < 4000; i++) {
+    EXPECT_TRUE(rbf.Contains(rbf.HashKey(i), 0));
+    EXPECT_TRUE(rbf.Contains(rbf.HashKey(i), 1));
+  }
+}
+
+/**
+ * パラメータが不正の場合にエラーとわかることを確認する．
+ */
+TEST_F(ReplicatedBloomFilterTest, ErrorParameters) {
+  using bf_t = sbf::ReplicatedBloomFilter<int>;
+  bf_t rbf(2, 0, 0);
+  EXPECT_TRUE((rbf.ParameterErrorFlags() & bf_t::kHasNumHashesError) != 0);
+  EXPECT_EQ(1u, rbf.NumHashes());
+  EXPECT_EQ(1u, rbf.NumReplicas());
+}
+
+} // namespace
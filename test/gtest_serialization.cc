@@ -0,0 +1,391 @@
+/**
+ * @file gtest_serialization.cc
+ * @brief Bloom filter のファイル入出力に対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/serialization.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+
+namespace {
+
+/**
+ * Bloom filter のファイル入出力のテストケース．
+ */
+class SerializationTest : public ::testing::Test {
+protected:
+  /**
+   * 一時ファイルのパスを返す．
+   *
+   * @param[in] name ファイル名
+   * @return 一時ファイルのパス
+   */
+  std::string TempPath(const std::string& name) {
+    std::string path = ::testing::TempDir() + name;
+    paths_.push_back(path);
+    return path;
+  }
+
+  /** 一時ファイルを削除する． */
+  void TearDown() override {
+    for (auto&& path : paths_) {
+      std::remove(path.c_str());
+    }
+  }
+
+  /**
+   * フィルタをファイルに書き出す．
+   *
+   * @param[in] bf フィルタ
+   * @param[in] path ファイルのパス
+   */
+  void SaveToFile(const sbf::BloomFilter<std::string>& bf, const std::string& path) {
+    std::ofstream ofs(path, std::ios::binary);
+    ASSERT_TRUE(bf.Save(ofs));
+  }
+
+  /**
+   * ファイルを置き換えるための一時ファイル (path + ".XXXXXX") が残っている個数を返す．
+   *
+   * @param[in] path 置き換えたファイルのパス
+   * @return 一時ファイルの個数
+   */
+  static std::size_t NumTemporaryFiles(const std::string& path) {
+    std::size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    std::string prefix = path.substr(slash == std::string::npos ? 0 : slash + 1) + ".";
+    std::size_t count = 0;
+    DIR* dir = ::opendir(directory.c_str());
+    if (dir == nullptr) {
+      return 0;
+    }
+    while (const struct dirent* entry = ::readdir(dir)) {
+      std::string name = entry->d_name;
+      count += name.size() == prefix.size() + 6 && name.compare(0, prefix.size(), prefix) == 0;
+    }
+    ::closedir(dir);
+    return count;
+  }
+
+  /** 一時ファイルのパス． */
+  std::vector<std::string> paths_;
+};
+
+/**
+ * ヘッダを書き出して読み込めることを確認する．
+ */
+TEST_F(SerializationTest, Header) {
+  sbf::FilterHeader header;
+  header.log2_num_bits = 20;
+  header.num_hashes = 7;
+  header.size = 12345;
+
+  std::stringstream ss;
+  ASSERT_TRUE(sbf::WriteFilterHeader(ss, header));
+  EXPECT_EQ(sbf::kFilterHeaderSize, ss.str().size());
+
+  sbf::FilterHeader actual;
+  ASSERT_TRUE(sbf::ReadFilterHeader(ss, actual));
+  EXPECT_EQ(sbf::kFilterFormatVersion, actual.version);
+  EXPECT_EQ(20, actual.log2_num_bits);
+  EXPECT_EQ(7, actual.num_hashes);
+  EXPECT_EQ(12345, actual.size);
+  EXPECT_EQ(16384, actual.NumWords());
+}
+
+/**
+ * マジックナンバーが一致しない場合に読み込めないことを確認する．
+ */
+TEST_F(SerializationTest, InvalidMagic) {
+  std::stringstream ss(std::string(sbf::kFilterHeaderSize, 'x'));
+  sbf::FilterHeader header;
+  EXPECT_FALSE(sbf::ReadFilterHeader(ss, header));
+}
+
+/**
+ * フィルタを書き出して読み込むと同じ判定結果になることを確認する．
+ */
+TEST_F(SerializationTest, SaveLoad) {
+  sbf::BloomFilter<std::string> bf(12, 4);
+  bf.Insert("a");
+  bf.Insert("b");
+  std::stringstream ss;
+  ASSERT_TRUE(bf.Save(ss));
+  EXPECT_EQ(sbf::kFilterHeaderSize + bf.NumWords() * 8, ss.str().size());
+
+  sbf::BloomFilter<std::string> loaded;
+  ASSERT_TRUE(loaded.Load(ss));
+  EXPECT_EQ(bf.NumBits(), loaded.NumBits());
+  EXPECT_EQ(bf.NumHashes(), loaded.NumHashes());
+  EXPECT_EQ(2, loaded.Size());
+  EXPECT_TRUE(loaded.Contains("a"));
+  EXPECT_TRUE(loaded.Contains("b"));
+  EXPECT_FALSE(loaded.Contains("c"));
+}
+
+/**
+ * 途中で切れたファイルを読み込めないことを確認する．
+ */
+TEST_F(SerializationTest, Truncated) {
+  sbf::BloomFilter<std::string> bf(12, 4);
+  std::stringstream ss;
+  ASSERT_TRUE(bf.Save(ss));
+  std::stringstream truncated(ss.str().substr(0, ss.str().size() - 1));
+  sbf::BloomFilter<std::string> loaded;
+  EXPECT_FALSE(loaded.Load(truncated));
+}
+
+/**
+ * 複数のファイルを統合したフィルタがすべての要素を含むことを確認する．
+ */
+TEST_F(SerializationTest, Merge) {
+  // 一度に処理する単位より大きいフィルタを使う．
+  sbf::BloomFilter<std::string> bf0(20, 3);
+  sbf::BloomFilter<std::string> bf1(20, 3);
+  for (int i = 0; i < 100; i++) {
+    bf0.Insert("a" + std::to_string(i));
+    bf1.Insert("b" + std::to_string(i));
+  }
+  std::string path0 = TempPath("gtest_serialization0.sbf");
+  std::string path1 = TempPath("gtest_serialization1.sbf");
+  std::string merged_path = TempPath("gtest_serialization_merged.sbf");
+  SaveToFile(bf0, path0);
+  SaveToFile(bf1, path1);
+
+  ASSERT_TRUE(sbf::MergeFilterFiles({path0, path1}, merged_path));
+  sbf::BloomFilter<std::string> merged;
+  std::ifstream ifs(merged_path, std::ios::binary);
+  ASSERT_TRUE(merged.Load(ifs));
+  EXPECT_EQ(200, merged.Size());
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(merged.Contains("a" + std::to_string(i)));
+    EXPECT_TRUE(merged.Contains("b" + std::to_string(i)));
+  }
+
+  // 立っているビット数は各フィルタのビット数の合計以下となる．
+  sbf::FilterHeader header;
+  std::uint64_t num_set_bits = 0;
+  std::uint64_t num_set_bits0 = 0;
+  ASSERT_TRUE(sbf::ReadFilterStats(merged_path, header, num_set_bits));
+  ASSERT_TRUE(sbf::ReadFilterStats(path0, header, num_set_bits0));
+  EXPECT_GT(num_set_bits, num_set_bits0);
+  EXPECT_LE(num_set_bits, 600);
+}
+
+/**
+ * パラメータが異なるファイルを統合できないことを確認する．
+ */
+TEST_F(SerializationTest, MergeMismatch) {
+  std::string path0 = TempPath("gtest_serialization0.sbf");
+  std::string path1 = TempPath("gtest_serialization1.sbf");
+  SaveToFile(sbf::BloomFilter<std::string>(10, 3), path0);
+  SaveToFile(sbf::BloomFilter<std::string>(11, 3), path1);
+  EXPECT_FALSE(sbf::MergeFilterFiles({path0, path1},
+    TempPath("gtest_serialization_merged.sbf")));
+}
+
+/**
+ * 同じファイルへの置き換えが重なっても互いの一時ファイルを壊さないことと，
+ * 書き出しに失敗した場合はファイルを変更しないことを確認する．
+ */
+TEST_F(SerializationTest, ReplaceFile) {
+  std::string path = TempPath("gtest_serialization_replace.txt");
+  ASSERT_TRUE(sbf::ReplaceFile(path, [&path](std::ostream& outer) {
+    outer << "outer";
+    // 書き出しの途中で同じファイルを置き換える．
+    return sbf::ReplaceFile(path, [](std::ostream& inner) {
+      return static_cast<bool>(inner << "inner");
+    }) && outer.good();
+  }));
+  std::string content;
+  std::ifstream(path) >> content;
+  EXPECT_EQ("outer", content);
+
+  EXPECT_FALSE(sbf::ReplaceFile(path, [](std::ostream& out) {
+    out << "partial";
+    return false;
+  }));
+  std::ifstream(path) >> content;
+  EXPECT_EQ("outer", content);
+  EXPECT_EQ(0u, NumTemporaryFiles(path));
+}
+
+/**
+ * 入力ファイルの1個を出力ファイルとして統合できることと，失敗した場合は出力ファイルを変更しないことを確認する．
+ */
+TEST_F(SerializationTest, MergeInPlace) {
+  sbf::BloomFilter<std::string> bf0(20, 3);
+  sbf::BloomFilter<std::string> bf1(20, 3);
+  for (int i = 0; i < 100; i++) {
+    bf0.Insert("a" + std::to_string(i));
+    bf1.Insert("b" + std::to_string(i));
+  }
+  std::string path0 = TempPath("gtest_serialization0.sbf");
+  std::string path1 = TempPath("gtest_serialization1.sbf");
+  SaveToFile(bf0, path0);
+  SaveToFile(bf1, path1);
+
+  ASSERT_TRUE(sbf::MergeFilterFiles({path0, path1}, path0));
+  sbf::BloomFilter<std::string> merged;
+  {
+    std::ifstream ifs(path0, std::ios::binary);
+    ASSERT_TRUE(merged.Load(ifs));
+  }
+  EXPECT_EQ(200, merged.Size());
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(merged.Contains("a" + std::to_string(i)));
+    EXPECT_TRUE(merged.Contains("b" + std::to_string(i)));
+  }
+  EXPECT_EQ(0u, NumTemporaryFiles(path0));
+
+  // 途中で読み込みに失敗する入力ファイル．
+  std::stringstream ss;
+  ASSERT_TRUE(bf1.Save(ss));
+  {
+    std::ofstream ofs(path1, std::ios::binary);
+    ofs << ss.str().substr(0, ss.str().size() / 2);
+  }
+  EXPECT_FALSE(sbf::MergeFilterFiles({path0, path1}, path0));
+  EXPECT_EQ(0u, NumTemporaryFiles(path0));
+  sbf::BloomFilter<std::string> unchanged;
+  std::ifstream ifs(path0, std::ios::binary);
+  ASSERT_TRUE(unchanged.Load(ifs));
+  EXPECT_EQ(200, unchanged.Size());
+}
+
+/**
+ * 圧縮して書き出したフィルタを読み込むと同じ配列になることを確認する．
+ */
+TEST_F(SerializationTest, SaveLoadCompressed) {
+  // 空，疎，密なフィルタと 64 ビット未満のフィルタを対象とする．
+  for (auto [log2_num_bits, num_entries] : {std::pair<int, int>{16, 0}, {16, 100},
+      {20, 3000}, {16, 20000}, {5, 3}}) {
+    sbf::BloomFilter<int> bf(log2_num_bits, 3);
+    for (int i = 0; i < num_entries; i++) {
+      bf.Insert(i);
+    }
+    std::stringstream ss;
+    ASSERT_TRUE(bf.SaveCompressed(ss));
+    EXPECT_EQ(bf.CompressedSize(), ss.str().size());
+
+    sbf::BloomFilter<int> loaded;
+    ASSERT_TRUE(loaded.Load(ss));
+    EXPECT_EQ(bf.NumBits(), loaded.NumBits());
+    EXPECT_EQ(bf.NumHashes(), loaded.NumHashes());
+    EXPECT_EQ(bf.Size(), loaded.Size());
+    EXPECT_TRUE(std::equal(bf.Data(), bf.Data() + bf.NumWords(), loaded.Data()));
+  }
+}
+
+/**
+ * 疎なフィルタが圧縮で小さくなることを確認する．
+ */
+TEST_F(SerializationTest, CompressedSize) {
+  sbf::BloomFilter<int> bf(20, 4);
+  for (int i = 0; i < 10000; i++) {
+    bf.Insert(i);
+  }
+  std::size_t raw_size = sbf::kFilterHeaderSize + bf.NumWords() * 8;
+  EXPECT_LT(bf.CompressedSize() * 3, raw_size);
+}
+
+/**
+ * 途中で切れた圧縮ファイルを読み込めないことを確認する．
+ */
+TEST_F(SerializationTest, TruncatedCompressed) {
+  sbf::BloomFilter<int> bf(16, 3);
+  for (int i = 0; i < 1000; i++) {
+    bf.Insert(i);
+  }
+  std::stringstream ss;
+  ASSERT_TRUE(bf.SaveCompressed(ss));
+  std::stringstream truncated(ss.str().substr(0, ss.str().size() - 16));
+  sbf::BloomFilter<int> loaded;
+  EXPECT_FALSE(loaded.Load(truncated));
+}
+
+/**
+ * 圧縮したファイルと圧縮していないファイルを統合できることを確認する．
+ */
+TEST_F(SerializationTest, MergeCompressed) {
+  sbf::BloomFilter<std::string> bf0(20, 3);
+  sbf::BloomFilter<std::string> bf1(20, 3);
+  for (int i = 0; i < 100; i++) {
+    bf0.Insert("a" + std::to_string(i));
+    bf1.Insert("b" + std::to_string(i));
+  }
+  std::string path0 = TempPath("gtest_serialization0.sbf");
+  std::string path1 = TempPath("gtest_serialization1.sbf");
+  std::string merged_path = TempPath("gtest_serialization_merged.sbf");
+  {
+    std::ofstream ofs(path0, std::ios::binary);
+    ASSERT_TRUE(bf0.SaveCompressed(ofs));
+  }
+  SaveToFile(bf1, path1);
+
+  ASSERT_TRUE(sbf::MergeFilterFiles({path0, path1}, merged_path));
+  sbf::BloomFilter<std::string> merged;
+  std::ifstream ifs(merged_path, std::ios::binary);
+  ASSERT_TRUE(merged.Load(ifs));
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(merged.Contains("a" + std::to_string(i)));
+    EXPECT_TRUE(merged.Contains("b" + std::to_string(i)));
+  }
+
+  // 圧縮したファイルの立っているビット数は格納された値を返す．
+  sbf::FilterHeader header;
+  std::uint64_t num_set_bits = 0;
+  ASSERT_TRUE(sbf::ReadFilterStats(path0, header, num_set_bits));
+  EXPECT_EQ(sbf::kFilterFlagCompressed, header.flags);
+  EXPECT_EQ(static_cast<std::uint64_t>(bf0.FillRatio() * bf0.NumBits() + 0.5), num_set_bits);
+}
+
+/**
+ * フィルタ用配列を埋め込むヘッダファイルを書き出せることを確認する．
+ */
+TEST_F(SerializationTest, WriteFilterSource) {
+  sbf::BloomFilter<std::string> bf(9, 4);
+  for (int i = 0; i < 30; i++) {
+    bf.Insert(std::to_string(i));
+  }
+  sbf::FilterHeader header;
+  header.log2_num_bits = bf.Log2NumBits();
+  header.num_hashes = bf.NumHashes();
+  header.size = bf.Size();
+
+  std::ostringstream oss;
+  ASSERT_TRUE(sbf::WriteFilterSource(oss, header, bf.Data(), "kBlocklist",
+    "app::data", "std::string"));
+  std::string source = oss.str();
+  EXPECT_NE(std::string::npos, source.find("#ifndef SIMPLEBF_EMBEDDED_APP_DATA_KBLOCKLIST_H_"));
+  EXPECT_NE(std::string::npos, source.find("namespace app {\nnamespace data {"));
+  EXPECT_NE(std::string::npos, source.find(
+    "alignas(64) inline constexpr std::uint64_t kBlocklistWords[8] = {"));
+  EXPECT_NE(std::string::npos, source.find(
+    "inline constexpr sbf::BloomFilterView<std::string> kBlocklist(\n"
+    "  kBlocklistWords, 9, 4, 30);"));
+
+  // 書き出した配列の値を読み直すと元の配列と一致する．
+  std::vector<std::uint64_t> words;
+  for (std::size_t pos = source.find("0x"); pos != std::string::npos;
+      pos = source.find("0x", pos + 1)) {
+    words.push_back(std::stoull(source.substr(pos, 18), nullptr, 16));
+  }
+  ASSERT_EQ(bf.NumWords(), words.size());
+  EXPECT_TRUE(std::equal(words.begin(), words.end(), bf.Data()));
+
+  // 識別子として使えない名前は書き出さない．
+  EXPECT_FALSE(sbf::WriteFilterSource(oss, header, bf.Data(), "1st", "", "int"));
+  EXPECT_FALSE(sbf::WriteFilterSource(oss, header, bf.Data(), "kFilter", "a::", "int"));
+  EXPECT_FALSE(sbf::WriteFilterSource(oss, header, bf.Data(), "kFilter", "", ""));
+}
+
+} // namespace
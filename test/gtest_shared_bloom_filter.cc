@@ -0,0 +1,157 @@
+/**
+ * @file gtest_shared_bloom_filter.cc
+ * @brief 共有メモリ上の Bloom filter に対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/shared_bloom_filter.h"
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * 共有メモリ上の Bloom filter のテストケース．
+ */
+class SharedBloomFilterTest : public ::testing::Test {
+protected:
+  /** テストごとに異なる共有メモリの名前を設定する． */
+  void SetUp() override {
+    name_ = "/gtest_simplebf_" + std::to_string(::getpid());
+    sbf::SharedBloomFilter<std::string>::Remove(name_);
+  }
+
+  /** 共有メモリを削除する． */
+  void TearDown() override {
+    sbf::SharedBloomFilter<std::string>::Remove(name_);
+  }
+
+  /** 共有メモリの名前． */
+  std::string name_;
+};
+
+/**
+ * 書き込み側の追加が読み込み側から見え，BloomFilter と同じ判定となることを確認する．
+ */
+TEST_F(SharedBloomFilterTest, WriterAndReader) {
+  sbf::SharedBloomFilter<std::string> writer;
+  ASSERT_TRUE(writer.Create(name_, 12, 5));
+  EXPECT_TRUE(writer.IsWritable());
+
+  sbf::SharedBloomFilter<std::string> reader;
+  ASSERT_TRUE(reader.Open(name_));
+  EXPECT_FALSE(reader.IsWritable());
+  EXPECT_EQ(4096u, reader.NumBits());
+  EXPECT_EQ(5u, reader.NumHashes());
+
+  sbf::BloomFilter<std::string> bf(12, 5);
+  for (int i = 0; i < 200; i++) {
+    writer.Insert(std::to_string(i));
+    bf.Insert(std::to_string(i));
+  }
+  EXPECT_EQ(200u, reader.Size());
+  for (int i = 0; i < 1000; i++) {
+    std::string entry = std::to_string(i);
+    EXPECT_EQ(bf.Contains(entry), reader.Contains(entry));
+    EXPECT_EQ(bf.Contains(entry), reader.Contains(std::string_view(entry)));
+  }
+
+  // 同じ名前では作成できない
+  sbf::SharedBloomFilter<std::string> other;
+  EXPECT_FALSE(other.Create(name_, 12, 5));
+}
+
+/**
+ * 別のプロセスから判定できることを確認する．
+ */
+TEST_F(SharedBloomFilterTest, AcrossProcesses) {
+  sbf::SharedBloomFilter<std::string> writer;
+  ASSERT_TRUE(writer.Create(name_, 16, 4));
+  writer.Insert("alpha");
+
+  pid_t pid = ::fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    sbf::SharedBloomFilter<std::string> reader;
+    bool ok = reader.Open(name_) && reader.Contains("alpha") && !reader.Contains("beta");
+    ::_exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(pid, ::waitpid(pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+/**
+ * 内容を置き換えると世代番号が進むことを確認する．
+ */
+TEST_F(SharedBloomFilterTest, Generation) {
+  sbf::SharedBloomFilter<std::string> writer;
+  ASSERT_TRUE(writer.Create(name_, 10, 3));
+  sbf::SharedBloomFilter<std::string> reader;
+  ASSERT_TRUE(reader.Open(name_));
+  EXPECT_EQ(0u, reader.Generation());
+
+  writer.Insert("alpha");
+  EXPECT_EQ(0u, reader.Generation());
+  std::uint64_t generation = reader.Generation();
+  EXPECT_TRUE(reader.Contains("alpha"));
+  EXPECT_TRUE(reader.Validate(generation));
+  EXPECT_TRUE(writer.Clear());
+  EXPECT_FALSE(reader.Validate(generation));
+  EXPECT_FALSE(reader.Validate(1));
+  EXPECT_EQ(2u, reader.Generation());
+  EXPECT_TRUE(reader.Validate(reader.Generation()));
+  EXPECT_EQ(0u, reader.Size());
+  EXPECT_FALSE(reader.Contains("alpha"));
+
+  sbf::BloomFilter<std::string> bf(10, 3);
+  bf.Insert("beta");
+  EXPECT_TRUE(writer.CopyFrom(bf));
+  EXPECT_EQ(4u, reader.Generation());
+  EXPECT_EQ(1u, reader.Size());
+  EXPECT_TRUE(reader.Contains("beta"));
+
+  // パラメータが異なるフィルタや読み込み側からは置き換えられない
+  EXPECT_FALSE(writer.CopyFrom(sbf::BloomFilter<std::string>(11, 3)));
+  EXPECT_FALSE(reader.CopyFrom(bf));
+}
+
+/**
+ * 読み込み専用のマッピングをもつ読み込み側や，開いていないフィルタからは変更できないことを確認する．
+ */
+TEST_F(SharedBloomFilterTest, ReadOnly) {
+  sbf::SharedBloomFilter<std::string> writer;
+  ASSERT_TRUE(writer.Create(name_, 10, 3));
+  EXPECT_TRUE(writer.Insert("alpha"));
+  sbf::SharedBloomFilter<std::string> reader;
+  ASSERT_TRUE(reader.Open(name_));
+  EXPECT_FALSE(reader.IsWritable());
+
+  EXPECT_FALSE(reader.Insert("beta"));
+  EXPECT_FALSE(reader.Clear());
+  EXPECT_EQ(1u, reader.Size());
+  EXPECT_EQ(0u, reader.Generation());
+  EXPECT_TRUE(reader.Contains("alpha"));
+
+  sbf::SharedBloomFilter<std::string> closed;
+  EXPECT_FALSE(closed.Insert("alpha"));
+  EXPECT_FALSE(closed.Clear());
+}
+
+/**
+ * 作成時のパラメータが不正の場合や共有メモリが存在しない場合に失敗することを確認する．
+ */
+TEST_F(SharedBloomFilterTest, Errors) {
+  using bf_t = sbf::SharedBloomFilter<std::string>;
+  bf_t bf;
+  EXPECT_FALSE(bf.Create(name_, 34, 0));
+  EXPECT_TRUE((bf.ParameterErrorFlags() & bf_t::kHasLog2NumBitsError) != 0);
+  EXPECT_TRUE((bf.ParameterErrorFlags() & bf_t::kHasNumHashesError) != 0);
+  EXPECT_FALSE(bf.IsOpen());
+  EXPECT_FALSE(bf.Open(name_));
+}
+
+} // namespace
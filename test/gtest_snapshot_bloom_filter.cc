@@ -0,0 +1,167 @@
+/**
+ * @file gtest_snapshot_bloom_filter.cc
+ * @brief 追加を止めずにスナップショットを取れる Bloom filter 用クラスに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/snapshot_bloom_filter.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+namespace {
+
+/**
+ * 追加を止めずにスナップショットを取れる Bloom filter 用クラスのテストケース．
+ */
+class SnapshotBloomFilterTest : public ::testing::Test {
+protected:
+  /**
+   * スナップショットを BloomFilter に読み込む．
+   *
+   * @param[in] snapshot スナップショット
+   * @param[out] bf 読み込む Bloom filter
+   * @return 読み込めた場合は true
+   */
+  static bool ToBloomFilter(const sbf::BloomFilterSnapshot<std::string>& snapshot,
+      sbf::BloomFilter<std::string>& bf) {
+    std::stringstream ss;
+    return snapshot.Save(ss) && bf.Load(ss);
+  }
+};
+
+/**
+ * BloomFilter と同じビットが立ち，同じ判定結果となることを確認する．
+ */
+TEST_F(SnapshotBloomFilterTest, SameAsBloomFilter) {
+  for (std::size_t log2_num_bits : {8, 20}) {
+    sbf::SnapshotBloomFilter<std::string> bf(log2_num_bits, 4);
+    sbf::BloomFilter<std::string> expected(log2_num_bits, 4);
+    EXPECT_FALSE(bf.HasParameterError());
+    EXPECT_EQ(0u, bf.NumAllocatedPages());
+    for (int i = 0; i < 1000; i++) {
+      bf.Insert(std::to_string(i));
+      expected.Insert(std::to_string(i));
+    }
+    for (int i = 0; i < 2000; i++) {
+      EXPECT_EQ(expected.Contains(std::to_string(i)), bf.Contains(std::to_string(i)));
+    }
+
+    sbf::BloomFilter<std::string> loaded;
+    ASSERT_TRUE(ToBloomFilter(bf.Snapshot(), loaded));
+    EXPECT_EQ(1000u, loaded.Size());
+    ASSERT_EQ(expected.NumWords(), loaded.NumWords());
+    EXPECT_TRUE(std::equal(expected.Data(), expected.Data() + expected.NumWords(),
+      loaded.Data()));
+  }
+}
+
+/**
+ * スナップショットが取得後の追加の影響を受けず，共有中のページのみを1回ずつ複製することを確認する．
+ */
+TEST_F(SnapshotBloomFilterTest, CopyOnWrite) {
+  // 64ページのフィルタ．
+  sbf::SnapshotBloomFilter<std::string> bf(25, 1);
+  ASSERT_EQ(64u, bf.NumPages());
+  bf.Insert("a");
+  EXPECT_EQ(1u, bf.NumAllocatedPages());
+
+  auto snapshot = bf.Snapshot();
+  EXPECT_EQ(0u, bf.NumCopiedPages());
+  for (int i = 0; i < 1000; i++) {
+    bf.Insert(std::to_string(i));
+  }
+  // 共有していたのは "a" を追加したページのみ．
+  EXPECT_EQ(1u, bf.NumCopiedPages());
+  EXPECT_EQ(64u, bf.NumAllocatedPages());
+  EXPECT_TRUE(snapshot.Contains("a"));
+  EXPECT_EQ(1u, snapshot.Size());
+  int contained = 0;
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(bf.Contains(std::to_string(i)));
+    contained += snapshot.Contains(std::to_string(i));
+  }
+  EXPECT_LT(contained, 10);
+
+  // スナップショットを破棄した後は複製しない．
+  auto second = bf.Snapshot();
+  { auto discarded = std::move(second); }
+  bf.Insert("b");
+  EXPECT_EQ(1u, bf.NumCopiedPages());
+
+  // 共有中は書き込んだページのみを複製する．
+  auto third = bf.Snapshot();
+  bf.Insert("c");
+  bf.Insert("c");
+  EXPECT_EQ(2u, bf.NumCopiedPages());
+  EXPECT_FALSE(third.Contains("c"));
+  EXPECT_TRUE(bf.Contains("c"));
+}
+
+/**
+ * 追加を続けながら別のスレッドでスナップショットを書き出せることを確認する．
+ */
+TEST_F(SnapshotBloomFilterTest, SaveAsync) {
+  std::string path = ::testing::TempDir() + "snapshot_bloom_filter.bin";
+  sbf::SnapshotBloomFilter<std::string> bf(24, 4);
+  sbf::BloomFilter<std::string> expected(24, 4);
+  for (int i = 0; i < 10000; i++) {
+    bf.Insert(std::to_string(i));
+    expected.Insert(std::to_string(i));
+  }
+
+  auto saved = bf.Snapshot().SaveAsync(path);
+  for (int i = 10000; i < 100000; i++) {
+    bf.Insert(std::to_string(i));
+  }
+  ASSERT_TRUE(saved.get());
+
+  sbf::BloomFilter<std::string> loaded;
+  std::ifstream in(path, std::ios::binary);
+  ASSERT_TRUE(loaded.Load(in));
+  EXPECT_EQ(10000u, loaded.Size());
+  EXPECT_TRUE(std::equal(expected.Data(), expected.Data() + expected.NumWords(),
+    loaded.Data()));
+
+  // 以前のスナップショットは切り詰めずに，一時ファイルの名前を変更して置き換える．
+  struct stat status;
+  ASSERT_EQ(0, ::stat(path.c_str(), &status));
+  ASSERT_TRUE(bf.Snapshot().SaveAsync(path).get());
+  struct stat replaced;
+  ASSERT_EQ(0, ::stat(path.c_str(), &replaced));
+  EXPECT_NE(status.st_ino, replaced.st_ino);
+  std::ifstream replaced_in(path, std::ios::binary);
+  ASSERT_TRUE(loaded.Load(replaced_in));
+  EXPECT_EQ(100000u, loaded.Size());
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(bf.Snapshot().SaveAsync(::testing::TempDir() + "missing/snapshot.bin").get());
+}
+
+/**
+ * BloomFilter の内容を取り込めることと，パラメータエラーを確認する．
+ */
+TEST_F(SnapshotBloomFilterTest, AddFilter) {
+  sbf::BloomFilter<std::string> source(20, 4);
+  source.Insert("a");
+  sbf::SnapshotBloomFilter<std::string> bf(20, 4);
+  EXPECT_TRUE(bf.AddFilter(source));
+  EXPECT_TRUE(bf.Contains("a"));
+  EXPECT_EQ(1u, bf.Size());
+  EXPECT_LE(bf.NumAllocatedPages(), 4u);
+
+  sbf::BloomFilter<std::string> other(19, 4);
+  EXPECT_FALSE(bf.AddFilter(other));
+
+  sbf::SnapshotBloomFilter<std::string> error(34, 0);
+  EXPECT_EQ(33u, error.Log2NumBits());
+  EXPECT_EQ(1u, error.NumHashes());
+  EXPECT_EQ(error.kHasLog2NumBitsError | error.kHasNumHashesError,
+    error.ParameterErrorFlags());
+}
+
+} // namespace
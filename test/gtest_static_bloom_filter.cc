@@ -0,0 +1,78 @@
+/**
+ * @file gtest_static_bloom_filter.cc
+ * @brief パラメータをコンパイル時に固定した Bloom filter に対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/bloom_filter.h"
+#include "simplebf/static_bloom_filter.h"
+#include <algorithm>
+#include <string>
+
+namespace {
+
+/**
+ * コンパイル時に2個の要素を追加したフィルタを返す．
+ *
+ * @return フィルタ
+ */
+constexpr sbf::StaticBloomFilter<int, 10, 3> MakeConstantFilter() {
+  sbf::StaticBloomFilter<int, 10, 3> bf;
+  bf.Insert(sbf::HashedKey{1, 2});
+  bf.Insert(sbf::HashedKey{100, 200});
+  return bf;
+}
+
+/**
+ * パラメータをコンパイル時に固定した Bloom filter のテストケース．
+ */
+class StaticBloomFilterTest : public ::testing::Test {
+};
+
+/**
+ * 同じパラメータの BloomFilter と同じビットが立つことを確認する．
+ */
+TEST_F(StaticBloomFilterTest, SameAsBloomFilter) {
+  sbf::StaticBloomFilter<std::string, 12, 5> fixed;
+  sbf::BloomFilter<std::string> bf(12, 5);
+  for (int i = 0; i < 300; i++) {
+    fixed.Insert(std::to_string(i));
+    bf.Insert(std::to_string(i));
+  }
+  EXPECT_EQ(300u, fixed.Size());
+  EXPECT_EQ(bf.NumWords(), fixed.NumWords());
+  EXPECT_TRUE(std::equal(bf.Data(), bf.Data() + bf.NumWords(), fixed.Data()));
+
+  for (int i = 0; i < 1000; i++) {
+    std::string entry = std::to_string(i);
+    EXPECT_EQ(bf.Contains(entry), fixed.Contains(entry));
+  }
+}
+
+/**
+ * 64ビット未満の配列サイズでも要素の追加・判定ができることを確認する．
+ */
+TEST_F(StaticBloomFilterTest, SmallFilter) {
+  sbf::StaticBloomFilter<int, 3, 2> bf;
+  static_assert(bf.NumBits() == 8);
+  static_assert(bf.NumWords() == 1);
+  bf.Insert(7);
+  EXPECT_TRUE(bf.Contains(7));
+}
+
+/**
+ * コンパイル時にフィルタを構築して判定できることを確認する．
+ */
+TEST_F(StaticBloomFilterTest, Constexpr) {
+  constexpr auto bf = MakeConstantFilter();
+  static_assert(bf.Size() == 2);
+  static_assert(bf.Contains(sbf::HashedKey{1, 2}));
+  static_assert(bf.Contains(sbf::HashedKey{100, 200}));
+
+  sbf::BloomFilter<int> runtime(10, 3);
+  runtime.Insert(sbf::HashedKey{1, 2});
+  runtime.Insert(sbf::HashedKey{100, 200});
+  EXPECT_TRUE(std::equal(runtime.Data(), runtime.Data() + runtime.NumWords(), bf.Data()));
+}
+
+} // namespace
@@ -0,0 +1,53 @@
+/**
+ * @file gtest_striped_counter.cc
+ * @brief 複数スレッドから同時に加算できるカウンタに対するテスト．
+ */
+
+#include <gtest/gtest.h>
+#include "simplebf/striped_counter.h"
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * 複数スレッドから同時に加算できるカウンタのテストケース．
+ */
+class StripedCounterTest : public ::testing::Test {
+};
+
+/**
+ * 加算した値の和を返すことと，0に戻せることを確認する．
+ */
+TEST_F(StripedCounterTest, AddAndReset) {
+  sbf::StripedCounter counter;
+  EXPECT_EQ(0u, counter.Load());
+  counter.Add(1);
+  counter.Add(41);
+  EXPECT_EQ(42u, counter.Load());
+  counter.Reset();
+  EXPECT_EQ(0u, counter.Load());
+}
+
+/**
+ * アトミック変数の個数より多いスレッドから同時に加算しても，加算を失わないことを確認する．
+ */
+TEST_F(StripedCounterTest, MultiThreaded) {
+  constexpr std::size_t kNumThreads = sbf::StripedCounter::kNumStripes + 8;
+  constexpr std::size_t kNumAdds = 10000;
+  sbf::StripedCounter counter;
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&counter]() {
+      for (std::size_t i = 0; i < kNumAdds; i++) {
+        counter.Add(1);
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(kNumThreads * kNumAdds, counter.Load());
+}
+
+} // namespace
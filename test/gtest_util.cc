@@ -5,6 +5,8 @@
 
 #include <gtest/gtest.h>
 #include "simplebf/util.h"
+#include <string>
+#include <string_view>
 
 namespace {
 
@@ -35,6 +37,25 @@ TEST_F(UtilTest, Empty) {
   EXPECT_EQ(expect, actual);
 }
 
+/**
+ * std::string, std::string_view, バイト列で同じハッシュ値になることを確認する．
+ */
+TEST_F(UtilTest, StringViewAndBytes) {
+  std::string str("simplebf");
+  std::string_view view(str);
+  EXPECT_EQ(sbf::hash::Djb2(str), sbf::hash::Djb2(view));
+  EXPECT_EQ(sbf::hash::Djb2(view), sbf::hash::Djb2(str.data(), str.size()));
+  EXPECT_EQ(sbf::hash::Djb2(view.substr(0, 6)), sbf::hash::Djb2("simple"));
+}
+
+/**
+ * 見積もられた偽陽性率が既知の値と一致することを確認する．
+ */
+TEST_F(UtilTest, EstimatedFalsePositiveRate) {
+  EXPECT_NEAR(0.021684, sbf::EstimatedFalsePositiveRate(8192, 5, 1024), 1e-6);
+  EXPECT_DOUBLE_EQ(0.0, sbf::EstimatedFalsePositiveRate(8192, 5, 0));
+}
+
 } // namespace
 
 